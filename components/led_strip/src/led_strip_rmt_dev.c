@@ -3,6 +3,7 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/cdefs.h>
@@ -30,10 +31,14 @@ typedef struct {
     rmt_encoder_handle_t strip_encoder;
     uint32_t strip_len;
     uint8_t bytes_per_pixel;
+    bool is_static; // storage belongs to the caller of led_strip_new_rmt_device_static()
     led_color_component_format_t component_fmt;
+    uint32_t encoder_mem[LED_STRIP_ENCODER_STATIC_SIZE / sizeof(uint32_t)];
     uint8_t pixel_buf[];
 } led_strip_rmt_obj;
 
+_Static_assert(sizeof(led_strip_rmt_obj) <= LED_STRIP_RMT_STATIC_BASE_SIZE, "LED_STRIP_RMT_STATIC_BASE_SIZE too small");
+
 static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -99,15 +104,15 @@ static esp_err_t led_strip_rmt_del(led_strip_t *strip)
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
     ESP_RETURN_ON_ERROR(rmt_del_channel(rmt_strip->rmt_chan), TAG, "delete RMT channel failed");
     ESP_RETURN_ON_ERROR(rmt_del_encoder(rmt_strip->strip_encoder), TAG, "delete strip encoder failed");
-    free(rmt_strip);
+    if (!rmt_strip->is_static) {
+        free(rmt_strip);
+    }
     return ESP_OK;
 }
 
-esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip)
+// check the color component format, filling in the default GRB order if none is given
+static esp_err_t led_strip_rmt_check_format(const led_strip_config_t *led_config, led_color_component_format_t *ret_fmt)
 {
-    led_strip_rmt_obj *rmt_strip = NULL;
-    esp_err_t ret = ESP_OK;
-    ESP_GOTO_ON_FALSE(led_config && rmt_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
     led_color_component_format_t component_fmt = led_config->color_component_format;
     // If R/G/B order is not specified, set default GRB order as fallback
     if (component_fmt.format_id == 0) {
@@ -126,10 +131,15 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     } else {
         ESP_RETURN_ON_FALSE(false, ESP_ERR_INVALID_ARG, TAG, "invalid number of color components: %d", component_fmt.format.num_components);
     }
-    // TODO: we assume each color component is 8 bits, may need to support other configurations in the future, e.g. 10bits per color component?
-    uint8_t bytes_per_pixel = component_fmt.format.num_components;
-    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + led_config->max_leds * bytes_per_pixel);
-    ESP_GOTO_ON_FALSE(rmt_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt strip");
+    *ret_fmt = component_fmt;
+    return ESP_OK;
+}
+
+// set up a zeroed strip object; on failure the channel and the encoder are deleted again
+static esp_err_t led_strip_rmt_init(led_strip_rmt_obj *rmt_strip, const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config,
+                                    led_color_component_format_t component_fmt)
+{
+    esp_err_t ret = ESP_OK;
     uint32_t resolution = rmt_config->resolution_hz ? rmt_config->resolution_hz : LED_STRIP_RMT_DEFAULT_RESOLUTION;
 
     // for backward compatibility, if the user does not set the clk_src, use the default value
@@ -157,28 +167,61 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
         .resolution = resolution,
         .led_model = led_config->led_model
     };
-    ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&strip_encoder_conf, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
+    // the encoder lives inside the strip object, so it needs no allocation of its own
+    ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder_static(&strip_encoder_conf, rmt_strip->encoder_mem, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
 
     rmt_strip->component_fmt = component_fmt;
-    rmt_strip->bytes_per_pixel = bytes_per_pixel;
+    // TODO: we assume each color component is 8 bits, may need to support other configurations in the future, e.g. 10bits per color component?
+    rmt_strip->bytes_per_pixel = component_fmt.format.num_components;
     rmt_strip->strip_len = led_config->max_leds;
     rmt_strip->base.set_pixel = led_strip_rmt_set_pixel;
     rmt_strip->base.set_pixel_rgbw = led_strip_rmt_set_pixel_rgbw;
     rmt_strip->base.refresh = led_strip_rmt_refresh;
     rmt_strip->base.clear = led_strip_rmt_clear;
     rmt_strip->base.del = led_strip_rmt_del;
+    return ESP_OK;
+err:
+    if (rmt_strip->rmt_chan) {
+        rmt_del_channel(rmt_strip->rmt_chan);
+    }
+    if (rmt_strip->strip_encoder) {
+        rmt_del_encoder(rmt_strip->strip_encoder);
+    }
+    return ret;
+}
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip)
+{
+    led_strip_rmt_obj *rmt_strip = NULL;
+    esp_err_t ret = ESP_OK;
+    led_color_component_format_t component_fmt;
+    ESP_GOTO_ON_FALSE(led_config && rmt_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_RETURN_ON_ERROR(led_strip_rmt_check_format(led_config, &component_fmt), TAG, "invalid color component format");
+    uint8_t bytes_per_pixel = component_fmt.format.num_components;
+    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + led_config->max_leds * bytes_per_pixel);
+    ESP_GOTO_ON_FALSE(rmt_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt strip");
+    ESP_GOTO_ON_ERROR(led_strip_rmt_init(rmt_strip, led_config, rmt_config, component_fmt), err, TAG, "init rmt strip failed");
 
     *ret_strip = &rmt_strip->base;
     return ESP_OK;
 err:
-    if (rmt_strip) {
-        if (rmt_strip->rmt_chan) {
-            rmt_del_channel(rmt_strip->rmt_chan);
-        }
-        if (rmt_strip->strip_encoder) {
-            rmt_del_encoder(rmt_strip->strip_encoder);
-        }
-        free(rmt_strip);
-    }
+    free(rmt_strip);
     return ret;
 }
+
+esp_err_t led_strip_new_rmt_device_static(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config,
+                                          void *storage, size_t storage_size, led_strip_handle_t *ret_strip)
+{
+    led_color_component_format_t component_fmt;
+    ESP_RETURN_ON_FALSE(led_config && rmt_config && storage && ret_strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(((uintptr_t)storage & 3) == 0, ESP_ERR_INVALID_ARG, TAG, "storage not 4-byte aligned");
+    ESP_RETURN_ON_ERROR(led_strip_rmt_check_format(led_config, &component_fmt), TAG, "invalid color component format");
+    size_t size = sizeof(led_strip_rmt_obj) + led_config->max_leds * component_fmt.format.num_components;
+    ESP_RETURN_ON_FALSE(storage_size >= size, ESP_ERR_INVALID_ARG, TAG, "storage too small, need %u bytes", (unsigned)size);
+    led_strip_rmt_obj *rmt_strip = memset(storage, 0, size);
+    rmt_strip->is_static = true;
+    ESP_RETURN_ON_ERROR(led_strip_rmt_init(rmt_strip, led_config, rmt_config, component_fmt), TAG, "init rmt strip failed");
+
+    *ret_strip = &rmt_strip->base;
+    return ESP_OK;
+}
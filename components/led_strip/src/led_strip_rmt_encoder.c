@@ -4,6 +4,9 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include "esp_check.h"
 #include "led_strip_rmt_encoder.h"
 
@@ -14,9 +17,12 @@ typedef struct {
     rmt_encoder_t *bytes_encoder;
     rmt_encoder_t *copy_encoder;
     int state;
+    bool is_static; // storage belongs to the caller of rmt_new_led_strip_encoder_static()
     rmt_symbol_word_t reset_code;
 } rmt_led_strip_encoder_t;
 
+_Static_assert(sizeof(rmt_led_strip_encoder_t) <= LED_STRIP_ENCODER_STATIC_SIZE, "LED_STRIP_ENCODER_STATIC_SIZE too small");
+
 static size_t rmt_encode_led_strip(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
 {
     rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
@@ -58,7 +64,9 @@ static esp_err_t rmt_del_led_strip_encoder(rmt_encoder_t *encoder)
     rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
     rmt_del_encoder(led_encoder->bytes_encoder);
     rmt_del_encoder(led_encoder->copy_encoder);
-    free(led_encoder);
+    if (!led_encoder->is_static) {
+        free(led_encoder);
+    }
     return ESP_OK;
 }
 
@@ -71,14 +79,10 @@ static esp_err_t rmt_led_strip_encoder_reset(rmt_encoder_t *encoder)
     return ESP_OK;
 }
 
-esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+// set up a zeroed encoder object; on failure the sub-encoders are deleted again
+static esp_err_t led_strip_encoder_init(rmt_led_strip_encoder_t *led_encoder, const led_strip_encoder_config_t *config)
 {
     esp_err_t ret = ESP_OK;
-    rmt_led_strip_encoder_t *led_encoder = NULL;
-    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
-    ESP_GOTO_ON_FALSE(config->led_model < LED_MODEL_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
-    led_encoder = calloc(1, sizeof(rmt_led_strip_encoder_t));
-    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
     led_encoder->base.encode = rmt_encode_led_strip;
     led_encoder->base.del = rmt_del_led_strip_encoder;
     led_encoder->base.reset = rmt_led_strip_encoder_reset;
@@ -130,17 +134,41 @@ esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rm
         .level1 = 0,
         .duration1 = reset_ticks,
     };
-    *ret_encoder = &led_encoder->base;
     return ESP_OK;
 err:
-    if (led_encoder) {
-        if (led_encoder->bytes_encoder) {
-            rmt_del_encoder(led_encoder->bytes_encoder);
-        }
-        if (led_encoder->copy_encoder) {
-            rmt_del_encoder(led_encoder->copy_encoder);
-        }
-        free(led_encoder);
+    if (led_encoder->bytes_encoder) {
+        rmt_del_encoder(led_encoder->bytes_encoder);
+    }
+    if (led_encoder->copy_encoder) {
+        rmt_del_encoder(led_encoder->copy_encoder);
     }
     return ret;
 }
+
+esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    esp_err_t ret = ESP_OK;
+    rmt_led_strip_encoder_t *led_encoder = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(config->led_model < LED_MODEL_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
+    led_encoder = calloc(1, sizeof(rmt_led_strip_encoder_t));
+    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
+    ESP_GOTO_ON_ERROR(led_strip_encoder_init(led_encoder, config), err, TAG, "init led strip encoder failed");
+    *ret_encoder = &led_encoder->base;
+    return ESP_OK;
+err:
+    free(led_encoder);
+    return ret;
+}
+
+esp_err_t rmt_new_led_strip_encoder_static(const led_strip_encoder_config_t *config, void *storage, rmt_encoder_handle_t *ret_encoder)
+{
+    ESP_RETURN_ON_FALSE(config && storage && ret_encoder, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(config->led_model < LED_MODEL_INVALID, ESP_ERR_INVALID_ARG, TAG, "invalid led model");
+    ESP_RETURN_ON_FALSE(((uintptr_t)storage & 3) == 0, ESP_ERR_INVALID_ARG, TAG, "storage not 4-byte aligned");
+    rmt_led_strip_encoder_t *led_encoder = memset(storage, 0, sizeof(rmt_led_strip_encoder_t));
+    led_encoder->is_static = true;
+    ESP_RETURN_ON_ERROR(led_strip_encoder_init(led_encoder, config), TAG, "init led strip encoder failed");
+    *ret_encoder = &led_encoder->base;
+    return ESP_OK;
+}
@@ -0,0 +1,59 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "driver/rmt_encoder.h"
+#include "led_strip_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Type of led strip encoder configuration
+ */
+typedef struct {
+    uint32_t resolution;   /*!< Encoder resolution, in Hz */
+    led_model_t led_model; /*!< LED model */
+} led_strip_encoder_config_t;
+
+/**
+ * @brief Create RMT encoder for encoding LED strip pixels into RMT symbols
+ *
+ * @param[in] config Encoder configuration
+ * @param[out] ret_encoder Returned encoder handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when creating led strip encoder
+ *      - ESP_OK if creating encoder successfully
+ */
+esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
+
+/**
+ * @brief Bytes of storage rmt_new_led_strip_encoder_static() needs
+ */
+#define LED_STRIP_ENCODER_STATIC_SIZE 48
+
+/**
+ * @brief Create RMT encoder for encoding LED strip pixels into RMT symbols, in caller-provided storage
+ *
+ * @note The bytes and copy encoders it is built on are still allocated by the RMT driver.
+ *       Deleting the encoder releases them but leaves the storage to the caller.
+ *
+ * @param[in] config Encoder configuration
+ * @param[in] storage At least LED_STRIP_ENCODER_STATIC_SIZE bytes, 4-byte aligned, valid until the encoder is deleted
+ * @param[out] ret_encoder Returned encoder handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments, or misaligned storage
+ *      - ESP_ERR_NO_MEM out of memory when creating the bytes or copy encoder
+ *      - ESP_OK if creating encoder successfully
+ */
+esp_err_t rmt_new_led_strip_encoder_static(const led_strip_encoder_config_t *config, void *storage, rmt_encoder_handle_t *ret_encoder);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,12 +3,14 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/cdefs.h>
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_rom_gpio.h"
+#include "esp_memory_utils.h"
 #include "soc/spi_periph.h"
 #include "led_strip.h"
 #include "led_strip_interface.h"
@@ -27,10 +29,13 @@ typedef struct {
     spi_device_handle_t spi_device;
     uint32_t strip_len;
     uint8_t bytes_per_pixel;
+    bool is_static; // storage belongs to the caller of led_strip_new_spi_device_static()
     led_color_component_format_t component_fmt;
     uint8_t pixel_buf[];
 } led_strip_spi_obj;
 
+_Static_assert(sizeof(led_strip_spi_obj) <= LED_STRIP_SPI_STATIC_BASE_SIZE, "LED_STRIP_SPI_STATIC_BASE_SIZE too small");
+
 // please make sure to zero-initialize the buf before calling this function
 static void __led_strip_spi_bit(uint8_t data, uint8_t *buf)
 {
@@ -122,15 +127,15 @@ static esp_err_t led_strip_spi_del(led_strip_t *strip)
     ESP_RETURN_ON_ERROR(spi_bus_remove_device(spi_strip->spi_device), TAG, "delete spi device failed");
     ESP_RETURN_ON_ERROR(spi_bus_free(spi_strip->spi_host), TAG, "free spi bus failed");
 
-    free(spi_strip);
+    if (!spi_strip->is_static) {
+        free(spi_strip);
+    }
     return ESP_OK;
 }
 
-esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const led_strip_spi_config_t *spi_config, led_strip_handle_t *ret_strip)
+// check the color component format, filling in the default GRB order if none is given
+static esp_err_t led_strip_spi_check_format(const led_strip_config_t *led_config, led_color_component_format_t *ret_fmt)
 {
-    led_strip_spi_obj *spi_strip = NULL;
-    esp_err_t ret = ESP_OK;
-    ESP_GOTO_ON_FALSE(led_config && spi_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
     led_color_component_format_t component_fmt = led_config->color_component_format;
     // If R/G/B order is not specified, set default GRB order as fallback
     if (component_fmt.format_id == 0) {
@@ -149,17 +154,17 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
     } else {
         ESP_RETURN_ON_FALSE(false, ESP_ERR_INVALID_ARG, TAG, "invalid number of color components: %d", component_fmt.format.num_components);
     }
+    *ret_fmt = component_fmt;
+    return ESP_OK;
+}
+
+// set up a zeroed strip object; on failure the SPI device and bus are released again
+static esp_err_t led_strip_spi_init(led_strip_spi_obj *spi_strip, const led_strip_config_t *led_config, const led_strip_spi_config_t *spi_config,
+                                    led_color_component_format_t component_fmt)
+{
+    esp_err_t ret = ESP_OK;
     // TODO: we assume each color component is 8 bits, may need to support other configurations in the future, e.g. 10bits per color component?
     uint8_t bytes_per_pixel = component_fmt.format.num_components;
-    uint32_t mem_caps = MALLOC_CAP_DEFAULT;
-    if (spi_config->flags.with_dma) {
-        // DMA buffer must be placed in internal SRAM
-        mem_caps |= MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
-    }
-    spi_strip = heap_caps_calloc(1, sizeof(led_strip_spi_obj) + led_config->max_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE, mem_caps);
-
-    ESP_GOTO_ON_FALSE(spi_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for spi strip");
-
     spi_strip->spi_host = spi_config->spi_bus;
     // for backward compatibility, if the user does not set the clk_src, use the default value
     spi_clock_source_t clk_src = SPI_CLK_SRC_DEFAULT;
@@ -214,17 +219,57 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
     spi_strip->base.clear = led_strip_spi_clear;
     spi_strip->base.del = led_strip_spi_del;
 
-    *ret_strip = &spi_strip->base;
     return ESP_OK;
 err:
-    if (spi_strip) {
-        if (spi_strip->spi_device) {
-            spi_bus_remove_device(spi_strip->spi_device);
-        }
-        if (spi_strip->spi_host) {
-            spi_bus_free(spi_strip->spi_host);
-        }
-        free(spi_strip);
+    if (spi_strip->spi_device) {
+        spi_bus_remove_device(spi_strip->spi_device);
+    }
+    if (spi_strip->spi_host) {
+        spi_bus_free(spi_strip->spi_host);
     }
     return ret;
 }
+
+esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const led_strip_spi_config_t *spi_config, led_strip_handle_t *ret_strip)
+{
+    led_strip_spi_obj *spi_strip = NULL;
+    esp_err_t ret = ESP_OK;
+    led_color_component_format_t component_fmt;
+    ESP_GOTO_ON_FALSE(led_config && spi_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_RETURN_ON_ERROR(led_strip_spi_check_format(led_config, &component_fmt), TAG, "invalid color component format");
+    uint8_t bytes_per_pixel = component_fmt.format.num_components;
+    uint32_t mem_caps = MALLOC_CAP_DEFAULT;
+    if (spi_config->flags.with_dma) {
+        // DMA buffer must be placed in internal SRAM
+        mem_caps |= MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
+    }
+    spi_strip = heap_caps_calloc(1, sizeof(led_strip_spi_obj) + led_config->max_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE, mem_caps);
+
+    ESP_GOTO_ON_FALSE(spi_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for spi strip");
+    ESP_GOTO_ON_ERROR(led_strip_spi_init(spi_strip, led_config, spi_config, component_fmt), err, TAG, "init spi strip failed");
+
+    *ret_strip = &spi_strip->base;
+    return ESP_OK;
+err:
+    free(spi_strip);
+    return ret;
+}
+
+esp_err_t led_strip_new_spi_device_static(const led_strip_config_t *led_config, const led_strip_spi_config_t *spi_config,
+                                          void *storage, size_t storage_size, led_strip_handle_t *ret_strip)
+{
+    led_color_component_format_t component_fmt;
+    ESP_RETURN_ON_FALSE(led_config && spi_config && storage && ret_strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(((uintptr_t)storage & 3) == 0, ESP_ERR_INVALID_ARG, TAG, "storage not 4-byte aligned");
+    // DMA buffer must be placed in internal SRAM
+    ESP_RETURN_ON_FALSE(!spi_config->flags.with_dma || esp_ptr_dma_capable(storage), ESP_ERR_INVALID_ARG, TAG, "storage not DMA capable");
+    ESP_RETURN_ON_ERROR(led_strip_spi_check_format(led_config, &component_fmt), TAG, "invalid color component format");
+    size_t size = sizeof(led_strip_spi_obj) + led_config->max_leds * component_fmt.format.num_components * SPI_BYTES_PER_COLOR_BYTE;
+    ESP_RETURN_ON_FALSE(storage_size >= size, ESP_ERR_INVALID_ARG, TAG, "storage too small, need %u bytes", (unsigned)size);
+    led_strip_spi_obj *spi_strip = memset(storage, 0, size);
+    spi_strip->is_static = true;
+    ESP_RETURN_ON_ERROR(led_strip_spi_init(spi_strip, led_config, spi_config, component_fmt), TAG, "init spi strip failed");
+
+    *ret_strip = &spi_strip->base;
+    return ESP_OK;
+}
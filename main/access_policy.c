@@ -0,0 +1,586 @@
+/*
+ * 🗓️ Access Policy - time-of-week windows per access schedule ⏰
+ *
+ * Two compiled policies alternate: updates compile into the one that is not
+ * active and then publish it with a single pointer store. Readers announce
+ * themselves in a per-policy counter before reading, and an update waits for
+ * the counter of the policy it is about to overwrite to drain, so a check
+ * never sees a half-compiled bitmap.
+ *
+ * The stored policy is read from NVS by the first check, not during startup.
+ * Both policies start zeroed, which opens no schedule at any time, so nothing
+ * passes before the load and the load needs no lock beyond `updating`.
+ */
+
+#include "access_policy.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "boot_prof.h"
+#include "lock_hal.h"
+#include "mem_placement.h"
+
+/* 🏷️ Log tag for the access policy */
+static const char *TAG = "access_policy";
+
+#define ACCESS_SLOT_SECONDS    (5 * 60)
+#define ACCESS_SLOTS_PER_DAY   (24 * 60 * 60 / ACCESS_SLOT_SECONDS)
+#define ACCESS_SLOTS_PER_WEEK  (7 * ACCESS_SLOTS_PER_DAY)
+#define ACCESS_WORDS_PER_WEEK  (ACCESS_SLOTS_PER_WEEK / 32)
+
+/* A policy source of ACCESS_POLICY_MAX_LEN bytes holds fewer rules than this */
+#define ACCESS_MAX_RULES       128
+
+/* Where the policy source is stored */
+#define ACCESS_NVS_NAMESPACE   "lock"
+#define ACCESS_NVS_KEY         "policy"
+
+/* Largest `tz` offset accepted, in minutes */
+#define ACCESS_MAX_UTC_OFFSET_MIN (14 * 60)
+
+/* Checks timed by access_policy_benchmark() */
+#define ACCESS_BENCH_ROUNDS    20
+
+_Static_assert(ACCESS_SLOTS_PER_WEEK % 32 == 0, "week bitmap is a whole number of words");
+_Static_assert(ACCESS_SCHEDULE_COUNT <= 32, "schedule masks are 32 bits");
+
+/**
+ * @brief One rule line, as parsed.
+ */
+typedef struct {
+    uint8_t schedule;
+    uint8_t days;        /*!< Bit d: the window opens on day d (0 = Monday) */
+    uint16_t from;       /*!< First slot of the window within the day */
+    uint16_t to;         /*!< Slot after the window; not above `from` if it runs past midnight */
+} access_rule_t;
+
+/**
+ * @brief A compiled policy.
+ */
+typedef struct {
+    uint32_t bits[ACCESS_SCHEDULE_COUNT][ACCESS_WORDS_PER_WEEK];  /*!< Bit s: slot s of the week is open */
+    int32_t utc_offset_s;       /*!< Added to UTC to get local time */
+    uint32_t restricted;        /*!< Bit n: the policy mentions schedule n */
+    uint32_t always;            /*!< Bit n: schedule n is open in every slot */
+} access_policy_t;
+
+static LOCK_COLD_BSS access_policy_t policies[2];
+static access_policy_t *active = &policies[0];
+static uint32_t readers[2];
+static bool updating;
+
+/* Set once the stored policy has been read, with what the read returned */
+static bool loaded;
+static esp_err_t load_err;
+
+/* Rules and source text of the update in progress */
+static LOCK_COLD_BSS access_rule_t rules[ACCESS_MAX_RULES];
+static LOCK_COLD_BSS char source[ACCESS_POLICY_MAX_LEN + 1];
+
+static const char *const day_names[7] = { "mon", "tue", "wed", "thu", "fri", "sat", "sun" };
+
+/**
+ * @brief Parses a day name.
+ *
+ * @return The day (0 = Monday), or -1.
+ */
+static int parse_day(const char *s, size_t len) {
+    for (int d = 0; d < 7; d++) {
+        if (len == 3 && strncmp(s, day_names[d], 3) == 0) {
+            return d;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Parses `daily`, or a comma separated list of days and day ranges.
+ *
+ * @return Bit d set for every day d, or 0 on a syntax error.
+ */
+static uint8_t parse_days(const char *s) {
+    if (strcmp(s, "daily") == 0) {
+        return 0x7f;
+    }
+    uint8_t days = 0;
+    while (*s) {
+        size_t len = strcspn(s, ",");
+        const char *dash = memchr(s, '-', len);
+        int first = parse_day(s, dash ? (size_t)(dash - s) : len);
+        int last = dash ? parse_day(dash + 1, len - (dash + 1 - s)) : first;
+        if (first < 0 || last < 0) {
+            return 0;
+        }
+        // Ranges may wrap around the end of the week (fri-mon)
+        for (int d = first;; d = (d + 1) % 7) {
+            days |= 1 << d;
+            if (d == last) {
+                break;
+            }
+        }
+        s += len;
+        if (*s == ',' && *++s == '\0') {
+            return 0;
+        }
+    }
+    return days;
+}
+
+/**
+ * @brief Parses `HH:MM` on the five-minute grid.
+ *
+ * @param s Text to parse
+ * @param end Receives the first character after the time
+ * @return The slot within the day (ACCESS_SLOTS_PER_DAY for 24:00), or -1.
+ */
+static int parse_time(const char *s, const char **end) {
+    if (!isdigit((unsigned char)s[0]) || !isdigit((unsigned char)s[1]) || s[2] != ':' ||
+        !isdigit((unsigned char)s[3]) || !isdigit((unsigned char)s[4])) {
+        return -1;
+    }
+    int hours = (s[0] - '0') * 10 + (s[1] - '0');
+    int minutes = (s[3] - '0') * 10 + (s[4] - '0');
+    int total = hours * 60 + minutes;
+    if (minutes > 59 || total > 24 * 60 || total % (ACCESS_SLOT_SECONDS / 60) != 0) {
+        return -1;
+    }
+    *end = s + 5;
+    return total / (ACCESS_SLOT_SECONDS / 60);
+}
+
+/**
+ * @brief Parses a `tz` offset, `+HH:MM` or `-HH:MM`.
+ *
+ * @return true if the offset is valid.
+ */
+static bool parse_utc_offset(const char *s, int32_t *offset_s) {
+    int sign = s[0] == '-' ? -1 : 1;
+    if (s[0] != '+' && s[0] != '-') {
+        return false;
+    }
+    if (!isdigit((unsigned char)s[1]) || !isdigit((unsigned char)s[2]) || s[3] != ':' ||
+        !isdigit((unsigned char)s[4]) || !isdigit((unsigned char)s[5]) || s[6] != '\0') {
+        return false;
+    }
+    int hours = (s[1] - '0') * 10 + (s[2] - '0');
+    int minutes = (s[4] - '0') * 10 + (s[5] - '0');
+    if (minutes > 59 || hours * 60 + minutes > ACCESS_MAX_UTC_OFFSET_MIN) {
+        return false;
+    }
+    *offset_s = sign * (hours * 3600 + minutes * 60);
+    return true;
+}
+
+/**
+ * @brief Parses one rule line, already split into words.
+ *
+ * @return true if the words form a rule.
+ */
+static bool parse_rule(char **words, int count, access_rule_t *rule) {
+    char *end;
+    unsigned long schedule = strtoul(words[0], &end, 10);
+    if (count < 2 || *end != '\0' || !isdigit((unsigned char)words[0][0]) || schedule >= ACCESS_SCHEDULE_COUNT) {
+        return false;
+    }
+    rule->schedule = schedule;
+
+    if (count == 2 && strcmp(words[1], "always") == 0) {
+        rule->days = 0x7f;
+        rule->from = 0;
+        rule->to = ACCESS_SLOTS_PER_DAY;
+        return true;
+    }
+    if (count == 2 && strcmp(words[1], "never") == 0) {
+        rule->days = 0;
+        rule->from = rule->to = 0;
+        return true;
+    }
+    if (count != 3 || (rule->days = parse_days(words[1])) == 0) {
+        return false;
+    }
+
+    const char *p;
+    int from = parse_time(words[2], &p);
+    int to = from >= 0 && *p == '-' ? parse_time(p + 1, &p) : -1;
+    if (to < 0 || *p != '\0' || from == to || from == ACCESS_SLOTS_PER_DAY) {
+        return false;
+    }
+    rule->from = from;
+    rule->to = to;
+    return true;
+}
+
+/**
+ * @brief Parses a policy source into rules and a UTC offset.
+ *
+ * @param text NUL-terminated source; modified while it is split into words
+ * @param count Receives the number of rules
+ * @param utc_offset_s Receives the `tz` offset, 0 if there is none
+ * @param error_line Receives the line of the first error
+ * @return true if the whole source parsed.
+ */
+static bool parse_policy(char *text, size_t *count, int32_t *utc_offset_s, int *error_line) {
+    int line = 0;
+    *count = 0;
+    *utc_offset_s = 0;
+
+    for (char *next = text; next;) {
+        char *s = next;
+        next = strchr(s, '\n');
+        if (next) {
+            *next++ = '\0';
+        }
+        line++;
+        s[strcspn(s, "#")] = '\0';
+
+        char *words[4];
+        int n = 0;
+        for (char *save, *w = strtok_r(s, " \t\r", &save); w; w = strtok_r(NULL, " \t\r", &save)) {
+            if (n == 4) {
+                *error_line = line;
+                return false;
+            }
+            words[n++] = w;
+        }
+        if (n == 0) {
+            continue;
+        }
+
+        bool ok;
+        if (strcmp(words[0], "tz") == 0) {
+            ok = n == 2 && parse_utc_offset(words[1], utc_offset_s);
+        } else {
+            ok = *count < ACCESS_MAX_RULES && parse_rule(words, n, &rules[*count]);
+            *count += ok;
+        }
+        if (!ok) {
+            *error_line = line;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Sets the bits of one window starting on every day in the rule.
+ */
+static void compile_rule(access_policy_t *policy, const access_rule_t *rule) {
+    uint32_t *bits = policy->bits[rule->schedule];
+    int len = rule->to > rule->from ? rule->to - rule->from : rule->to + ACCESS_SLOTS_PER_DAY - rule->from;
+
+    for (int d = 0; d < 7; d++) {
+        if (!(rule->days & (1 << d))) {
+            continue;
+        }
+        for (int i = 0; i < len; i++) {
+            int slot = (d * ACCESS_SLOTS_PER_DAY + rule->from + i) % ACCESS_SLOTS_PER_WEEK;
+            bits[slot / 32] |= 1u << (slot % 32);
+        }
+    }
+}
+
+/**
+ * @brief Compiles parsed rules into a policy.
+ *
+ * Schedules no rule mentions are open in every slot.
+ */
+static void compile_policy(access_policy_t *policy, size_t count, int32_t utc_offset_s) {
+    memset(policy, 0, sizeof(*policy));
+    policy->utc_offset_s = utc_offset_s;
+    for (size_t i = 0; i < count; i++) {
+        policy->restricted |= 1u << rules[i].schedule;
+        compile_rule(policy, &rules[i]);
+    }
+    for (int n = 0; n < ACCESS_SCHEDULE_COUNT; n++) {
+        if (!(policy->restricted & (1u << n))) {
+            memset(policy->bits[n], 0xff, sizeof(policy->bits[n]));
+        }
+        bool all = true;
+        for (int w = 0; w < ACCESS_WORDS_PER_WEEK && all; w++) {
+            all = policy->bits[n][w] == UINT32_MAX;
+        }
+        policy->always |= (uint32_t)all << n;
+    }
+}
+
+/**
+ * @brief Returns the slot of the week, counted from Monday 00:00 local time.
+ */
+static int week_slot(int64_t unix_s, int32_t utc_offset_s) {
+    // 1970-01-01 was a Thursday
+    int64_t slot = (unix_s + utc_offset_s) / ACCESS_SLOT_SECONDS + 3 * ACCESS_SLOTS_PER_DAY;
+    return (int)(slot % ACCESS_SLOTS_PER_WEEK);
+}
+
+/**
+ * @brief Tests a schedule's bit for a time, or its always-open flag if the time is unknown.
+ */
+static bool policy_test(const access_policy_t *policy, uint8_t schedule, int64_t unix_s) {
+    if (unix_s < 0) {
+        return (policy->always >> schedule) & 1;
+    }
+    int slot = week_slot(unix_s, policy->utc_offset_s);
+    return (policy->bits[schedule][slot / 32] >> (slot % 32)) & 1;
+}
+
+/**
+ * @brief Compiles the source in `source` into the inactive policy and publishes it.
+ */
+static esp_err_t access_policy_apply(int *error_line) {
+    size_t count;
+    int32_t utc_offset_s;
+
+    *error_line = 0;
+    if (!parse_policy(source, &count, &utc_offset_s, error_line)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Wait for checks still reading the inactive policy from before the last update
+    access_policy_t *spare = active == &policies[0] ? &policies[1] : &policies[0];
+    while (__atomic_load_n(&readers[spare - policies], __ATOMIC_SEQ_CST) != 0) {
+        vTaskDelay(1);
+    }
+    compile_policy(spare, count, utc_offset_s);
+    __atomic_store_n(&active, spare, __ATOMIC_SEQ_CST);
+
+    ESP_LOGI(TAG, "🗓️ Policy with %u rules active, restricted schedules 0x%04lx",
+             (unsigned)count, (unsigned long)spare->restricted);
+    return ESP_OK;
+}
+
+/**
+ * @brief Compiles the policy stored in NVS into the active policy; `updating` must be held.
+ */
+static esp_err_t access_policy_load(void) {
+    int error_line;
+
+    // Start with every schedule unrestricted
+    compile_policy(&policies[0], 0, 0);
+    active = &policies[0];
+
+    nvs_handle_t nvs;
+    size_t len = ACCESS_POLICY_MAX_LEN;
+    esp_err_t err = nvs_open(ACCESS_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "🗓️ No access policy stored, all schedules unrestricted");
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Cannot open NVS, policies will not persist: %s", esp_err_to_name(err));
+        return err;
+    }
+    err = nvs_get_blob(nvs, ACCESS_NVS_KEY, source, &len);
+    nvs_close(nvs);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "🗓️ No access policy stored, all schedules unrestricted");
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Cannot read the stored policy: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    source[len] = '\0';
+    if (access_policy_apply(&error_line) != ESP_OK) {
+        // Only compiled policies are stored, so this is corruption; fail closed
+        ESP_LOGE(TAG, "❌ Stored policy does not compile (line %d), restricting every schedule", error_line);
+        memset(&policies[0], 0, sizeof(policies[0]));
+        policies[0].restricted = (1u << ACCESS_SCHEDULE_COUNT) - 1;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Loads the stored policy unless that has happened already.
+ *
+ * The caller that wins `updating` does the load; any other caller waits for
+ * it, which only happens when the first checks race each other after boot.
+ */
+static void access_policy_ensure_loaded(void) {
+    while (!__atomic_load_n(&loaded, __ATOMIC_ACQUIRE)) {
+        if (__atomic_exchange_n(&updating, true, __ATOMIC_ACQUIRE)) {
+            vTaskDelay(1);
+            continue;
+        }
+        if (!loaded) {
+            boot_prof_begin(BOOT_PHASE_POLICY);
+            load_err = access_policy_load();
+            boot_prof_end(BOOT_PHASE_POLICY);
+            __atomic_store_n(&loaded, true, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&updating, false, __ATOMIC_RELEASE);
+    }
+}
+
+esp_err_t access_policy_init(void) {
+    access_policy_ensure_loaded();
+    return load_err;
+}
+
+esp_err_t access_policy_update(const char *text, size_t len, int *error_line) {
+    *error_line = 0;
+    if (len > ACCESS_POLICY_MAX_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // An update replaces the stored policy, but the active one must be it first
+    access_policy_ensure_loaded();
+    if (__atomic_exchange_n(&updating, true, __ATOMIC_ACQUIRE)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memcpy(source, text, len);
+    source[len] = '\0';
+    esp_err_t err = access_policy_apply(error_line);
+
+    // Keep the source for the next boot; the copy in `source` was split into words
+    if (err == ESP_OK) {
+        nvs_handle_t nvs;
+        esp_err_t nvs_err = nvs_open(ACCESS_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+        if (nvs_err == ESP_OK) {
+            nvs_err = nvs_set_blob(nvs, ACCESS_NVS_KEY, text, len);
+            if (nvs_err == ESP_OK) {
+                nvs_err = nvs_commit(nvs);
+            }
+            nvs_close(nvs);
+        }
+        if (nvs_err != ESP_OK) {
+            ESP_LOGW(TAG, "⚠️ Policy not stored, it is lost on reboot: %s", esp_err_to_name(nvs_err));
+        }
+    }
+
+    __atomic_store_n(&updating, false, __ATOMIC_RELEASE);
+    return err;
+}
+
+bool access_policy_allows_at(uint8_t schedule, int64_t unix_s) {
+    if (schedule >= ACCESS_SCHEDULE_COUNT) {
+        return false;
+    }
+    access_policy_ensure_loaded();
+
+    // Pin the active policy; retry if an update published another one meanwhile
+    access_policy_t *policy;
+    uint32_t *pin;
+    for (;;) {
+        policy = __atomic_load_n(&active, __ATOMIC_SEQ_CST);
+        pin = &readers[policy - policies];
+        __atomic_fetch_add(pin, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&active, __ATOMIC_SEQ_CST) == policy) {
+            break;
+        }
+        __atomic_fetch_sub(pin, 1, __ATOMIC_SEQ_CST);
+    }
+
+    bool allowed = policy_test(policy, schedule, unix_s);
+    __atomic_fetch_sub(pin, 1, __ATOMIC_RELEASE);
+    return allowed;
+}
+
+bool access_policy_allows(uint8_t schedule) {
+    return access_policy_allows_at(schedule, lock_hal_wall_time_s());
+}
+
+uint32_t access_policy_restricted(void) {
+    access_policy_ensure_loaded();
+    return __atomic_load_n(&active, __ATOMIC_SEQ_CST)->restricted;
+}
+
+#if CONFIG_LOCK_ACCESS_POLICY_BENCHMARK
+
+/**
+ * @brief Reference check scanning the rules as intervals, what the bitmaps replace.
+ */
+static bool rules_allow(size_t count, int32_t utc_offset_s, uint8_t schedule, int64_t unix_s) {
+    int slot = week_slot(unix_s, utc_offset_s);
+    bool mentioned = false;
+
+    for (size_t i = 0; i < count; i++) {
+        const access_rule_t *r = &rules[i];
+        if (r->schedule != schedule) {
+            continue;
+        }
+        mentioned = true;
+        int len = r->to > r->from ? r->to - r->from : r->to + ACCESS_SLOTS_PER_DAY - r->from;
+        for (int d = 0; d < 7; d++) {
+            int start = d * ACCESS_SLOTS_PER_DAY + r->from;
+            if ((r->days & (1 << d)) && (slot - start + ACCESS_SLOTS_PER_WEEK) % ACCESS_SLOTS_PER_WEEK < len) {
+                return true;
+            }
+        }
+    }
+    return !mentioned;
+}
+
+void access_policy_benchmark(void) {
+    static const char sample[] =
+        "tz +01:00\n"
+        "1 mon-fri 08:00-17:00\n"
+        "1 sat 08:00-12:00\n"
+        "2 daily 22:00-06:00\n"
+        "3 mon,wed,fri 07:00-09:00\n"
+        "3 mon,wed,fri 16:00-18:30\n"
+        "4 sat-sun 10:00-16:00\n"
+        "5 never\n";
+    static access_policy_t bench;
+    size_t count;
+    int32_t utc_offset_s;
+    int error_line;
+    volatile uint32_t sink = 0;
+
+    // The parser works in `source` and `rules`, which an update or the first load also uses
+    access_policy_ensure_loaded();
+    while (__atomic_exchange_n(&updating, true, __ATOMIC_ACQUIRE)) {
+        vTaskDelay(1);
+    }
+
+    // Compile: parse the sample and build all bitmaps, without publishing them
+    int64_t start = lock_hal_time_us();
+    for (int i = 0; i < ACCESS_BENCH_ROUNDS; i++) {
+        memcpy(source, sample, sizeof(sample));
+        parse_policy(source, &count, &utc_offset_s, &error_line);
+        compile_policy(&bench, count, utc_offset_s);
+    }
+    int64_t compile_us = (lock_hal_time_us() - start) / ACCESS_BENCH_ROUNDS;
+
+    // Check every slot of the week for every schedule, both ways
+    const int64_t monday = 1704067200;  // 2024-01-01 00:00 UTC
+    const int checks = ACCESS_BENCH_ROUNDS * ACCESS_SCHEDULE_COUNT * ACCESS_SLOTS_PER_WEEK;
+    uint32_t mismatches = 0;
+    start = lock_hal_time_us();
+    for (int r = 0; r < ACCESS_BENCH_ROUNDS; r++) {
+        for (int s = 0; s < ACCESS_SLOTS_PER_WEEK; s++) {
+            for (int n = 0; n < ACCESS_SCHEDULE_COUNT; n++) {
+                sink += policy_test(&bench, n, monday + (int64_t)s * ACCESS_SLOT_SECONDS);
+            }
+        }
+    }
+    int64_t bitmap_us = lock_hal_time_us() - start;
+    start = lock_hal_time_us();
+    for (int r = 0; r < ACCESS_BENCH_ROUNDS; r++) {
+        for (int s = 0; s < ACCESS_SLOTS_PER_WEEK; s++) {
+            for (int n = 0; n < ACCESS_SCHEDULE_COUNT; n++) {
+                sink += rules_allow(count, utc_offset_s, n, monday + (int64_t)s * ACCESS_SLOT_SECONDS);
+            }
+        }
+    }
+    int64_t scan_us = lock_hal_time_us() - start;
+    for (int s = 0; s < ACCESS_SLOTS_PER_WEEK; s++) {
+        for (int n = 0; n < ACCESS_SCHEDULE_COUNT; n++) {
+            int64_t t = monday + (int64_t)s * ACCESS_SLOT_SECONDS;
+            mismatches += policy_test(&bench, n, t) != rules_allow(count, utc_offset_s, n, t);
+        }
+    }
+    __atomic_store_n(&updating, false, __ATOMIC_RELEASE);
+
+    ESP_LOGI(TAG, "⏱️ Compile %lld us for %u rules; check %lld ns (bitmap) vs %lld ns (interval scan), "
+             "%lu mismatches", (long long)compile_us, (unsigned)count, (long long)bitmap_us * 1000 / checks,
+             (long long)scan_us * 1000 / checks, (unsigned long)mismatches);
+    (void)sink;
+}
+
+#endif /* CONFIG_LOCK_ACCESS_POLICY_BENCHMARK */
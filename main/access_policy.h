@@ -0,0 +1,113 @@
+/*
+ * 🗓️ Access Policy - time-of-week windows per access schedule ⏰
+ *
+ * Every credential is assigned one of ACCESS_SCHEDULE_COUNT access schedules
+ * when its table is built (see tools/gen_creds.py); the pre-shared key is
+ * never restricted. The policy describes when each schedule may open the
+ * lock, as text uploaded with PUT /policy, one rule per line:
+ *
+ *     # contractors: weekdays 08:00-17:00, Saturday mornings
+ *     tz +01:00
+ *     1 mon-fri 08:00-17:00
+ *     1 sat 08:00-12:00
+ *     2 daily 22:00-06:00
+ *     3 never
+ *
+ * Days are `mon` ... `sun`, ranges such as `mon-fri` or `fri-mon`, lists
+ * such as `mon,wed,fri`, or `daily`; times are local (UTC plus the `tz`
+ * offset) on a five-minute grid, and a window ending before it starts runs
+ * past midnight into the next day. `<n> always` and `<n> never` are also
+ * accepted. A schedule the policy does not mention is unrestricted.
+ *
+ * The rules are compiled into one bitmap per schedule with a bit for every
+ * five minutes of the week (2016 bits, 252 bytes), so checking an unlock is
+ * a single bit test whatever the rules look like. A new policy is compiled
+ * into a second bitmap set and published with one pointer store, so an
+ * unlock checked during an update sees either the old or the new policy
+ * completely. The source text is kept in NVS and compiled again after a
+ * reboot, once the lock is ready to serve clients.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of access schedules credentials can be assigned to */
+#define ACCESS_SCHEDULE_COUNT 16
+
+/* Longest policy source accepted, in bytes */
+#define ACCESS_POLICY_MAX_LEN 1024
+
+/**
+ * @brief Compiles the policy stored in NVS, or leaves every schedule unrestricted.
+ *
+ * The first check or update does this on its own, so calling it is optional;
+ * startup calls it once the lock is ready, to take the NVS read off the first
+ * unlock. Later calls only return the result of the first. Every check needs
+ * NVS to be initialized (see lock_hal_net_init()).
+ *
+ * @return
+ *      - ESP_OK: stored policy active, or none stored
+ *      - Other: NVS is unavailable; policies still work but are not persisted
+ */
+esp_err_t access_policy_init(void);
+
+/**
+ * @brief Checks whether a schedule may open the lock now.
+ *
+ * Until the wall clock has been set (see lock_hal_wall_time_s()) only
+ * schedules that are open around the clock pass.
+ *
+ * @param schedule Access schedule of the credential
+ * @return true if the current time of week is inside the schedule
+ */
+bool access_policy_allows(uint8_t schedule);
+
+/**
+ * @brief Checks whether a schedule may open the lock at a given time.
+ *
+ * @param schedule Access schedule of the credential
+ * @param unix_s Seconds since the Unix epoch (UTC), or -1 if unknown
+ * @return true if the time of week is inside the schedule
+ */
+bool access_policy_allows_at(uint8_t schedule, int64_t unix_s);
+
+/**
+ * @brief Compiles a new policy, makes it active and stores it in NVS.
+ *
+ * The active policy is untouched if the text does not compile.
+ *
+ * @param text Policy source, not necessarily NUL-terminated
+ * @param len Length of the source
+ * @param error_line Receives the 1-based line of a syntax error, or 0
+ * @return
+ *      - ESP_OK: new policy active (and stored, unless NVS is unavailable)
+ *      - ESP_ERR_INVALID_ARG: syntax error on *error_line
+ *      - ESP_ERR_INVALID_SIZE: the source is longer than ACCESS_POLICY_MAX_LEN
+ *      - ESP_ERR_INVALID_STATE: another update is in progress
+ */
+esp_err_t access_policy_update(const char *text, size_t len, int *error_line);
+
+/**
+ * @brief Returns a bitmask of the schedules the active policy restricts.
+ */
+uint32_t access_policy_restricted(void);
+
+#if CONFIG_LOCK_ACCESS_POLICY_BENCHMARK
+/**
+ * @brief Logs the cost of compiling a sample policy and of checking it,
+ * against scanning the same rules as intervals.
+ */
+void access_policy_benchmark(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
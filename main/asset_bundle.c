@@ -0,0 +1,143 @@
+/*
+ * 📦 Asset Bundle - read-only web asset image with perfect-hash path lookup 🗂️
+ *
+ * The on-flash layout is documented in gen_assets.py; the structures below
+ * must stay in sync with HEADER_FMT and ENTRY_FMT there.
+ */
+
+#include "asset_bundle.h"
+
+#include <string.h>
+#include "perfect_hash.h"
+
+#define ASSET_IMAGE_MAGIC   0x31534157 // 'WAS1'
+#define ASSET_IMAGE_VERSION 1
+
+/**
+ * @brief Image header as written by gen_assets.py.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t seed;
+    uint16_t bucket_count;
+    uint16_t reserved0;
+    uint32_t buckets_off;
+    uint32_t entries_off;
+    uint32_t image_size;
+    uint32_t reserved1;
+} asset_image_header_t;
+
+/**
+ * @brief Image entry as written by gen_assets.py.
+ */
+typedef struct {
+    uint32_t hash;
+    uint32_t path_off;
+    uint32_t mime_off;
+    uint32_t etag_off;
+    uint32_t gz_etag_off;
+    uint32_t data_off;
+    uint32_t data_len;
+    uint32_t gz_off;
+    uint32_t gz_len;
+    uint16_t path_len;
+    uint16_t reserved;
+} asset_image_entry_t;
+
+_Static_assert(sizeof(asset_image_header_t) == 32, "asset image header layout");
+_Static_assert(sizeof(asset_image_entry_t) == 40, "asset image entry layout");
+
+/**
+ * @brief Checks that [off, off + len) lies inside the image.
+ */
+static bool asset_range_ok(size_t size, uint32_t off, uint32_t len) {
+    return off <= size && len <= size - off;
+}
+
+/**
+ * @brief Checks that a NUL-terminated string starts at `off` inside the image.
+ */
+static bool asset_string_ok(const uint8_t *base, size_t size, uint32_t off) {
+    return off < size && memchr(base + off, '\0', size - off) != NULL;
+}
+
+esp_err_t asset_bundle_open(asset_bundle_t *bundle, const void *image, size_t size) {
+    const uint8_t *base = image;
+    asset_image_header_t hdr;
+
+    // Tables are read with word loads, which must be aligned on Xtensa
+    if (((uintptr_t)base & 3) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (size < sizeof(hdr)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(&hdr, base, sizeof(hdr));
+    if (hdr.magic != ASSET_IMAGE_MAGIC || hdr.version != ASSET_IMAGE_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    // The bucket count is a power of two so that the bucket index is a mask
+    if (hdr.image_size > size || hdr.bucket_count == 0 ||
+        (hdr.bucket_count & (hdr.bucket_count - 1)) != 0 ||
+        (hdr.buckets_off & 1) != 0 || (hdr.entries_off & 3) != 0 ||
+        !asset_range_ok(hdr.image_size, hdr.buckets_off, hdr.bucket_count * sizeof(uint16_t)) ||
+        !asset_range_ok(hdr.image_size, hdr.entries_off, hdr.count * sizeof(asset_image_entry_t))) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    size = hdr.image_size;
+
+    const asset_image_entry_t *entries = (const asset_image_entry_t *)(base + hdr.entries_off);
+    for (uint32_t i = 0; i < hdr.count; i++) {
+        const asset_image_entry_t *e = &entries[i];
+        if (!asset_string_ok(base, size, e->path_off) || strlen((const char *)base + e->path_off) != e->path_len ||
+            !asset_string_ok(base, size, e->mime_off) || !asset_string_ok(base, size, e->etag_off) ||
+            !asset_range_ok(size, e->data_off, e->data_len) ||
+            (e->gz_len && (!asset_string_ok(base, size, e->gz_etag_off) ||
+                           !asset_range_ok(size, e->gz_off, e->gz_len)))) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+
+    bundle->base = base;
+    bundle->size = size;
+    bundle->seed = hdr.seed;
+    bundle->count = hdr.count;
+    bundle->bucket_mask = hdr.bucket_count - 1;
+    bundle->buckets = (const uint16_t *)(base + hdr.buckets_off);
+    bundle->entries = entries;
+    return ESP_OK;
+}
+
+bool asset_bundle_find(const asset_bundle_t *bundle, const char *path, size_t path_len, asset_t *out) {
+    if (bundle->count == 0) {
+        return false;
+    }
+
+    uint32_t h = perfect_hash_key(path, path_len, bundle->seed);
+    uint32_t slot = perfect_hash_slot(h, bundle->buckets, bundle->bucket_mask, bundle->count);
+    const asset_image_entry_t *e = &((const asset_image_entry_t *)bundle->entries)[slot];
+
+    // Every path maps to some slot; confirm it is really this one
+    if (e->hash != h || e->path_len != path_len ||
+        memcmp(bundle->base + e->path_off, path, path_len) != 0) {
+        return false;
+    }
+
+    out->path = (const char *)bundle->base + e->path_off;
+    out->mime = (const char *)bundle->base + e->mime_off;
+    out->etag = (const char *)bundle->base + e->etag_off;
+    out->data = bundle->base + e->data_off;
+    out->len = e->data_len;
+    if (e->gz_len) {
+        out->gz_etag = (const char *)bundle->base + e->gz_etag_off;
+        out->gz_data = bundle->base + e->gz_off;
+        out->gz_len = e->gz_len;
+    } else {
+        out->gz_etag = NULL;
+        out->gz_data = NULL;
+        out->gz_len = 0;
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+/*
+ * 📦 Asset Bundle - read-only web asset image with perfect-hash path lookup 🗂️
+ *
+ * The image is produced at build time by gen_assets.py from the files below
+ * main/www. It carries its own table of assets (path, MIME type, ETags,
+ * identity and gzip payloads) laid out by a minimal perfect hash over the
+ * paths, so looking up a path costs the same for 1 or 500 assets and never
+ * allocates. The image is used in place, straight from flash.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief An opened, validated asset image.
+ */
+typedef struct {
+    const uint8_t *base;        /*!< Start of the image */
+    size_t size;                /*!< Image size in bytes */
+    uint32_t seed;              /*!< Perfect hash seed */
+    uint16_t count;             /*!< Number of assets */
+    uint16_t bucket_mask;       /*!< Number of displacement buckets minus one */
+    const uint16_t *buckets;    /*!< Displacement table */
+    const void *entries;        /*!< Entry table, indexed by perfect-hash slot */
+} asset_bundle_t;
+
+/**
+ * @brief One asset as found in the bundle. All pointers reference the image.
+ */
+typedef struct {
+    const char *path;           /*!< Request path, e.g. "/index.html" */
+    const char *mime;           /*!< MIME type */
+    const char *etag;           /*!< Strong ETag (quoted) of the identity payload */
+    const uint8_t *data;        /*!< Identity payload */
+    size_t len;                 /*!< Identity payload length */
+    const char *gz_etag;        /*!< Strong ETag (quoted) of the gzip payload, NULL if none */
+    const uint8_t *gz_data;     /*!< gzip payload, NULL if the asset is not stored compressed */
+    size_t gz_len;              /*!< gzip payload length */
+} asset_t;
+
+/**
+ * @brief Validates an image and prepares it for lookups.
+ *
+ * All offsets and strings in the image are bounds-checked here once, so that
+ * lookups do not need to.
+ *
+ * @param bundle Bundle to initialize
+ * @param image Start of the image, 4-byte aligned
+ * @param size Size of the memory holding the image
+ * @return
+ *      - ESP_OK: image is valid
+ *      - ESP_ERR_INVALID_ARG: the image is not 4-byte aligned
+ *      - ESP_ERR_INVALID_VERSION: unknown magic or version
+ *      - ESP_ERR_INVALID_SIZE: the image is truncated or an offset is out of bounds
+ */
+esp_err_t asset_bundle_open(asset_bundle_t *bundle, const void *image, size_t size);
+
+/**
+ * @brief Looks up an asset by request path.
+ *
+ * @param bundle Opened bundle
+ * @param path Request path, not necessarily NUL-terminated
+ * @param path_len Length of the path
+ * @param out Filled in when the asset exists
+ * @return true if the asset exists
+ */
+bool asset_bundle_find(const asset_bundle_t *bundle, const char *path, size_t path_len, asset_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,94 @@
+/*
+ * 🗄️ Asset Store - hot-swappable web asset images in A/B flash partitions 🔁
+ *
+ * The slots, their headers and uploads are handled by the slot store (see
+ * slot_store.h); this file keeps the opened bundle of each slot and decides
+ * which bundle is served.
+ */
+
+#include "asset_store.h"
+
+#include "esp_log.h"
+#include "slot_store.h"
+
+/* 🏷️ Log tag for the asset store */
+static const char *TAG = "asset_store";
+
+#define ASSET_SLOT_SUBTYPE     0x40
+#define ASSET_SLOT_MAGIC       0x544c5357 // 'WSLT'
+
+static esp_err_t asset_slot_open(int slot, const uint8_t *image, size_t size);
+
+static slot_store_t store = {
+    .tag = "asset_store",
+    .what = "asset image",
+    .subtype = ASSET_SLOT_SUBTYPE,
+    .magic = ASSET_SLOT_MAGIC,
+    .open = asset_slot_open,
+    .slots = { { .label = "assets_a" }, { .label = "assets_b" } },
+    .active = -1,
+};
+static asset_bundle_t slot_bundles[2];
+static asset_bundle_t builtin_bundle;
+
+static esp_err_t asset_slot_open(int slot, const uint8_t *image, size_t size) {
+    return asset_bundle_open(&slot_bundles[slot], image, size);
+}
+
+/**
+ * @brief Logs which bundle is served from now on.
+ */
+static void asset_store_log_active(void) {
+    int active = slot_store_active(&store);
+    if (active >= 0) {
+        ESP_LOGI(TAG, "📦 Serving %u assets from %s (generation %u)", slot_bundles[active].count,
+                 store.slots[active].label, (unsigned)store.slots[active].generation);
+    } else {
+        ESP_LOGI(TAG, "📦 Serving %u built-in assets", builtin_bundle.count);
+    }
+}
+
+esp_err_t asset_store_init(const void *builtin, size_t builtin_size) {
+    esp_err_t err = asset_bundle_open(&builtin_bundle, builtin, builtin_size);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Built-in asset image is invalid: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (slot_store_init(&store) != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ No asset partitions, hot-swap disabled");
+    }
+    asset_store_log_active();
+    return ESP_OK;
+}
+
+const asset_bundle_t *asset_store_acquire(void) {
+    int slot = slot_store_pin(&store);
+    return slot >= 0 ? &slot_bundles[slot] : &builtin_bundle;
+}
+
+void asset_store_release(const asset_bundle_t *bundle) {
+    if (bundle != &builtin_bundle) {
+        slot_store_unpin(&store, bundle - slot_bundles);
+    }
+}
+
+esp_err_t asset_store_upload_begin(size_t image_size, const uint8_t sha256[32]) {
+    return slot_store_upload_begin(&store, image_size, sha256);
+}
+
+esp_err_t asset_store_upload_write(const void *data, size_t len) {
+    return slot_store_upload_write(&store, data, len);
+}
+
+esp_err_t asset_store_upload_finish(void) {
+    esp_err_t err = slot_store_upload_finish(&store);
+    if (err == ESP_OK) {
+        asset_store_log_active();
+    }
+    return err;
+}
+
+void asset_store_upload_abort(void) {
+    slot_store_upload_abort(&store);
+}
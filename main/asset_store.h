@@ -0,0 +1,91 @@
+/*
+ * 🗄️ Asset Store - hot-swappable web asset images in A/B flash partitions 🔁
+ *
+ * The web UI is served from an asset image (see asset_bundle.h) that lives in
+ * one of two data partitions, `assets_a` and `assets_b`, memory-mapped through
+ * the flash cache. A new image is streamed into the inactive slot, its SHA-256
+ * is verified incrementally while it is written, and the slot is committed by
+ * programming its magic word last, which makes the switch atomic across power
+ * loss. The image compiled into the firmware is used when neither slot holds a
+ * valid image.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "asset_bundle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maps both slots and activates the newest valid image.
+ *
+ * @param builtin Built-in asset image used as fallback (4-byte aligned)
+ * @param builtin_size Size of the built-in image
+ * @return
+ *      - ESP_OK: an image (slot or built-in) is active
+ *      - Other: the built-in image is invalid
+ */
+esp_err_t asset_store_init(const void *builtin, size_t builtin_size);
+
+/**
+ * @brief Returns the bundle currently being served and keeps its slot from being overwritten.
+ *
+ * Assets found in the bundle stay readable until asset_store_release(); an
+ * upload started in the meantime is refused rather than erase them under a
+ * send that is still streaming. Safe to call from any task.
+ */
+const asset_bundle_t *asset_store_acquire(void);
+
+/**
+ * @brief Releases a bundle returned by asset_store_acquire().
+ */
+void asset_store_release(const asset_bundle_t *bundle);
+
+/**
+ * @brief Starts writing a new image into the inactive slot.
+ *
+ * Only one upload can be in progress at a time.
+ *
+ * @param image_size Exact size of the image that will be written
+ * @param sha256 Expected SHA-256 of the image
+ * @return
+ *      - ESP_OK: upload started
+ *      - ESP_ERR_INVALID_STATE: another upload is in progress, or the previous image is still being sent
+ *      - ESP_ERR_INVALID_SIZE: the image does not fit into a slot
+ *      - ESP_ERR_NOT_FOUND: the asset partitions are missing
+ */
+esp_err_t asset_store_upload_begin(size_t image_size, const uint8_t sha256[32]);
+
+/**
+ * @brief Appends image data, erasing flash sectors just ahead of the write position.
+ *
+ * @return
+ *      - ESP_OK: data written
+ *      - ESP_ERR_INVALID_SIZE: more data than announced in asset_store_upload_begin()
+ *      - Other: flash error
+ */
+esp_err_t asset_store_upload_write(const void *data, size_t len);
+
+/**
+ * @brief Verifies the written image and atomically makes it the active one.
+ *
+ * @return
+ *      - ESP_OK: new image active
+ *      - ESP_ERR_INVALID_SIZE: fewer bytes written than announced
+ *      - ESP_ERR_INVALID_CRC: SHA-256 mismatch
+ *      - Other: the image is malformed or a flash error occurred
+ */
+esp_err_t asset_store_upload_finish(void);
+
+/**
+ * @brief Abandons an upload in progress; the active image is unaffected.
+ */
+void asset_store_upload_abort(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,511 @@
+/*
+ * 🧾 Audit Log - persistent record of unlock attempts 🗃️
+ *
+ * Flash layout: the partition is a ring of 256-byte pages, 16 to a 4 KB
+ * sector. Each page holds a 24-byte header (magic, sequence number, time of
+ * its first record, payload length, record count, CRC-32) followed by
+ * records:
+ *
+ *   byte 0     event (bits 0-2, bit 3 of it in bit 5), channel (bits 3-4),
+ *              full IPv6 address (bit 7)
+ *   varint     milliseconds since the previous record (the first: since base_ms)
+ *   4/16 bytes client address (IPv4 for IPv4-mapped addresses)
+ *
+ * A page is programmed in one write once it is full or has been pending for
+ * AUDIT_FLUSH_MS, so a torn write only ever loses that page (its CRC fails).
+ * Sectors are erased just before their first page is written. The RAM index
+ * holds the sequence number and time of the first page of every sector.
+ */
+
+#include "audit_log.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_log.h"
+#include "lock_hal.h"
+#include "mem_placement.h"
+#include "task_topology.h"
+
+/* 🏷️ Log tag for the audit log */
+static const char *TAG = "audit";
+
+#define AUDIT_PARTITION_LABEL   "audit"
+#define AUDIT_PARTITION_SUBTYPE 0x41
+
+/* Flash geometry */
+#define AUDIT_PAGE_SIZE         256
+#define AUDIT_SECTOR_SIZE       4096
+#define AUDIT_PAGES_PER_SECTOR  (AUDIT_SECTOR_SIZE / AUDIT_PAGE_SIZE)
+#define AUDIT_MAX_SECTORS       64
+
+#define AUDIT_PAGE_MAGIC        0x31544441 // 'ADT1'
+#define AUDIT_HEADER_SIZE       24
+#define AUDIT_PAYLOAD_MAX       (AUDIT_PAGE_SIZE - AUDIT_HEADER_SIZE)
+#define AUDIT_RECORD_MAX        (1 + 5 + AUDIT_ADDR_LEN)
+
+/* A partly filled page is written after this long */
+#define AUDIT_FLUSH_MS          10000
+
+/* Writer queue and task stack */
+#define AUDIT_QUEUE_LEN         32
+#define AUDIT_TASK_STACK        3072
+
+/**
+ * @brief Page header; the CRC covers the header up to `crc` and the payload.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;        /*!< Page sequence number, 1 for the first page ever written */
+    uint64_t base_ms;    /*!< Time of the first record */
+    uint16_t len;        /*!< Payload bytes */
+    uint16_t count;      /*!< Records in the payload */
+    uint32_t crc;
+} audit_page_header_t;
+
+typedef struct {
+    audit_page_header_t hdr;
+    uint8_t payload[AUDIT_PAYLOAD_MAX];
+} audit_page_t;
+
+_Static_assert(sizeof(audit_page_header_t) == AUDIT_HEADER_SIZE, "audit page header layout");
+_Static_assert(sizeof(audit_page_t) == AUDIT_PAGE_SIZE, "audit page layout");
+
+static const uint8_t v4_mapped_prefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+
+static const esp_partition_t *part;
+static uint32_t page_count;                 /*!< Pages in the ring */
+
+/* Sparse index: first page of every sector, first_seq 0 if the sector holds none */
+static LOCK_COLD_BSS struct {
+    uint32_t first_seq;
+    uint64_t first_ms;
+} sector_index[AUDIT_MAX_SECTORS];
+
+/* Writer state, protected by audit_lock */
+static uint32_t write_page;                 /*!< Ring position of the next page write */
+static uint32_t next_seq = 1;
+static LOCK_COLD_BSS audit_page_t pending;  /*!< Page being filled; flash writes bounce it */
+static uint64_t last_ms;                    /*!< Time of the newest record, stored or pending */
+static int64_t pending_since_us;            /*!< When the first pending record arrived */
+
+static int64_t clock_offset_ms;
+static QueueHandle_t audit_queue;
+static StaticQueue_t audit_queue_buf;
+static uint8_t audit_queue_items[AUDIT_QUEUE_LEN * sizeof(audit_record_t)];
+static SemaphoreHandle_t audit_lock;
+static StaticSemaphore_t audit_lock_buf;
+TASK_TOPOLOGY_MEM_DEFINE(audit_mem, AUDIT_TASK_STACK);
+static uint32_t dropped;
+
+static uint32_t audit_page_crc(const audit_page_t *page) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&page->hdr, offsetof(audit_page_header_t, crc));
+    return esp_rom_crc32_le(crc, page->payload, page->hdr.len);
+}
+
+static bool audit_page_valid(const audit_page_t *page) {
+    return page->hdr.magic == AUDIT_PAGE_MAGIC && page->hdr.len <= AUDIT_PAYLOAD_MAX &&
+           page->hdr.crc == audit_page_crc(page);
+}
+
+static esp_err_t audit_read_page(uint32_t index, audit_page_t *page) {
+    return esp_partition_read(part, (size_t)index * AUDIT_PAGE_SIZE, page, sizeof(*page));
+}
+
+/**
+ * @brief Appends one encoded record to a payload.
+ *
+ * @return Encoded length.
+ */
+static size_t audit_encode(uint8_t *out, const audit_record_t *rec, uint64_t prev_ms) {
+    bool v4 = memcmp(rec->addr, v4_mapped_prefix, sizeof(v4_mapped_prefix)) == 0;
+    uint64_t delta = rec->time_ms > prev_ms ? rec->time_ms - prev_ms : 0;
+    uint32_t varint = delta > UINT32_MAX ? UINT32_MAX : (uint32_t)delta;
+    size_t n = 0;
+
+    out[n++] = (uint8_t)((rec->event & 0x07) | ((rec->event & 0x08) << 2) | (rec->channel << 3) |
+                         (v4 ? 0 : 0x80));
+    while (varint >= 0x80) {
+        out[n++] = (uint8_t)(varint | 0x80);
+        varint >>= 7;
+    }
+    out[n++] = (uint8_t)varint;
+    if (v4) {
+        memcpy(out + n, rec->addr + 12, 4);
+        n += 4;
+    } else {
+        memcpy(out + n, rec->addr, AUDIT_ADDR_LEN);
+        n += AUDIT_ADDR_LEN;
+    }
+    return n;
+}
+
+/**
+ * @brief Decodes the record at *pos and advances *pos past it.
+ *
+ * @return false if the payload is malformed.
+ */
+static bool audit_decode(const uint8_t *payload, size_t len, size_t *pos, uint64_t *time_ms,
+                         audit_record_t *rec) {
+    size_t p = *pos;
+    if (p >= len) {
+        return false;
+    }
+    uint8_t tag = payload[p++];
+    uint32_t delta = 0;
+    for (int shift = 0;; shift += 7) {
+        if (p >= len || shift > 28) {
+            return false;
+        }
+        uint8_t b = payload[p++];
+        delta |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            break;
+        }
+    }
+    size_t addr_len = (tag & 0x80) ? AUDIT_ADDR_LEN : 4;
+    if (len - p < addr_len) {
+        return false;
+    }
+    *time_ms += delta;
+    rec->time_ms = *time_ms;
+    rec->event = (audit_event_t)((tag & 0x07) | ((tag >> 2) & 0x08));
+    rec->channel = (audit_channel_t)((tag >> 3) & 0x03);
+    if (tag & 0x80) {
+        memcpy(rec->addr, payload + p, AUDIT_ADDR_LEN);
+    } else {
+        memcpy(rec->addr, v4_mapped_prefix, sizeof(v4_mapped_prefix));
+        memcpy(rec->addr + 12, payload + p, 4);
+    }
+    *pos = p + addr_len;
+    return true;
+}
+
+/**
+ * @brief Returns the time of the last record of a valid page.
+ */
+static uint64_t audit_page_end_ms(const audit_page_t *page) {
+    uint64_t t = page->hdr.base_ms;
+    size_t pos = 0;
+    audit_record_t rec;
+    while (audit_decode(page->payload, page->hdr.len, &pos, &t, &rec)) {
+    }
+    return t;
+}
+
+/**
+ * @brief Writes the pending page to flash. Must be called with audit_lock held.
+ */
+static void audit_flush_locked(void) {
+    if (pending.hdr.count == 0) {
+        return;
+    }
+
+    uint32_t sector = write_page / AUDIT_PAGES_PER_SECTOR;
+    esp_err_t err = ESP_OK;
+    if (write_page % AUDIT_PAGES_PER_SECTOR == 0) {
+        // Entering a sector: its oldest records make room for the new ones
+        sector_index[sector].first_seq = 0;
+        err = esp_partition_erase_range(part, (size_t)sector * AUDIT_SECTOR_SIZE, AUDIT_SECTOR_SIZE);
+    }
+
+    pending.hdr.magic = AUDIT_PAGE_MAGIC;
+    pending.hdr.seq = next_seq;
+    pending.hdr.crc = audit_page_crc(&pending);
+    if (err == ESP_OK) {
+        err = esp_partition_write(part, (size_t)write_page * AUDIT_PAGE_SIZE, &pending,
+                                  AUDIT_HEADER_SIZE + pending.hdr.len);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Cannot write audit page %lu: %s", (unsigned long)write_page, esp_err_to_name(err));
+    } else if (write_page % AUDIT_PAGES_PER_SECTOR == 0) {
+        sector_index[sector].first_seq = next_seq;
+        sector_index[sector].first_ms = pending.hdr.base_ms;
+    }
+
+    next_seq++;
+    write_page = (write_page + 1) % page_count;
+    memset(&pending, 0, sizeof(pending));
+}
+
+/**
+ * @brief Adds a record to the pending page. Must be called with audit_lock held.
+ */
+static void audit_append_locked(audit_record_t *rec) {
+    // Records from different tasks may arrive slightly out of order
+    if (rec->time_ms < last_ms) {
+        rec->time_ms = last_ms;
+    }
+    if (pending.hdr.count && pending.hdr.len + AUDIT_RECORD_MAX > AUDIT_PAYLOAD_MAX) {
+        audit_flush_locked();
+    }
+    if (pending.hdr.count == 0) {
+        pending.hdr.base_ms = rec->time_ms;
+        pending_since_us = lock_hal_time_us();
+        last_ms = rec->time_ms;
+    }
+    pending.hdr.len += audit_encode(pending.payload + pending.hdr.len, rec, last_ms);
+    pending.hdr.count++;
+    last_ms = rec->time_ms;
+}
+
+/**
+ * @brief Writer task body: batches queued records into pages.
+ *
+ * @param arg Unused.
+ */
+static void audit_task(void *arg) {
+    uint32_t reported = 0;
+
+    for (;;) {
+        TickType_t wait = portMAX_DELAY;
+        if (pending.hdr.count) {
+            int64_t remaining_us = pending_since_us + AUDIT_FLUSH_MS * 1000LL - lock_hal_time_us();
+            wait = remaining_us > 0 ? pdMS_TO_TICKS((remaining_us + 999) / 1000) + 1 : 0;
+        }
+
+        audit_record_t rec;
+        bool received = xQueueReceive(audit_queue, &rec, wait) == pdTRUE;
+        xSemaphoreTake(audit_lock, portMAX_DELAY);
+        if (received) {
+            audit_append_locked(&rec);
+        } else {
+            audit_flush_locked();
+        }
+        xSemaphoreGive(audit_lock);
+
+        uint32_t lost = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+        if (lost != reported) {
+            ESP_LOGW(TAG, "⚠️ %lu audit records dropped, queue full", (unsigned long)(lost - reported));
+            reported = lost;
+        }
+    }
+}
+
+/**
+ * @brief Rebuilds the sector index and finds the write position.
+ */
+static void audit_scan(void) {
+    static audit_page_t page; // scanned once at boot, keep it off the stack
+    uint32_t sectors = page_count / AUDIT_PAGES_PER_SECTOR;
+    int newest = -1;
+
+    for (uint32_t s = 0; s < sectors; s++) {
+        sector_index[s].first_seq = 0;
+        if (audit_read_page(s * AUDIT_PAGES_PER_SECTOR, &page) == ESP_OK && audit_page_valid(&page)) {
+            sector_index[s].first_seq = page.hdr.seq;
+            sector_index[s].first_ms = page.hdr.base_ms;
+            if (newest < 0 || page.hdr.seq > sector_index[newest].first_seq) {
+                newest = s;
+            }
+        }
+    }
+    if (newest < 0) {
+        write_page = 0;
+        return;
+    }
+
+    // Walk the newest sector up to its first unwritten page
+    uint32_t p = newest * AUDIT_PAGES_PER_SECTOR;
+    uint32_t end = p + AUDIT_PAGES_PER_SECTOR;
+    for (; p < end; p++) {
+        if (audit_read_page(p, &page) != ESP_OK) {
+            continue;
+        }
+        if (audit_page_valid(&page)) {
+            next_seq = page.hdr.seq + 1;
+            last_ms = audit_page_end_ms(&page);
+            continue;
+        }
+        // Only a fully erased page can be programmed; skip pages torn by power loss
+        bool erased = true;
+        for (size_t i = 0; i < sizeof(page) && erased; i++) {
+            erased = ((const uint8_t *)&page)[i] == 0xff;
+        }
+        if (erased) {
+            break;
+        }
+    }
+    write_page = p % page_count;
+}
+
+esp_err_t audit_log_init(void) {
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, AUDIT_PARTITION_SUBTYPE, AUDIT_PARTITION_LABEL);
+    if (!part) {
+        ESP_LOGW(TAG, "⚠️ Partition %s not found, audit records are discarded", AUDIT_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint32_t sectors = part->size / AUDIT_SECTOR_SIZE;
+    page_count = (sectors < AUDIT_MAX_SECTORS ? sectors : AUDIT_MAX_SECTORS) * AUDIT_PAGES_PER_SECTOR;
+
+    audit_scan();
+    // Continue the clock after the newest stored record
+    clock_offset_ms = last_ms ? (int64_t)last_ms + 1 - lock_hal_time_us() / 1000 : 0;
+
+    audit_lock = xSemaphoreCreateMutexStatic(&audit_lock_buf);
+    audit_queue = xQueueCreateStatic(AUDIT_QUEUE_LEN, sizeof(audit_record_t), audit_queue_items, &audit_queue_buf);
+    if (task_topology_create(TASK_ROLE_AUDIT, audit_task, "audit", AUDIT_TASK_STACK, NULL,
+                             TASK_TOPOLOGY_MEM(audit_mem), NULL) != pdPASS) {
+        ESP_LOGE(TAG, "❌ Failed to start the audit writer");
+        audit_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "🧾 Audit log ready: %lu pages, next page %lu (sequence %lu)",
+             (unsigned long)page_count, (unsigned long)write_page, (unsigned long)next_seq);
+    return ESP_OK;
+}
+
+uint64_t audit_log_now_ms(void) {
+    return (uint64_t)(lock_hal_time_us() / 1000 + clock_offset_ms);
+}
+
+void audit_log_record(audit_event_t event, audit_channel_t channel, const uint8_t addr[AUDIT_ADDR_LEN]) {
+    if (!audit_queue) {
+        return;
+    }
+    audit_record_t rec = {
+        .time_ms = audit_log_now_ms(),
+        .event = event,
+        .channel = channel,
+    };
+    memcpy(rec.addr, addr, AUDIT_ADDR_LEN);
+    if (xQueueSend(audit_queue, &rec, 0) != pdTRUE) {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Visits the records of one page that fall into the range.
+ *
+ * @param done Set once a record newer than to_ms has been seen.
+ */
+static esp_err_t audit_visit_page(const audit_page_t *page, uint64_t from_ms, uint64_t to_ms,
+                                  audit_visit_fn_t visit, void *ctx, bool *done) {
+    uint64_t t = page->hdr.base_ms;
+    size_t pos = 0;
+    audit_record_t rec;
+    while (audit_decode(page->payload, page->hdr.len, &pos, &t, &rec)) {
+        if (rec.time_ms > to_ms) {
+            *done = true;
+            break;
+        }
+        if (rec.time_ms >= from_ms) {
+            esp_err_t err = visit(ctx, &rec);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t audit_log_query(uint64_t from_ms, uint64_t to_ms, audit_visit_fn_t visit, void *ctx) {
+    audit_page_t page;
+    audit_page_t tail;
+    uint32_t start, end;
+    bool done = false;
+
+    if (!audit_queue) {
+        return ESP_OK;
+    }
+
+    // Snapshot the write position and the pending page, so a concurrent flush
+    // cannot make records appear twice or not at all
+    xSemaphoreTake(audit_lock, portMAX_DELAY);
+    end = write_page;
+    memcpy(&tail, &pending, sizeof(tail));
+    uint32_t sectors = page_count / AUDIT_PAGES_PER_SECTOR;
+    int newest = -1;
+    for (uint32_t s = 0; s < sectors; s++) {
+        if (sector_index[s].first_seq &&
+            (newest < 0 || sector_index[s].first_seq > sector_index[newest].first_seq)) {
+            newest = s;
+        }
+    }
+    // Oldest to newest: start at the last sector that begins before from_ms; one that
+    // begins at from_ms may follow records of that same millisecond in the sector before it
+    int first = -1;
+    for (uint32_t k = 1; newest >= 0 && k <= sectors; k++) {
+        uint32_t s = (newest + k) % sectors;
+        if (!sector_index[s].first_seq) {
+            continue;
+        }
+        if (first < 0 || sector_index[s].first_ms < from_ms) {
+            first = s;
+        }
+    }
+    xSemaphoreGive(audit_lock);
+
+    // A full ring starts and ends at the same page
+    start = first >= 0 ? first * AUDIT_PAGES_PER_SECTOR : end;
+    uint32_t pages = (end + page_count - start) % page_count;
+    if (pages == 0 && first >= 0) {
+        pages = page_count;
+    }
+    for (uint32_t i = 0, p = start; i < pages && !done; i++, p = (p + 1) % page_count) {
+        esp_err_t err = audit_read_page(p, &page);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (!audit_page_valid(&page)) {
+            continue;
+        }
+        if (page.hdr.base_ms > to_ms) {
+            break;
+        }
+        err = audit_visit_page(&page, from_ms, to_ms, visit, ctx, &done);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (!done && tail.hdr.count) {
+        return audit_visit_page(&tail, from_ms, to_ms, visit, ctx, &done);
+    }
+    return ESP_OK;
+}
+
+const char *audit_event_name(audit_event_t event) {
+    switch (event) {
+    case AUDIT_EVT_UNLOCK:
+        return "unlock";
+    case AUDIT_EVT_BAD_TOKEN:
+        return "bad_token";
+    case AUDIT_EVT_UNKNOWN_CHALLENGE:
+        return "unknown_challenge";
+    case AUDIT_EVT_REPLAY:
+        return "replay";
+    case AUDIT_EVT_ASSETS_UPDATED:
+        return "assets_updated";
+    case AUDIT_EVT_UNKNOWN_CREDENTIAL:
+        return "unknown_credential";
+    case AUDIT_EVT_CREDS_UPDATED:
+        return "credentials_updated";
+    case AUDIT_EVT_OUTSIDE_SCHEDULE:
+        return "outside_schedule";
+    case AUDIT_EVT_POLICY_UPDATED:
+        return "policy_updated";
+    case AUDIT_EVT_CLOCK_SET:
+        return "clock_set";
+    case AUDIT_EVT_CONFIG_UPDATED:
+        return "config_updated";
+    }
+    return "unknown";
+}
+
+const char *audit_channel_name(audit_channel_t channel) {
+    switch (channel) {
+    case AUDIT_CH_HTTP:
+        return "http";
+    case AUDIT_CH_WS:
+        return "ws";
+    case AUDIT_CH_COUNTER:
+        return "counter";
+    case AUDIT_CH_ADMIN:
+        return "admin";
+    }
+    return "unknown";
+}
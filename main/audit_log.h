@@ -0,0 +1,127 @@
+/*
+ * 🧾 Audit Log - persistent record of unlock attempts 🗃️
+ *
+ * Every unlock attempt (and every web asset replacement) is appended to the
+ * `audit` data partition, so the history survives reboots. Records are
+ * compact binary with delta-encoded timestamps, collected in RAM and written
+ * one CRC-protected flash page at a time by a dedicated task; the partition is
+ * used as a ring, so the oldest sector is erased when the log wraps. A sparse
+ * per-sector time index lets range queries start close to the first match
+ * instead of scanning the partition.
+ *
+ * Timestamps are milliseconds on the "audit clock": time since boot, offset
+ * so that it continues where the newest stored record left off. The clock
+ * never runs backwards across reboots, but does not count time spent
+ * powered off.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size of client addresses in records (IPv6, or IPv4-mapped IPv6) */
+#define AUDIT_ADDR_LEN 16
+
+/**
+ * @brief What happened.
+ */
+typedef enum {
+    AUDIT_EVT_UNLOCK,             /*!< Valid response, lock opened */
+    AUDIT_EVT_BAD_TOKEN,          /*!< Response or counter token did not verify */
+    AUDIT_EVT_UNKNOWN_CHALLENGE,  /*!< Response to a challenge that was never issued, used or expired */
+    AUDIT_EVT_REPLAY,             /*!< Authentic counter that was already used or fell out of the window */
+    AUDIT_EVT_ASSETS_UPDATED,     /*!< Authenticated upload replaced the web asset image */
+    AUDIT_EVT_UNKNOWN_CREDENTIAL, /*!< Response named a credential that is not provisioned */
+    AUDIT_EVT_CREDS_UPDATED,      /*!< Authenticated upload replaced the credential table */
+    AUDIT_EVT_OUTSIDE_SCHEDULE,   /*!< Valid response from a credential outside its access schedule */
+    AUDIT_EVT_POLICY_UPDATED,     /*!< Authenticated request replaced the access policy */
+    AUDIT_EVT_CLOCK_SET,          /*!< Authenticated request set the wall clock */
+    AUDIT_EVT_CONFIG_UPDATED,     /*!< Authenticated request changed settings */
+} audit_event_t;
+
+/**
+ * @brief How the client reached the lock.
+ */
+typedef enum {
+    AUDIT_CH_HTTP,               /*!< POST /response */
+    AUDIT_CH_WS,                 /*!< WebSocket `response` command */
+    AUDIT_CH_COUNTER,            /*!< POST /unlock */
+    AUDIT_CH_ADMIN,              /*!< Authenticated administrative request */
+} audit_channel_t;
+
+/**
+ * @brief One decoded audit record.
+ */
+typedef struct {
+    uint64_t time_ms;               /*!< Audit clock time */
+    audit_event_t event;
+    audit_channel_t channel;
+    uint8_t addr[AUDIT_ADDR_LEN];   /*!< Client address */
+} audit_record_t;
+
+/**
+ * @brief Callback receiving records from audit_log_query().
+ *
+ * @return ESP_OK to continue, anything else stops the query.
+ */
+typedef esp_err_t (*audit_visit_fn_t)(void *ctx, const audit_record_t *rec);
+
+/**
+ * @brief Indexes the audit partition, restores the clock and starts the writer task.
+ *
+ * @return
+ *      - ESP_OK: audit log ready
+ *      - ESP_ERR_NOT_FOUND: the audit partition is missing (records are discarded)
+ *      - ESP_ERR_NO_MEM: the writer task could not be created
+ */
+esp_err_t audit_log_init(void);
+
+/**
+ * @brief Queues a record for the writer task without blocking.
+ *
+ * The record is stamped with the current audit clock. If the queue is full
+ * the record is dropped and counted.
+ *
+ * @param event What happened.
+ * @param channel How the client reached the lock.
+ * @param addr Client address.
+ */
+void audit_log_record(audit_event_t event, audit_channel_t channel, const uint8_t addr[AUDIT_ADDR_LEN]);
+
+/**
+ * @brief Returns the current audit clock time in milliseconds.
+ */
+uint64_t audit_log_now_ms(void);
+
+/**
+ * @brief Visits stored and pending records with from_ms <= time_ms <= to_ms, oldest first.
+ *
+ * Flash pages are read one at a time, starting at the sector the time index
+ * points to, and the scan stops at the first page newer than to_ms.
+ *
+ * @param from_ms Start of the range.
+ * @param to_ms End of the range.
+ * @param visit Callback receiving each record.
+ * @param ctx User argument passed to the callback.
+ *
+ * @return ESP_OK, the first error returned by the callback, or a flash error.
+ */
+esp_err_t audit_log_query(uint64_t from_ms, uint64_t to_ms, audit_visit_fn_t visit, void *ctx);
+
+/**
+ * @brief Returns a short lowercase name for an event ("unlock", "bad_token", ...).
+ */
+const char *audit_event_name(audit_event_t event);
+
+/**
+ * @brief Returns a short lowercase name for a channel ("http", "ws", "counter", "admin").
+ */
+const char *audit_channel_name(audit_channel_t channel);
+
+#ifdef __cplusplus
+}
+#endif
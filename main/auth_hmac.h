@@ -0,0 +1,141 @@
+/*
+ * 🔏 HMAC-SHA256 verification engine with pluggable backends 🧩
+ *
+ * A key object caches everything that only depends on the secret (for the
+ * software and mbedTLS backends: the SHA-256 midstates after the inner and
+ * outer pad blocks), so verifying a response costs only the compressions over
+ * the message plus a single outer block. Tags are compared in constant time.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Length of an HMAC-SHA256 tag in bytes, and of its lowercase hex encoding */
+#define AUTH_HMAC_LEN     32
+#define AUTH_HMAC_HEX_LEN (AUTH_HMAC_LEN * 2)
+
+/* Size of a stored key state (see auth_hmac_key_save()) */
+#define AUTH_HMAC_SAVED_KEY_LEN 64
+
+/* Opaque per-key state storage, large enough for every backend */
+#define AUTH_HMAC_KEY_STATE_SIZE 512
+
+typedef struct auth_hmac_backend_t auth_hmac_backend_t; /*!< Type of HMAC backend */
+
+/**
+ * @brief A prepared HMAC key bound to one backend.
+ */
+typedef struct {
+    const auth_hmac_backend_t *backend; /*!< Backend that prepared and uses this key */
+    union {
+        uint8_t bytes[AUTH_HMAC_KEY_STATE_SIZE];
+        uint64_t align;
+    } state;                            /*!< Backend specific cached key state */
+} auth_hmac_key_t;
+
+/* Available backends. The hardware peripheral backend is NULL on chips without an HMAC peripheral. */
+extern const auth_hmac_backend_t *const auth_hmac_backend_sw;      /*!< Portable software SHA-256 */
+extern const auth_hmac_backend_t *const auth_hmac_backend_mbedtls; /*!< mbedTLS SHA-256, hardware accelerated when CONFIG_MBEDTLS_HARDWARE_SHA is set */
+extern const auth_hmac_backend_t *const auth_hmac_backend_periph;  /*!< On-chip HMAC peripheral with an eFuse key */
+
+/**
+ * @brief Returns the backend selected in menuconfig.
+ */
+const auth_hmac_backend_t *auth_hmac_default_backend(void);
+
+/**
+ * @brief Returns the human readable name of a backend.
+ */
+const char *auth_hmac_backend_name(const auth_hmac_backend_t *backend);
+
+/**
+ * @brief Prepares a key for repeated use.
+ *
+ * @param key Key object to initialize
+ * @param backend Backend to bind the key to
+ * @param secret Raw secret bytes (ignored by the peripheral backend, which uses the configured eFuse key)
+ * @param secret_len Length of the secret in bytes
+ * @return
+ *      - ESP_OK: key prepared
+ *      - ESP_ERR_INVALID_ARG: invalid argument
+ *      - ESP_ERR_NOT_SUPPORTED: backend not available on this chip
+ */
+esp_err_t auth_hmac_key_init(auth_hmac_key_t *key, const auth_hmac_backend_t *backend,
+                             const uint8_t *secret, size_t secret_len);
+
+/**
+ * @brief Copies out the prepared state of a key, e.g. to keep many keys in flash.
+ *
+ * Only backends whose key state is plain data support this (the software
+ * backend: the two pad midstates). The saved state is as sensitive as the
+ * secret itself.
+ *
+ * @param key Prepared key
+ * @param saved Output state
+ * @return
+ *      - ESP_OK: state saved
+ *      - ESP_ERR_NOT_SUPPORTED: the key's backend cannot save its state
+ */
+esp_err_t auth_hmac_key_save(const auth_hmac_key_t *key, uint8_t saved[AUTH_HMAC_SAVED_KEY_LEN]);
+
+/**
+ * @brief Restores a key saved with auth_hmac_key_save(), without hashing the secret again.
+ *
+ * @param key Key object to initialize
+ * @param backend Backend the state was saved from
+ * @param saved Saved state
+ * @return
+ *      - ESP_OK: key prepared
+ *      - ESP_ERR_NOT_SUPPORTED: the backend cannot restore a saved state
+ */
+esp_err_t auth_hmac_key_load(auth_hmac_key_t *key, const auth_hmac_backend_t *backend,
+                             const uint8_t saved[AUTH_HMAC_SAVED_KEY_LEN]);
+
+/**
+ * @brief Computes HMAC-SHA256(key, msg).
+ *
+ * @param key Prepared key
+ * @param msg Message bytes
+ * @param msg_len Message length
+ * @param mac Output tag
+ * @return
+ *      - ESP_OK: tag computed
+ *      - ESP_FAIL: the backend failed
+ */
+esp_err_t auth_hmac_compute(const auth_hmac_key_t *key, const void *msg, size_t msg_len,
+                            uint8_t mac[AUTH_HMAC_LEN]);
+
+/**
+ * @brief Verifies a lowercase or uppercase hex encoded tag over a message.
+ *
+ * @param key Prepared key
+ * @param msg Message bytes
+ * @param msg_len Message length
+ * @param hex_tag NUL-terminated hex tag received from the client
+ * @return true if the tag is well-formed and matches, false otherwise
+ */
+bool auth_hmac_verify_hex(const auth_hmac_key_t *key, const void *msg, size_t msg_len,
+                          const char *hex_tag);
+
+/**
+ * @brief Compares two buffers in time independent of their contents.
+ *
+ * @return true if the buffers are equal
+ */
+bool auth_hmac_equal(const uint8_t *a, const uint8_t *b, size_t len);
+
+/**
+ * @brief Measures verifications per second for every available backend and logs the results.
+ */
+void auth_hmac_benchmark(void);
+
+#ifdef __cplusplus
+}
+#endif
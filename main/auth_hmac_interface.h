@@ -0,0 +1,59 @@
+/*
+ * 🧩 HMAC backend interface - implemented by auth_hmac_sw.c, auth_hmac_mbedtls.c
+ * and auth_hmac_periph.c
+ */
+#pragma once
+
+#include "auth_hmac.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief HMAC backend interface definition
+ */
+struct auth_hmac_backend_t {
+    /**
+     * @brief Short backend name used in logs and benchmarks
+     */
+    const char *name;
+
+    /**
+     * @brief Prepare the backend specific state of a key
+     *
+     * @param key: key whose `state` should be filled in
+     * @param secret: raw secret bytes
+     * @param secret_len: length of the secret
+     *
+     * @return
+     *      - ESP_OK: key prepared
+     *      - ESP_FAIL: backend failure
+     */
+    esp_err_t (*init_key)(auth_hmac_key_t *key, const uint8_t *secret, size_t secret_len);
+
+    /**
+     * @brief Compute HMAC-SHA256 of a message with a prepared key
+     *
+     * @param key: prepared key
+     * @param msg: message bytes
+     * @param msg_len: message length
+     * @param mac: output tag
+     *
+     * @return
+     *      - ESP_OK: tag computed
+     *      - ESP_FAIL: backend failure
+     */
+    esp_err_t (*compute)(const auth_hmac_key_t *key, const uint8_t *msg, size_t msg_len,
+                         uint8_t mac[AUTH_HMAC_LEN]);
+
+    /**
+     * @brief Size of the key state if it is plain data that can be stored and
+     * copied back byte for byte (AUTH_HMAC_SAVED_KEY_LEN), 0 otherwise
+     */
+    size_t saved_key_len;
+};
+
+#ifdef __cplusplus
+}
+#endif
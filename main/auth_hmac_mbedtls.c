@@ -0,0 +1,85 @@
+/*
+ * 🧰 mbedTLS HMAC-SHA256 backend
+ *
+ * Uses mbedtls_sha256, which runs on the SHA accelerator when
+ * CONFIG_MBEDTLS_HARDWARE_SHA is enabled. The key state holds two SHA-256
+ * contexts that have already absorbed the inner and outer pad blocks; each
+ * verification clones them instead of re-hashing the key.
+ */
+
+#include <string.h>
+#include "mbedtls/sha256.h"
+#include "auth_hmac_interface.h"
+
+/**
+ * @brief Cached contexts of an mbedTLS key.
+ */
+typedef struct {
+    mbedtls_sha256_context inner; /*!< Context after absorbing key ^ ipad */
+    mbedtls_sha256_context outer; /*!< Context after absorbing key ^ opad */
+} auth_hmac_mbedtls_state_t;
+
+_Static_assert(sizeof(auth_hmac_mbedtls_state_t) <= AUTH_HMAC_KEY_STATE_SIZE, "mbedTLS key state too large");
+
+static esp_err_t mbedtls_init_key(auth_hmac_key_t *key, const uint8_t *secret, size_t secret_len) {
+    auth_hmac_mbedtls_state_t *st = (auth_hmac_mbedtls_state_t *)key->state.bytes;
+    uint8_t k0[64] = {0};
+    uint8_t pad[64];
+    int ret;
+
+    // Keys longer than the block size are hashed first, per RFC 2104
+    if (secret_len > sizeof(k0)) {
+        if (mbedtls_sha256(secret, secret_len, k0, 0) != 0) {
+            return ESP_FAIL;
+        }
+    } else {
+        memcpy(k0, secret, secret_len);
+    }
+
+    mbedtls_sha256_init(&st->inner);
+    mbedtls_sha256_init(&st->outer);
+
+    for (int i = 0; i < 64; i++) {
+        pad[i] = k0[i] ^ 0x36;
+    }
+    ret = mbedtls_sha256_starts(&st->inner, 0);
+    ret |= mbedtls_sha256_update(&st->inner, pad, sizeof(pad));
+
+    for (int i = 0; i < 64; i++) {
+        pad[i] = k0[i] ^ 0x5c;
+    }
+    ret |= mbedtls_sha256_starts(&st->outer, 0);
+    ret |= mbedtls_sha256_update(&st->outer, pad, sizeof(pad));
+
+    memset(k0, 0, sizeof(k0));
+    memset(pad, 0, sizeof(pad));
+    return ret == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t mbedtls_compute(const auth_hmac_key_t *key, const uint8_t *msg, size_t msg_len,
+                                 uint8_t mac[AUTH_HMAC_LEN]) {
+    const auth_hmac_mbedtls_state_t *st = (const auth_hmac_mbedtls_state_t *)key->state.bytes;
+    mbedtls_sha256_context ctx;
+    uint8_t inner_digest[32];
+    int ret;
+
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_clone(&ctx, &st->inner);
+    ret = mbedtls_sha256_update(&ctx, msg, msg_len);
+    ret |= mbedtls_sha256_finish(&ctx, inner_digest);
+
+    mbedtls_sha256_clone(&ctx, &st->outer);
+    ret |= mbedtls_sha256_update(&ctx, inner_digest, sizeof(inner_digest));
+    ret |= mbedtls_sha256_finish(&ctx, mac);
+    mbedtls_sha256_free(&ctx);
+
+    return ret == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static const auth_hmac_backend_t mbedtls_backend = {
+    .name = "mbedtls",
+    .init_key = mbedtls_init_key,
+    .compute = mbedtls_compute,
+};
+
+const auth_hmac_backend_t *const auth_hmac_backend_mbedtls = &mbedtls_backend;
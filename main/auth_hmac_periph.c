@@ -0,0 +1,42 @@
+/*
+ * 🔑 On-chip HMAC peripheral backend
+ *
+ * The secret never leaves the chip: it is burned into an eFuse key block with
+ * the HMAC_UP purpose, and the peripheral computes the full HMAC-SHA256 in
+ * hardware. The raw secret passed to init_key is therefore ignored; the key
+ * state only records which eFuse key block to use.
+ */
+
+#include "soc/soc_caps.h"
+#include "sdkconfig.h"
+#include "auth_hmac_interface.h"
+
+#if SOC_HMAC_SUPPORTED
+
+#include "esp_hmac.h"
+
+static esp_err_t periph_init_key(auth_hmac_key_t *key, const uint8_t *secret, size_t secret_len) {
+    hmac_key_id_t *key_id = (hmac_key_id_t *)key->state.bytes;
+    *key_id = (hmac_key_id_t)(HMAC_KEY0 + CONFIG_LOCK_AUTH_HMAC_EFUSE_KEY_ID);
+    return ESP_OK;
+}
+
+static esp_err_t periph_compute(const auth_hmac_key_t *key, const uint8_t *msg, size_t msg_len,
+                                uint8_t mac[AUTH_HMAC_LEN]) {
+    const hmac_key_id_t *key_id = (const hmac_key_id_t *)key->state.bytes;
+    return esp_hmac_calculate(*key_id, msg, msg_len, mac);
+}
+
+static const auth_hmac_backend_t periph_backend = {
+    .name = "periph",
+    .init_key = periph_init_key,
+    .compute = periph_compute,
+};
+
+const auth_hmac_backend_t *const auth_hmac_backend_periph = &periph_backend;
+
+#else
+
+const auth_hmac_backend_t *const auth_hmac_backend_periph = NULL;
+
+#endif // SOC_HMAC_SUPPORTED
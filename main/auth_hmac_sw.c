@@ -0,0 +1,157 @@
+/*
+ * 🧮 Portable software HMAC-SHA256 backend
+ *
+ * The key state holds the SHA-256 chaining values after compressing the
+ * (key ^ ipad) and (key ^ opad) blocks, so a verification only compresses
+ * the message blocks and a single outer block.
+ */
+
+#include <string.h>
+#include "auth_hmac_interface.h"
+
+/**
+ * @brief Cached midstates of a software key.
+ */
+typedef struct {
+    uint32_t inner[8]; /*!< State after compressing key ^ ipad */
+    uint32_t outer[8]; /*!< State after compressing key ^ opad */
+} auth_hmac_sw_state_t;
+
+_Static_assert(sizeof(auth_hmac_sw_state_t) <= AUTH_HMAC_KEY_STATE_SIZE, "software key state too large");
+_Static_assert(sizeof(auth_hmac_sw_state_t) == AUTH_HMAC_SAVED_KEY_LEN, "software key state must be storable");
+
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * @brief SHA-256 compression function over one 64-byte block.
+ */
+static void sha256_compress(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/**
+ * @brief Finishes a hash that started from a midstate covering `prefix_len` bytes.
+ *
+ * @param state Chaining value, updated in place
+ * @param msg Remaining message bytes
+ * @param msg_len Remaining message length
+ * @param prefix_len Bytes already absorbed into `state` (a multiple of 64)
+ * @param digest Output digest
+ */
+static void sha256_finish_from(uint32_t state[8], const uint8_t *msg, size_t msg_len,
+                               uint64_t prefix_len, uint8_t digest[32]) {
+    uint64_t total_bits = (prefix_len + msg_len) * 8;
+    while (msg_len >= 64) {
+        sha256_compress(state, msg);
+        msg += 64;
+        msg_len -= 64;
+    }
+
+    uint8_t block[64] = {0};
+    memcpy(block, msg, msg_len);
+    block[msg_len] = 0x80;
+    if (msg_len >= 56) {
+        sha256_compress(state, block);
+        memset(block, 0, sizeof(block));
+    }
+    for (int i = 0; i < 8; i++) {
+        block[63 - i] = (uint8_t)(total_bits >> (i * 8));
+    }
+    sha256_compress(state, block);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (uint8_t)(state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)state[i];
+    }
+}
+
+static esp_err_t sw_init_key(auth_hmac_key_t *key, const uint8_t *secret, size_t secret_len) {
+    auth_hmac_sw_state_t *st = (auth_hmac_sw_state_t *)key->state.bytes;
+    uint8_t k0[64] = {0};
+
+    // Keys longer than the block size are hashed first, per RFC 2104
+    if (secret_len > sizeof(k0)) {
+        uint32_t h[8];
+        memcpy(h, sha256_iv, sizeof(h));
+        sha256_finish_from(h, secret, secret_len, 0, k0);
+    } else {
+        memcpy(k0, secret, secret_len);
+    }
+
+    uint8_t pad[64];
+    for (int i = 0; i < 64; i++) {
+        pad[i] = k0[i] ^ 0x36;
+    }
+    memcpy(st->inner, sha256_iv, sizeof(st->inner));
+    sha256_compress(st->inner, pad);
+
+    for (int i = 0; i < 64; i++) {
+        pad[i] = k0[i] ^ 0x5c;
+    }
+    memcpy(st->outer, sha256_iv, sizeof(st->outer));
+    sha256_compress(st->outer, pad);
+
+    memset(k0, 0, sizeof(k0));
+    memset(pad, 0, sizeof(pad));
+    return ESP_OK;
+}
+
+static esp_err_t sw_compute(const auth_hmac_key_t *key, const uint8_t *msg, size_t msg_len,
+                            uint8_t mac[AUTH_HMAC_LEN]) {
+    const auth_hmac_sw_state_t *st = (const auth_hmac_sw_state_t *)key->state.bytes;
+    uint32_t h[8];
+    uint8_t inner_digest[32];
+
+    memcpy(h, st->inner, sizeof(h));
+    sha256_finish_from(h, msg, msg_len, 64, inner_digest);
+
+    memcpy(h, st->outer, sizeof(h));
+    sha256_finish_from(h, inner_digest, sizeof(inner_digest), 64, mac);
+    return ESP_OK;
+}
+
+static const auth_hmac_backend_t sw_backend = {
+    .name = "software",
+    .init_key = sw_init_key,
+    .compute = sw_compute,
+    .saved_key_len = sizeof(auth_hmac_sw_state_t),
+};
+
+const auth_hmac_backend_t *const auth_hmac_backend_sw = &sw_backend;
@@ -0,0 +1,146 @@
+/*
+ * ⏱️ Boot Profiler - when each startup phase ran 🚀
+ *
+ * Phases end on different tasks and 64-bit stores are not atomic on Xtensa,
+ * so the timestamps are kept under a spinlock; every phase writes twice and
+ * the exporter reads them once per scrape.
+ */
+
+#include "boot_prof.h"
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "lock_hal.h"
+
+/* 🏷️ Log tag for the boot profiler */
+static const char *TAG = "boot_prof";
+
+static const char *const phase_names[BOOT_PHASE_COUNT] = {
+    [BOOT_PHASE_STATE] = "state",
+    [BOOT_PHASE_CONFIG] = "config",
+    [BOOT_PHASE_LED] = "led",
+    [BOOT_PHASE_NET_INIT] = "net_init",
+    [BOOT_PHASE_NET_UP] = "net_up",
+    [BOOT_PHASE_AUTH] = "auth",
+    [BOOT_PHASE_ASSETS] = "assets",
+    [BOOT_PHASE_CREDS] = "creds",
+    [BOOT_PHASE_AUDIT] = "audit",
+    [BOOT_PHASE_HTTPD] = "httpd",
+    [BOOT_PHASE_POLICY] = "policy",
+};
+
+/* Timestamps in µs on the monotonic clock, -1 until recorded */
+static struct {
+    int64_t start_us;
+    int64_t end_us;
+} phases[BOOT_PHASE_COUNT] = { [0 ... BOOT_PHASE_COUNT - 1] = { -1, -1 } };
+
+/* Power-on to the start of the monotonic clock, -1 if unknown; read with the first phase */
+static int64_t prestart_us = -1;
+static bool prestart_read;
+
+static portMUX_TYPE prof_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void boot_prof_begin(boot_phase_t phase) {
+    int64_t now = lock_hal_time_us();
+    if (!prestart_read) {
+        // Only app_main begins phases before any helper task exists
+        prestart_us = lock_hal_boot_prestart_us();
+        prestart_read = true;
+    }
+    portENTER_CRITICAL(&prof_lock);
+    phases[phase].start_us = now;
+    portEXIT_CRITICAL(&prof_lock);
+}
+
+void boot_prof_end(boot_phase_t phase) {
+    int64_t now = lock_hal_time_us();
+    portENTER_CRITICAL(&prof_lock);
+    phases[phase].end_us = now;
+    portEXIT_CRITICAL(&prof_lock);
+}
+
+int64_t boot_prof_ready_us(void) {
+    portENTER_CRITICAL(&prof_lock);
+    int64_t httpd = phases[BOOT_PHASE_HTTPD].end_us;
+    int64_t net = phases[BOOT_PHASE_NET_UP].end_us;
+    portEXIT_CRITICAL(&prof_lock);
+    if (httpd < 0 || net < 0) {
+        return -1;
+    }
+    return httpd > net ? httpd : net;
+}
+
+void boot_prof_log(void) {
+    if (prestart_us >= 0) {
+        ESP_LOGI(TAG, "⏱️ %-8s %.1f ms from power-on to app startup", "prestart", prestart_us / 1000.0);
+    }
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        portENTER_CRITICAL(&prof_lock);
+        int64_t start = phases[i].start_us, end = phases[i].end_us;
+        portEXIT_CRITICAL(&prof_lock);
+        if (start >= 0 && end >= start) {
+            ESP_LOGI(TAG, "⏱️ %-8s %8.1f .. %8.1f ms (%.1f ms)", phase_names[i], start / 1000.0, end / 1000.0,
+                     (end - start) / 1000.0);
+        }
+    }
+    int64_t ready = boot_prof_ready_us();
+    if (ready >= 0 && prestart_us >= 0) {
+        ESP_LOGI(TAG, "⏱️ Ready %.1f ms after app startup, %.1f ms after power-on", ready / 1000.0,
+                 (prestart_us + ready) / 1000.0);
+    } else if (ready >= 0) {
+        ESP_LOGI(TAG, "⏱️ Ready %.1f ms after app startup (not a power-on reset)", ready / 1000.0);
+    }
+}
+
+esp_err_t boot_prof_export(boot_prof_write_fn_t write, void *ctx) {
+    char line[256];
+    int len;
+    esp_err_t err;
+
+    static const char starts[] =
+        "# HELP lock_boot_phase_start_seconds Start of each boot phase on the monotonic clock.\n"
+        "# TYPE lock_boot_phase_start_seconds gauge\n";
+    static const char durations[] =
+        "# HELP lock_boot_phase_duration_seconds Duration of each boot phase; phases may overlap.\n"
+        "# TYPE lock_boot_phase_duration_seconds gauge\n";
+
+    for (int pass = 0; pass < 2; pass++) {
+        err = write(ctx, pass ? durations : starts, pass ? sizeof(durations) - 1 : sizeof(starts) - 1);
+        for (int i = 0; i < BOOT_PHASE_COUNT && err == ESP_OK; i++) {
+            portENTER_CRITICAL(&prof_lock);
+            int64_t start = phases[i].start_us, end = phases[i].end_us;
+            portEXIT_CRITICAL(&prof_lock);
+            if (start < 0 || end < start) {
+                continue;
+            }
+            len = snprintf(line, sizeof(line), "lock_boot_phase_%s_seconds{phase=\"%s\"} %.6f\n",
+                           pass ? "duration" : "start", phase_names[i], (pass ? end - start : start) / 1e6);
+            err = write(ctx, line, len);
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (prestart_us >= 0) {
+        len = snprintf(line, sizeof(line),
+                       "# HELP lock_boot_prestart_seconds Power-on to the start of the monotonic clock.\n"
+                       "# TYPE lock_boot_prestart_seconds gauge\n"
+                       "lock_boot_prestart_seconds %.6f\n", prestart_us / 1e6);
+        err = write(ctx, line, len);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    int64_t ready = boot_prof_ready_us();
+    if (ready >= 0) {
+        len = snprintf(line, sizeof(line),
+                       "# HELP lock_boot_ready_seconds Network up and HTTP server listening, on the monotonic clock.\n"
+                       "# TYPE lock_boot_ready_seconds gauge\n"
+                       "lock_boot_ready_seconds %.6f\n", ready / 1e6);
+        err = write(ctx, line, len);
+    }
+    return err;
+}
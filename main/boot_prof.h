@@ -0,0 +1,83 @@
+/*
+ * ⏱️ Boot Profiler - when each startup phase ran 🚀
+ *
+ * Startup is split into phases that record their start and end on the
+ * monotonic clock. Some of them overlap: the LED comes up on the lock
+ * controller task and the network on a helper task while app_main prepares
+ * the stores and starts the HTTP server. The time from power-on to the start
+ * of the monotonic clock (ROM, bootloader and early app startup) is added
+ * from the RTC timer when the chip came out of a power-on reset, which is
+ * the case that matters after a power blip.
+ *
+ * The profile is logged once the lock is ready and exported at /metrics.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Startup phases.
+ */
+typedef enum {
+    BOOT_PHASE_STATE,       /*!< NVS and the lock state persisted before the reset */
+    BOOT_PHASE_CONFIG,      /*!< Settings read from NVS, pre-shared key prepared */
+    BOOT_PHASE_LED,         /*!< LED driver set up in the restored color, on the lock controller task */
+    BOOT_PHASE_NET_INIT,    /*!< NVS, ESP-NETIF and the event loop */
+    BOOT_PHASE_NET_UP,      /*!< Wi-Fi access point (or QEMU Ethernet) started, on a helper task */
+    BOOT_PHASE_AUTH,        /*!< Challenge store and nonce pool */
+    BOOT_PHASE_ASSETS,      /*!< Asset partitions mapped and indexed */
+    BOOT_PHASE_CREDS,       /*!< Credential partitions mapped */
+    BOOT_PHASE_AUDIT,       /*!< Audit log scanned */
+    BOOT_PHASE_HTTPD,       /*!< HTTP workers and server listening */
+    BOOT_PHASE_POLICY,      /*!< Stored access policy read and compiled, on first use */
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+
+/**
+ * @brief Marks the start of a phase.
+ */
+void boot_prof_begin(boot_phase_t phase);
+
+/**
+ * @brief Marks the end of a phase.
+ */
+void boot_prof_end(boot_phase_t phase);
+
+/**
+ * @brief Returns when the lock became ready, in µs on the monotonic clock.
+ *
+ * Ready means the HTTP server is listening and the network is up.
+ *
+ * @return Time of the later of the two, or -1 while either is pending.
+ */
+int64_t boot_prof_ready_us(void);
+
+/**
+ * @brief Logs every phase that has run, with its start, end and duration.
+ */
+void boot_prof_log(void);
+
+/**
+ * @brief Callback receiving the export of boot_prof_export() piece by piece.
+ */
+typedef esp_err_t (*boot_prof_write_fn_t)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Exports the phases and the ready time in the Prometheus text format.
+ *
+ * @param write Sink for the text
+ * @param ctx Passed to write
+ * @return ESP_OK, or the first error returned by write
+ */
+esp_err_t boot_prof_export(boot_prof_write_fn_t write, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,217 @@
+/*
+ * 🎲 Challenge Store - outstanding challenge nonces for concurrent unlock flows 🔢
+ *
+ * Linear probing over a power-of-two slot array, FNV-1a hashing of the nonce
+ * string and backward-shift deletion (no tombstones), so lookups stay short
+ * no matter how many challenges have been issued and consumed. All table
+ * operations are bounded by the slot count and run inside a spinlock critical
+ * section, which keeps the httpd task and the periodic reaper consistent.
+ */
+
+#include "challenge_store.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+#include "lock_hal.h"
+#include "esp_log.h"
+
+/* 🏷️ Log tag for the challenge store */
+static const char *TAG = "challenge";
+
+/* Table geometry: slot count must be a power of two */
+#define CHALLENGE_STORE_SLOTS    64
+#define CHALLENGE_STORE_MAX_LIVE 48   // keep the load factor at or below 75%
+
+/* ⏳ How long an issued challenge stays valid */
+#define CHALLENGE_TTL_US         (30LL * 1000 * 1000)
+
+/* 🧹 Reaper period */
+#define CHALLENGE_REAP_PERIOD_MS 5000
+
+/**
+ * @brief One outstanding challenge; an empty slot has nonce[0] == '\0'.
+ */
+typedef struct {
+    char nonce[CHALLENGE_NONCE_MAX_LEN + 1]; /*!< NUL-terminated nonce */
+    int64_t expires_us;                      /*!< lock_hal_time_us() time after which the entry is invalid */
+} challenge_entry_t;
+
+static challenge_entry_t slots[CHALLENGE_STORE_SLOTS];
+static size_t live_count = 0;
+static uint32_t evicted_count = 0;
+static portMUX_TYPE store_lock = portMUX_INITIALIZER_UNLOCKED;
+static TimerHandle_t reaper_timer = NULL;
+
+/**
+ * @brief FNV-1a hash of a NUL-terminated string, reduced to a slot index.
+ */
+static size_t challenge_home_slot(const char *nonce) {
+    uint32_t h = 2166136261u;
+    while (*nonce) {
+        h ^= (uint8_t)*nonce++;
+        h *= 16777619u;
+    }
+    return h & (CHALLENGE_STORE_SLOTS - 1);
+}
+
+/**
+ * @brief Finds the slot holding a nonce. Must be called with store_lock held.
+ *
+ * @return Slot index, or -1 if the nonce is not present.
+ */
+static int challenge_find_locked(const char *nonce) {
+    size_t i = challenge_home_slot(nonce);
+    for (size_t probes = 0; probes < CHALLENGE_STORE_SLOTS; probes++) {
+        if (slots[i].nonce[0] == '\0') {
+            return -1;
+        }
+        if (strcmp(slots[i].nonce, nonce) == 0) {
+            return (int)i;
+        }
+        i = (i + 1) & (CHALLENGE_STORE_SLOTS - 1);
+    }
+    return -1;
+}
+
+/**
+ * @brief Empties a slot and shifts later members of its probe run back, so
+ *        that no tombstones are needed. Must be called with store_lock held.
+ */
+static void challenge_remove_locked(size_t hole) {
+    size_t i = (hole + 1) & (CHALLENGE_STORE_SLOTS - 1);
+    while (slots[i].nonce[0] != '\0') {
+        size_t home = challenge_home_slot(slots[i].nonce);
+        // Move the entry into the hole unless its home lies cyclically in (hole, i]
+        size_t dist_hole = (i - hole) & (CHALLENGE_STORE_SLOTS - 1);
+        size_t dist_home = (i - home) & (CHALLENGE_STORE_SLOTS - 1);
+        if (dist_home >= dist_hole) {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+        i = (i + 1) & (CHALLENGE_STORE_SLOTS - 1);
+    }
+    slots[hole].nonce[0] = '\0';
+    live_count--;
+}
+
+/**
+ * @brief Removes every expired entry. Must be called with store_lock held.
+ */
+static size_t challenge_reap_locked(int64_t now) {
+    size_t removed = 0;
+    size_t i = 0;
+    while (i < CHALLENGE_STORE_SLOTS) {
+        if (slots[i].nonce[0] != '\0' && slots[i].expires_us <= now) {
+            // Backward shift may pull another entry into slot i, so re-check it
+            challenge_remove_locked(i);
+            removed++;
+        } else {
+            i++;
+        }
+    }
+    return removed;
+}
+
+/**
+ * @brief Removes the entry issued first. Must be called with store_lock held.
+ *
+ * Every entry lives for the same time, so the oldest is the one expiring first.
+ */
+static void challenge_evict_oldest_locked(void) {
+    size_t oldest = CHALLENGE_STORE_SLOTS;
+    for (size_t i = 0; i < CHALLENGE_STORE_SLOTS; i++) {
+        if (slots[i].nonce[0] != '\0' &&
+            (oldest == CHALLENGE_STORE_SLOTS || slots[i].expires_us < slots[oldest].expires_us)) {
+            oldest = i;
+        }
+    }
+    if (oldest < CHALLENGE_STORE_SLOTS) {
+        challenge_remove_locked(oldest);
+        evicted_count++;
+    }
+}
+
+static void challenge_reaper_cb(TimerHandle_t timer) {
+    size_t removed = challenge_store_reap();
+    if (removed) {
+        ESP_LOGD(TAG, "🧹 Reaped %u expired challenges", (unsigned)removed);
+    }
+}
+
+esp_err_t challenge_store_init(void) {
+    memset(slots, 0, sizeof(slots));
+    live_count = 0;
+    evicted_count = 0;
+
+    // A FreeRTOS software timer, so the store runs unchanged on the linux target
+    reaper_timer = xTimerCreate("chal_reaper", pdMS_TO_TICKS(CHALLENGE_REAP_PERIOD_MS), pdTRUE, NULL,
+                                challenge_reaper_cb);
+    if (!reaper_timer) {
+        return ESP_ERR_NO_MEM;
+    }
+    return xTimerStart(reaper_timer, 0) == pdPASS ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t challenge_store_put(const char *nonce) {
+    size_t len = strlen(nonce);
+    if (len == 0 || len > CHALLENGE_NONCE_MAX_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t now = lock_hal_time_us();
+    esp_err_t err = ESP_OK;
+
+    portENTER_CRITICAL(&store_lock);
+    if (challenge_find_locked(nonce) >= 0) {
+        err = ESP_ERR_INVALID_STATE;
+    } else {
+        if (live_count >= CHALLENGE_STORE_MAX_LIVE) {
+            challenge_reap_locked(now);
+        }
+        if (live_count >= CHALLENGE_STORE_MAX_LIVE) {
+            challenge_evict_oldest_locked();
+        }
+        size_t i = challenge_home_slot(nonce);
+        while (slots[i].nonce[0] != '\0') {
+            i = (i + 1) & (CHALLENGE_STORE_SLOTS - 1);
+        }
+        memcpy(slots[i].nonce, nonce, len + 1);
+        slots[i].expires_us = now + CHALLENGE_TTL_US;
+        live_count++;
+    }
+    portEXIT_CRITICAL(&store_lock);
+
+    return err;
+}
+
+bool challenge_store_consume(const char *nonce) {
+    if (nonce[0] == '\0' || strlen(nonce) > CHALLENGE_NONCE_MAX_LEN) {
+        return false;
+    }
+
+    int64_t now = lock_hal_time_us();
+    bool valid = false;
+
+    portENTER_CRITICAL(&store_lock);
+    int i = challenge_find_locked(nonce);
+    if (i >= 0) {
+        valid = slots[i].expires_us > now;
+        challenge_remove_locked((size_t)i);
+    }
+    portEXIT_CRITICAL(&store_lock);
+
+    return valid;
+}
+
+size_t challenge_store_reap(void) {
+    int64_t now = lock_hal_time_us();
+    portENTER_CRITICAL(&store_lock);
+    size_t removed = challenge_reap_locked(now);
+    portEXIT_CRITICAL(&store_lock);
+    return removed;
+}
+
+uint32_t challenge_store_evicted(void) {
+    return __atomic_load_n(&evicted_count, __ATOMIC_RELAXED);
+}
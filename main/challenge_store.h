@@ -0,0 +1,78 @@
+/*
+ * 🎲 Challenge Store - outstanding challenge nonces for concurrent unlock flows 🔢
+ *
+ * A fixed-capacity, open-addressed hash table keyed by the nonce string. Every
+ * issued challenge gets its own entry with an expiry time, so several phones
+ * can run the challenge/response flow in parallel. Entries are single-use and
+ * expired entries are swept by a periodic reaper. When the store is full the
+ * oldest challenge makes room for the new one, so a client requesting
+ * challenges in a loop cannot lock everybody else out until its challenges
+ * expire. No memory is allocated after challenge_store_init().
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest nonce string (without the terminator) the store can hold */
+#define CHALLENGE_NONCE_MAX_LEN 24
+
+/**
+ * @brief Initializes the store and starts the periodic reaper.
+ *
+ * @return
+ *      - ESP_OK: store ready
+ *      - Other: the reaper timer could not be created or started
+ */
+esp_err_t challenge_store_init(void);
+
+/**
+ * @brief Records a freshly issued nonce.
+ *
+ * If the store is full, the outstanding challenge issued first is dropped
+ * (see challenge_store_evicted()).
+ *
+ * @param nonce NUL-terminated nonce, at most CHALLENGE_NONCE_MAX_LEN characters.
+ *
+ * @return
+ *      - ESP_OK: nonce stored
+ *      - ESP_ERR_INVALID_ARG: nonce is empty or too long
+ *      - ESP_ERR_INVALID_STATE: the same nonce is already outstanding
+ */
+esp_err_t challenge_store_put(const char *nonce);
+
+/**
+ * @brief Looks up and removes a nonce.
+ *
+ * A nonce can be consumed at most once; the entry is removed whether or not
+ * the caller's subsequent verification succeeds.
+ *
+ * @param nonce NUL-terminated nonce received from the client.
+ *
+ * @return true if the nonce was outstanding and not expired, false otherwise.
+ */
+bool challenge_store_consume(const char *nonce);
+
+/**
+ * @brief Removes all expired entries.
+ *
+ * Called periodically by the reaper; may also be called directly.
+ *
+ * @return Number of entries removed.
+ */
+size_t challenge_store_reap(void);
+
+/**
+ * @brief Returns how many unexpired challenges were dropped to make room for new ones.
+ */
+uint32_t challenge_store_evicted(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,448 @@
+/*
+ * ⚙️ Config Store - runtime settings kept in NVS, changed without a reboot 🔄
+ *
+ * Every setting is described once in `fields`: its key (which is also its
+ * NVS key), type, place in lock_config_t, limits and the group it belongs
+ * to. Loading, parsing, validating, storing and formatting all walk that
+ * table, so a new setting is one struct member and one table row.
+ *
+ * Snapshots are taken round-robin from a small static pool. The one after
+ * the active snapshot is always the one replaced longest ago; an update
+ * reuses it once it has been out of use for CONFIG_STORE_GRACE_MS, which
+ * stands in for the grace period of RCU: readers never hold a snapshot
+ * across a wait, so none can still be reading it after that long. Updates
+ * are serialized with the `updating` flag.
+ */
+
+#include "config_store.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "lock_hal.h"
+
+/* 🏷️ Log tag for the config store */
+static const char *TAG = "config_store";
+
+#define CONFIG_NVS_NAMESPACE   "lock_cfg"
+
+/* Snapshots in the pool: the active one, and two that updates in quick succession can use */
+#define CONFIG_SNAPSHOTS       3
+
+#define CONFIG_GRACE_US        ((int64_t)CONFIG_STORE_GRACE_MS * 1000)
+
+/* Rounds timed by config_store_benchmark() */
+#define CONFIG_BENCH_READS     100000
+
+/**
+ * @brief Storage type of a setting.
+ */
+typedef enum {
+    CONFIG_FIELD_STR,           /*!< NUL-terminated char array, nvs_set_str() */
+    CONFIG_FIELD_U32,           /*!< uint32_t, nvs_set_u32() */
+} config_field_type_t;
+
+/**
+ * @brief Description of one setting.
+ */
+typedef struct {
+    const char *key;            /*!< Name in the text form and NVS key, at most 15 characters */
+    config_field_type_t type;
+    size_t offset;              /*!< Offset in lock_config_t */
+    size_t size;                /*!< Size of the member */
+    uint32_t min;               /*!< Shortest string, or smallest number */
+    uint32_t max;               /*!< Longest string, or largest number */
+    uint32_t group;             /*!< config_store_changed_t bit */
+    bool secret;                /*!< Left out by config_store_format() */
+    bool (*usable)(uint32_t);   /*!< Further check of a number within limits, or NULL */
+} config_field_t;
+
+#define CONFIG_FIELD(member, type, min, max, group, secret, usable) \
+    { #member, type, offsetof(lock_config_t, member), sizeof(((lock_config_t *)0)->member), min, max, group, \
+      secret, usable }
+
+static const config_field_t fields[] = {
+    CONFIG_FIELD(ap_ssid, CONFIG_FIELD_STR, 1, CONFIG_STORE_SSID_MAX_LEN, CONFIG_STORE_CHANGED_NET, false, NULL),
+    CONFIG_FIELD(ap_password, CONFIG_FIELD_STR, 8, CONFIG_STORE_PASSWORD_MAX_LEN, CONFIG_STORE_CHANGED_NET, true,
+                 NULL),
+    CONFIG_FIELD(led_gpio, CONFIG_FIELD_U32, 0, UINT32_MAX, CONFIG_STORE_CHANGED_LED, false,
+                 lock_hal_led_gpio_usable),
+    CONFIG_FIELD(bad_token_ms, CONFIG_FIELD_U32, 100, 600000, CONFIG_STORE_CHANGED_LOCK, false, NULL),
+    CONFIG_FIELD(psk, CONFIG_FIELD_STR, 1, CONFIG_STORE_PSK_MAX_LEN, CONFIG_STORE_CHANGED_AUTH, true, NULL),
+};
+
+#define CONFIG_FIELD_COUNT (sizeof(fields) / sizeof(fields[0]))
+
+#define CONFIG_STR_(x) #x
+#define CONFIG_STR(x)  CONFIG_STR_(x)
+
+/* The menuconfig defaults in the text form, parsed like an update so that they are held to the same limits */
+static const char default_text[] =
+    "ap_ssid=" CONFIG_LOCK_AP_SSID "\n"
+    "ap_password=" CONFIG_LOCK_AP_PASSWORD "\n"
+    "led_gpio=" CONFIG_STR(CONFIG_BLINK_GPIO) "\n"
+    "bad_token_ms=" CONFIG_STR(CONFIG_LOCK_BAD_TOKEN_MS) "\n"
+    "psk=" CONFIG_LOCK_PSK "\n";
+
+/* Snapshot pool; only the active snapshot is read outside updates */
+static lock_config_t snapshots[CONFIG_SNAPSHOTS];
+const lock_config_t *config_store_active = &snapshots[0];
+
+/* lock_hal_time_us() when each snapshot stopped being the active one */
+static int64_t retired_us[CONFIG_SNAPSHOTS] = { [0 ... CONFIG_SNAPSHOTS - 1] = -CONFIG_GRACE_US };
+
+/* Set while an update builds the next snapshot in `staging` */
+static bool updating;
+static lock_config_t staging;
+
+/**
+ * @brief Returns the address of a setting in a snapshot.
+ */
+static void *field_ptr(lock_config_t *config, const config_field_t *field) {
+    return (uint8_t *)config + field->offset;
+}
+
+/**
+ * @brief Checks a string setting against its length limits.
+ */
+static bool field_str_valid(const config_field_t *field, const char *value) {
+    size_t len = strnlen(value, field->size);
+    return len < field->size && len >= field->min && len <= field->max;
+}
+
+/**
+ * @brief Checks a number setting against its limits and, if it has one, its usable() check.
+ */
+static bool field_u32_valid(const config_field_t *field, uint32_t value) {
+    return value >= field->min && value <= field->max && (!field->usable || field->usable(value));
+}
+
+/**
+ * @brief Parses a value in the text form into a snapshot.
+ *
+ * @param field Setting to set
+ * @param config Snapshot receiving the value
+ * @param value Value text
+ * @param len Length of value
+ * @return true if the value is well-formed and in range.
+ */
+static bool field_parse(const config_field_t *field, lock_config_t *config, const char *value, size_t len) {
+    if (field->type == CONFIG_FIELD_STR) {
+        if (len < field->min || len > field->max || memchr(value, '\0', len)) {
+            return false;
+        }
+        char *dst = field_ptr(config, field);
+        memcpy(dst, value, len);
+        dst[len] = '\0';
+        return true;
+    }
+
+    char digits[11];
+    char *end;
+    if (len == 0 || len >= sizeof(digits) || value[0] < '0' || value[0] > '9') {
+        return false;
+    }
+    memcpy(digits, value, len);
+    digits[len] = '\0';
+    errno = 0;
+    unsigned long number = strtoul(digits, &end, 10);
+    if (*end != '\0' || errno != 0 || (uint32_t)number != number || !field_u32_valid(field, number)) {
+        return false;
+    }
+    *(uint32_t *)field_ptr(config, field) = (uint32_t)number;
+    return true;
+}
+
+/**
+ * @brief Tells whether a setting differs between two snapshots.
+ */
+static bool field_differs(const config_field_t *field, const lock_config_t *a, const lock_config_t *b) {
+    const void *pa = (const uint8_t *)a + field->offset;
+    const void *pb = (const uint8_t *)b + field->offset;
+    if (field->type == CONFIG_FIELD_STR) {
+        return strcmp(pa, pb) != 0;
+    }
+    return *(const uint32_t *)pa != *(const uint32_t *)pb;
+}
+
+/**
+ * @brief Overrides the settings in a snapshot with those stored in NVS.
+ */
+static void config_load_nvs(lock_config_t *config) {
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return; // Nothing was ever stored
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Stored settings unreadable, using the defaults: %s", esp_err_to_name(err));
+        return;
+    }
+
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        const config_field_t *field = &fields[i];
+        void *dst = field_ptr(config, field);
+        if (field->type == CONFIG_FIELD_STR) {
+            char value[CONFIG_STORE_PSK_MAX_LEN + 1]; // the longest string setting
+            size_t len = sizeof(value);
+            err = nvs_get_str(nvs, field->key, value, &len);
+            if (err == ESP_OK && !field_str_valid(field, value)) {
+                err = ESP_ERR_INVALID_SIZE;
+            }
+            if (err == ESP_OK) {
+                strlcpy(dst, value, field->size);
+            }
+        } else {
+            uint32_t value;
+            err = nvs_get_u32(nvs, field->key, &value);
+            if (err == ESP_OK && !field_u32_valid(field, value)) {
+                err = ESP_ERR_INVALID_ARG;
+            }
+            if (err == ESP_OK) {
+                *(uint32_t *)dst = value;
+            }
+        }
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "⚠️ Stored %s ignored: %s", field->key, esp_err_to_name(err));
+        }
+    }
+    nvs_close(nvs);
+}
+
+/**
+ * @brief Stores the settings of the given groups in NVS.
+ */
+static esp_err_t config_save_nvs(const lock_config_t *config, uint32_t groups) {
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT && err == ESP_OK; i++) {
+        const config_field_t *field = &fields[i];
+        const void *src = (const uint8_t *)config + field->offset;
+        if (!(field->group & groups)) {
+            continue;
+        }
+        err = field->type == CONFIG_FIELD_STR ? nvs_set_str(nvs, field->key, src)
+                                              : nvs_set_u32(nvs, field->key, *(const uint32_t *)src);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
+
+/**
+ * @brief Applies the text form to `staging`, which holds a copy of the active settings.
+ *
+ * @param text Settings text
+ * @param len Length of text
+ * @param error_line Receives the line of the first error
+ * @return ESP_OK, ESP_ERR_NOT_FOUND or ESP_ERR_INVALID_ARG.
+ */
+static esp_err_t config_parse(const char *text, size_t len, int *error_line) {
+    const char *end = text + len;
+    int line_no = 0;
+
+    for (const char *line = text; line < end;) {
+        const char *eol = memchr(line, '\n', end - line);
+        const char *next = eol ? eol + 1 : end;
+        if (!eol) {
+            eol = end;
+        }
+        if (eol > line && eol[-1] == '\r') {
+            eol--;
+        }
+        line_no++;
+
+        if (eol > line && line[0] != '#') {
+            const char *eq = memchr(line, '=', eol - line);
+            if (!eq) {
+                *error_line = line_no;
+                return ESP_ERR_INVALID_ARG;
+            }
+            const config_field_t *field = NULL;
+            for (size_t i = 0; i < CONFIG_FIELD_COUNT && !field; i++) {
+                if (strlen(fields[i].key) == (size_t)(eq - line) && memcmp(fields[i].key, line, eq - line) == 0) {
+                    field = &fields[i];
+                }
+            }
+            if (!field) {
+                *error_line = line_no;
+                return ESP_ERR_NOT_FOUND;
+            }
+            if (!field_parse(field, &staging, eq + 1, eol - (eq + 1))) {
+                *error_line = line_no;
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+        line = next;
+    }
+    return ESP_OK;
+}
+
+esp_err_t config_store_init(void) {
+    lock_config_t *config = &snapshots[0];
+    int error_line = 0;
+
+    // The defaults set every setting; the rest, generation included, starts from zero
+    memset(&staging, 0, sizeof(staging));
+    esp_err_t err = config_parse(default_text, strlen(default_text), &error_line);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Default for %s is out of range, check menuconfig", fields[error_line - 1].key);
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(config, &staging, sizeof(*config));
+    config_load_nvs(config);
+    err = auth_hmac_key_init(&config->psk_key, auth_hmac_default_backend(),
+                             (const uint8_t *)config->psk, strlen(config->psk));
+    if (err != ESP_OK) {
+        return err;
+    }
+    __atomic_store_n(&config_store_active, config, __ATOMIC_RELEASE);
+    ESP_LOGI(TAG, "⚙️ Settings ready: SSID '%s', LED on GPIO %lu, bad token indication %lu ms",
+             config->ap_ssid, (unsigned long)config->led_gpio, (unsigned long)config->bad_token_ms);
+    return ESP_OK;
+}
+
+esp_err_t config_store_update(const char *text, size_t len, int *error_line, uint32_t *changed) {
+    *error_line = 0;
+    *changed = 0;
+    if (len > CONFIG_STORE_TEXT_MAX_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (__atomic_exchange_n(&updating, true, __ATOMIC_ACQUIRE)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Only updates change the active pointer, so it is stable while `updating` is held
+    const lock_config_t *current = config_store_active;
+    memcpy(&staging, current, sizeof(staging));
+    esp_err_t err = config_parse(text, len, error_line);
+    for (size_t i = 0; err == ESP_OK && i < CONFIG_FIELD_COUNT; i++) {
+        if (field_differs(&fields[i], &staging, current)) {
+            *changed |= fields[i].group;
+        }
+    }
+    if (err != ESP_OK || *changed == 0) {
+        goto out;
+    }
+
+    // Readers of the spare, if any, loaded it at least one grace period ago
+    size_t index = current - snapshots;
+    lock_config_t *spare = &snapshots[(index + 1) % CONFIG_SNAPSHOTS];
+    int64_t wait_us = retired_us[spare - snapshots] + CONFIG_GRACE_US - lock_hal_time_us();
+    if (wait_us > 0) {
+        vTaskDelay(pdMS_TO_TICKS(wait_us / 1000) + 1);
+    }
+    memcpy(spare, &staging, sizeof(*spare));
+    if (*changed & CONFIG_STORE_CHANGED_AUTH) {
+        err = auth_hmac_key_init(&spare->psk_key, auth_hmac_default_backend(),
+                                 (const uint8_t *)spare->psk, strlen(spare->psk));
+        if (err != ESP_OK) {
+            goto out;
+        }
+    }
+    spare->generation = current->generation + 1;
+
+    __atomic_store_n(&config_store_active, spare, __ATOMIC_RELEASE);
+    retired_us[index] = lock_hal_time_us();
+    ESP_LOGI(TAG, "⚙️ Settings generation %lu active, changed groups 0x%02lx",
+             (unsigned long)spare->generation, (unsigned long)*changed);
+
+    // led_gpio waits for config_store_confirm_led_gpio()
+    uint32_t store = *changed & ~CONFIG_STORE_CHANGED_LED;
+    esp_err_t nvs_err = store ? config_save_nvs(spare, store) : ESP_OK;
+    if (nvs_err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Settings not stored, they are lost on reboot: %s", esp_err_to_name(nvs_err));
+    }
+
+out:
+    __atomic_store_n(&updating, false, __ATOMIC_RELEASE);
+    return err;
+}
+
+esp_err_t config_store_confirm_led_gpio(uint32_t gpio) {
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_u32(nvs, "led_gpio", gpio);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
+
+size_t config_store_format(char *buf, size_t size) {
+    const lock_config_t *config = config_store_get();
+    size_t len = 0;
+
+    len += snprintf(buf, size, "# generation %lu\n", (unsigned long)config->generation);
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT && len < size; i++) {
+        const config_field_t *field = &fields[i];
+        const void *value = (const uint8_t *)config + field->offset;
+        if (field->secret) {
+            continue;
+        }
+        if (field->type == CONFIG_FIELD_STR) {
+            len += snprintf(buf + len, size - len, "%s=%s\n", field->key, (const char *)value);
+        } else {
+            len += snprintf(buf + len, size - len, "%s=%lu\n", field->key,
+                            (unsigned long)*(const uint32_t *)value);
+        }
+    }
+    return len < size ? len : size - 1;
+}
+
+#if CONFIG_LOCK_CONFIG_BENCHMARK
+
+void config_store_benchmark(void) {
+    static StaticSemaphore_t mutex_buf;
+    SemaphoreHandle_t mutex = xSemaphoreCreateMutexStatic(&mutex_buf);
+    static uint32_t pins;
+    volatile uint32_t sink = 0;
+
+    // Snapshot pointer, as every reader in the firmware does it
+    int64_t start = lock_hal_time_us();
+    for (int i = 0; i < CONFIG_BENCH_READS; i++) {
+        sink += config_store_get()->bad_token_ms;
+    }
+    int64_t pointer_us = lock_hal_time_us() - start;
+
+    // Pinned like an access policy check: announce the reader, read, leave
+    start = lock_hal_time_us();
+    for (int i = 0; i < CONFIG_BENCH_READS; i++) {
+        __atomic_fetch_add(&pins, 1, __ATOMIC_SEQ_CST);
+        sink += __atomic_load_n(&config_store_active, __ATOMIC_SEQ_CST)->bad_token_ms;
+        __atomic_fetch_sub(&pins, 1, __ATOMIC_RELEASE);
+    }
+    int64_t pinned_us = lock_hal_time_us() - start;
+
+    // A mutex around a shared struct, the usual alternative
+    start = lock_hal_time_us();
+    for (int i = 0; i < CONFIG_BENCH_READS; i++) {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        sink += snapshots[0].bad_token_ms;
+        xSemaphoreGive(mutex);
+    }
+    int64_t mutex_us = lock_hal_time_us() - start;
+    vSemaphoreDelete(mutex);
+
+    ESP_LOGI(TAG, "⏱️ Setting read %lld ns (snapshot pointer) vs %lld ns (pinned) vs %lld ns (mutex)",
+             (long long)pointer_us * 1000 / CONFIG_BENCH_READS, (long long)pinned_us * 1000 / CONFIG_BENCH_READS,
+             (long long)mutex_us * 1000 / CONFIG_BENCH_READS);
+    (void)sink;
+}
+
+#endif /* CONFIG_LOCK_CONFIG_BENCHMARK */
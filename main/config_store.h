@@ -0,0 +1,164 @@
+/*
+ * ⚙️ Config Store - runtime settings kept in NVS, changed without a reboot 🔄
+ *
+ * The settings that used to be compiled in (access point SSID and password,
+ * LED GPIO, length of the bad-token indication and the pre-shared key) live
+ * in one typed record. Defaults come from menuconfig; values set with
+ * PUT /config are kept in NVS, one entry per setting, and override them
+ * from the next boot on.
+ *
+ * Readers get the whole record as one immutable snapshot: config_store_get()
+ * is a single pointer load, with no lock and no counter to update. An update
+ * fills a spare snapshot and publishes it with one pointer store, so a reader
+ * sees either the old or the new settings completely. A replaced snapshot is
+ * only reused after CONFIG_STORE_GRACE_MS, which is why readers must not keep
+ * the pointer across anything that waits (a socket, a queue, a delay); load
+ * it again instead. The pre-shared key is kept prepared for HMAC inside the
+ * snapshot, so a new key is in force from the next verification on.
+ *
+ * The text form, used by PUT and GET /config, is one `key=value` per line,
+ * the value running to the end of the line:
+ *
+ *     ap_ssid=Front door
+ *     ap_password=correct horse
+ *     led_gpio=48
+ *     bad_token_ms=4000
+ *     psk=DEFAULT_KEY
+ *
+ * An update only needs the lines of the settings it changes. Blank lines and
+ * lines starting with `#` are ignored.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "auth_hmac.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest access point SSID and WPA2 passphrase (IEEE 802.11) */
+#define CONFIG_STORE_SSID_MAX_LEN     32
+#define CONFIG_STORE_PASSWORD_MAX_LEN 63
+
+/* Longest pre-shared key, one SHA-256 block */
+#define CONFIG_STORE_PSK_MAX_LEN      64
+
+/* Longest update accepted by config_store_update() */
+#define CONFIG_STORE_TEXT_MAX_LEN     512
+
+/* How long a replaced snapshot stays untouched before an update may reuse it */
+#define CONFIG_STORE_GRACE_MS         5000
+
+/**
+ * @brief Groups of settings, reported by config_store_update() when they change.
+ */
+typedef enum {
+    CONFIG_STORE_CHANGED_NET  = 1 << 0, /*!< ap_ssid or ap_password: reconfigure the access point */
+    CONFIG_STORE_CHANGED_LED  = 1 << 1, /*!< led_gpio: move the status LED */
+    CONFIG_STORE_CHANGED_LOCK = 1 << 2, /*!< bad_token_ms: used from the next bad token on */
+    CONFIG_STORE_CHANGED_AUTH = 1 << 3, /*!< psk: used from the next verification on */
+} config_store_changed_t;
+
+/**
+ * @brief One snapshot of the settings. Never changes once published.
+ */
+typedef struct {
+    char ap_ssid[CONFIG_STORE_SSID_MAX_LEN + 1];         /*!< Access point SSID */
+    char ap_password[CONFIG_STORE_PASSWORD_MAX_LEN + 1]; /*!< Access point WPA/WPA2 passphrase, 8 characters or more */
+    uint32_t led_gpio;                                   /*!< GPIO driving the addressable status LED */
+    uint32_t bad_token_ms;                               /*!< How long the LED stays blue after a bad token */
+    char psk[CONFIG_STORE_PSK_MAX_LEN + 1];              /*!< Pre-shared key */
+    auth_hmac_key_t psk_key;                             /*!< psk prepared for the configured HMAC backend */
+    uint32_t generation;                                 /*!< 0 at boot, counts the updates since */
+} lock_config_t;
+
+/* Current snapshot; read it with config_store_get() */
+extern const lock_config_t *config_store_active;
+
+/**
+ * @brief Loads the settings stored in NVS over the menuconfig defaults.
+ *
+ * Must follow lock_hal_storage_init() and come before anything reads the
+ * settings. A stored value that is no longer valid is ignored with a
+ * warning; the lock still starts from the defaults if NVS cannot be opened.
+ *
+ * @return
+ *      - ESP_OK: settings ready
+ *      - ESP_ERR_INVALID_ARG: a menuconfig default is out of range
+ *      - Error from auth_hmac_key_init(): the pre-shared key could not be prepared
+ */
+esp_err_t config_store_init(void);
+
+/**
+ * @brief Returns the current settings.
+ *
+ * Lock-free and safe from any task; see the top of this file for how long
+ * the snapshot may be used.
+ */
+static inline const lock_config_t *config_store_get(void) {
+    return __atomic_load_n(&config_store_active, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Applies settings in the text form, stores them in NVS and publishes them.
+ *
+ * Either every line is applied or, on any error, none is. May wait up to
+ * CONFIG_STORE_GRACE_MS when updates follow each other closely, for the
+ * snapshot it reuses to fall out of use. A failed NVS write is logged and
+ * leaves the new settings active until the next reboot. A new led_gpio is
+ * not stored here but by config_store_confirm_led_gpio(), once the LED has
+ * come up on it.
+ *
+ * @param text Settings, not necessarily NUL-terminated
+ * @param len Length of text
+ * @param error_line Receives the 1-based line of the first error, 0 if none
+ * @param changed Receives the config_store_changed_t groups that changed
+ * @return
+ *      - ESP_OK: settings active (changed may be 0 if nothing differed)
+ *      - ESP_ERR_INVALID_SIZE: text longer than CONFIG_STORE_TEXT_MAX_LEN
+ *      - ESP_ERR_NOT_FOUND: unknown setting on error_line
+ *      - ESP_ERR_INVALID_ARG: malformed or out of range value on error_line
+ *      - ESP_ERR_INVALID_STATE: another update is in progress
+ *      - Error from auth_hmac_key_init(): the new pre-shared key could not be prepared
+ */
+esp_err_t config_store_update(const char *text, size_t len, int *error_line, uint32_t *changed);
+
+/**
+ * @brief Stores led_gpio in NVS once the LED runs on it.
+ *
+ * Called by the lock controller after it moved the LED for an update, so a
+ * GPIO the LED driver could not use is never what the next boot starts from.
+ *
+ * @param gpio GPIO the LED now runs on
+ * @return ESP_OK, or the NVS error.
+ */
+esp_err_t config_store_confirm_led_gpio(uint32_t gpio);
+
+/**
+ * @brief Writes the current settings in the text form, without the secrets.
+ *
+ * The first line is a comment with the generation; ap_password and psk are
+ * left out, so the output can be edited and sent back as an update.
+ *
+ * @param buf Output buffer
+ * @param size Size of buf
+ * @return Length of the text, truncated to size - 1 like snprintf().
+ */
+size_t config_store_format(char *buf, size_t size);
+
+#if CONFIG_LOCK_CONFIG_BENCHMARK
+/**
+ * @brief Logs the cost of reading a setting through the snapshot pointer,
+ *        next to a reader-pinned and a mutex-guarded read of the same value.
+ */
+void config_store_benchmark(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,199 @@
+/*
+ * 🪪 Credential Store - per-phone HMAC keys in A/B flash partitions 🗝️
+ *
+ * Partition layout: a 64-byte slot header (see slot_store.c) followed by the
+ * table image written by tools/gen_creds.py, all integers little endian:
+ *
+ *   header      32 bytes   magic 'CRD1', version, credential count, hash seed,
+ *                          bucket count, offsets of the tables below, image size
+ *   buckets     u16[nb]    displacement per bucket of the minimal perfect hash
+ *   entries     100 B each one per credential, stored at its perfect-hash slot:
+ *                          FNV-1a hash of the ID, NUL-padded ID, access
+ *                          schedule, and the software backend's inner and
+ *                          outer pad midstates
+ *
+ * The perfect hash is the one used for web asset paths (see perfect_hash.h).
+ */
+
+#include "cred_store.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "perfect_hash.h"
+#include "slot_store.h"
+
+/* 🏷️ Log tag for the credential store */
+static const char *TAG = "cred_store";
+
+#define CRED_SLOT_SUBTYPE     0x42
+#define CRED_SLOT_MAGIC       0x544c5343 // 'CSLT'
+
+#define CRED_TABLE_MAGIC      0x31445243 // 'CRD1'
+#define CRED_TABLE_VERSION    2
+
+/**
+ * @brief Table header as written by gen_creds.py.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t count;
+    uint32_t seed;
+    uint32_t bucket_count;
+    uint32_t buckets_off;
+    uint32_t entries_off;
+    uint32_t image_size;
+} cred_table_header_t;
+
+/**
+ * @brief Table entry as written by gen_creds.py.
+ */
+typedef struct {
+    uint32_t hash;                               /*!< FNV-1a of the ID with the table seed */
+    char id[CRED_ID_MAX_LEN + 1];                /*!< NUL-padded ID */
+    uint8_t schedule;                            /*!< Access schedule (see access_policy.h) */
+    uint8_t reserved[3];
+    uint8_t saved_key[AUTH_HMAC_SAVED_KEY_LEN];  /*!< See auth_hmac_key_save() */
+} cred_entry_t;
+
+_Static_assert(sizeof(cred_table_header_t) == 32, "credential table header layout");
+_Static_assert(sizeof(cred_entry_t) == 100, "credential entry layout");
+
+/**
+ * @brief An opened, validated table.
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t seed;
+    uint32_t bucket_mask;
+    const uint16_t *buckets;
+    const cred_entry_t *entries;
+} cred_table_t;
+
+static esp_err_t cred_slot_open(int slot, const uint8_t *image, size_t size);
+
+static slot_store_t store = {
+    .tag = "cred_store",
+    .what = "credential table",
+    .subtype = CRED_SLOT_SUBTYPE,
+    .magic = CRED_SLOT_MAGIC,
+    .open = cred_slot_open,
+    .slots = { { .label = "creds_a" }, { .label = "creds_b" } },
+    .active = -1,
+};
+static cred_table_t slot_tables[2];
+
+/**
+ * @brief Validates a table image and prepares it for lookups.
+ *
+ * Every ID is checked to be NUL-terminated once here, so an entry can only
+ * match IDs of at most CRED_ID_MAX_LEN characters.
+ */
+static esp_err_t cred_table_open(cred_table_t *table, const uint8_t *base, size_t size) {
+    cred_table_header_t hdr;
+
+    if (size < sizeof(hdr)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(&hdr, base, sizeof(hdr));
+    if (hdr.magic != CRED_TABLE_MAGIC || hdr.version != CRED_TABLE_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    // Both tables are read with aligned loads; the bucket count is a power of two
+    if (hdr.image_size > size || hdr.bucket_count == 0 ||
+        (hdr.bucket_count & (hdr.bucket_count - 1)) != 0 ||
+        (hdr.buckets_off & 1) != 0 || (hdr.entries_off & 3) != 0 ||
+        hdr.buckets_off > hdr.image_size || hdr.bucket_count > (hdr.image_size - hdr.buckets_off) / sizeof(uint16_t) ||
+        hdr.entries_off > hdr.image_size || hdr.count > (hdr.image_size - hdr.entries_off) / sizeof(cred_entry_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const cred_entry_t *entries = (const cred_entry_t *)(base + hdr.entries_off);
+    for (uint32_t i = 0; i < hdr.count; i++) {
+        if (entries[i].id[CRED_ID_MAX_LEN] != '\0') {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+
+    table->count = hdr.count;
+    table->seed = hdr.seed;
+    table->bucket_mask = hdr.bucket_count - 1;
+    table->buckets = (const uint16_t *)(base + hdr.buckets_off);
+    table->entries = entries;
+    return ESP_OK;
+}
+
+static esp_err_t cred_slot_open(int slot, const uint8_t *image, size_t size) {
+    return cred_table_open(&slot_tables[slot], image, size);
+}
+
+/**
+ * @brief Logs which table is used from now on.
+ */
+static void cred_store_log_active(void) {
+    int active = slot_store_active(&store);
+    if (active >= 0) {
+        ESP_LOGI(TAG, "🪪 %lu credentials from %s (generation %u)", (unsigned long)slot_tables[active].count,
+                 store.slots[active].label, (unsigned)store.slots[active].generation);
+    } else {
+        ESP_LOGI(TAG, "🪪 No credentials provisioned, only the pre-shared key is accepted");
+    }
+}
+
+esp_err_t cred_store_init(void) {
+    esp_err_t err = slot_store_init(&store);
+    cred_store_log_active();
+    return err;
+}
+
+size_t cred_store_count(void) {
+    int active = slot_store_active(&store);
+    return active >= 0 ? slot_tables[active].count : 0;
+}
+
+esp_err_t cred_store_lookup(const char *id, auth_hmac_key_t *key, uint8_t *schedule) {
+    size_t len = strnlen(id, CRED_ID_MAX_LEN + 1);
+    if (len > CRED_ID_MAX_LEN) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Pinned, so that an upload cannot erase the table while the entry is read
+    int slot = slot_store_pin(&store);
+    if (slot < 0 || slot_tables[slot].count == 0) {
+        slot_store_unpin(&store, slot);
+        return ESP_ERR_NOT_FOUND;
+    }
+    const cred_table_t *table = &slot_tables[slot];
+    uint32_t h = perfect_hash_key(id, len, table->seed);
+    const cred_entry_t *e = &table->entries[perfect_hash_slot(h, table->buckets, table->bucket_mask, table->count)];
+
+    // Every ID maps to some slot; confirm it is really this one
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (e->hash == h && memcmp(e->id, id, len + 1) == 0) {
+        *schedule = e->schedule;
+        err = auth_hmac_key_load(key, auth_hmac_backend_sw, e->saved_key);
+    }
+    slot_store_unpin(&store, slot);
+    return err;
+}
+
+esp_err_t cred_store_upload_begin(size_t image_size, const uint8_t sha256[32]) {
+    return slot_store_upload_begin(&store, image_size, sha256);
+}
+
+esp_err_t cred_store_upload_write(const void *data, size_t len) {
+    return slot_store_upload_write(&store, data, len);
+}
+
+esp_err_t cred_store_upload_finish(void) {
+    esp_err_t err = slot_store_upload_finish(&store);
+    if (err == ESP_OK) {
+        cred_store_log_active();
+    }
+    return err;
+}
+
+void cred_store_upload_abort(void) {
+    slot_store_upload_abort(&store);
+}
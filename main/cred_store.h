@@ -0,0 +1,102 @@
+/*
+ * 🪪 Credential Store - per-phone HMAC keys in A/B flash partitions 🗝️
+ *
+ * Each phone can get its own credential: an ID it names in its responses and
+ * a secret it signs them with. Credentials come as a read-only table built on
+ * a workstation by tools/gen_creds.py, laid out by a minimal perfect hash over
+ * the IDs like the web asset image, with every secret stored as its
+ * precomputed HMAC pad midstates. The table lives in one of two data
+ * partitions, `creds_a` and `creds_b`, and is used in place through the flash
+ * mapping: a lookup is one hash, one bucket read and one ID compare, costs
+ * the same for ten credentials or ten thousand and never allocates. Each
+ * credential also names the access schedule that decides when it may open
+ * the lock (see access_policy.h).
+ *
+ * A new table is streamed into the inactive partition, its SHA-256 is verified
+ * while it is written, and the partition is committed by programming its
+ * magic word last, exactly like an asset image (see slot_store.h).
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "auth_hmac.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest credential ID in characters */
+#define CRED_ID_MAX_LEN 27
+
+/**
+ * @brief Maps both partitions and activates the newest valid table.
+ *
+ * @return
+ *      - ESP_OK: ready, possibly without any credential
+ *      - ESP_ERR_NOT_FOUND: the credential partitions are missing (only the pre-shared key works)
+ */
+esp_err_t cred_store_init(void);
+
+/**
+ * @brief Returns the number of credentials in the active table.
+ */
+size_t cred_store_count(void);
+
+/**
+ * @brief Looks up a credential and prepares its HMAC key.
+ *
+ * @param id NUL-terminated credential ID
+ * @param key Receives the credential's key, bound to the software backend
+ * @param schedule Receives the credential's access schedule
+ * @return
+ *      - ESP_OK: key prepared
+ *      - ESP_ERR_NOT_FOUND: no credential with this ID
+ */
+esp_err_t cred_store_lookup(const char *id, auth_hmac_key_t *key, uint8_t *schedule);
+
+/**
+ * @brief Starts writing a new table into the inactive partition.
+ *
+ * Only one upload can be in progress at a time.
+ *
+ * @param image_size Exact size of the table image that will be written
+ * @param sha256 Expected SHA-256 of the image
+ * @return
+ *      - ESP_OK: upload started
+ *      - ESP_ERR_INVALID_STATE: another upload is in progress
+ *      - ESP_ERR_INVALID_SIZE: the image does not fit into a partition
+ *      - ESP_ERR_NOT_FOUND: the credential partitions are missing
+ */
+esp_err_t cred_store_upload_begin(size_t image_size, const uint8_t sha256[32]);
+
+/**
+ * @brief Appends image data, erasing flash sectors just ahead of the write position.
+ *
+ * @return
+ *      - ESP_OK: data written
+ *      - ESP_ERR_INVALID_SIZE: more data than announced in cred_store_upload_begin()
+ *      - Other: flash error
+ */
+esp_err_t cred_store_upload_write(const void *data, size_t len);
+
+/**
+ * @brief Verifies the written table and atomically makes it the active one.
+ *
+ * @return
+ *      - ESP_OK: new table active
+ *      - ESP_ERR_INVALID_SIZE: fewer bytes written than announced, or a malformed table
+ *      - ESP_ERR_INVALID_CRC: SHA-256 mismatch
+ *      - Other: the table is malformed or a flash error occurred
+ */
+esp_err_t cred_store_upload_finish(void);
+
+/**
+ * @brief Abandons an upload in progress; the active table is unaffected.
+ */
+void cred_store_upload_abort(void);
+
+#ifdef __cplusplus
+}
+#endif
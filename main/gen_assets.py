@@ -0,0 +1,360 @@
+#!/usr/bin/env python3
+"""
+Build-time web asset pipeline for the lock firmware.
+
+Every file below --www-dir is minified (HTML/CSS/JS), gzip-compressed
+deterministically and packed into a single read-only image that the firmware
+serves directly from flash (see asset_bundle.h for the consumer side).
+
+Image layout, all integers little endian:
+
+  header      32 bytes   magic 'WAS1', version, entry count, hash seed,
+                         bucket count, offsets of the tables below, image size
+  buckets     u16[nb]    displacement per bucket of the minimal perfect hash
+  entries     40 B each  one per asset, stored at its perfect-hash slot
+  pool        NUL-terminated paths, MIME types and ETags, plus the identity
+              and gzip payloads (4-byte aligned)
+
+With --slot-output the image is additionally written behind the 64-byte
+header expected by slot_store.c (magic 'WSLT', version, generation, image
+size, SHA-256), which is what goes into the assets_a/assets_b partitions.
+With --blank-slot-output one erased sector is written as well; flashing it
+over the other partition's header invalidates whatever image was uploaded
+there, so the flashed image is the one served after `idf.py flash`.
+
+With --synthetic N the image holds N small pages `/page-00000.html`,
+`/page-00001.html`, ... instead of --www-dir; test/host times lookups in
+such images of different sizes.
+
+Lookup of a path is one FNV-1a hash, one bucket read, one mix and one
+string compare, independent of the number of assets.
+
+The minifier is deliberately conservative: it removes comments and leading
+whitespace and drops blank lines, but keeps line breaks so that JavaScript
+automatic semicolon insertion and inline HTML whitespace behave exactly as
+in the source. It does not understand JavaScript regular expression literals,
+so the embedded scripts must not contain any.
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+import struct
+import sys
+
+
+def strip_js_comments(src: str) -> str:
+    """Removes // and /* */ comments from JavaScript, honouring string and template literals."""
+    out = []
+    i, n = 0, len(src)
+    quote = None
+    while i < n:
+        c = src[i]
+        if quote:
+            out.append(c)
+            if c == '\\' and i + 1 < n:
+                out.append(src[i + 1])
+                i += 2
+                continue
+            if c == quote:
+                quote = None
+            i += 1
+        elif c in '\'"`':
+            quote = c
+            out.append(c)
+            i += 1
+        elif src.startswith('//', i):
+            end = src.find('\n', i)
+            i = n if end < 0 else end
+        elif src.startswith('/*', i):
+            end = src.find('*/', i + 2)
+            i = n if end < 0 else end + 2
+        else:
+            out.append(c)
+            i += 1
+    return ''.join(out)
+
+
+def strip_css_comments(src: str) -> str:
+    return re.sub(r'/\*.*?\*/', '', src, flags=re.S)
+
+
+def squeeze_lines(src: str) -> str:
+    """Trims every line and drops empty ones."""
+    return '\n'.join(line.strip() for line in src.splitlines() if line.strip())
+
+
+def minify_css(src: str) -> str:
+    css = squeeze_lines(strip_css_comments(src))
+    css = re.sub(r'\s*([{};:,>])\s*', r'\1', css)
+    return css.replace(';}', '}')
+
+
+def minify_html(src: str) -> str:
+    html = re.sub(r'<!--.*?-->', '', src, flags=re.S)
+
+    def style(m):
+        return m.group(1) + minify_css(m.group(2)) + m.group(3)
+
+    def script(m):
+        return m.group(1) + squeeze_lines(strip_js_comments(m.group(2))) + m.group(3)
+
+    parts = re.split(r'(<style[^>]*>.*?</style>|<script[^>]*>.*?</script>)', html, flags=re.S)
+    out = []
+    for part in parts:
+        if part.startswith('<style'):
+            out.append(re.sub(r'(<style[^>]*>)(.*?)(</style>)', style, part, flags=re.S))
+        elif part.startswith('<script'):
+            out.append(re.sub(r'(<script[^>]*>)(.*?)(</script>)', script, part, flags=re.S))
+        else:
+            out.append(squeeze_lines(part))
+    return '\n'.join(p for p in out if p)
+
+
+def minify(name: str, data: bytes) -> bytes:
+    if name.endswith(('.html', '.htm')):
+        return minify_html(data.decode('utf-8')).encode('utf-8')
+    if name.endswith('.css'):
+        return minify_css(data.decode('utf-8')).encode('utf-8')
+    if name.endswith('.js'):
+        return squeeze_lines(strip_js_comments(data.decode('utf-8'))).encode('utf-8')
+    return data
+
+
+def etag(data: bytes) -> str:
+    return '"' + hashlib.sha256(data).hexdigest()[:20] + '"'
+
+
+MIME_TYPES = {
+    '.html': 'text/html', '.htm': 'text/html', '.css': 'text/css',
+    '.js': 'application/javascript', '.json': 'application/json',
+    '.svg': 'image/svg+xml', '.png': 'image/png', '.jpg': 'image/jpeg',
+    '.jpeg': 'image/jpeg', '.gif': 'image/gif', '.ico': 'image/x-icon',
+    '.webp': 'image/webp', '.woff2': 'font/woff2', '.txt': 'text/plain',
+    '.webmanifest': 'application/manifest+json',
+}
+
+IMAGE_MAGIC = 0x31534157  # 'WAS1'
+IMAGE_VERSION = 1
+HEADER_FMT = '<IHHIHHIIII'
+ENTRY_FMT = '<IIIIIIIIIHH'
+MAX_DISPLACEMENT = 0xFFFF
+
+
+def fnv1a(data: bytes, seed: int) -> int:
+    h = 2166136261 ^ seed
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def fmix32(h: int) -> int:
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+    h ^= h >> 13
+    h = (h * 0xC2B2AE35) & 0xFFFFFFFF
+    h ^= h >> 16
+    return h
+
+
+def perfect_slot(h: int, d: int, n: int) -> int:
+    return fmix32(h ^ ((d * 0x9E3779B1) & 0xFFFFFFFF)) % n
+
+
+def build_perfect_hash(keys):
+    """Hash-and-displace minimal perfect hash; returns (seed, displacements, slot per key)."""
+    n = len(keys)
+    nbuckets = 1
+    while nbuckets * 2 < n:
+        nbuckets *= 2
+    for seed in range(1000):
+        hashes = [fnv1a(k, seed) for k in keys]
+        buckets = [[] for _ in range(nbuckets)]
+        for i, h in enumerate(hashes):
+            buckets[h & (nbuckets - 1)].append(i)
+        disp = [0] * nbuckets
+        taken = [False] * n
+        slot_of = [0] * n
+        ok = True
+        # Place the most crowded buckets first while the slot space is still empty
+        for b in sorted(range(nbuckets), key=lambda b: -len(buckets[b])):
+            members = buckets[b]
+            if not members:
+                continue
+            for d in range(MAX_DISPLACEMENT + 1):
+                slots = [perfect_slot(hashes[i], d, n) for i in members]
+                if len(set(slots)) == len(slots) and not any(taken[s] for s in slots):
+                    break
+            else:
+                ok = False
+                break
+            disp[b] = d
+            for i, s in zip(members, slots):
+                taken[s] = True
+                slot_of[i] = s
+        if ok:
+            return seed, disp, slot_of
+    raise RuntimeError('could not build a perfect hash over {} paths'.format(n))
+
+
+class Pool:
+    """Deduplicating, append-only byte pool."""
+
+    def __init__(self):
+        self.data = bytearray()
+        self.index = {}
+
+    def add_str(self, s: str) -> int:
+        return self.add(s.encode('utf-8') + b'\0', align=1)
+
+    def add(self, blob: bytes, align: int = 4) -> int:
+        key = (blob, align)
+        if key in self.index:
+            return self.index[key]
+        while len(self.data) % align:
+            self.data.append(0)
+        off = len(self.data)
+        self.data += blob
+        self.index[key] = off
+        return off
+
+
+def collect(www_dir: str):
+    assets = []
+    for root, _, files in os.walk(www_dir):
+        for name in sorted(files):
+            full = os.path.join(root, name)
+            rel = os.path.relpath(full, www_dir).replace(os.sep, '/')
+            with open(full, 'rb') as f:
+                assets.append(('/' + rel, f.read()))
+    return sorted(assets)
+
+
+def synthetic_assets(n: int):
+    return [('/page-{:05d}.html'.format(i), '<p>Page {}</p>\n'.format(i).encode()) for i in range(n)]
+
+
+def pack(assets, quiet=False) -> bytes:
+    records = []
+    total_raw = total_wire = 0
+    for path, raw in assets:
+        small = minify(path, raw)
+        # mtime=0 keeps the output (and therefore the ETag) reproducible
+        packed = gzip.compress(small, compresslevel=9, mtime=0)
+        if len(packed) >= len(small) * 9 // 10:
+            packed = b''  # not worth compressing (images, fonts, tiny files)
+        mime = MIME_TYPES.get(os.path.splitext(path)[1].lower(), 'application/octet-stream')
+        records.append((path, mime, small, packed))
+        total_raw += len(raw)
+        total_wire += len(packed) if packed else len(small)
+        if not quiet:
+            print('gen_assets: {}: {} bytes raw, {} minified, {} gzip'.format(
+                path, len(raw), len(small), len(packed) if packed else '-'))
+
+    keys = [r[0].encode('utf-8') for r in records]
+    n = len(records)
+    seed, disp, slot_of = build_perfect_hash(keys) if n else (0, [0], [])
+    nbuckets = len(disp)
+
+    header_size = struct.calcsize(HEADER_FMT)
+    entry_size = struct.calcsize(ENTRY_FMT)
+    disp_off = header_size
+    entries_off = (disp_off + 2 * nbuckets + 3) & ~3
+    pool_off = entries_off + entry_size * n
+
+    pool = Pool()
+    entries = [None] * n
+    for i, (path, mime, small, packed) in enumerate(records):
+        path_off = pool_off + pool.add_str(path)
+        mime_off = pool_off + pool.add_str(mime)
+        etag_off = pool_off + pool.add_str(etag(small))
+        gz_etag_off = pool_off + pool.add_str(etag(packed)) if packed else 0
+        data_off = pool_off + pool.add(small)
+        gz_off = pool_off + pool.add(packed) if packed else 0
+        entries[slot_of[i]] = struct.pack(
+            ENTRY_FMT, fnv1a(keys[i], seed), path_off, mime_off, etag_off, gz_etag_off,
+            data_off, len(small), gz_off, len(packed), len(keys[i]), 0)
+
+    image_size = pool_off + len(pool.data)
+    image = bytearray(struct.pack(HEADER_FMT, IMAGE_MAGIC, IMAGE_VERSION, n, seed, nbuckets, 0,
+                                  disp_off, entries_off, image_size, 0))
+    image += struct.pack('<{}H'.format(nbuckets), *disp)
+    image += bytes(entries_off - len(image))
+    image += b''.join(entries)
+    image += pool.data
+    if not quiet:
+        print('gen_assets: {} assets, {} bytes image, {} -> {} bytes on the wire'.format(
+            n, len(image), total_raw, total_wire))
+    return bytes(image)
+
+
+SLOT_MAGIC = 0x544C5357  # 'WSLT'
+SLOT_VERSION = 1
+SLOT_HEADER_SIZE = 64
+
+
+SLOT_SECTOR_SIZE = 4096
+
+
+def slot_image(image: bytes, generation: int = 1) -> bytes:
+    """Prefixes the image with the asset_store slot header, ready to flash into assets_a/assets_b."""
+    header = struct.pack('<IIII32s', SLOT_MAGIC, SLOT_VERSION, generation, len(image),
+                         hashlib.sha256(image).digest())
+    return header + b'\xff' * (SLOT_HEADER_SIZE - len(header)) + image
+
+
+def write_c_source(path: str, symbol: str, image: bytes, generator: str = 'gen_assets.py') -> None:
+    """Writes the image as a word-aligned C array, so the firmware can read its tables with aligned loads."""
+    lines = [
+        '/* Generated by {} - do not edit */'.format(generator),
+        '#include <stddef.h>',
+        '#include <stdint.h>',
+        '',
+        'const uint8_t {}[{}] __attribute__((aligned(4))) = {{'.format(symbol, max(len(image), 1)),
+    ]
+    for i in range(0, len(image), 16):
+        lines.append('    ' + ' '.join('0x{:02x},'.format(b) for b in image[i:i + 16]))
+    lines.append('};')
+    lines.append('const size_t {}_size = {};'.format(symbol, len(image)))
+    lines.append('')
+    with open(path, 'w') as f:
+        f.write('\n'.join(lines))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--www-dir', help='directory tree holding the web assets')
+    source.add_argument('--synthetic', type=int, metavar='N', help='pack N small test pages instead')
+    parser.add_argument('--output', help='path of the packed image to write')
+    parser.add_argument('--slot-output', help='also write the image with an asset partition slot header')
+    parser.add_argument('--blank-slot-output', help='also write an erased sector that invalidates a slot header')
+    parser.add_argument('--c-source', help='also write the image as a C array to this file')
+    parser.add_argument('--symbol', default='web_assets_image', help='C symbol name used with --c-source')
+    args = parser.parse_args()
+
+    if args.www_dir:
+        image = pack(collect(args.www_dir))
+    else:
+        image = pack(synthetic_assets(args.synthetic), quiet=True)
+    for out in (args.output, args.slot_output, args.blank_slot_output, args.c_source):
+        if out:
+            os.makedirs(os.path.dirname(os.path.abspath(out)), exist_ok=True)
+    if args.output:
+        with open(args.output, 'wb') as f:
+            f.write(image)
+    if args.slot_output:
+        with open(args.slot_output, 'wb') as f:
+            f.write(slot_image(image))
+    if args.blank_slot_output:
+        with open(args.blank_slot_output, 'wb') as f:
+            f.write(b'\xff' * SLOT_SECTOR_SIZE)
+    if args.c_source:
+        write_c_source(args.c_source, args.symbol, image)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,86 @@
+/*
+ * 🔍 Heap Watch - counts every heap allocation, by the task that made it 🧮
+ *
+ * The hooks run on every heap_caps_malloc() and free(), possibly with the
+ * flash cache disabled, so they live in IRAM and only touch .bss: a short
+ * scan of the registered task handles and one atomic increment.
+ */
+
+#include "heap_watch.h"
+
+#if CONFIG_LOCK_HEAP_ALLOC_COUNT
+
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+/* 🏷️ Log tag for the heap watch */
+static const char *TAG = "heap_watch";
+
+/* Tasks whose allocations are charged to an owner other than HEAP_WATCH_OTHER */
+#define HEAP_WATCH_MAX_TASKS 16
+
+static TaskHandle_t tasks[HEAP_WATCH_MAX_TASKS];
+static uint8_t task_owners[HEAP_WATCH_MAX_TASKS];
+static uint32_t task_count;
+
+static uint32_t allocs[HEAP_WATCH_OWNER_COUNT];
+static uint32_t frees;
+
+void heap_watch_add_task(TaskHandle_t task, heap_watch_owner_t owner) {
+    uint32_t n = task_count;
+    do {
+        if (n >= HEAP_WATCH_MAX_TASKS) {
+            ESP_LOGW(TAG, "⚠️ More than %d tasks, counting %s's allocations as other", HEAP_WATCH_MAX_TASKS,
+                     pcTaskGetName(task));
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&task_count, &n, n + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    // The slot is ours; the hooks only scan up to task_count, so publish the handle last
+    task_owners[n] = owner;
+    __atomic_store_n(&tasks[n], task, __ATOMIC_RELEASE);
+}
+
+void heap_watch_get(heap_watch_counts_t *counts) {
+    for (int i = 0; i < HEAP_WATCH_OWNER_COUNT; i++) {
+        counts->allocs[i] = __atomic_load_n(&allocs[i], __ATOMIC_RELAXED);
+    }
+    counts->frees = __atomic_load_n(&frees, __ATOMIC_RELAXED);
+}
+
+const char *heap_watch_owner_name(heap_watch_owner_t owner) {
+    switch (owner) {
+    case HEAP_WATCH_FIRMWARE:
+        return "firmware";
+    case HEAP_WATCH_HTTPD:
+        return "httpd";
+    default:
+        return "other";
+    }
+}
+
+/**
+ * @brief ESP-IDF heap hook, called after every successful allocation (CONFIG_HEAP_USE_HOOKS).
+ */
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    heap_watch_owner_t owner = HEAP_WATCH_OTHER;
+
+    uint32_t n = __atomic_load_n(&task_count, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < n; i++) {
+        if (__atomic_load_n(&tasks[i], __ATOMIC_ACQUIRE) == self) {
+            owner = (heap_watch_owner_t)task_owners[i];
+            break;
+        }
+    }
+    __atomic_fetch_add(&allocs[owner], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief ESP-IDF heap hook, called on every free (CONFIG_HEAP_USE_HOOKS).
+ */
+void IRAM_ATTR esp_heap_trace_free_hook(void *ptr) {
+    __atomic_fetch_add(&frees, 1, __ATOMIC_RELAXED);
+}
+#endif /* CONFIG_LOCK_HEAP_ALLOC_COUNT */
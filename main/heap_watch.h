@@ -0,0 +1,72 @@
+/*
+ * 🔍 Heap Watch - counts every heap allocation, by the task that made it 🧮
+ *
+ * With CONFIG_LOCK_HEAP_ALLOC_COUNT the ESP-IDF heap hooks count each
+ * allocation and free. Allocations are charged to one of three owners: the
+ * firmware's own tasks (everything created with task_topology_create()),
+ * the HTTP server task, and everything else (lwIP, Wi-Fi, timers, the
+ * startup task). Free bytes and block counts only show what is left
+ * allocated; these counters also show a buffer that is allocated and freed
+ * again within one request. tools/heap_soak.sh reads them from /metrics.
+ *
+ * Without the option the functions do nothing and every count is 0.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Who an allocation is charged to.
+ */
+typedef enum {
+    HEAP_WATCH_FIRMWARE,    /*!< Tasks created with task_topology_create() */
+    HEAP_WATCH_HTTPD,       /*!< The HTTP server task, handlers included */
+    HEAP_WATCH_OTHER,       /*!< lwIP, Wi-Fi, timers and the rest of ESP-IDF */
+    HEAP_WATCH_OWNER_COUNT
+} heap_watch_owner_t;
+
+/**
+ * @brief Allocation and free counts since boot.
+ */
+typedef struct {
+    uint32_t allocs[HEAP_WATCH_OWNER_COUNT];  /*!< Allocations, by owner */
+    uint32_t frees;                           /*!< Frees, whoever made them */
+} heap_watch_counts_t;
+
+#if CONFIG_LOCK_HEAP_ALLOC_COUNT
+/**
+ * @brief Charges the allocations of a task to an owner.
+ *
+ * Safe to call from any task. At most a few tasks per owner are tracked;
+ * the rest are logged and counted as HEAP_WATCH_OTHER.
+ */
+void heap_watch_add_task(TaskHandle_t task, heap_watch_owner_t owner);
+
+/**
+ * @brief Reads the counts.
+ */
+void heap_watch_get(heap_watch_counts_t *counts);
+
+/**
+ * @brief Returns the name of an owner as exported at /metrics ("firmware", "httpd", "other").
+ */
+const char *heap_watch_owner_name(heap_watch_owner_t owner);
+#else
+static inline void heap_watch_add_task(TaskHandle_t task, heap_watch_owner_t owner) {
+}
+
+static inline void heap_watch_get(heap_watch_counts_t *counts) {
+    *counts = (heap_watch_counts_t){ 0 };
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,131 @@
+/*
+ * 🧵 HTTP Workers - request handlers off the server task 🏗️
+ *
+ * The server task admits a request only if the backlog has room for it, so
+ * it never blocks on a busy pool. The request is then detached, which hands
+ * the socket over to the copy until httpd_req_async_handler_complete(), and
+ * queued together with its handler. Idle workers wait on the queue; the
+ * server task is its only writer, so the room checked before detaching is
+ * still there when the job is sent.
+ */
+
+#include "http_workers.h"
+
+#if HTTP_WORKERS_COUNT > 0
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "task_topology.h"
+
+/* 🏷️ Log tag for the worker pool */
+static const char *TAG = "http_workers";
+
+/* Worker stack, the same as the HTTP server task's */
+#define HTTP_WORKERS_TASK_STACK 4096
+
+/**
+ * @brief A detached request and the handler that finishes it, or other queued work.
+ */
+typedef struct {
+    httpd_req_t *req;
+    esp_err_t (*handler)(httpd_req_t *req);   /*!< NULL for work from http_workers_queue() */
+    void (*work)(void *arg);
+    void *arg;
+} http_job_t;
+
+/* Longest backlog http_workers_start() accepts, more than the HTTP server keeps sockets open */
+#define HTTP_WORKERS_MAX_BACKLOG 16
+
+static QueueHandle_t jobs;
+static StaticQueue_t jobs_buf;
+static uint8_t jobs_items[HTTP_WORKERS_MAX_BACKLOG * sizeof(http_job_t)];
+
+#if CONFIG_LOCK_STATIC_ALLOC
+static StackType_t worker_stacks[HTTP_WORKERS_COUNT][HTTP_WORKERS_TASK_STACK];
+static StaticTask_t worker_tcbs[HTTP_WORKERS_COUNT];
+#endif
+
+esp_err_t http_workers_dispatch(httpd_req_t *req) {
+    http_job_t job = { .handler = (esp_err_t (*)(httpd_req_t *))req->user_ctx };
+
+    // Refuse before detaching, so the reply goes out on the request itself
+    if (uxQueueSpacesAvailable(jobs) == 0) {
+        ESP_LOGW(TAG, "⚠️ Every HTTP worker busy, request refused");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_send_custom_err(req, "503 Service Unavailable", "Server busy");
+        return ESP_OK;
+    }
+    esp_err_t err = httpd_req_async_handler_begin(req, &job.req);
+    if (err != ESP_OK) {
+        // Out of memory for the copy: serve it here rather than dropping it
+        ESP_LOGW(TAG, "⚠️ Request not detached (%s), handled inline", esp_err_to_name(err));
+        return job.handler(req);
+    }
+    xQueueSend(jobs, &job, portMAX_DELAY);
+    return ESP_OK;
+}
+
+esp_err_t http_workers_queue(void (*work)(void *arg), void *arg) {
+    http_job_t job = { .work = work, .arg = arg };
+
+    if (xQueueSend(jobs, &job, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "⚠️ Every HTTP worker busy, work refused");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Worker task body: runs queued handlers and hands their sockets back.
+ *
+ * @param arg Unused.
+ */
+static void http_worker_task(void *arg) {
+    http_job_t job;
+
+    for (;;) {
+        xQueueReceive(jobs, &job, portMAX_DELAY);
+        if (!job.handler) {
+            job.work(job.arg);
+            continue;
+        }
+        esp_err_t err = job.handler(job.req);
+        httpd_handle_t server = job.req->handle;
+        int fd = httpd_req_to_sockfd(job.req);
+        httpd_req_async_handler_complete(job.req);
+        // A failed handler closes its connection, as on the server task
+        if (err != ESP_OK) {
+            httpd_sess_trigger_close(server, fd);
+        }
+    }
+}
+
+esp_err_t http_workers_start(unsigned backlog) {
+    char name[configMAX_TASK_NAME_LEN];
+
+    if (jobs) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (backlog == 0 || backlog > HTTP_WORKERS_MAX_BACKLOG) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jobs = xQueueCreateStatic(backlog, sizeof(http_job_t), jobs_items, &jobs_buf);
+    for (int i = 0; i < HTTP_WORKERS_COUNT; i++) {
+        const task_topology_mem_t *mem = NULL;
+#if CONFIG_LOCK_STATIC_ALLOC
+        mem = &(const task_topology_mem_t){ worker_stacks[i], &worker_tcbs[i] };
+#endif
+        snprintf(name, sizeof(name), "http_worker%d", i);
+        if (task_topology_create(TASK_ROLE_HTTP_WORKER, http_worker_task, name, HTTP_WORKERS_TASK_STACK,
+                                 NULL, mem, NULL) != pdPASS) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    ESP_LOGI(TAG, "🧵 %d HTTP workers ready, backlog %u", HTTP_WORKERS_COUNT, backlog);
+    return ESP_OK;
+}
+
+#endif /* HTTP_WORKERS_COUNT > 0 */
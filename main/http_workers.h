@@ -0,0 +1,83 @@
+/*
+ * 🧵 HTTP Workers - request handlers off the server task 🏗️
+ *
+ * The HTTP server runs every handler on its one task, so while a handler
+ * verifies an HMAC, streams an upload into flash or pages through the audit
+ * log, no other connection is accepted or read. Handlers registered through
+ * http_workers_dispatch() are instead detached from the server task with
+ * httpd_req_async_handler_begin() and run to completion on a small pool of
+ * worker tasks, while the server task goes back to its sockets. Cheap
+ * handlers stay on the server task, where they avoid the hand-off.
+ *
+ * Work that is not an HTTP request, such as checking a WebSocket frame, can
+ * be queued with http_workers_queue() and shares the same workers.
+ *
+ * Handlers running on a worker may run concurrently with each other and with
+ * the server task, so everything they share must be safe for that.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of worker tasks, 0 to run every handler on the server task */
+#define HTTP_WORKERS_COUNT CONFIG_LOCK_HTTP_WORKERS
+
+#if HTTP_WORKERS_COUNT > 0
+
+/**
+ * @brief Starts the worker tasks.
+ *
+ * Must be called before the HTTP server starts.
+ *
+ * @param backlog Requests that may wait for a worker; further ones are
+ *                answered with 503 Service Unavailable. A connection has at
+ *                most one request detached, so the open socket limit of the
+ *                server is enough to never refuse one. The queue lives in
+ *                a fixed buffer of 16 entries.
+ * @return
+ *      - ESP_OK: workers running
+ *      - ESP_ERR_INVALID_STATE: already started
+ *      - ESP_ERR_INVALID_ARG: backlog is 0 or more than 16
+ *      - ESP_ERR_NO_MEM: a task could not be created
+ */
+esp_err_t http_workers_start(unsigned backlog);
+
+/**
+ * @brief URI handler that runs the handler in the URI's user_ctx on a worker.
+ *
+ * Register the real handler as `.handler = http_workers_dispatch,
+ * .user_ctx = handler`; the handler sees the detached request copy and may
+ * use it exactly like the original. Returning an error from it closes the
+ * connection, as it does on the server task.
+ *
+ * @param req Request on the server task.
+ * @return ESP_OK once the request is queued or refused with 503.
+ */
+esp_err_t http_workers_dispatch(httpd_req_t *req);
+
+/**
+ * @brief Runs a function on a worker.
+ *
+ * Must be called from the HTTP server task, like http_workers_dispatch().
+ * The function usually hands its result back with httpd_queue_work(), since
+ * only the server task may write to its sockets.
+ *
+ * @param work Function to run.
+ * @param arg Argument for the function; must stay valid until it has run.
+ * @return
+ *      - ESP_OK: queued
+ *      - ESP_ERR_NO_MEM: backlog full, work not queued
+ */
+esp_err_t http_workers_queue(void (*work)(void *arg), void *arg);
+
+#endif /* HTTP_WORKERS_COUNT > 0 */
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,291 @@
+/*
+ * 🔐 Lock Controller - owns the lock state and the status LED 🚥
+ *
+ * A single task consumes lock events from a FreeRTOS queue and is the only
+ * place where `lock_is_open` and the LED are changed. Timed indications (the
+ * blue flash after a bad token) are tracked as lock_hal_time_us() deadlines:
+ * the task simply waits on its queue until the earliest deadline and then
+ * feeds itself a LOCK_EVT_RELOCK_TIMEOUT event. The write-back of the
+ * persisted state (see state_store.h) is one more deadline on the same wait.
+ */
+
+#include "lock_ctrl.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "boot_prof.h"
+#include "config_store.h"
+#include "lock_hal.h"
+#include "metrics.h"
+#include "state_store.h"
+#include "task_topology.h"
+
+/* 🏷️ Log tag for the lock controller */
+static const char *TAG = "lock_ctrl";
+
+/* Controller task parameters */
+#define LOCK_CTRL_QUEUE_LEN   8
+#define LOCK_CTRL_TASK_STACK  4096
+
+/* Sentinel for "no deadline armed" */
+#define LOCK_DEADLINE_NONE    INT64_MAX
+
+/* Event queue feeding the controller task */
+static QueueHandle_t lock_evt_queue = NULL;
+static StaticQueue_t lock_evt_queue_buf;
+static uint8_t lock_evt_queue_items[LOCK_CTRL_QUEUE_LEN * sizeof(lock_evt_t)];
+
+TASK_TOPOLOGY_MEM_DEFINE(lock_ctrl_mem, LOCK_CTRL_TASK_STACK);
+
+/* Current state machine state, only written by the controller task */
+static volatile lock_state_t lock_state = LOCK_STATE_LOCKED;
+
+/* State transition listener, called on the controller task */
+static lock_state_listener_t state_listener = NULL;
+static void *state_listener_arg = NULL;
+
+/* Boolean flag representing the lock state:
+ * true  -> Unlocked
+ * false -> Locked
+ * Written only by the controller task, read from any task.
+ */
+static volatile bool lock_is_open = false;
+
+/* lock_hal_time_us() timestamp at which the blue indication ends */
+static int64_t relock_deadline_us = LOCK_DEADLINE_NONE;
+
+/* Persisted state and counters, only changed by the controller task */
+static state_store_data_t persisted;
+
+/* GPIO the LED driver is set up on, only used by the controller task */
+static uint32_t led_gpio;
+
+/**
+ * @brief Sets the LED color, recording how long the refresh took.
+ */
+static void lock_ctrl_set_led(uint8_t r, uint8_t g, uint8_t b) {
+    int64_t start = metrics_now();
+    lock_hal_led_set(r, g, b);
+    metrics_lap(METRICS_LED_REFRESH, start);
+}
+
+/**
+ * @brief Sets up the LED on a GPIO, going back to another one if that fails.
+ *
+ * @param gpio GPIO to move the LED to
+ * @param fallback GPIO to use instead if the LED cannot be set up on gpio
+ * @return ESP_OK if the LED is up on either GPIO.
+ */
+static esp_err_t lock_ctrl_led_init(uint32_t gpio, uint32_t fallback) {
+    esp_err_t err = lock_hal_led_init(gpio);
+    if (err == ESP_OK) {
+        led_gpio = gpio;
+        return ESP_OK;
+    }
+    ESP_LOGW(TAG, "⚠️ LED not available on GPIO %lu (%s), using GPIO %lu", (unsigned long)gpio,
+             esp_err_to_name(err), (unsigned long)fallback);
+    err = lock_hal_led_init(fallback);
+    if (err == ESP_OK) {
+        led_gpio = fallback;
+    }
+    return err;
+}
+
+/**
+ * @brief Applies one event to the lock state machine.
+ *
+ * @param evt Event to process.
+ */
+static void lock_ctrl_handle_event(lock_evt_t evt) {
+    lock_state_t prev = lock_state;
+
+    switch (evt) {
+    case LOCK_EVT_AUTH_OK:
+        relock_deadline_us = LOCK_DEADLINE_NONE;
+        lock_state = LOCK_STATE_UNLOCKED;
+        lock_is_open = true;
+        ESP_LOGI(TAG, "🟢 Unlock successful! LED set to green");
+        lock_ctrl_set_led(0, 255, 0);
+        persisted.unlocks++;
+        persisted.fail_streak = 0;
+        persisted.open = true;
+        state_store_set(&persisted);
+        break;
+
+    case LOCK_EVT_AUTH_FAIL:
+        // (Re)arm the deadline so repeated failures keep the blue indication visible
+        relock_deadline_us = lock_hal_time_us() + (int64_t)config_store_get()->bad_token_ms * 1000;
+        if (lock_state != LOCK_STATE_BAD_TOKEN) {
+            lock_state = LOCK_STATE_BAD_TOKEN;
+            ESP_LOGW(TAG, "🔵 Invalid token - LED flashing blue");
+            lock_ctrl_set_led(0, 0, 255);
+        }
+        // Stored as locked already: the lock relocks when the indication ends
+        persisted.auth_failures++;
+        persisted.fail_streak++;
+        persisted.last_fail_s = lock_hal_wall_time_s();
+        persisted.open = false;
+        state_store_set(&persisted);
+        break;
+
+    case LOCK_EVT_RELOCK_TIMEOUT:
+        if (lock_state != LOCK_STATE_BAD_TOKEN) {
+            break; // Stale timeout, a later event already changed the state
+        }
+        relock_deadline_us = LOCK_DEADLINE_NONE;
+        lock_state = LOCK_STATE_LOCKED;
+        lock_is_open = false;
+        ESP_LOGI(TAG, "🔴 Relocking - LED set to red");
+        lock_ctrl_set_led(255, 0, 0);
+        break;
+
+    case LOCK_EVT_CONFIG_CHANGED: {
+        uint32_t gpio = config_store_get()->led_gpio;
+        if (gpio == led_gpio) {
+            break;
+        }
+        if (lock_ctrl_led_init(gpio, led_gpio) != ESP_OK) {
+            ESP_LOGE(TAG, "❌ LED lost, it stays dark until the next change or reboot");
+            break;
+        }
+        // Only a GPIO the LED came up on is kept for the next boot
+        if (led_gpio == gpio) {
+            esp_err_t err = config_store_confirm_led_gpio(gpio);
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "⚠️ LED GPIO not stored, back to the previous one on reboot: %s",
+                         esp_err_to_name(err));
+            }
+        }
+        // The new driver starts dark; show the state again
+        if (lock_state == LOCK_STATE_UNLOCKED) {
+            lock_ctrl_set_led(0, 255, 0);
+        } else if (lock_state == LOCK_STATE_BAD_TOKEN) {
+            lock_ctrl_set_led(0, 0, 255);
+        } else {
+            lock_ctrl_set_led(255, 0, 0);
+        }
+        break;
+    }
+    }
+
+    lock_state_listener_t listener = state_listener;
+    if (listener && lock_state != prev) {
+        listener(lock_state, state_listener_arg);
+    }
+}
+
+/**
+ * @brief Lock controller task body.
+ *
+ * Brings up the LED first, in the color of the restored state, so the RMT
+ * setup overlaps with the rest of startup; events posted meanwhile wait in
+ * the queue. Then blocks on the event queue until an event arrives, the
+ * pending relock deadline expires or the state is due to be written back,
+ * whichever comes first.
+ *
+ * @param arg Unused.
+ */
+static void lock_ctrl_task(void *arg) {
+    /* Configure the LED and show the state restored at startup */
+    boot_prof_begin(BOOT_PHASE_LED);
+    esp_err_t err = lock_ctrl_led_init(config_store_get()->led_gpio, CONFIG_BLINK_GPIO);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ LED initialization failed: %s", esp_err_to_name(err));
+        ESP_ERROR_CHECK(err);
+    }
+    if (lock_is_open) {
+        ESP_LOGI(TAG, "🟢 Setting LED to green on startup (unlocked before the reset)");
+        lock_hal_led_set(0, 255, 0);
+    } else {
+        ESP_LOGI(TAG, "🔴 Setting LED to red on startup (locked)");
+        lock_hal_led_set(255, 0, 0);
+    }
+    boot_prof_end(BOOT_PHASE_LED);
+
+    for (;;) {
+        int64_t writeback_us = state_store_writeback_due_us();
+        int64_t deadline_us = relock_deadline_us < writeback_us ? relock_deadline_us : writeback_us;
+        TickType_t wait = portMAX_DELAY;
+        if (deadline_us != LOCK_DEADLINE_NONE) {
+            int64_t remaining_us = deadline_us - lock_hal_time_us();
+            // Round up so we never wake just before the deadline
+            wait = remaining_us > 0 ? pdMS_TO_TICKS((remaining_us + 999) / 1000) + 1 : 0;
+        }
+
+        lock_evt_t evt;
+        if (xQueueReceive(lock_evt_queue, &evt, wait) == pdTRUE) {
+            lock_ctrl_handle_event(evt);
+        } else if (relock_deadline_us != LOCK_DEADLINE_NONE &&
+                   lock_hal_time_us() >= relock_deadline_us) {
+            lock_ctrl_handle_event(LOCK_EVT_RELOCK_TIMEOUT);
+        }
+        if (lock_hal_time_us() >= state_store_writeback_due_us()) {
+            state_store_flush();
+        }
+    }
+}
+
+esp_err_t lock_ctrl_start(void) {
+    state_store_get(&persisted);
+#if CONFIG_LOCK_STATE_RESUME_UNLOCKED
+    if (persisted.open) {
+        lock_state = LOCK_STATE_UNLOCKED;
+        lock_is_open = true;
+    }
+#else
+    persisted.open = false;
+#endif
+
+    lock_evt_queue = xQueueCreateStatic(LOCK_CTRL_QUEUE_LEN, sizeof(lock_evt_t), lock_evt_queue_items,
+                                        &lock_evt_queue_buf);
+    if (!lock_evt_queue) {
+        ESP_LOGE(TAG, "❌ Failed to create lock event queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (task_topology_create(TASK_ROLE_LOCK_CTRL, lock_ctrl_task, "lock_ctrl", LOCK_CTRL_TASK_STACK,
+                             NULL, TASK_TOPOLOGY_MEM(lock_ctrl_mem), NULL) != pdPASS) {
+        ESP_LOGE(TAG, "❌ Failed to create lock controller task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t lock_ctrl_post(lock_evt_t evt) {
+    if (!lock_evt_queue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Never block the caller: a full queue means the controller is already busy with indications
+    if (xQueueSend(lock_evt_queue, &evt, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "⚠️ Lock event queue full, dropping event %d", (int)evt);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+void lock_ctrl_set_listener(lock_state_listener_t listener, void *arg) {
+    state_listener_arg = arg;
+    state_listener = listener;
+}
+
+lock_state_t lock_ctrl_get_state(void) {
+    return lock_state;
+}
+
+const char *lock_ctrl_state_name(lock_state_t state) {
+    switch (state) {
+    case LOCK_STATE_LOCKED:
+        return "locked";
+    case LOCK_STATE_UNLOCKED:
+        return "unlocked";
+    case LOCK_STATE_BAD_TOKEN:
+        return "bad_token";
+    }
+    return "unknown";
+}
+
+bool lock_ctrl_is_open(void) {
+    return lock_is_open;
+}
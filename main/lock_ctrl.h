@@ -0,0 +1,105 @@
+/*
+ * 🔐 Lock Controller - owns the lock state and the status LED 🚥
+ *
+ * All lock/LED transitions happen on a dedicated FreeRTOS task that is driven
+ * by a queue of events. HTTP handlers only post events and return immediately,
+ * so a slow LED indication never stalls other clients.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Events understood by the lock controller state machine.
+ */
+typedef enum {
+    LOCK_EVT_AUTH_OK,        /*!< A client presented a valid response: unlock (green) */
+    LOCK_EVT_AUTH_FAIL,      /*!< A client presented an invalid response: blue indication, then relock */
+    LOCK_EVT_RELOCK_TIMEOUT, /*!< The bad-token indication deadline expired: relock (red) */
+    LOCK_EVT_CONFIG_CHANGED, /*!< The LED GPIO setting changed: move the LED, keep its color */
+} lock_evt_t;
+
+/**
+ * @brief States of the lock controller state machine.
+ */
+typedef enum {
+    LOCK_STATE_LOCKED,    /*!< 🔴 Locked, LED red */
+    LOCK_STATE_UNLOCKED,  /*!< 🟢 Unlocked, LED green */
+    LOCK_STATE_BAD_TOKEN, /*!< 🔵 Bad token indication, LED blue until the relock deadline */
+} lock_state_t;
+
+/**
+ * @brief Callback invoked after every state transition.
+ *
+ * Runs on the lock controller task, so it must not block; hand the work off
+ * (e.g. with httpd_queue_work) instead.
+ *
+ * @param state New state.
+ * @param arg User argument given to lock_ctrl_set_listener().
+ */
+typedef void (*lock_state_listener_t)(lock_state_t state, void *arg);
+
+/**
+ * @brief Starts the lock controller task.
+ *
+ * Starts locked, or with CONFIG_LOCK_STATE_RESUME_UNLOCKED in the state
+ * restored by state_store_init(), which must have run. The task
+ * initializes the status LED in that color before it handles the first
+ * event, while the caller goes on with startup, on the GPIO of the
+ * settings (see config_store.h), which must be loaded. If the LED cannot be
+ * set up there, CONFIG_BLINK_GPIO is tried; failing that too aborts like it
+ * would have here.
+ *
+ * @return
+ *      - ESP_OK: controller started
+ *      - ESP_ERR_NO_MEM: the event queue or the task could not be created
+ */
+esp_err_t lock_ctrl_start(void);
+
+/**
+ * @brief Posts an event to the lock controller without blocking.
+ *
+ * @param evt Event to post.
+ *
+ * @return
+ *      - ESP_OK: event queued
+ *      - ESP_ERR_INVALID_STATE: the controller has not been started
+ *      - ESP_ERR_TIMEOUT: the event queue is full and the event was dropped
+ */
+esp_err_t lock_ctrl_post(lock_evt_t evt);
+
+/**
+ * @brief Registers the state transition listener, replacing any previous one.
+ *
+ * Meant to be called once during startup, before clients can post events.
+ *
+ * @param listener Callback, or NULL to remove the listener.
+ * @param arg User argument passed to the callback.
+ */
+void lock_ctrl_set_listener(lock_state_listener_t listener, void *arg);
+
+/**
+ * @brief Returns the current state machine state.
+ */
+lock_state_t lock_ctrl_get_state(void);
+
+/**
+ * @brief Returns a short lowercase name for a state ("locked", "unlocked", "bad_token").
+ */
+const char *lock_ctrl_state_name(lock_state_t state);
+
+/**
+ * @brief Returns the current lock state.
+ *
+ * @return true if the lock is open, false if it is locked.
+ */
+bool lock_ctrl_is_open(void);
+
+#ifdef __cplusplus
+}
+#endif
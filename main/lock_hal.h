@@ -0,0 +1,179 @@
+/*
+ * 🧩 Lock HAL - device services used by the portable lock core 🔌
+ *
+ * Everything that touches hardware or the platform goes through here: the
+ * status LED, network bring-up, random numbers and the clock. The HTTP
+ * handlers, authentication and the lock state machine only use these
+ * functions, so the same core runs on the ESP32-S3 (lock_hal_esp32s3.c) and
+ * natively on a workstation with the ESP-IDF linux target (lock_hal_linux.c).
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes the status LED and switches it off.
+ *
+ * May be called again to move the LED to another GPIO; the driver on the
+ * previous one is released first. Only the lock controller task calls it.
+ *
+ * @param gpio GPIO driving the addressable LED
+ */
+esp_err_t lock_hal_led_init(uint32_t gpio);
+
+/**
+ * @brief Tells whether the status LED may be driven from a GPIO.
+ *
+ * On the board this rules out pins that cannot drive an output and those
+ * the chip needs for itself: the strapping pins, the flash and octal PSRAM
+ * lines and the console. Claiming one of those for the LED would hang or
+ * reset the chip. The linux target accepts every ESP32-S3 GPIO number.
+ *
+ * @param gpio GPIO number
+ */
+bool lock_hal_led_gpio_usable(uint32_t gpio);
+
+/**
+ * @brief Sets the status LED color.
+ *
+ * @param r Red intensity (0-255)
+ * @param g Green intensity (0-255)
+ * @param b Blue intensity (0-255)
+ */
+void lock_hal_led_set(uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Initializes NVS, erasing it first if its pages are full or from a newer layout.
+ *
+ * Comes first in startup: the lock state, the access policy and, on the
+ * device, the Wi-Fi driver keep their data there. The linux target keeps
+ * NVS in ESP-IDF's emulated flash.
+ */
+esp_err_t lock_hal_storage_init(void);
+
+/**
+ * @brief Prepares the network stack without starting an interface.
+ *
+ * Must follow lock_hal_storage_init(). On the device this initializes
+ * ESP-NETIF and the default event loop, after which the HTTP server can
+ * already be started; it listens on every interface and picks up the access
+ * point once it is up.
+ */
+esp_err_t lock_hal_net_init(void);
+
+/**
+ * @brief Brings up the network the HTTP server listens on.
+ *
+ * Must follow lock_hal_net_init(). On the device this starts the Wi-Fi
+ * access point, which takes most of a second, so it may run on its own task
+ * while the rest of the firmware starts; on the linux target the host network
+ * is used as is.
+ */
+esp_err_t lock_hal_net_start(void);
+
+/**
+ * @brief Sets the SSID and password of the access point.
+ *
+ * Must follow lock_hal_net_init(). Before lock_hal_net_start() this only
+ * records what the access point starts with; afterwards the access point
+ * switches at once, which disconnects every station. Does nothing on the
+ * linux target and with the QEMU Ethernet.
+ *
+ * @param ssid SSID, 1 to 32 characters
+ * @param password WPA/WPA2 passphrase, 8 to 63 characters
+ * @return ESP_OK, or the error of the Wi-Fi driver.
+ */
+esp_err_t lock_hal_net_set_ap(const char *ssid, const char *password);
+
+/**
+ * @brief Returns 32 random bits from a cryptographically secure source.
+ */
+uint32_t lock_hal_random(void);
+
+/**
+ * @brief Fills a buffer from a cryptographically secure source.
+ *
+ * @param buf Buffer to fill
+ * @param len Number of random bytes
+ */
+void lock_hal_fill_random(void *buf, size_t len);
+
+/**
+ * @brief Switches on an entropy source for random numbers drawn before the network is up.
+ *
+ * The ESP32-S3 RNG only mixes in true entropy while the radio runs or, before
+ * that, while the SAR ADC noise source is on; otherwise its output is
+ * pseudo-random. Random numbers needed at startup are drawn between this and
+ * lock_hal_entropy_disable(), which must come before lock_hal_net_init().
+ * Does nothing on the linux target.
+ */
+void lock_hal_entropy_enable(void);
+
+/**
+ * @brief Switches the startup entropy source off again.
+ */
+void lock_hal_entropy_disable(void);
+
+/**
+ * @brief Returns the monotonic time in microseconds.
+ */
+int64_t lock_hal_time_us(void);
+
+/**
+ * @brief Returns the time from power-on to the start of the monotonic clock.
+ *
+ * Covers the ROM, the bootloader and early application startup. It is only
+ * known after a power-on reset, when the RTC timer started with the chip.
+ *
+ * @return Microseconds, or -1 if unknown.
+ */
+int64_t lock_hal_boot_prestart_us(void);
+
+/* Wall-clock times before this (2024-01-01) mean the clock was never set */
+#define LOCK_HAL_WALL_TIME_MIN 1704067200
+
+/**
+ * @brief Returns the wall-clock time in seconds since the Unix epoch (UTC).
+ *
+ * The board has no battery-backed clock, so its time is only known once it
+ * has been set with lock_hal_set_wall_time_s() since boot; the linux target
+ * starts from the host's clock.
+ *
+ * @return Seconds since the epoch, or -1 if the clock has not been set.
+ */
+int64_t lock_hal_wall_time_s(void);
+
+/**
+ * @brief Sets the wall clock.
+ *
+ * @param unix_s Seconds since the Unix epoch (UTC), at least LOCK_HAL_WALL_TIME_MIN
+ * @return
+ *      - ESP_OK: clock set
+ *      - ESP_ERR_INVALID_ARG: the time is before LOCK_HAL_WALL_TIME_MIN
+ */
+esp_err_t lock_hal_set_wall_time_s(int64_t unix_s);
+
+#if CONFIG_IDF_TARGET_LINUX
+/**
+ * @brief Moves the virtual clock forward.
+ *
+ * Lets tests expire challenges, rate limits and the relock deadline without
+ * waiting. Tasks already sleeping on a FreeRTOS timeout re-read the clock
+ * when they next wake up.
+ *
+ * @param delta_us Time to skip, in microseconds.
+ */
+void lock_hal_advance_time_us(int64_t delta_us);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,315 @@
+/*
+ * 🧩 Lock HAL for the ESP32-S3 board 🛜
+ *
+ * Status LED on an addressable LED driven by the RMT peripheral, Wi-Fi access
+ * point, hardware RNG and esp_timer clock. With CONFIG_LOCK_NET_QEMU_OPENETH the
+ * same image brings the network up on QEMU's emulated OpenCores Ethernet MAC
+ * instead, so it can be run and measured in qemu-system-xtensa. The wall
+ * clock is the system time, valid once an administrator has set it, and the
+ * RTC timer tells how long the chip took to get to app_main after power-on.
+ */
+
+#include "lock_hal.h"
+
+#include <string.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "bootloader_random.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_private/esp_clk.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "led_strip.h"
+#include "driver/gpio.h"
+#if CONFIG_LOCK_NET_QEMU_OPENETH
+#include "esp_eth.h"
+#endif
+
+/* 🏷️ Log tag for the board HAL */
+static const char *TAG = "lock_hal";
+
+#define GPIO_BIT(n) (1ULL << (n))
+
+#if CONFIG_SPIRAM_MODE_OCT || CONFIG_ESPTOOLPY_OCT_FLASH
+/* Octal PSRAM or flash also uses DQS and data lines 4-7 */
+#define LED_OCTAL_GPIOS   (GPIO_BIT(33) | GPIO_BIT(34) | GPIO_BIT(35) | GPIO_BIT(36) | GPIO_BIT(37))
+#else
+#define LED_OCTAL_GPIOS   0
+#endif
+
+#if CONFIG_ESP_CONSOLE_UART_DEFAULT
+#define LED_CONSOLE_GPIOS (GPIO_BIT(43) | GPIO_BIT(44))
+#else
+#define LED_CONSOLE_GPIOS 0
+#endif
+
+#if CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG || CONFIG_ESP_CONSOLE_SECONDARY_USB_SERIAL_JTAG
+#define LED_USB_GPIOS     (GPIO_BIT(19) | GPIO_BIT(20))
+#else
+#define LED_USB_GPIOS     0
+#endif
+
+/* GPIOs the LED must stay off: strapping pins, SPI flash (GPIO26-32), then the above */
+#define LED_RESERVED_GPIOS (GPIO_BIT(0) | GPIO_BIT(3) | GPIO_BIT(45) | GPIO_BIT(46) | (0x7fULL << 26) | \
+                            LED_OCTAL_GPIOS | LED_CONSOLE_GPIOS | LED_USB_GPIOS)
+
+/* Global handle for the LED strip device */
+static led_strip_handle_t led_strip = NULL;
+
+#if CONFIG_LOCK_STATIC_ALLOC
+/* Strip object and pixel buffer for one GRB LED, word-aligned for the driver */
+static uint32_t led_strip_mem[(LED_STRIP_RMT_STATIC_SIZE(1, 3) + 3) / 4];
+#endif
+
+bool lock_hal_led_gpio_usable(uint32_t gpio) {
+    return gpio < SOC_GPIO_PIN_COUNT && GPIO_IS_VALID_OUTPUT_GPIO((int)gpio) && !(LED_RESERVED_GPIOS & GPIO_BIT(gpio));
+}
+
+/**
+ * @brief Configures and initializes the LED strip.
+ *
+ * This function sets up the LED strip hardware by specifying the GPIO pin used
+ * and the number of LEDs on the strip. It configures the RMT peripheral to drive
+ * the LED with a specified resolution. On success, the LED strip is cleared to
+ * ensure that no residual data is displayed. A strip set up earlier is
+ * deleted first, which frees its RMT channel and, with static allocation,
+ * the storage the new one reuses.
+ */
+esp_err_t lock_hal_led_init(uint32_t gpio) {
+#if CONFIG_LOCK_HAL_VIRTUAL_LED
+    // QEMU does not emulate the RMT peripheral; colors are only logged
+    ESP_LOGI(TAG, "💡 Virtual LED on GPIO %lu, colors are logged", (unsigned long)gpio);
+    return ESP_OK;
+#endif
+    if (led_strip) {
+        esp_err_t err = led_strip_del(led_strip);
+        if (err != ESP_OK) {
+            return err;
+        }
+        led_strip = NULL;
+    }
+
+    led_strip_config_t strip_config = {
+        .strip_gpio_num = gpio,
+        .max_leds = 1,
+    };
+
+    led_strip_rmt_config_t rmt_config = {
+        .resolution_hz = 10 * 1000 * 1000, // 10 MHz resolution for precise timing control
+        .flags.with_dma = false,
+    };
+
+    // Initialize the LED strip device using the RMT peripheral
+#if CONFIG_LOCK_STATIC_ALLOC
+    esp_err_t err = led_strip_new_rmt_device_static(&strip_config, &rmt_config, led_strip_mem,
+                                                    sizeof(led_strip_mem), &led_strip);
+#else
+    esp_err_t err = led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip);
+#endif
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    ESP_LOGI(TAG, "🎉 LED initialization successful on GPIO %lu", (unsigned long)gpio);
+    // Clear the LED strip to ensure all LEDs are off at startup
+    return led_strip_clear(led_strip);
+}
+
+/**
+ * @brief Sets the color of the LED.
+ *
+ * This function updates the color of the first LED (index 0) on the LED strip
+ * by setting its red, green, and blue intensity values. The changes are then
+ * applied by refreshing the LED strip.
+ */
+void lock_hal_led_set(uint8_t r, uint8_t g, uint8_t b) {
+#if CONFIG_LOCK_HAL_VIRTUAL_LED
+    ESP_LOGI(TAG, "💡 LED #%02x%02x%02x", r, g, b);
+#endif
+    if (led_strip) {
+        ESP_ERROR_CHECK(led_strip_set_pixel(led_strip, 0, r, g, b));
+        ESP_ERROR_CHECK(led_strip_refresh(led_strip));
+    }
+}
+
+#if CONFIG_LOCK_NET_QEMU_OPENETH
+/**
+ * @brief Logs the address QEMU's DHCP server assigned.
+ */
+static void eth_got_ip_handler(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    const ip_event_got_ip_t *event = data;
+    ESP_LOGI(TAG, "🖧 Ethernet up, IP " IPSTR, IP2STR(&event->ip_info.ip));
+}
+
+/**
+ * @brief Starts the OpenCores Ethernet MAC emulated by QEMU.
+ *
+ * The interface takes its address from the DHCP server of QEMU's user-mode
+ * network (normally 10.0.2.15); clients reach the HTTP server through the
+ * host port forwarded by tools/qemu_run.sh.
+ */
+static void eth_start(void) {
+    esp_netif_config_t netif_config = ESP_NETIF_DEFAULT_ETH();
+    esp_netif_t *netif = esp_netif_new(&netif_config);
+
+    eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+    eth_phy_config_t phy_config = ETH_PHY_DEFAULT_CONFIG();
+    phy_config.autonego_timeout_ms = 100; // The emulated link is up immediately
+    esp_eth_mac_t *mac = esp_eth_mac_new_openeth(&mac_config);
+    esp_eth_phy_t *phy = esp_eth_phy_new_dp83848(&phy_config);
+
+    esp_eth_config_t eth_config = ETH_DEFAULT_CONFIG(mac, phy);
+    esp_eth_handle_t eth = NULL;
+    ESP_ERROR_CHECK(esp_eth_driver_install(&eth_config, &eth));
+    ESP_ERROR_CHECK(esp_netif_attach(netif, esp_eth_new_netif_glue(eth)));
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_ETH_GOT_IP, eth_got_ip_handler, NULL));
+    ESP_ERROR_CHECK(esp_eth_start(eth));
+    ESP_LOGI(TAG, "🖧 QEMU open-ethernet started, waiting for DHCP");
+}
+#else
+/* Access point configuration; SSID and password come from lock_hal_net_set_ap() */
+static wifi_config_t ap_config = {
+    .ap = {
+        .channel = 1,
+        .max_connection = 4,
+        .authmode = WIFI_AUTH_WPA_WPA2_PSK
+    },
+};
+
+/* Set once the Wi-Fi driver takes ap_config; both under ap_lock */
+static bool wifi_ready;
+static StaticSemaphore_t ap_lock_buf;
+static SemaphoreHandle_t ap_lock;
+
+/**
+ * @brief Initializes and starts the Wi-Fi Access Point (AP) mode.
+ *
+ * The access point uses WPA/WPA2-PSK on channel 1 with the SSID and password
+ * given to lock_hal_net_set_ap(), and accepts up to 4 stations; its DHCP
+ * server hands out addresses in 192.168.4.0/24.
+ */
+static void wifi_start_softap(void) {
+    // Create the default Wi-Fi AP network interface
+    esp_netif_create_default_wifi_ap();
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+    // Set the device to operate in AP mode and apply the configuration
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
+    xSemaphoreTake(ap_lock, portMAX_DELAY);
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &ap_config));
+    wifi_ready = true;
+    xSemaphoreGive(ap_lock);
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    ESP_LOGI(TAG, "🛜 Wi-Fi AP started. SSID=%.*s, Password=%s",
+             (int)ap_config.ap.ssid_len, ap_config.ap.ssid, ap_config.ap.password);
+}
+#endif
+
+esp_err_t lock_hal_storage_init(void) {
+    /* Initialize NVS flash storage (the Wi-Fi driver also keeps calibration data there) */
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        // If necessary, erase and reinitialize NVS
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    return ret;
+}
+
+/**
+ * @brief Brings up ESP-NETIF and the default event loop.
+ */
+esp_err_t lock_hal_net_init(void) {
+    /* Initialize network components: ESP-NETIF and event loop */
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+#if !CONFIG_LOCK_NET_QEMU_OPENETH
+    ap_lock = xSemaphoreCreateMutexStatic(&ap_lock_buf);
+#endif
+    return ESP_OK;
+}
+
+esp_err_t lock_hal_net_set_ap(const char *ssid, const char *password) {
+#if CONFIG_LOCK_NET_QEMU_OPENETH
+    return ESP_OK;
+#else
+    esp_err_t err = ESP_OK;
+
+    xSemaphoreTake(ap_lock, portMAX_DELAY);
+    // A 32-character SSID fills the field with no room for a terminator; ssid_len tells its length
+    size_t ssid_len = strnlen(ssid, sizeof(ap_config.ap.ssid));
+    memset(ap_config.ap.ssid, 0, sizeof(ap_config.ap.ssid));
+    memcpy(ap_config.ap.ssid, ssid, ssid_len);
+    ap_config.ap.ssid_len = ssid_len;
+    strlcpy((char *)ap_config.ap.password, password, sizeof(ap_config.ap.password));
+    if (wifi_ready) {
+        // Restarts the access point with the new settings
+        err = esp_wifi_set_config(WIFI_IF_AP, &ap_config);
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG, "🛜 Wi-Fi AP reconfigured. SSID=%.*s", (int)ap_config.ap.ssid_len,
+                     ap_config.ap.ssid);
+        }
+    }
+    xSemaphoreGive(ap_lock);
+    return err;
+#endif
+}
+
+esp_err_t lock_hal_net_start(void) {
+#if CONFIG_LOCK_NET_QEMU_OPENETH
+    eth_start();
+#else
+    wifi_start_softap();
+#endif
+    return ESP_OK;
+}
+
+uint32_t lock_hal_random(void) {
+    return esp_random();
+}
+
+void lock_hal_fill_random(void *buf, size_t len) {
+    esp_fill_random(buf, len);
+}
+
+void lock_hal_entropy_enable(void) {
+    bootloader_random_enable();
+}
+
+void lock_hal_entropy_disable(void) {
+    bootloader_random_disable();
+}
+
+int64_t lock_hal_time_us(void) {
+    return esp_timer_get_time();
+}
+
+int64_t lock_hal_boot_prestart_us(void) {
+    // The RTC timer runs from power-on; any other reset leaves it counting
+    if (esp_reset_reason() != ESP_RST_POWERON) {
+        return -1;
+    }
+    return (int64_t)esp_clk_rtc_time() - esp_timer_get_time();
+}
+
+int64_t lock_hal_wall_time_s(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec >= LOCK_HAL_WALL_TIME_MIN ? tv.tv_sec : -1;
+}
+
+esp_err_t lock_hal_set_wall_time_s(int64_t unix_s) {
+    if (unix_s < LOCK_HAL_WALL_TIME_MIN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct timeval tv = { .tv_sec = unix_s };
+    return settimeofday(&tv, NULL) == 0 ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,120 @@
+/*
+ * 🧩 Lock HAL for the ESP-IDF linux target 🐧
+ *
+ * Runs the lock core as a native process: the LED is a log line, the host
+ * network stack serves HTTP on localhost, random numbers come from the
+ * kernel, and the clock is the host's monotonic clock plus an offset that
+ * tests can advance. The wall clock follows the host's, moved by the same
+ * offset and by whatever lock_hal_set_wall_time_s() asked for.
+ */
+
+#include "lock_hal.h"
+
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/random.h>
+#include "esp_log.h"
+#include "nvs_flash.h"
+
+/* 🏷️ Log tag for the linux HAL */
+static const char *TAG = "lock_hal";
+
+/* Time skipped with lock_hal_advance_time_us() */
+static atomic_int_fast64_t time_offset_us;
+
+/* Difference between the wall clock set by the lock and the host's */
+static atomic_int_fast64_t wall_offset_s;
+
+bool lock_hal_led_gpio_usable(uint32_t gpio) {
+    return gpio <= 48; // No pins to protect; the GPIO numbers of the ESP32-S3
+}
+
+esp_err_t lock_hal_led_init(uint32_t gpio) {
+    ESP_LOGI(TAG, "💡 Virtual LED ready (GPIO %lu)", (unsigned long)gpio);
+    return ESP_OK;
+}
+
+void lock_hal_led_set(uint8_t r, uint8_t g, uint8_t b) {
+    ESP_LOGI(TAG, "💡 LED #%02x%02x%02x", r, g, b);
+}
+
+esp_err_t lock_hal_storage_init(void) {
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    return ret;
+}
+
+esp_err_t lock_hal_net_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t lock_hal_net_start(void) {
+    ESP_LOGI(TAG, "🐧 Using the host network, HTTP on port %d", CONFIG_LOCK_HTTP_PORT);
+    return ESP_OK;
+}
+
+esp_err_t lock_hal_net_set_ap(const char *ssid, const char *password) {
+    return ESP_OK;
+}
+
+uint32_t lock_hal_random(void) {
+    uint32_t value;
+    while (getrandom(&value, sizeof(value), 0) != sizeof(value)) {
+    }
+    return value;
+}
+
+void lock_hal_fill_random(void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = getrandom(p, len, 0);
+        if (n > 0) {
+            p += n;
+            len -= n;
+        }
+    }
+}
+
+void lock_hal_entropy_enable(void) {
+}
+
+void lock_hal_entropy_disable(void) {
+}
+
+int64_t lock_hal_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000 + atomic_load(&time_offset_us);
+}
+
+int64_t lock_hal_boot_prestart_us(void) {
+    return -1;
+}
+
+void lock_hal_advance_time_us(int64_t delta_us) {
+    atomic_fetch_add(&time_offset_us, delta_us);
+}
+
+/**
+ * @brief Returns the host's wall clock plus the virtual time skipped so far.
+ */
+static int64_t host_wall_time_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + atomic_load(&time_offset_us) / 1000000;
+}
+
+int64_t lock_hal_wall_time_s(void) {
+    return host_wall_time_s() + atomic_load(&wall_offset_s);
+}
+
+esp_err_t lock_hal_set_wall_time_s(int64_t unix_s) {
+    if (unix_s < LOCK_HAL_WALL_TIME_MIN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_store(&wall_offset_s, unix_s - host_wall_time_s());
+    return ESP_OK;
+}
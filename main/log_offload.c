@@ -0,0 +1,176 @@
+/*
+ * 📜 Log Offload - asynchronous console output for ESP_LOGx 🚚
+ *
+ * The ring is a bounded multi-producer queue in the style of Dmitry Vyukov's:
+ * every slot carries a sequence number telling whether it is free for the
+ * producer of a given position or holds a record for the consumer. Producers
+ * claim a position with one compare-and-swap and then format straight into
+ * the slot, so neither a lock nor an extra copy is needed. There is a single
+ * consumer, the drain task, which can therefore advance its position without
+ * atomics.
+ */
+
+#include "log_offload.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "task_topology.h"
+#include "sdkconfig.h"
+
+/* 🏷️ Log tag for the log offload */
+static const char *TAG = "log_offload";
+
+/* Ring geometry: slot count must be a power of two */
+#define LOG_OFFLOAD_SLOTS      CONFIG_LOCK_LOG_OFFLOAD_SLOTS
+#define LOG_OFFLOAD_LINE_MAX   124
+
+/* How long the drain task sleeps when the ring is empty */
+#define LOG_OFFLOAD_IDLE_MS    20
+
+/* Drain task stack; the topology table runs it below every task that serves clients */
+#define LOG_OFFLOAD_TASK_STACK 3072
+
+_Static_assert((LOG_OFFLOAD_SLOTS & (LOG_OFFLOAD_SLOTS - 1)) == 0, "log ring slot count must be a power of two");
+
+/**
+ * @brief One ring slot.
+ *
+ * seq == position: free for the producer of that position.
+ * seq == position + 1: holds the record of that position.
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t len;                       /*!< Length of the text, without NUL */
+    char text[LOG_OFFLOAD_LINE_MAX];
+} log_slot_t;
+
+static log_slot_t slots[LOG_OFFLOAD_SLOTS];
+static uint32_t head;                   /*!< Next position to claim, shared by producers */
+static uint32_t tail;                   /*!< Next position to drain, drain task only */
+static uint32_t dropped;                /*!< Records lost to a full ring */
+static vprintf_like_t console_vprintf;  /*!< Hook that was installed before ours */
+static TaskHandle_t drain_task;
+TASK_TOPOLOGY_MEM_DEFINE(drain_mem, LOG_OFFLOAD_TASK_STACK);
+
+/**
+ * @brief Claims the slot for the next ring position.
+ *
+ * @return The claimed slot, or NULL if the ring is full.
+ */
+static log_slot_t *log_offload_claim(uint32_t *pos_out) {
+    uint32_t pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    for (;;) {
+        log_slot_t *slot = &slots[pos & (LOG_OFFLOAD_SLOTS - 1)];
+        int32_t diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            // Free for this position: try to take it (pos is refreshed on failure)
+            if (__atomic_compare_exchange_n(&head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *pos_out = pos;
+                return slot;
+            }
+        } else if (diff < 0) {
+            // Still holds the record from one lap ago: the ring is full
+            return NULL;
+        } else {
+            // Another producer took this position first
+            pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * @brief esp_log vprintf hook: formats the record into the ring.
+ */
+static int log_offload_vprintf(const char *fmt, va_list args) {
+    // The drain task logs synchronously, so it never waits on itself
+    if (xTaskGetCurrentTaskHandle() == drain_task) {
+        return console_vprintf(fmt, args);
+    }
+
+    uint32_t pos;
+    log_slot_t *slot = log_offload_claim(&pos);
+    if (!slot) {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    int n = vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+    if (n < 0) {
+        n = 0;
+    } else if (n >= (int)sizeof(slot->text)) {
+        // Truncated: keep the line break so the next record starts on its own line
+        n = sizeof(slot->text) - 1;
+        slot->text[n - 1] = '\n';
+    }
+    slot->len = n;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    return n;
+}
+
+/**
+ * @brief Writes text through the original hook.
+ */
+static int log_offload_console(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = console_vprintf(fmt, args);
+    va_end(args);
+    return n;
+}
+
+/**
+ * @brief Drain task body: writes records to the console in ring order.
+ *
+ * @param arg Unused.
+ */
+static void log_offload_task(void *arg) {
+    uint32_t reported = 0;
+
+    for (;;) {
+        log_slot_t *slot = &slots[tail & (LOG_OFFLOAD_SLOTS - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != tail + 1) {
+            // Empty, or the producer of this position is still formatting
+            uint32_t lost = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+            if (lost != reported) {
+                ESP_LOGW(TAG, "⚠️ %lu log lines dropped", (unsigned long)(lost - reported));
+                reported = lost;
+            }
+            // A claimed slot is ready within microseconds; an empty ring can wait
+            bool claimed = __atomic_load_n(&head, __ATOMIC_RELAXED) != tail;
+            vTaskDelay(claimed ? 1 : pdMS_TO_TICKS(LOG_OFFLOAD_IDLE_MS));
+            continue;
+        }
+
+        log_offload_console("%.*s", (int)slot->len, slot->text);
+        __atomic_store_n(&slot->seq, tail + LOG_OFFLOAD_SLOTS, __ATOMIC_RELEASE);
+        tail++;
+    }
+}
+
+esp_err_t log_offload_start(void) {
+    if (drain_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (uint32_t i = 0; i < LOG_OFFLOAD_SLOTS; i++) {
+        slots[i].seq = i;
+    }
+    head = tail = 0;
+
+    // Records queue up from here on; the drain task picks them up once it runs
+    console_vprintf = esp_log_set_vprintf(log_offload_vprintf);
+    if (task_topology_create(TASK_ROLE_LOG_OFFLOAD, log_offload_task, "log_offload", LOG_OFFLOAD_TASK_STACK,
+                             NULL, TASK_TOPOLOGY_MEM(drain_mem), &drain_task) != pdPASS) {
+        esp_log_set_vprintf(console_vprintf);
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "🚚 Console output offloaded (%d x %d-byte ring)", LOG_OFFLOAD_SLOTS, LOG_OFFLOAD_LINE_MAX);
+    return ESP_OK;
+}
+
+uint32_t log_offload_dropped(void) {
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,40 @@
+/*
+ * 📜 Log Offload - asynchronous console output for ESP_LOGx 🚚
+ *
+ * Installed as the esp_log vprintf hook, it formats each log record into a
+ * slot of a lock-free ring buffer and returns at once; a low-priority task
+ * writes the records to the console later. A request handler therefore pays
+ * for formatting a line, not for pushing it through the UART at 115200 baud.
+ * When the ring is full new records are dropped and counted, and the drain
+ * task reports how many were lost.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Starts the drain task and redirects esp_log output into the ring.
+ *
+ * Records logged before this call, and records logged by the drain task
+ * itself, go to the console directly.
+ *
+ * @return
+ *      - ESP_OK: log output is offloaded
+ *      - ESP_ERR_INVALID_STATE: already started
+ *      - ESP_ERR_NO_MEM: the drain task could not be created
+ */
+esp_err_t log_offload_start(void);
+
+/**
+ * @brief Returns the number of log records dropped because the ring was full.
+ */
+uint32_t log_offload_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
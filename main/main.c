@@ -2,144 +2,269 @@
  * 🔒 Smart Lock Project - ESP32-S3 Firmware 🚀
  *
  * This firmware implements a smart lock system with the following features:
- *  - Operates in Wi-Fi Access Point (AP) mode.
- *  - Provides an HTTP server that implements challenge-response authentication.
- *  - Uses an addressable LED to indicate the lock status.
+ *  - Operates in Wi-Fi Access Point (AP) mode, or natively on a workstation with the
+ *    ESP-IDF linux target; all device access goes through the HAL in lock_hal.h.
+ *  - Provides an HTTP server that implements challenge-response authentication, plus an
+ *    optional one-round-trip mode with counter nonces and a sliding replay window.
+ *  - Serves the web UI (every file under main/www) from a packed asset image kept in
+ *    A/B flash partitions, which can be replaced at run time without reflashing.
+ *  - Offers the unlock flow over a WebSocket that also pushes every lock state change.
+ *  - Uses an addressable LED, driven by a dedicated lock controller task, to indicate the lock status.
+ *  - Times every stage of request handling and exports the histograms at /metrics.
+ *  - Writes log output from a background task, so handlers never wait for the console.
+ *  - Keeps an audit log of unlock attempts in flash, queryable by time range at /audit.
+ *  - Accepts per-phone credentials from a provisioned table next to the pre-shared key.
+ *  - Limits each credential to the time-of-week windows of its access schedule.
+ *  - Runs the expensive handlers on a pool of worker tasks, so the server keeps accepting.
+ *  - Places every task on a core and priority from one table, with per-task CPU time at /tasks.
+ *  - Starts the LED, the network and the HTTP server side by side and profiles every boot phase.
  *
  * The design leverages ESP-IDF components including Wi-Fi, HTTP server, and LED control via RMT.
  * Detailed error checking is performed using the ESP_ERROR_CHECK macro to ensure system robustness.
  */
 
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
-#include "esp_wifi.h"
-#include "esp_event.h"
-#include "esp_random.h"
-#include "nvs_flash.h"
+#include <ctype.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_system.h"
-#include "esp_netif.h"
+#include "esp_heap_caps.h"
 #include "esp_http_server.h"
-#include "led_strip.h"
+#include "lock_hal.h"
+#include "lock_ctrl.h"
+#include "challenge_store.h"
+#include "nonce_pool.h"
+#include "unlock_flow.h"
+#include "auth_hmac.h"
+#include "asset_store.h"
+#include "cred_store.h"
+#include "access_policy.h"
+#include "rate_limit.h"
+#include "metrics.h"
+#include "log_offload.h"
+#include "audit_log.h"
+#include "http_workers.h"
+#include "task_topology.h"
+#include "boot_prof.h"
+#include "heap_watch.h"
+#include "mem_placement.h"
+#include "state_store.h"
+#include "config_store.h"
 #include "sdkconfig.h"
 
 /* 🏷️ Global Log Tag for debugging messages */
 static const char *TAG = "lock_app";
 
-/* 🚥 LED configuration - using GPIO 48 for the addressable LED */
-#define LED_STRIP_GPIO 48
+/* Concurrent HTTP and WebSocket connections */
+#define HTTP_MAX_OPEN_SOCKETS 7
 
-/* Global handle for the LED strip device */
-static led_strip_handle_t led_strip = NULL;
+/* Longest WebSocket text frame accepted from clients */
+#define WS_MAX_FRAME_LEN 128
 
-/* Pre-shared key for challenge-response authentication.
- * In a production environment, this key should be securely provisioned.
- */
-static char pre_shared_key[32] = "DEFAULT_KEY";
+/* WebSocket "response" command; sscanf needs the field widths as literals, and
+ * each %n records where a field ended so that longer fields can be rejected */
+#define WS_RESPONSE_FORMAT "response %24s%n %64s%n %27s%n"
+_Static_assert(CHALLENGE_NONCE_MAX_LEN == 24, "nonce width in WS_RESPONSE_FORMAT");
+_Static_assert(AUTH_HMAC_HEX_LEN == 64, "token width in WS_RESPONSE_FORMAT");
+_Static_assert(CRED_ID_MAX_LEN == 27, "credential ID width in WS_RESPONSE_FORMAT");
 
-/* Buffer to store the current challenge token */
-static char current_challenge[64];
+/* Running HTTP server, used to push lock state changes to WebSocket clients */
+static httpd_handle_t http_server = NULL;
 
-/* Boolean flag representing the lock state:
- * true  -> Unlocked
- * false -> Locked
- */
-static bool lock_is_open = false;
+/* Web UI asset image packed at build time from main/www (see gen_assets.py),
+ * served when neither asset partition holds a valid image */
+extern const uint8_t web_assets_image[];
+extern const size_t web_assets_image_size;
+
+/* Assets are sent in chunks of this size, straight from the flash mapping */
+#define ASSET_SEND_CHUNK 4096
+
+/* Receive buffer size for asset image and credential table uploads */
+#define ASSET_UPLOAD_CHUNK 2048
+
+/* Longest body accepted by PUT /clock */
+#define CLOCK_BODY_MAX_LEN 20
+
+/* Serializes the admin updates, which share the upload buffers below */
+static StaticSemaphore_t admin_lock_buf;
+static SemaphoreHandle_t admin_lock;
+
+#if HTTP_WORKERS_COUNT > 0
+/* Registers a handler to run on an HTTP worker (see http_workers.h) */
+#define ON_WORKER(fn) .handler = http_workers_dispatch, .user_ctx = (void *)(fn)
+#else
+#define ON_WORKER(fn) .handler = (fn)
+#endif
 
 /**
- * @brief Configures and initializes the LED strip.
+ * @brief Gets the IP address of the client that sent a request.
+ *
+ * The address is taken from the request's socket. IPv4 addresses are returned
+ * in their IPv4-mapped IPv6 form; the address is all zeros if it is unknown.
  *
- * This function sets up the LED strip hardware by specifying the GPIO pin used
- * and the number of LEDs on the strip. It configures the RMT peripheral to drive
- * the LED with a specified resolution. On success, the LED strip is cleared to
- * ensure that no residual data is displayed.
+ * @param req Pointer to the HTTP request object.
+ * @param addr Receives the address.
  */
-static void configure_led_strip(void) {
-    led_strip_config_t strip_config = {
-        .strip_gpio_num = LED_STRIP_GPIO,
-        .max_leds = 1,
-    };
+static void req_peer_addr(httpd_req_t *req, uint8_t addr[RATE_LIMIT_ADDR_LEN]) {
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
 
-    led_strip_rmt_config_t rmt_config = {
-        .resolution_hz = 10 * 1000 * 1000, // 10 MHz resolution for precise timing control
-        .flags.with_dma = false,
-    };
+    memset(addr, 0, RATE_LIMIT_ADDR_LEN);
+    if (getpeername(httpd_req_to_sockfd(req), (struct sockaddr *)&peer, &peer_len) == 0) {
+        if (peer.ss_family == AF_INET6) {
+            memcpy(addr, &((struct sockaddr_in6 *)&peer)->sin6_addr, RATE_LIMIT_ADDR_LEN);
+        } else if (peer.ss_family == AF_INET) {
+            addr[10] = addr[11] = 0xff;
+            memcpy(addr + 12, &((struct sockaddr_in *)&peer)->sin_addr, 4);
+        }
+    }
+}
 
-    // Initialize the LED strip device using the RMT peripheral
-    ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip));
+/**
+ * @brief Charges an authentication attempt to the client's rate limit.
+ *
+ * The client is identified by its IP address (see req_peer_addr()).
+ *
+ * @param req Pointer to the HTTP request object.
+ * @param retry_after_s Receives the seconds until the next attempt is allowed.
+ *
+ * @return true if the attempt may proceed.
+ */
+static bool req_attempt_allowed(httpd_req_t *req, uint32_t *retry_after_s) {
+    uint8_t addr[RATE_LIMIT_ADDR_LEN];
+    req_peer_addr(req, addr);
+    return unlock_flow_admit(addr, retry_after_s);
+}
 
-    if (led_strip) {
-        ESP_LOGI(TAG, "🎉 LED initialization successful on GPIO %d", LED_STRIP_GPIO);
-        // Clear the LED strip to ensure all LEDs are off at startup
-        ESP_ERROR_CHECK(led_strip_clear(led_strip));
-    }
+/**
+ * @brief Appends an attempt by the request's client to the audit log.
+ */
+static void req_audit(httpd_req_t *req, audit_event_t event, audit_channel_t channel) {
+    uint8_t addr[RATE_LIMIT_ADDR_LEN];
+    req_peer_addr(req, addr);
+    audit_log_record(event, channel, addr);
 }
 
 /**
- * @brief Sets the color of the LED.
+ * @brief Rejects an HTTP authentication attempt with 429 if the client is over its limit.
  *
- * This function updates the color of the first LED (index 0) on the LED strip
- * by setting its red, green, and blue intensity values. The changes are then
- * applied by refreshing the LED strip.
+ * Called before the request body is read, so a flood costs neither HMAC work
+ * nor receive time. The handler should then return ESP_FAIL, which also closes
+ * the connection and makes a flooding client pay for a new TCP handshake.
  *
- * @param r Red intensity (0-255)
- * @param g Green intensity (0-255)
- * @param b Blue intensity (0-255)
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return true if the request was rejected.
  */
-static void set_led_color(uint8_t r, uint8_t g, uint8_t b) {
-    if (led_strip) {
-        ESP_ERROR_CHECK(led_strip_set_pixel(led_strip, 0, r, g, b));
-        ESP_ERROR_CHECK(led_strip_refresh(led_strip));
+static bool req_rate_limited(httpd_req_t *req) {
+    uint32_t retry_after_s;
+    char retry_after[12];
+
+    if (req_attempt_allowed(req, &retry_after_s)) {
+        return false;
     }
+    snprintf(retry_after, sizeof(retry_after), "%u", (unsigned)retry_after_s);
+    httpd_resp_set_hdr(req, "Retry-After", retry_after);
+    httpd_resp_send_custom_err(req, "429 Too Many Requests", "Too many attempts");
+    return true;
 }
 
 /**
  * @brief HTTP GET handler to generate and return a challenge token.
  *
- * This handler generates a pseudo-random challenge token using the ESP32's
- * hardware random number generator (esp_random). The generated challenge is stored
- * in a global buffer and then returned to the client as a plain text response.
+ * This handler takes a challenge of 128 random bits, encoded as 22 base64url
+ * characters, from the nonce pool, which draws them ahead of time from the
+ * platform's secure random number generator (see nonce_pool.h). The challenge
+ * is recorded in the challenge store, so several clients can hold outstanding
+ * challenges at the same time, and then returned to the client as a plain
+ * text response.
  *
  * @param req Pointer to the HTTP request object.
  *
  * @return esp_err_t ESP_OK on success, or an appropriate error code on failure.
  */
 static esp_err_t get_challenge_handler(httpd_req_t *req) {
-    uint32_t rand_val = esp_random();
-    snprintf(current_challenge, sizeof(current_challenge), "%u", (unsigned)rand_val);
-    ESP_LOGI(TAG, "🎲 New challenge generated: %s", current_challenge);
+    char challenge[CHALLENGE_NONCE_MAX_LEN + 1];
+    int64_t t0 = metrics_now();
+
+    if (unlock_flow_issue(challenge) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Cannot issue a challenge");
+        return ESP_FAIL;
+    }
+    int64_t t = metrics_lap(METRICS_CHALLENGE_ISSUE, t0);
 
     httpd_resp_set_type(req, "text/plain");
-    httpd_resp_sendstr(req, current_challenge);
+    httpd_resp_sendstr(req, challenge);
+    metrics_lap(METRICS_CHALLENGE_SEND, t);
+    metrics_lap(METRICS_CHALLENGE_TOTAL, t0);
     return ESP_OK;
 }
 
 /**
  * @brief HTTP POST handler for processing the client's response token.
  *
- * This function handles the authentication response from the client. It reads
- * the response token from the HTTP request and verifies it against the expected
- * token, which is a concatenation of the current challenge and the pre-shared key.
+ * This function handles the authentication response from the client. The
+ * challenge being answered is passed as the `nonce` query parameter
+ * (`POST /response?nonce=<challenge>`) and is consumed from the challenge store,
+ * so each challenge can be answered only once. The response token in the body
+ * is the hex encoded HMAC-SHA256 of the challenge keyed with the pre-shared key,
+ * or with the secret of the credential named in the optional `id` query
+ * parameter (see cred_store.h); it is verified with a constant-time comparison,
+ * so the key itself never crosses the network. The credential lookup takes the
+ * same time however many credentials are provisioned.
  *
  * On successful verification:
- *   - The lock state is updated to unlocked.
- *   - The LED is set to green to indicate an unlocked state.
+ *   - An unlock event is posted to the lock controller (LED turns green).
  *   - A success message is sent back to the client.
  *
  * On failure:
- *   - The LED flashes blue to indicate an invalid token.
+ *   - An auth-failure event is posted to the lock controller, which flashes the
+ *     LED blue for the bad_token_ms setting (4 seconds by default) and then
+ *     re-engages the lock (LED red).
  *   - An HTTP error (401 Unauthorized) is sent to the client.
- *   - After a short delay, the lock is re-engaged and the LED is set to red.
+ *
+ * The handler never waits for the LED indication, so other clients are served
+ * immediately while the blue indication is still active.
+ *
+ * Clients that exceed their authentication rate limit get 429 Too Many Requests
+ * before the body is read and before any verification work is done.
  *
  * @param req Pointer to the HTTP request object.
  *
  * @return esp_err_t ESP_OK on success, or an appropriate error code on failure.
  */
 static esp_err_t post_response_handler(httpd_req_t *req) {
-    char resp_buf[64];
+    char resp_buf[AUTH_HMAC_HEX_LEN + 1];
+    char query[96];
+    char nonce[CHALLENGE_NONCE_MAX_LEN + 1];
+    char id[CRED_ID_MAX_LEN + 1];
+    uint8_t addr[RATE_LIMIT_ADDR_LEN];
     int total_len = req->content_len;
+    int64_t t0 = metrics_now();
+
+    // Turn away flooding clients before doing any work for them
+    if (req_rate_limited(req)) {
+        return ESP_FAIL;
+    }
+
+    // Extract the challenge this response answers from the query string
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "nonce", nonce, sizeof(nonce)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing nonce");
+        return ESP_FAIL;
+    }
+    esp_err_t id_err = httpd_query_key_value(query, "id", id, sizeof(id));
+    if (id_err == ESP_ERR_HTTPD_RESULT_TRUNC) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Credential ID too long");
+        return ESP_FAIL;
+    }
 
     // Validate that the received data does not exceed the buffer size
     if (total_len >= sizeof(resp_buf)) {
@@ -154,162 +279,1506 @@ static esp_err_t post_response_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
     resp_buf[recv_len] = '\0'; // Null-terminate the received string
+    int64_t t = metrics_lap(METRICS_RESPONSE_RECV, t0);
 
-    // Construct the expected token by concatenating the challenge and the pre-shared key
-    char expected[128];
-    snprintf(expected, sizeof(expected), "%s%s", current_challenge, pre_shared_key);
-
-    // Verify the response token
-    if (strcmp(resp_buf, expected) == 0) {
-        lock_is_open = true;
-        ESP_LOGI(TAG, "🟢 Unlock successful! LED set to green");
-        set_led_color(0, 255, 0);
+    // Verify the response token and hand the outcome to the lock controller
+    req_peer_addr(req, addr);
+    const char *reason = unlock_flow_verify(addr, AUDIT_CH_HTTP, id_err == ESP_OK ? id : NULL, nonce, resp_buf);
+    t = metrics_lap(METRICS_RESPONSE_VERIFY, t);
+    if (!reason) {
         httpd_resp_sendstr(req, "Unlocked");
     } else {
-        ESP_LOGW(TAG, "🔵 Invalid token - LED flashing blue");
-        set_led_color(0, 0, 255);
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, reason);
+    }
+    metrics_lap(METRICS_RESPONSE_SEND, t);
+    metrics_lap(METRICS_RESPONSE_TOTAL, t0);
+
+    return ESP_OK;
+}
+
+#if CONFIG_LOCK_AUTH_COUNTER_UNLOCK
+/**
+ * @brief Parses one unsigned 32-bit decimal field of a request body.
+ *
+ * Unlike sscanf("%lu"), rejects a sign (which strtoul() would negate and
+ * wrap), values that do not fit in 32 bits and fields running into other
+ * characters.
+ *
+ * @param text Parse position, advanced past the field on success.
+ * @param value Receives the value.
+ *
+ * @return true if a field was parsed.
+ */
+static bool parse_u32_field(const char **text, uint32_t *value) {
+    const char *p = *text;
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (!isdigit((unsigned char)*p)) {
+        return false;
+    }
+    char *end;
+    errno = 0;
+    unsigned long number = strtoul(p, &end, 10);
+    if (errno != 0 || (uint32_t)number != number || (*end != '\0' && !isspace((unsigned char)*end))) {
+        return false;
+    }
+    *value = (uint32_t)number;
+    *text = end;
+    return true;
+}
+
+/**
+ * @brief HTTP POST handler for one-round-trip unlocks.
+ *
+ * Instead of fetching a challenge first, the client picks the nonce itself
+ * from a counter and sends a single request whose body is
+ * `<epoch> <counter> <token>`, where the token is the hex encoded
+ * HMAC-SHA256 of `<epoch>:<counter>` keyed with the pre-shared key. The colon
+ * keeps these messages distinct from /challenge nonces, which are base64url
+ * and never contain one, so a response to one scheme can never be replayed in
+ * the other.
+ *
+ * The token is verified before the counter is checked against the replay
+ * window (see unlock_flow_counter()). A client that does not
+ * know the current epoch (first use, device rebooted) or whose counter has
+ * fallen out of the window receives 409 Conflict with `<epoch> <next counter>`
+ * in the body, and retries with those values.
+ *
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return esp_err_t ESP_OK on success, or an appropriate error code on failure.
+ */
+static esp_err_t post_unlock_handler(httpd_req_t *req) {
+    char body[64];
+    char token[AUTH_HMAC_HEX_LEN + 1];
+    char resync[24];
+    uint8_t addr[RATE_LIMIT_ADDR_LEN];
+    const char *cursor = body;
+    uint32_t epoch, counter;
+    int64_t t0 = metrics_now();
+
+    if (req_rate_limited(req)) {
+        return ESP_FAIL;
+    }
+    if (req->content_len >= sizeof(body)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Request too long");
+        return ESP_FAIL;
+    }
+    int recv_len = httpd_req_recv(req, body, req->content_len);
+    if (recv_len <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No data received");
+        return ESP_FAIL;
+    }
+    body[recv_len] = '\0';
+    if (!parse_u32_field(&cursor, &epoch) || !parse_u32_field(&cursor, &counter) || counter == 0 ||
+        sscanf(cursor, "%64s", token) != 1) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected '<epoch> <counter> <token>'");
+        return ESP_FAIL;
+    }
+    int64_t t = metrics_lap(METRICS_UNLOCK_RECV, t0);
+
+    req_peer_addr(req, addr);
+    unlock_counter_result_t result = unlock_flow_counter(addr, epoch, counter, token);
+    t = metrics_lap(METRICS_UNLOCK_VERIFY, t);
+
+    if (result == UNLOCK_COUNTER_FORGED) {
         httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Invalid token");
+    } else if (result == UNLOCK_COUNTER_STALE) {
+        // Stale epoch or counter: tell the client where to resume
+        uint32_t resume_epoch, resume_counter;
+        unlock_flow_counter_resync(&resume_epoch, &resume_counter);
+        snprintf(resync, sizeof(resync), "%lu %lu", (unsigned long)resume_epoch, (unsigned long)resume_counter);
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_set_type(req, "text/plain");
+        httpd_resp_sendstr(req, resync);
+    } else {
+        httpd_resp_sendstr(req, "Unlocked");
+    }
+    metrics_lap(METRICS_UNLOCK_SEND, t);
+    metrics_lap(METRICS_UNLOCK_TOTAL, t0);
+    return ESP_OK;
+}
+#endif
+
+/**
+ * @brief Sends a text frame to one WebSocket client without a request context.
+ *
+ * @param server HTTP server handle.
+ * @param fd Socket of the client.
+ * @param text NUL-terminated frame payload.
+ *
+ * @return esp_err_t ESP_OK on success, or the socket error.
+ */
+static esp_err_t ws_send_text(httpd_handle_t server, int fd, const char *text) {
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)text,
+        .len = strlen(text),
+    };
+    return httpd_ws_send_frame_async(server, fd, &frame);
+}
+
+/**
+ * @brief Pushes a lock state to every connected WebSocket client.
+ *
+ * Runs on the HTTP server task (queued by ws_on_lock_state()), which owns the
+ * sockets, so it never races with request handlers.
+ *
+ * @param arg The new lock_state_t.
+ */
+static void ws_broadcast_state(void *arg) {
+    char text[32];
+    int fds[HTTP_MAX_OPEN_SOCKETS];
+    size_t count = sizeof(fds) / sizeof(fds[0]);
+
+    snprintf(text, sizeof(text), "state %s", lock_ctrl_state_name((lock_state_t)(uintptr_t)arg));
+    if (httpd_get_client_list(http_server, &count, fds) != ESP_OK) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (httpd_ws_get_fd_info(http_server, fds[i]) == HTTPD_WS_CLIENT_WEBSOCKET) {
+            ws_send_text(http_server, fds[i], text);
+        }
+    }
+}
+
+/**
+ * @brief Lock controller listener forwarding state changes to the HTTP server task.
+ */
+static void ws_on_lock_state(lock_state_t state, void *arg) {
+    if (httpd_queue_work(http_server, ws_broadcast_state, (void *)(uintptr_t)state) != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Cannot queue lock state broadcast");
+    }
+}
+
+/**
+ * @brief A WebSocket "response" command on its way through verification.
+ */
+typedef struct {
+    httpd_handle_t server;                      /*!< Server the reply goes out on */
+    int fd;                                     /*!< Socket of the WebSocket client */
+    uint8_t addr[RATE_LIMIT_ADDR_LEN];          /*!< Client address, for the audit log */
+    char nonce[CHALLENGE_NONCE_MAX_LEN + 1];
+    char token[AUTH_HMAC_HEX_LEN + 1];
+    char id[CRED_ID_MAX_LEN + 1];               /*!< Credential ID, empty for the pre-shared key */
+    char reply[64];                             /*!< `unlocked` or `error <reason>` */
+    int64_t t0;                                 /*!< When the frame started arriving, for the metrics */
+    int64_t t;                                  /*!< When the last stage ended, for the metrics */
+    bool busy;                                  /*!< Slot in use, claimed by the server task */
+} ws_verify_t;
+
+/**
+ * @brief Splits a WebSocket "response" command into its fields.
+ *
+ * @param text The frame, NUL-terminated.
+ * @param v Receives the nonce, token and credential ID (empty if there is none).
+ *
+ * @return false unless the frame is `response <nonce> <token> [<credential id>]`
+ *         with every field within its length.
+ */
+static bool ws_parse_response(const char *text, ws_verify_t *v) {
+    int end[3] = { 0 };
+    int fields = sscanf(text, WS_RESPONSE_FORMAT, v->nonce, &end[0], v->token, &end[1], v->id, &end[2]);
+    if (fields < 2) {
+        return false;
+    }
+    if (fields == 2) {
+        v->id[0] = '\0';
+    }
+    // A field that filled its width and goes on would otherwise spill into the next one
+    for (int i = 0; i < fields; i++) {
+        if (text[end[i]] != '\0' && text[end[i]] != ' ') {
+            return false;
+        }
+    }
+    return text[end[fields - 1] + strspn(text + end[fields - 1], " ")] == '\0';
+}
+
+#if HTTP_WORKERS_COUNT > 0
+/* Commands being verified on the HTTP workers, as many as the worker backlog holds */
+static ws_verify_t ws_verifies[HTTP_MAX_OPEN_SOCKETS];
+#else
+/* The command being verified, in place on the server task */
+static ws_verify_t ws_verifies[1];
+#endif
+
+/**
+ * @brief Takes a free command slot. Runs on the HTTP server task.
+ *
+ * @return The slot, or NULL if every one is in use.
+ */
+static ws_verify_t *ws_verify_claim(void) {
+    for (size_t i = 0; i < sizeof(ws_verifies) / sizeof(ws_verifies[0]); i++) {
+        if (!__atomic_load_n(&ws_verifies[i].busy, __ATOMIC_ACQUIRE)) {
+            ws_verifies[i].busy = true;
+            return &ws_verifies[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Checks a parsed "response" command and fills in the reply.
+ *
+ * The client has already been charged to its rate limit.
+ */
+static void ws_verify(ws_verify_t *v) {
+    const char *reason = unlock_flow_verify(v->addr, AUDIT_CH_WS, v->id[0] ? v->id : NULL, v->nonce, v->token);
+    if (reason) {
+        snprintf(v->reply, sizeof(v->reply), "error %s", reason);
+    } else {
+        snprintf(v->reply, sizeof(v->reply), "unlocked");
+    }
+}
+
+#if HTTP_WORKERS_COUNT > 0
+/**
+ * @brief Sends the reply of a verified command. Runs on the HTTP server task.
+ *
+ * @param arg The ws_verify_t, released here.
+ */
+static void ws_verify_reply(void *arg) {
+    ws_verify_t *v = arg;
+
+    // The client may have gone meanwhile, and its socket been reused
+    if (httpd_ws_get_fd_info(v->server, v->fd) == HTTPD_WS_CLIENT_WEBSOCKET) {
+        ws_send_text(v->server, v->fd, v->reply);
+    }
+    metrics_lap(METRICS_WS_SEND, v->t);
+    metrics_lap(METRICS_WS_TOTAL, v->t0);
+    __atomic_store_n(&v->busy, false, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Verifies a command on an HTTP worker and hands the reply back to the server task.
+ *
+ * @param arg The ws_verify_t.
+ */
+static void ws_verify_work(void *arg) {
+    ws_verify_t *v = arg;
+
+    ws_verify(v);
+    v->t = metrics_lap(METRICS_WS_VERIFY, v->t);
+    if (httpd_queue_work(v->server, ws_verify_reply, v) != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Cannot queue WebSocket reply");
+        __atomic_store_n(&v->busy, false, __ATOMIC_RELEASE);
+    }
+}
+#endif
+
+/**
+ * @brief WebSocket handler for unlock RPC and lock state updates.
+ *
+ * One long-lived connection replaces the HTTP requests of the unlock flow and
+ * saves a TCP connection and HTTP parsing per step. Text frames, one command each:
+ *
+ *   client -> `challenge`                 server -> `challenge <nonce>`
+ *   client -> `response <nonce> <token> [<credential id>]`
+ *                                         server -> `unlocked` or `error <reason>`
+ *   server -> `state <locked|unlocked|bad_token>` on connect and on every transition
+ *
+ * Nonces, tokens and credential IDs are the same as for /challenge and /response.
+ * Responses are verified on an HTTP worker, like POST /response, and answered
+ * once verified, so a client that sends several without waiting for the
+ * answers may get them in another order.
+ *
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return esp_err_t ESP_OK on success, or an error to close the connection.
+ */
+static esp_err_t ws_handler(httpd_req_t *req) {
+    char text[WS_MAX_FRAME_LEN + 1];
+    char reply[64];
+    char nonce[CHALLENGE_NONCE_MAX_LEN + 1];
+
+    if (req->method == HTTP_GET) {
+        // Handshake complete: tell the new client where the lock stands
+        snprintf(reply, sizeof(reply), "state %s", lock_ctrl_state_name(lock_ctrl_get_state()));
+        return ws_send_text(req->handle, httpd_req_to_sockfd(req), reply);
+    }
+
+    int64_t t0 = metrics_now();
+    httpd_ws_frame_t frame = { .type = HTTPD_WS_TYPE_TEXT };
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (frame.type != HTTPD_WS_TYPE_TEXT || frame.len > WS_MAX_FRAME_LEN) {
+        return ESP_FAIL;
+    }
+    frame.payload = (uint8_t *)text;
+    err = httpd_ws_recv_frame(req, &frame, frame.len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    text[frame.len] = '\0';
+    int64_t t = metrics_lap(METRICS_WS_RECV, t0);
+
+    if (strcmp(text, "challenge") == 0) {
+        if (unlock_flow_issue(nonce) == ESP_OK) {
+            snprintf(reply, sizeof(reply), "challenge %s", nonce);
+        } else {
+            snprintf(reply, sizeof(reply), "error Cannot issue a challenge");
+        }
+    } else if (strncmp(text, "response ", 9) == 0) {
+        uint8_t addr[RATE_LIMIT_ADDR_LEN];
+        ws_verify_t *v = NULL;
+        req_peer_addr(req, addr);
+        // Turn away flooding clients before they take a slot or a worker
+        if (!unlock_flow_admit(addr, NULL)) {
+            snprintf(reply, sizeof(reply), "error Too many attempts");
+        } else if (!(v = ws_verify_claim())) {
+            snprintf(reply, sizeof(reply), "error Server busy");
+        } else if (!ws_parse_response(text, v)) {
+            snprintf(reply, sizeof(reply), "error Malformed response");
+        } else {
+            v->server = req->handle;
+            v->fd = httpd_req_to_sockfd(req);
+            memcpy(v->addr, addr, sizeof(v->addr));
+            v->t0 = t0;
+            v->t = t;
+#if HTTP_WORKERS_COUNT > 0
+            if (http_workers_queue(ws_verify_work, v) == ESP_OK) {
+                return ESP_OK;
+            }
+            snprintf(reply, sizeof(reply), "error Server busy");
+#else
+            ws_verify(v);
+            snprintf(reply, sizeof(reply), "%s", v->reply);
+#endif
+        }
+        // Not handed to a worker: the slot is free again
+        if (v) {
+            v->busy = false;
+        }
+    } else {
+        snprintf(reply, sizeof(reply), "error Unknown command");
+    }
+    t = metrics_lap(METRICS_WS_VERIFY, t);
+
+    httpd_ws_frame_t out = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)reply,
+        .len = strlen(reply),
+    };
+    err = httpd_ws_send_frame(req, &out);
+    metrics_lap(METRICS_WS_SEND, t);
+    metrics_lap(METRICS_WS_TOTAL, t0);
+    return err;
+}
+
+/**
+ * @brief Checks whether a request header contains a token.
+ *
+ * Headers longer than the local buffer are truncated before matching, which is
+ * sufficient for the short tokens (encodings, ETags) looked up here.
+ *
+ * @param req Pointer to the HTTP request object.
+ * @param field Header name.
+ * @param token Substring to look for.
+ *
+ * @return true if the header is present and contains the token.
+ */
+static bool req_header_contains(httpd_req_t *req, const char *field, const char *token) {
+    char value[128];
+    if (httpd_req_get_hdr_value_len(req, field) == 0) {
+        return false;
+    }
+    esp_err_t err = httpd_req_get_hdr_value_str(req, field, value, sizeof(value));
+    if (err != ESP_OK && err != ESP_ERR_HTTPD_RESULT_TRUNC) {
+        return false;
+    }
+    return strstr(value, token) != NULL;
+}
+
+/**
+ * @brief Sends a response body in fixed-size chunks.
+ *
+ * Small payloads go out in one piece. Larger ones are handed to the socket
+ * one chunk at a time directly from the flash-mapped image, so neither the
+ * server nor the handler ever buffers the whole payload.
+ *
+ * @param req Pointer to the HTTP request object.
+ * @param data Payload, typically pointing into the asset image.
+ * @param len Payload length.
+ *
+ * @return esp_err_t ESP_OK on success, or the socket error.
+ */
+static esp_err_t send_from_flash(httpd_req_t *req, const uint8_t *data, size_t len) {
+    if (len <= ASSET_SEND_CHUNK) {
+        return httpd_resp_send(req, (const char *)data, len);
+    }
+    for (size_t off = 0; off < len; off += ASSET_SEND_CHUNK) {
+        size_t n = len - off < ASSET_SEND_CHUNK ? len - off : ASSET_SEND_CHUNK;
+        esp_err_t err = httpd_resp_send_chunk(req, (const char *)data + off, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * @brief Decodes a hex string of exactly 2 * len digits.
+ *
+ * @return true if the string was valid.
+ */
+static bool hex_decode(const char *hex, uint8_t *out, size_t len) {
+    if (strlen(hex) != 2 * len) {
+        return false;
+    }
+    for (size_t i = 0; i < 2 * len; i++) {
+        char c = hex[i];
+        int v = isdigit((unsigned char)c) ? c - '0' : isxdigit((unsigned char)c) ? (tolower((unsigned char)c) - 'a' + 10) : -1;
+        if (v < 0) {
+            return false;
+        }
+        out[i / 2] = (i & 1) ? (out[i / 2] | v) : (uint8_t)(v << 4);
+    }
+    return true;
+}
+
+/**
+ * @brief Wildcard HTTP GET handler serving every web asset.
+ *
+ * The request path (without query string; a trailing '/' maps to index.html)
+ * is resolved in the asset bundle with a single perfect-hash probe, so the
+ * cost does not depend on how many pages, scripts or icons are bundled. The
+ * payload is sent straight from the flash mapping in fixed-size chunks, so
+ * large pages never need a RAM copy. Assets stored compressed are sent with
+ * `Content-Encoding: gzip` to clients that accept it. Each variant carries a
+ * strong ETag, and a matching `If-None-Match` is answered with 304 Not
+ * Modified and no body, so repeat visits only revalidate.
+ *
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return esp_err_t ESP_OK on success, or ESP_FAIL if the asset does not exist.
+ */
+static esp_err_t asset_get_handler(httpd_req_t *req) {
+    int64_t t0 = metrics_now();
+    char path[128];
+    size_t path_len = strcspn(req->uri, "?#");
+    bool directory = path_len > 0 && req->uri[path_len - 1] == '/';
+
+    if (path_len + (directory ? strlen("index.html") : 0) >= sizeof(path)) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+        return ESP_FAIL;
+    }
+    memcpy(path, req->uri, path_len);
+    if (directory) {
+        memcpy(path + path_len, "index.html", strlen("index.html"));
+        path_len += strlen("index.html");
+    }
+    path[path_len] = '\0';
+
+    // The image stays pinned until the last chunk is out, so an upload cannot erase it
+    const asset_bundle_t *bundle = asset_store_acquire();
+    asset_t asset;
+    if (!asset_bundle_find(bundle, path, path_len, &asset)) {
+        asset_store_release(bundle);
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+        return ESP_FAIL;
+    }
+
+    int64_t t = metrics_lap(METRICS_ASSET_LOOKUP, t0);
+
+    bool gzip = asset.gz_data && req_header_contains(req, "Accept-Encoding", "gzip");
+    const char *etag = gzip ? asset.gz_etag : asset.etag;
+
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    if (asset.gz_data) {
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    }
+
+    // The client already holds this exact representation
+    esp_err_t err;
+    if (req_header_contains(req, "If-None-Match", etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        err = httpd_resp_send(req, NULL, 0);
+    } else {
+        httpd_resp_set_type(req, asset.mime);
+        if (gzip) {
+            httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        }
+        err = send_from_flash(req, gzip ? asset.gz_data : asset.data, gzip ? asset.gz_len : asset.len);
+    }
+    asset_store_release(bundle);
+    metrics_lap(METRICS_ASSET_SEND, t);
+    metrics_lap(METRICS_ASSET_TOTAL, t0);
+    return err;
+}
+
+#if CONFIG_LOCK_METRICS
+/**
+ * @brief metrics_export() sink sending each piece as an HTTP chunk.
+ */
+static esp_err_t metrics_send_chunk(void *ctx, const char *data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+#if !CONFIG_IDF_TARGET_LINUX
+/**
+ * @brief Sends the heap gauges of each heap region as HTTP chunks.
+ *
+ * Free bytes and allocated blocks coming back to the same values after a run
+ * of unlocks means nothing leaked and nothing long-lived was left behind.
+ * With CONFIG_LOCK_HEAP_ALLOC_COUNT the allocation counters by owner follow,
+ * which tools/heap_soak.sh uses to see every allocation made during the run.
+ */
+static esp_err_t heap_send_metrics(httpd_req_t *req) {
+    static const struct {
+        const char *name;
+        uint32_t caps;
+    } regions[] = {
+        { "internal", MALLOC_CAP_INTERNAL },
+#if CONFIG_SPIRAM
+        { "psram", MALLOC_CAP_SPIRAM },
+#endif
+    };
+    static const struct {
+        const char *name;
+        const char *help;
+    } gauges[] = {
+        { "free_bytes", "Free heap bytes." },
+        { "minimum_free_bytes", "Lowest free heap bytes since boot." },
+        { "largest_free_block_bytes", "Largest block that can be allocated." },
+        { "allocated_blocks", "Blocks currently allocated." },
+    };
+    multi_heap_info_t info[sizeof(regions) / sizeof(regions[0])];
+    char line[160];
+    int len;
+    esp_err_t err = ESP_OK;
+
+    for (size_t r = 0; r < sizeof(regions) / sizeof(regions[0]); r++) {
+        heap_caps_get_info(&info[r], regions[r].caps);
+    }
+    for (size_t g = 0; g < sizeof(gauges) / sizeof(gauges[0]) && err == ESP_OK; g++) {
+        len = snprintf(line, sizeof(line), "# HELP lock_heap_%s %s\n# TYPE lock_heap_%s gauge\n", gauges[g].name,
+                       gauges[g].help, gauges[g].name);
+        err = httpd_resp_send_chunk(req, line, len);
+        for (size_t r = 0; r < sizeof(regions) / sizeof(regions[0]) && err == ESP_OK; r++) {
+            const size_t values[] = { info[r].total_free_bytes, info[r].minimum_free_bytes,
+                                      info[r].largest_free_block, info[r].allocated_blocks };
+            len = snprintf(line, sizeof(line), "lock_heap_%s{region=\"%s\"} %u\n", gauges[g].name, regions[r].name,
+                           (unsigned)values[g]);
+            err = httpd_resp_send_chunk(req, line, len);
+        }
+    }
+#if CONFIG_LOCK_HEAP_ALLOC_COUNT
+    heap_watch_counts_t counts;
+    heap_watch_get(&counts);
+    if (err == ESP_OK) {
+        static const char header[] =
+            "# HELP lock_heap_allocs_total Heap allocations since boot, by the task that made them.\n"
+            "# TYPE lock_heap_allocs_total counter\n";
+        err = httpd_resp_send_chunk(req, header, sizeof(header) - 1);
+    }
+    for (int o = 0; o < HEAP_WATCH_OWNER_COUNT && err == ESP_OK; o++) {
+        len = snprintf(line, sizeof(line), "lock_heap_allocs_total{by=\"%s\"} %lu\n",
+                       heap_watch_owner_name((heap_watch_owner_t)o), (unsigned long)counts.allocs[o]);
+        err = httpd_resp_send_chunk(req, line, len);
+    }
+    if (err == ESP_OK) {
+        len = snprintf(line, sizeof(line),
+                       "# HELP lock_heap_frees_total Heap frees since boot.\n"
+                       "# TYPE lock_heap_frees_total counter\n"
+                       "lock_heap_frees_total %lu\n", (unsigned long)counts.frees);
+        err = httpd_resp_send_chunk(req, line, len);
+    }
+#endif
+    return err;
+}
+#endif
+
+/**
+ * @brief HTTP GET handler exporting the request stage histograms.
+ *
+ * The body is in the Prometheus text exposition format, so the endpoint can
+ * be scraped directly. Only stages that have recorded at least one request
+ * are listed. The boot phases, the persisted lock counters and the heap
+ * gauges follow the counters.
+ *
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return esp_err_t ESP_OK on success, or the socket error.
+ */
+static esp_err_t metrics_get_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    esp_err_t err = metrics_export(metrics_send_chunk, req);
+    if (err != ESP_OK) {
+        return err;
+    }
+    char line[64];
+    int len;
+#if CONFIG_LOCK_LOG_OFFLOAD
+    static const char log_dropped[] = "# HELP lock_log_dropped_total Log lines lost to a full log ring.\n"
+                                      "# TYPE lock_log_dropped_total counter\n";
+    err = httpd_resp_send_chunk(req, log_dropped, sizeof(log_dropped) - 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+    len = snprintf(line, sizeof(line), "lock_log_dropped_total %lu\n", (unsigned long)log_offload_dropped());
+    err = httpd_resp_send_chunk(req, line, len);
+    if (err != ESP_OK) {
+        return err;
+    }
+#endif
+    static const char nonce_exhausted[] =
+        "# HELP lock_nonce_pool_exhausted_total Challenges issued while the nonce pool was empty.\n"
+        "# TYPE lock_nonce_pool_exhausted_total counter\n";
+    err = httpd_resp_send_chunk(req, nonce_exhausted, sizeof(nonce_exhausted) - 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+    len = snprintf(line, sizeof(line), "lock_nonce_pool_exhausted_total %lu\n",
+                   (unsigned long)nonce_pool_exhausted());
+    err = httpd_resp_send_chunk(req, line, len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    static const char challenges_evicted[] =
+        "# HELP lock_challenges_evicted_total Outstanding challenges dropped to make room for new ones.\n"
+        "# TYPE lock_challenges_evicted_total counter\n";
+    err = httpd_resp_send_chunk(req, challenges_evicted, sizeof(challenges_evicted) - 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+    len = snprintf(line, sizeof(line), "lock_challenges_evicted_total %lu\n",
+                   (unsigned long)challenge_store_evicted());
+    err = httpd_resp_send_chunk(req, line, len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = boot_prof_export(metrics_send_chunk, req);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = state_store_export(metrics_send_chunk, req);
+    if (err != ESP_OK) {
+        return err;
+    }
+#if !CONFIG_IDF_TARGET_LINUX
+    err = heap_send_metrics(req);
+    if (err != ESP_OK) {
+        return err;
+    }
+#endif
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+#endif
 
-        // Wait for 4 seconds to allow the blue LED indication to be visible
-        vTaskDelay(pdMS_TO_TICKS(4000));
+#if CONFIG_LOCK_TASK_STATS
+/**
+ * @brief task_topology_report() sink sending each line as an HTTP chunk.
+ */
+static esp_err_t tasks_send_chunk(void *ctx, const char *data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
 
-        // Re-lock the system after the delay
-        lock_is_open = false;
-        ESP_LOGI(TAG, "🔴 Relocking - LED set to red");
-        set_led_color(255, 0, 0);
+/**
+ * @brief HTTP GET handler listing every task with its core, priority and CPU time.
+ *
+ * One line per task, busiest first: name, core (`any` if not pinned),
+ * priority, state (X running, R ready, B blocked, S suspended), lowest free
+ * stack in bytes, and the time it has run since boot in µs and as a share of
+ * one core. The idle tasks show how much of each core is left. Comparing two
+ * reads gives the load over the interval.
+ *
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return esp_err_t ESP_OK on success, or the socket error.
+ */
+static esp_err_t tasks_get_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "text/plain");
+    esp_err_t err = task_topology_report(tasks_send_chunk, req);
+    if (err == ESP_ERR_NO_MEM) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
     }
+    if (err != ESP_OK) {
+        return err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+#endif
+
+/**
+ * @brief Checks that a request answers an outstanding challenge.
+ *
+ * Privileged endpoints reuse the challenge-response scheme of /response: the
+ * client fetches a challenge from /challenge and sends it in `X-Nonce` along
+ * with the hex encoded HMAC-SHA256 of the challenge in `X-Auth`. The challenge
+ * is consumed, so a captured request cannot be replayed.
+ *
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return true if the request is authenticated.
+ */
+static bool req_authenticate(httpd_req_t *req) {
+    char nonce[CHALLENGE_NONCE_MAX_LEN + 1];
+    char token[AUTH_HMAC_HEX_LEN + 1];
+
+    if (httpd_req_get_hdr_value_str(req, "X-Nonce", nonce, sizeof(nonce)) != ESP_OK ||
+        httpd_req_get_hdr_value_str(req, "X-Auth", token, sizeof(token)) != ESP_OK) {
+        return false;
+    }
+    return challenge_store_consume(nonce) &&
+           auth_hmac_verify_hex(&config_store_get()->psk_key, nonce, strlen(nonce), token);
+}
+
+/**
+ * @brief Admits an image upload: rate limit, authentication and the announced hash.
+ *
+ * Sends the error response itself when the upload is refused.
+ *
+ * @param req Pointer to the HTTP request object.
+ * @param sha256 Receives the SHA-256 announced in `X-Image-SHA256`.
+ *
+ * @return true if the upload may proceed.
+ */
+static bool req_upload_admitted(httpd_req_t *req, uint8_t sha256[32]) {
+    char hex[2 * 32 + 1];
+
+    if (req_rate_limited(req)) {
+        return false;
+    }
+    if (!req_authenticate(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Authentication required");
+        return false;
+    }
+    if (httpd_req_get_hdr_value_str(req, "X-Image-SHA256", hex, sizeof(hex)) != ESP_OK ||
+        !hex_decode(hex, sha256, 32)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or invalid X-Image-SHA256");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Claims the admin lock for an update, answering 409 while another one runs.
+ *
+ * Uploads and policy updates may run on different HTTP workers at the same
+ * time; this keeps them one at a time, which the stores and the receive
+ * buffers below rely on. The lock is released with xSemaphoreGive().
+ *
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return true if the lock was claimed.
+ */
+static bool req_admin_claim(httpd_req_t *req) {
+    if (xSemaphoreTake(admin_lock, 0) != pdTRUE) {
+        httpd_resp_send_custom_err(req, "409 Conflict", "Another update is in progress");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Streams the request body into an image store through a small buffer.
+ *
+ * Must be called with the admin lock held (see req_admin_claim()).
+ *
+ * @param req Pointer to the HTTP request object.
+ * @param write Upload write function of the store, e.g. asset_store_upload_write().
+ *
+ * @return esp_err_t ESP_OK once the whole body has been written, or the first error.
+ */
+static esp_err_t req_recv_upload(httpd_req_t *req, esp_err_t (*write)(const void *data, size_t len)) {
+    static LOCK_COLD_BSS char buf[ASSET_UPLOAD_CHUNK];
+    size_t remaining = req->content_len;
 
+    while (remaining > 0) {
+        int len = httpd_req_recv(req, buf, remaining < sizeof(buf) ? remaining : sizeof(buf));
+        if (len == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (len <= 0) {
+            return ESP_FAIL;
+        }
+        esp_err_t err = write(buf, len);
+        if (err != ESP_OK) {
+            return err;
+        }
+        remaining -= len;
+    }
     return ESP_OK;
 }
 
 /**
- * @brief HTTP GET handler for serving the root web page.
+ * @brief Answers a refused upload start: 409 while another upload runs or the
+ * slot to write is still being read, 413 otherwise.
+ */
+static void send_upload_begin_err(httpd_req_t *req, esp_err_t err) {
+    httpd_resp_send_custom_err(req, err == ESP_ERR_INVALID_STATE ? "409 Conflict" : "413 Payload Too Large",
+                               esp_err_to_name(err));
+}
+
+/**
+ * @brief HTTP PUT handler replacing the web asset image.
+ *
+ * The body is a packed asset image as produced by gen_assets.py (`--output`),
+ * and `X-Image-SHA256` carries its hex encoded SHA-256. The request must be
+ * authenticated (see req_authenticate()). The image is streamed through a
+ * small buffer into the inactive asset partition while its hash is computed,
+ * and the new UI is served from the next request on once the hash matches.
+ * The running image stays active if anything goes wrong.
+ *
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return esp_err_t ESP_OK once a response has been sent, or ESP_FAIL on failure.
+ */
+static esp_err_t put_assets_handler(httpd_req_t *req) {
+    uint8_t sha256[32];
+
+    if (!req_upload_admitted(req, sha256) || !req_admin_claim(req)) {
+        return ESP_FAIL;
+    }
+    esp_err_t err = asset_store_upload_begin(req->content_len, sha256);
+    if (err != ESP_OK) {
+        send_upload_begin_err(req, err);
+        goto out;
+    }
+    err = req_recv_upload(req, asset_store_upload_write);
+    if (err != ESP_OK) {
+        asset_store_upload_abort();
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Upload failed");
+        goto out;
+    }
+
+    err = asset_store_upload_finish();
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, esp_err_to_name(err));
+        goto out;
+    }
+    req_audit(req, AUDIT_EVT_ASSETS_UPDATED, AUDIT_CH_ADMIN);
+    httpd_resp_sendstr(req, "Assets updated");
+
+out:
+    xSemaphoreGive(admin_lock);
+    return err == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief HTTP PUT handler replacing all per-phone credentials.
  *
- * This handler serves the index.html file embedded in the firmware binary.
- * The start and end symbols (index_html_start and index_html_end) mark the
- * location of the HTML file data in the binary.
+ * The body is a credential table as produced by tools/gen_creds.py, with its
+ * hex encoded SHA-256 in `X-Image-SHA256`; the request must be authenticated
+ * with the pre-shared key (see req_authenticate()). Like an asset upload, the
+ * table is streamed into the inactive credential partition and replaces the
+ * active table atomically once its hash matches, so responses keep being
+ * verified against the old credentials until then. An empty table revokes
+ * every credential.
  *
  * @param req Pointer to the HTTP request object.
  *
- * @return esp_err_t ESP_OK on success.
+ * @return esp_err_t ESP_OK once a response has been sent, or ESP_FAIL on failure.
  */
-static esp_err_t root_get_handler(httpd_req_t *req) {
-    // External symbols generated by the linker, representing the HTML file in flash
-    extern const unsigned char index_html_start[] asm("_binary_index_html_start");
-    extern const unsigned char index_html_end[]   asm("_binary_index_html_end");
-    size_t index_html_size = (index_html_end - index_html_start);
+static esp_err_t put_credentials_handler(httpd_req_t *req) {
+    uint8_t sha256[32];
+    char msg[40];
+
+    if (!req_upload_admitted(req, sha256) || !req_admin_claim(req)) {
+        return ESP_FAIL;
+    }
+    esp_err_t err = cred_store_upload_begin(req->content_len, sha256);
+    if (err != ESP_OK) {
+        send_upload_begin_err(req, err);
+        goto out;
+    }
+    err = req_recv_upload(req, cred_store_upload_write);
+    if (err != ESP_OK) {
+        cred_store_upload_abort();
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Upload failed");
+        goto out;
+    }
 
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, (const char *)index_html_start, index_html_size);
+    err = cred_store_upload_finish();
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, esp_err_to_name(err));
+        goto out;
+    }
+    req_audit(req, AUDIT_EVT_CREDS_UPDATED, AUDIT_CH_ADMIN);
+    snprintf(msg, sizeof(msg), "%u credentials active", (unsigned)cred_store_count());
+    httpd_resp_sendstr(req, msg);
+
+out:
+    xSemaphoreGive(admin_lock);
+    return err == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Receives a small request body in one piece and NUL-terminates it.
+ *
+ * @param req Pointer to the HTTP request object.
+ * @param buf Receives the body.
+ * @param size Size of buf; longer bodies are refused.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_SIZE if the body does not fit, or ESP_FAIL.
+ */
+static esp_err_t req_recv_small_body(httpd_req_t *req, char *buf, size_t size) {
+    size_t received = 0;
+
+    if (req->content_len >= size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    while (received < req->content_len) {
+        int len = httpd_req_recv(req, buf + received, req->content_len - received);
+        if (len == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (len <= 0) {
+            return ESP_FAIL;
+        }
+        received += len;
+    }
+    buf[received] = '\0';
     return ESP_OK;
 }
 
 /**
- * @brief Initializes and starts the HTTP server.
+ * @brief HTTP PUT handler replacing the access policy.
  *
- * This function configures the HTTP server with default settings, registers URI
- * handlers for the root page, challenge token generation, and authentication response,
- * and then starts the server.
+ * The body is the policy source described in access_policy.h, at most
+ * ACCESS_POLICY_MAX_LEN bytes, and the request must be authenticated with the
+ * pre-shared key (see req_authenticate()). The policy is compiled into the
+ * time-of-week bitmaps and takes effect with the next response; a policy with
+ * a syntax error is refused with the offending line and the old one stays
+ * active.
  *
- * @return httpd_handle_t Handle to the HTTP server instance, or NULL if server startup fails.
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return esp_err_t ESP_OK once a response has been sent, or ESP_FAIL on failure.
  */
-static httpd_handle_t start_webserver(void) {
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    httpd_handle_t server = NULL;
+static esp_err_t put_policy_handler(httpd_req_t *req) {
+    static char text[ACCESS_POLICY_MAX_LEN + 1]; // guarded by admin_lock
+    char msg[48];
+    int error_line;
 
-    if (httpd_start(&server, &config) == ESP_OK) {
-        // Register URI handler for serving the main web page
-        httpd_register_uri_handler(server, &(httpd_uri_t){
-            .uri = "/", .method = HTTP_GET, .handler = root_get_handler
-        });
-        // Register URI handler for generating the challenge token
-        httpd_register_uri_handler(server, &(httpd_uri_t){
-            .uri = "/challenge", .method = HTTP_GET, .handler = get_challenge_handler
-        });
-        // Register URI handler for processing the response token
-        httpd_register_uri_handler(server, &(httpd_uri_t){
-            .uri = "/response", .method = HTTP_POST, .handler = post_response_handler
-        });
+    if (req_rate_limited(req)) {
+        return ESP_FAIL;
     }
-    return server;
+    if (!req_authenticate(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Authentication required");
+        return ESP_FAIL;
+    }
+    if (!req_admin_claim(req)) {
+        return ESP_FAIL;
+    }
+    esp_err_t err = req_recv_small_body(req, text, sizeof(text));
+    if (err != ESP_OK) {
+        httpd_resp_send_custom_err(req, err == ESP_ERR_INVALID_SIZE ? "413 Payload Too Large" : "400 Bad Request",
+                                   "Policy not received");
+        goto out;
+    }
+
+    err = access_policy_update(text, req->content_len, &error_line);
+    if (err == ESP_ERR_INVALID_ARG) {
+        snprintf(msg, sizeof(msg), "Policy error on line %d", error_line);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, msg);
+        goto out;
+    }
+    if (err != ESP_OK) {
+        httpd_resp_send_custom_err(req, "409 Conflict", esp_err_to_name(err));
+        goto out;
+    }
+    req_audit(req, AUDIT_EVT_POLICY_UPDATED, AUDIT_CH_ADMIN);
+    snprintf(msg, sizeof(msg), "Policy active, restricted schedules 0x%04lx",
+             (unsigned long)access_policy_restricted());
+    httpd_resp_sendstr(req, msg);
+
+out:
+    xSemaphoreGive(admin_lock);
+    return err == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief HTTP PUT handler setting the wall clock access schedules are checked against.
+ *
+ * The body is the current time in seconds since the Unix epoch (UTC). The
+ * board has no battery-backed clock, so this must be repeated after every
+ * restart; until then only credentials whose schedule is open around the
+ * clock are accepted. The request must be authenticated with the pre-shared
+ * key (see req_authenticate()).
+ *
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return esp_err_t ESP_OK once a response has been sent, or ESP_FAIL on failure.
+ */
+static esp_err_t put_clock_handler(httpd_req_t *req) {
+    char body[CLOCK_BODY_MAX_LEN + 1];
+    char *end;
+
+    if (req_rate_limited(req)) {
+        return ESP_FAIL;
+    }
+    if (!req_authenticate(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Authentication required");
+        return ESP_FAIL;
+    }
+    if (req_recv_small_body(req, body, sizeof(body)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid time");
+        return ESP_FAIL;
+    }
+    long long unix_s = strtoll(body, &end, 10);
+    if (end == body || (*end != '\0' && !isspace((unsigned char)*end)) ||
+        lock_hal_set_wall_time_s(unix_s) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid time");
+        return ESP_FAIL;
+    }
+    req_audit(req, AUDIT_EVT_CLOCK_SET, AUDIT_CH_ADMIN);
+    httpd_resp_sendstr(req, "Clock set");
+    return ESP_OK;
 }
 
 /**
- * @brief Initializes and starts the Wi-Fi Access Point (AP) mode.
+ * @brief HTTP GET handler returning the current settings.
  *
- * This function sets up the ESP32 as a Wi-Fi Access Point with the following parameters:
- *  - SSID: "LockAP"
- *  - Channel: 1
- *  - Password: "12345678"
- *  - Maximum number of simultaneous connections: 4
- *  - Authentication mode: WPA/WPA2 PSK
+ * The answer is the text form of config_store.h without the access point
+ * password and the pre-shared key. The request must be authenticated with
+ * the pre-shared key (see req_authenticate()).
  *
- * Upon successful configuration, the Access Point is started and becomes available
- * for client connections.
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return esp_err_t ESP_OK once a response has been sent, or ESP_FAIL on failure.
  */
-static void wifi_init_softap(void) {
-    // Create the default Wi-Fi AP network interface
-    esp_netif_create_default_wifi_ap();
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+static esp_err_t get_config_handler(httpd_req_t *req) {
+    char text[256];
 
-    wifi_config_t wifi_config = {
-        .ap = {
-            .ssid = "LockAP",
-            .ssid_len = strlen("LockAP"),
-            .channel = 1,
-            .password = "12345678",
-            .max_connection = 4,
-            .authmode = WIFI_AUTH_WPA_WPA2_PSK
-        },
+    if (req_rate_limited(req)) {
+        return ESP_FAIL;
+    }
+    if (!req_authenticate(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Authentication required");
+        return ESP_FAIL;
+    }
+    config_store_format(text, sizeof(text));
+    httpd_resp_set_type(req, "text/plain");
+    return httpd_resp_sendstr(req, text);
+}
+
+/**
+ * @brief Hands changed settings to the subsystems that do not read them per use.
+ *
+ * The LED moves on the lock controller task and the access point is set up
+ * again; the bad-token indication and the pre-shared key are read from the
+ * snapshot whenever they are needed, so they apply without any help. Runs
+ * with the admin lock held, which keeps the snapshot current meanwhile.
+ *
+ * @param changed config_store_changed_t groups reported by config_store_update().
+ */
+static void config_apply(uint32_t changed) {
+    const lock_config_t *config = config_store_get();
+
+    if ((changed & CONFIG_STORE_CHANGED_LED) && lock_ctrl_post(LOCK_EVT_CONFIG_CHANGED) != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ LED stays on its GPIO until the next reboot");
+    }
+    if (changed & CONFIG_STORE_CHANGED_NET) {
+        esp_err_t err = lock_hal_net_set_ap(config->ap_ssid, config->ap_password);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "⚠️ Access point not reconfigured: %s", esp_err_to_name(err));
+        }
+    }
+}
+
+/**
+ * @brief HTTP PUT handler changing settings without a reboot.
+ *
+ * The body holds the `key=value` lines of the settings to change, in the
+ * text form of config_store.h, at most CONFIG_STORE_TEXT_MAX_LEN bytes. The
+ * request must be authenticated with the pre-shared key (see
+ * req_authenticate()); a new pre-shared key authenticates the requests after
+ * this one. An unknown setting or a value out of range is refused with its
+ * line and nothing changes. The answer goes out before a new access point
+ * SSID or password is applied, since that disconnects the client.
+ *
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return esp_err_t ESP_OK once a response has been sent, or ESP_FAIL on failure.
+ */
+static esp_err_t put_config_handler(httpd_req_t *req) {
+    static char text[CONFIG_STORE_TEXT_MAX_LEN + 1]; // guarded by admin_lock
+    char msg[48];
+    int error_line;
+    uint32_t changed = 0;
+
+    if (req_rate_limited(req)) {
+        return ESP_FAIL;
+    }
+    if (!req_authenticate(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Authentication required");
+        return ESP_FAIL;
+    }
+    if (!req_admin_claim(req)) {
+        return ESP_FAIL;
+    }
+    esp_err_t err = req_recv_small_body(req, text, sizeof(text));
+    if (err != ESP_OK) {
+        httpd_resp_send_custom_err(req, err == ESP_ERR_INVALID_SIZE ? "413 Payload Too Large" : "400 Bad Request",
+                                   "Settings not received");
+        goto out;
+    }
+
+    err = config_store_update(text, req->content_len, &error_line, &changed);
+    if (err == ESP_ERR_NOT_FOUND || err == ESP_ERR_INVALID_ARG) {
+        snprintf(msg, sizeof(msg), "%s on line %d",
+                 err == ESP_ERR_NOT_FOUND ? "Unknown setting" : "Invalid value", error_line);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, msg);
+        goto out;
+    }
+    if (err != ESP_OK) {
+        httpd_resp_send_custom_err(req, "409 Conflict", esp_err_to_name(err));
+        goto out;
+    }
+    if (changed) {
+        req_audit(req, AUDIT_EVT_CONFIG_UPDATED, AUDIT_CH_ADMIN);
+    }
+    snprintf(msg, sizeof(msg), "Settings generation %lu active",
+             (unsigned long)config_store_get()->generation);
+    httpd_resp_sendstr(req, msg);
+    config_apply(changed);
+
+out:
+    xSemaphoreGive(admin_lock);
+    return err == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Streaming state of an /audit response.
+ */
+typedef struct {
+    httpd_req_t *req;
+    size_t len;
+    char buf[256];
+} audit_stream_t;
+
+/**
+ * @brief audit_log_query() callback formatting one record as a text line.
+ */
+static esp_err_t audit_stream_record(void *ctx, const audit_record_t *rec) {
+    audit_stream_t *out = ctx;
+    char ip[INET6_ADDRSTRLEN];
+    static const uint8_t v4_mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+
+    if (memcmp(rec->addr, v4_mapped, sizeof(v4_mapped)) == 0) {
+        inet_ntop(AF_INET, rec->addr + 12, ip, sizeof(ip));
+    } else {
+        inet_ntop(AF_INET6, rec->addr, ip, sizeof(ip));
+    }
+    // Lines are well below half the buffer, so one flush always makes room
+    if (out->len > sizeof(out->buf) / 2) {
+        esp_err_t err = httpd_resp_send_chunk(out->req, out->buf, out->len);
+        out->len = 0;
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    out->len += snprintf(out->buf + out->len, sizeof(out->buf) - out->len, "%llu %s %s %s\n",
+                         (unsigned long long)rec->time_ms, audit_event_name(rec->event),
+                         audit_channel_name(rec->channel), ip);
+    return ESP_OK;
+}
+
+/**
+ * @brief HTTP GET handler streaming audit log records in a time range.
+ *
+ * `GET /audit?from=<ms>&to=<ms>` returns one line per record,
+ * `<time_ms> <event> <channel> <client ip>`, oldest first. Both bounds are
+ * optional and inclusive, in audit clock milliseconds; the current audit
+ * clock is returned in `X-Audit-Now` so clients can map it to wall time. The
+ * log names the clients that opened the lock, so the request must be
+ * authenticated like an asset upload (see req_authenticate()).
+ *
+ * @param req Pointer to the HTTP request object.
+ *
+ * @return esp_err_t ESP_OK once the records have been sent, or ESP_FAIL on failure.
+ */
+static esp_err_t audit_get_handler(httpd_req_t *req) {
+    char query[64];
+    char value[24];
+    char now[24];
+    uint64_t from_ms = 0, to_ms = UINT64_MAX;
+
+    if (req_rate_limited(req)) {
+        return ESP_FAIL;
+    }
+    if (!req_authenticate(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Authentication required");
+        return ESP_FAIL;
+    }
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char *end;
+        if (httpd_query_key_value(query, "from", value, sizeof(value)) == ESP_OK) {
+            from_ms = strtoull(value, &end, 10);
+            if (*end != '\0') {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid from");
+                return ESP_FAIL;
+            }
+        }
+        if (httpd_query_key_value(query, "to", value, sizeof(value)) == ESP_OK) {
+            to_ms = strtoull(value, &end, 10);
+            if (*end != '\0') {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid to");
+                return ESP_FAIL;
+            }
+        }
+    }
+
+    snprintf(now, sizeof(now), "%llu", (unsigned long long)audit_log_now_ms());
+    httpd_resp_set_hdr(req, "X-Audit-Now", now);
+    httpd_resp_set_type(req, "text/plain");
+
+    audit_stream_t out = { .req = req };
+    esp_err_t err = audit_log_query(from_ms, to_ms, audit_stream_record, &out);
+    if (err == ESP_OK && out.len) {
+        err = httpd_resp_send_chunk(req, out.buf, out.len);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Audit query failed: %s", esp_err_to_name(err));
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * @brief Initializes and starts the HTTP server.
+ *
+ * This function configures the HTTP server with default settings plus wildcard
+ * URI matching, registers URI handlers for challenge token generation and
+ * authentication response, one-round-trip unlock, the WebSocket channel,
+ * metrics export, the task list, asset image and credential table uploads, the access policy
+ * and the clock, the settings, audit queries, and a catch-all handler serving the bundled web
+ * assets, and then starts the server. The catch-all must be registered last because handlers
+ * are matched in registration order. Responses, unlocks, uploads, policy and settings updates
+ * and audit queries run on the HTTP workers (see http_workers.h); the rest is cheap enough
+ * to answer on the server task. The server is sized for exactly the handlers in the table,
+ * and is stopped again if any of them fails to register.
+ *
+ * @return httpd_handle_t Handle to the HTTP server instance, or NULL if server startup fails.
+ */
+static httpd_handle_t start_webserver(void) {
+    static const httpd_uri_t uris[] = {
+        // Challenge token generation and the response that answers it
+        { .uri = "/challenge", .method = HTTP_GET, .handler = get_challenge_handler },
+        { .uri = "/response", .method = HTTP_POST, ON_WORKER(post_response_handler) },
+#if CONFIG_LOCK_AUTH_COUNTER_UNLOCK
+        // One-round-trip unlocks
+        { .uri = "/unlock", .method = HTTP_POST, ON_WORKER(post_unlock_handler) },
+#endif
+        // WebSocket endpoint, also pushed lock state changes
+        { .uri = "/ws", .method = HTTP_GET, .handler = ws_handler, .is_websocket = true },
+#if CONFIG_LOCK_METRICS
+        // Latency histograms
+        { .uri = "/metrics", .method = HTTP_GET, .handler = metrics_get_handler },
+#endif
+#if CONFIG_LOCK_TASK_STATS
+        // Tasks and their CPU time
+        { .uri = "/tasks", .method = HTTP_GET, .handler = tasks_get_handler },
+#endif
+        // Replacing the web asset image and the credential table
+        { .uri = "/assets", .method = HTTP_PUT, ON_WORKER(put_assets_handler) },
+        { .uri = "/credentials", .method = HTTP_PUT, ON_WORKER(put_credentials_handler) },
+        // The access policy and the clock it is checked against
+        { .uri = "/policy", .method = HTTP_PUT, ON_WORKER(put_policy_handler) },
+        { .uri = "/clock", .method = HTTP_PUT, .handler = put_clock_handler },
+        // Reading and changing the settings
+        { .uri = "/config", .method = HTTP_GET, .handler = get_config_handler },
+        { .uri = "/config", .method = HTTP_PUT, ON_WORKER(put_config_handler) },
+        // Audit log range queries
+        { .uri = "/audit", .method = HTTP_GET, ON_WORKER(audit_get_handler) },
+        // Catch-all serving the web assets (must stay last)
+        { .uri = "/*", .method = HTTP_GET, .handler = asset_get_handler },
     };
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.uri_match_fn = httpd_uri_match_wildcard;
+    config.server_port = CONFIG_LOCK_HTTP_PORT;
+    config.max_open_sockets = HTTP_MAX_OPEN_SOCKETS;
+    config.max_uri_handlers = sizeof(uris) / sizeof(uris[0]);
+    config.core_id = task_topology_get(TASK_ROLE_HTTPD)->core;
+    config.task_priority = task_topology_get(TASK_ROLE_HTTPD)->priority;
+    httpd_handle_t server = NULL;
 
-    // Set the device to operate in AP mode and apply the configuration
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+    if (httpd_start(&server, &config) != ESP_OK) {
+        return NULL;
+    }
+#if CONFIG_LOCK_HEAP_ALLOC_COUNT
+    heap_watch_add_task(xTaskGetHandle("httpd"), HEAP_WATCH_HTTPD);
+#endif
+    // A handler that fails to register would answer 404 (or fall to the catch-all), so refuse to run without it
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        esp_err_t err = httpd_register_uri_handler(server, &uris[i]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "❌ Could not register %s %s: %s", http_method_str(uris[i].method), uris[i].uri,
+                     esp_err_to_name(err));
+            httpd_stop(server);
+            return NULL;
+        }
+    }
+    // Push lock state changes to the WebSocket clients
+    http_server = server;
+    lock_ctrl_set_listener(ws_on_lock_state, NULL);
+    return server;
+}
 
-    ESP_LOGI(TAG, "🛜 Wi-Fi AP started. SSID=%s, Password=%s",
-             wifi_config.ap.ssid, wifi_config.ap.password);
+/* Stack of the one-shot task bringing up the network during startup */
+#define NET_START_TASK_STACK 4096
+
+/* Given by net_start_task once the network is up */
+static StaticSemaphore_t net_up_buf;
+static SemaphoreHandle_t net_up;
+
+/**
+ * @brief Starts the access point (or QEMU Ethernet) while app_main goes on, then exits.
+ */
+static void net_start_task(void *arg) {
+    boot_prof_begin(BOOT_PHASE_NET_UP);
+    ESP_ERROR_CHECK(lock_hal_net_start());
+    boot_prof_end(BOOT_PHASE_NET_UP);
+    xSemaphoreGive(net_up);
+    vTaskDelete(NULL);
 }
 
 /**
  * @brief Main application entry point.
  *
  * This function performs the following initialization steps:
- *  1. Initializes Non-Volatile Storage (NVS) to support system configurations.
- *  2. Sets up network components including the default Wi-Fi Access Point and event loop.
- *  3. Configures the LED strip and sets its initial color to red, indicating that the lock is engaged.
- *  4. Initializes the Wi-Fi Access Point to allow client connections.
- *  5. Starts the HTTP server to handle incoming web requests.
+ *  1. Hands console output to the log offload task.
+ *  2. Logs the task topology, restores the lock state, loads the settings (see
+ *     config_store.h) and starts the lock controller, which configures the LED on the
+ *     configured GPIO and sets it to the restored color on its own task.
+ *  3. Initializes the challenge store for outstanding challenges and fills the nonce
+ *     pool they are drawn from, with the startup entropy source of the HAL on since
+ *     the radio is not up yet.
+ *  4. Prepares the network stack through the HAL and starts the network (the Wi-Fi
+ *     Access Point on the device, the host network on the linux target) on a helper
+ *     task, free to run on the other core; meanwhile initializes the web asset store,
+ *     the credential store and the audit log.
+ *  5. Starts the HTTP workers and the HTTP server, which listens on every interface
+ *     and so need not wait for the access point.
+ *  6. Waits for the network, logs the boot profile and compiles the access policy
+ *     stored in NVS, which the first check would otherwise do.
  */
 void app_main(void) {
-    /* Initialize NVS flash storage */
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        // If necessary, erase and reinitialize NVS
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
+#if CONFIG_LOCK_LOG_OFFLOAD
+    /* Move console output off the calling tasks before anything else logs */
+    ESP_ERROR_CHECK(log_offload_start());
+#endif
+
+    /* Log where every task will run */
+    task_topology_log();
+
+    /* Restore the lock state and counters from before the reset */
+    boot_prof_begin(BOOT_PHASE_STATE);
+    ESP_ERROR_CHECK(state_store_init());
+    boot_prof_end(BOOT_PHASE_STATE);
+
+    /* Load the settings (LED GPIO, access point, pre-shared key) from NVS over the defaults */
+    boot_prof_begin(BOOT_PHASE_CONFIG);
+    ESP_ERROR_CHECK(config_store_init());
+    ESP_LOGI(TAG, "🔏 Verifying responses with the %s HMAC backend",
+             auth_hmac_backend_name(config_store_get()->psk_key.backend));
+    boot_prof_end(BOOT_PHASE_CONFIG);
+
+    /* Start the lock controller: it sets up the LED in the color of the restored state */
+    ESP_ERROR_CHECK(lock_ctrl_start());
+
+    /* Prepare the table of outstanding challenges and the nonce pool it draws from */
+    boot_prof_begin(BOOT_PHASE_AUTH);
+    ESP_ERROR_CHECK(challenge_store_init());
+    /* Draw the first nonces and the replay epoch before the radio, the RNG's usual entropy, is up */
+    lock_hal_entropy_enable();
+    esp_err_t err = nonce_pool_start();
+    unlock_flow_init();
+    lock_hal_entropy_disable();
+    ESP_ERROR_CHECK(err);
+    boot_prof_end(BOOT_PHASE_AUTH);
+
+    /* Bring up the network for client connections, next to the rest of startup */
+    boot_prof_begin(BOOT_PHASE_NET_INIT);
+    ESP_ERROR_CHECK(lock_hal_net_init());
+    ESP_ERROR_CHECK(lock_hal_net_set_ap(config_store_get()->ap_ssid, config_store_get()->ap_password));
+    boot_prof_end(BOOT_PHASE_NET_INIT);
+    net_up = xSemaphoreCreateBinaryStatic(&net_up_buf);
+    if (xTaskCreatePinnedToCore(net_start_task, "net_start", NET_START_TASK_STACK, NULL,
+                                uxTaskPriorityGet(NULL), NULL, tskNO_AFFINITY) != pdPASS) {
+        ESP_ERROR_CHECK(ESP_ERR_NO_MEM);
     }
-    ESP_ERROR_CHECK(ret);
 
-    /* Initialize network components: ESP-NETIF and event loop */
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    /* Map the asset partitions and pick the newest valid web asset image */
+    boot_prof_begin(BOOT_PHASE_ASSETS);
+    ESP_ERROR_CHECK(asset_store_init(web_assets_image, web_assets_image_size));
+    boot_prof_end(BOOT_PHASE_ASSETS);
 
-    /* Configure the LED strip and set the initial LED color to red (locked state) */
-    configure_led_strip();
-    ESP_LOGI(TAG, "🔴 Setting LED to red on startup (locked)");
-    set_led_color(255, 0, 0);
+    /* Map the credential partitions; without them only the pre-shared key is accepted */
+    boot_prof_begin(BOOT_PHASE_CREDS);
+    err = cred_store_init();
+    if (err != ESP_OK && err != ESP_ERR_NOT_FOUND) {
+        ESP_ERROR_CHECK(err);
+    }
+    boot_prof_end(BOOT_PHASE_CREDS);
 
-    /* Initialize the Wi-Fi Access Point for client connections */
-    wifi_init_softap();
+    /* Index the audit log; the lock works without it if the partition is missing */
+    boot_prof_begin(BOOT_PHASE_AUDIT);
+    err = audit_log_init();
+    if (err != ESP_OK && err != ESP_ERR_NOT_FOUND) {
+        ESP_ERROR_CHECK(err);
+    }
+    boot_prof_end(BOOT_PHASE_AUDIT);
 
-    /* Start the HTTP server to handle incoming requests */
+    /* Start the workers for the expensive handlers, then the HTTP server */
+    boot_prof_begin(BOOT_PHASE_HTTPD);
+    admin_lock = xSemaphoreCreateMutexStatic(&admin_lock_buf);
+#if HTTP_WORKERS_COUNT > 0
+    ESP_ERROR_CHECK(http_workers_start(HTTP_MAX_OPEN_SOCKETS));
+#endif
     httpd_handle_t server = start_webserver();
+    boot_prof_end(BOOT_PHASE_HTTPD);
+    xSemaphoreTake(net_up, portMAX_DELAY);
     if (server) {
-        ESP_LOGI(TAG, "🌐 HTTP Server running. Connect to 'LockAP' and visit http://192.168.4.1/");
+#if CONFIG_IDF_TARGET_LINUX
+        ESP_LOGI(TAG, "🌐 HTTP Server running. Visit http://localhost:%d/", CONFIG_LOCK_HTTP_PORT);
+#elif CONFIG_LOCK_NET_QEMU_OPENETH
+        ESP_LOGI(TAG, "🌐 HTTP Server running on port %d (forwarded by tools/qemu_run.sh)",
+                 CONFIG_LOCK_HTTP_PORT);
+#else
+        ESP_LOGI(TAG, "🌐 HTTP Server running. Connect to '%s' and visit http://192.168.4.1/",
+                 config_store_get()->ap_ssid);
+#endif
+#if !CONFIG_IDF_TARGET_LINUX
+        // Boot-to-ready time and heap headroom, the numbers compared across QEMU and board runs
+        // (internal RAM only; the PSRAM heap would swamp it)
+        ESP_LOGI(TAG, "⏱️ Ready %lld ms after boot, free heap %u bytes (minimum %u)",
+                 (long long)(boot_prof_ready_us() / 1000), (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+                 (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+#endif
     } else {
         ESP_LOGE(TAG, "❌ HTTP Server failed to start");
     }
+    boot_prof_log();
+
+    /* Compile the stored access policy before the first unlock needs it (policies still apply without NVS) */
+    access_policy_init();
+
+    /* Optional benchmarks, after the boot profile so that they do not inflate it */
+#if CONFIG_LOCK_AUTH_HMAC_BENCHMARK
+    auth_hmac_benchmark();
+#endif
+#if CONFIG_LOCK_METRICS_BENCHMARK
+    metrics_benchmark();
+#endif
+#if CONFIG_LOCK_NONCE_POOL_BENCHMARK
+    nonce_pool_benchmark();
+#endif
+#if CONFIG_LOCK_ACCESS_POLICY_BENCHMARK
+    access_policy_benchmark();
+#endif
+#if CONFIG_LOCK_STATE_BENCHMARK
+    state_store_benchmark();
+#endif
+#if CONFIG_LOCK_CONFIG_BENCHMARK
+    config_store_benchmark();
+#endif
 }
\ No newline at end of file
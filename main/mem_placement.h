@@ -0,0 +1,38 @@
+/*
+ * 🧠 Memory Placement - what may live in PSRAM 🗄️
+ *
+ * On the N16R8 module 8 MB of octal PSRAM sit behind the same cache as the
+ * flash. Buffers that are large and touched rarely (policy bitmaps, the
+ * audit page being filled, the upload buffer, the /tasks list) are placed
+ * there with LOCK_COLD_BSS or allocated with LOCK_COLD_CAPS, which leaves
+ * internal SRAM to what needs it:
+ *
+ *  - task stacks, since tasks that write flash run with the cache disabled;
+ *  - queues, mutexes and the log ring, which are on every request's path;
+ *  - the LED strip and its RMT channel, DMA buffers and anything an ISR reads;
+ *  - anything updated with __atomic builtins (counters, histograms, reader
+ *    pins, flags): on Xtensa they compile to S32C1I, which only works on
+ *    internal RAM, so they must never be marked cold;
+ *  - lwIP and HTTP server socket buffers, allocated by ESP-IDF with plain
+ *    malloc(), which SPIRAM_USE_CAPS_ALLOC keeps internal.
+ *
+ * Without CONFIG_LOCK_PSRAM_PLACEMENT (or without PSRAM) both fall back to
+ * internal memory, so a build with and one without can be compared with
+ * tools/psram_bench.sh.
+ */
+#pragma once
+
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+
+#if CONFIG_LOCK_PSRAM_PLACEMENT
+#include "esp_attr.h"
+
+/* Places a zero-initialized static buffer in PSRAM */
+#define LOCK_COLD_BSS EXT_RAM_BSS_ATTR
+/* heap_caps_malloc() capabilities of a cold buffer */
+#define LOCK_COLD_CAPS (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define LOCK_COLD_BSS
+#define LOCK_COLD_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#endif
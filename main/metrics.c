@@ -0,0 +1,305 @@
+/*
+ * 📊 Metrics - per-stage request latency histograms 📈
+ *
+ * Buckets are log-linear: every power of two is split into METRICS_SUB equal
+ * sub-buckets, so the relative error is below 1 / METRICS_SUB at any scale
+ * from 1 µs to 16 s while a histogram needs less than 400 bytes. The bucket
+ * index is computed from the position of the highest set bit, without loops
+ * or divisions.
+ *
+ * Each core records into its own copy of the histograms and only the exporter
+ * sums them up, so cores never contend for the same cache lines. Counters are
+ * updated with relaxed atomic adds, which keeps them exact when a task is
+ * preempted or migrates to the other core halfway through a lap.
+ */
+
+#include "metrics.h"
+
+#if CONFIG_LOCK_METRICS
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+/* 🏷️ Log tag for the metrics module */
+static const char *TAG = "metrics";
+
+/* Sub-buckets per power of two (2^METRICS_SUB_BITS) */
+#define METRICS_SUB_BITS   2
+#define METRICS_SUB        (1u << METRICS_SUB_BITS)
+
+/* Durations over 2^METRICS_MAX_LOG2 µs land in the overflow bucket */
+#define METRICS_MAX_LOG2   24
+#define METRICS_BUCKETS    (((METRICS_MAX_LOG2 - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS) + 1)
+
+/* Export buffer, flushed to the sink whenever the next line might not fit */
+#define METRICS_EXPORT_BUF 512
+
+/* Laps timed by metrics_benchmark() */
+#define METRICS_BENCH_ITERATIONS 10000
+
+#if portNUM_PROCESSORS > 1
+#define METRICS_CORES      portNUM_PROCESSORS
+#define metrics_core()     xPortGetCoreID()
+#else
+#define METRICS_CORES      1
+#define metrics_core()     0
+#endif
+
+/**
+ * @brief One core's copy of a histogram.
+ *
+ * The sum of all recorded durations is split in two words, because 64-bit
+ * atomics are not lock-free on Xtensa: whoever carries out of the low word
+ * increments the high word.
+ */
+typedef struct {
+    uint32_t buckets[METRICS_BUCKETS];  /*!< Sample count per bucket */
+    uint32_t sum_lo;                    /*!< Sum of durations in µs, low word */
+    uint32_t sum_hi;                    /*!< Sum of durations in µs, high word */
+} metrics_hist_t;
+
+/* Updated with atomics, so internal RAM only (see mem_placement.h) */
+static metrics_hist_t hists[METRICS_CORES][METRICS_SERIES_COUNT];
+
+/**
+ * @brief Prometheus labels of every series.
+ */
+static const struct {
+    const char *endpoint;
+    const char *stage;
+} series_labels[METRICS_SERIES_COUNT] = {
+    [METRICS_CHALLENGE_ISSUE] = { "challenge", "issue" },
+    [METRICS_CHALLENGE_SEND] = { "challenge", "send" },
+    [METRICS_CHALLENGE_TOTAL] = { "challenge", "total" },
+    [METRICS_RESPONSE_RECV] = { "response", "recv" },
+    [METRICS_RESPONSE_VERIFY] = { "response", "verify" },
+    [METRICS_RESPONSE_SEND] = { "response", "send" },
+    [METRICS_RESPONSE_TOTAL] = { "response", "total" },
+    [METRICS_UNLOCK_RECV] = { "unlock", "recv" },
+    [METRICS_UNLOCK_VERIFY] = { "unlock", "verify" },
+    [METRICS_UNLOCK_SEND] = { "unlock", "send" },
+    [METRICS_UNLOCK_TOTAL] = { "unlock", "total" },
+    [METRICS_WS_RECV] = { "ws", "recv" },
+    [METRICS_WS_VERIFY] = { "ws", "verify" },
+    [METRICS_WS_SEND] = { "ws", "send" },
+    [METRICS_WS_TOTAL] = { "ws", "total" },
+    [METRICS_ASSET_LOOKUP] = { "assets", "lookup" },
+    [METRICS_ASSET_SEND] = { "assets", "send" },
+    [METRICS_ASSET_TOTAL] = { "assets", "total" },
+    [METRICS_LED_REFRESH] = { "lock_ctrl", "led" },
+};
+
+/* Quantiles exported next to each histogram */
+static const struct {
+    const char *label;
+    uint32_t permille;
+} quantiles[] = { { "0.5", 500 }, { "0.9", 900 }, { "0.99", 990 } };
+
+/**
+ * @brief Maps a duration to its bucket.
+ *
+ * Buckets hold their upper edge, like a Prometheus `le` bound: mapping
+ * us - 1 makes exactly 2^k µs count below the 2^k edge, not above it.
+ */
+static inline unsigned metrics_bucket(uint32_t us) {
+    uint32_t v = us ? us - 1 : 0;
+    if (v < METRICS_SUB) {
+        return v;
+    }
+    if (v >> METRICS_MAX_LOG2) {
+        return METRICS_BUCKETS - 1;
+    }
+    unsigned log2 = 31 - __builtin_clz(v);
+    return ((log2 - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS) +
+           ((v >> (log2 - METRICS_SUB_BITS)) & (METRICS_SUB - 1));
+}
+
+/**
+ * @brief Returns the lower edge of a bucket, the longest duration of the bucket below it.
+ */
+static uint32_t metrics_bucket_edge(unsigned bucket) {
+    if (bucket < METRICS_SUB) {
+        return bucket;
+    }
+    unsigned group = bucket >> METRICS_SUB_BITS;
+    return (METRICS_SUB + (bucket & (METRICS_SUB - 1))) << (group - 1);
+}
+
+int64_t metrics_lap(metrics_series_t series, int64_t since_us) {
+    int64_t now = lock_hal_time_us();
+    int64_t elapsed = now - since_us;
+    uint32_t us = elapsed < 0 ? 0 : elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+
+    metrics_hist_t *h = &hists[metrics_core()][series];
+    __atomic_fetch_add(&h->buckets[metrics_bucket(us)], 1, __ATOMIC_RELAXED);
+    uint32_t old = __atomic_fetch_add(&h->sum_lo, us, __ATOMIC_RELAXED);
+    if ((uint32_t)(old + us) < old) {
+        __atomic_fetch_add(&h->sum_hi, 1, __ATOMIC_RELAXED);
+    }
+    return now;
+}
+
+/**
+ * @brief Exporter state: a line buffer in front of the sink.
+ */
+typedef struct {
+    metrics_write_fn_t write;
+    void *ctx;
+    esp_err_t err;
+    size_t len;
+    char buf[METRICS_EXPORT_BUF];
+    uint32_t counts[METRICS_BUCKETS];   /*!< Merged histogram being exported */
+} metrics_out_t;
+
+static void metrics_flush(metrics_out_t *out) {
+    if (out->err == ESP_OK && out->len) {
+        out->err = out->write(out->ctx, out->buf, out->len);
+    }
+    out->len = 0;
+}
+
+/**
+ * @brief Appends one formatted line, which must be shorter than METRICS_EXPORT_BUF / 2.
+ */
+static void metrics_printf(metrics_out_t *out, const char *fmt, ...) {
+    if (out->len > METRICS_EXPORT_BUF / 2) {
+        metrics_flush(out);
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(out->buf + out->len, METRICS_EXPORT_BUF - out->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        out->len += n;
+    }
+}
+
+/**
+ * @brief Formats a duration in µs as seconds without floating point.
+ */
+static const char *metrics_seconds(char buf[24], uint64_t us) {
+    snprintf(buf, 24, "%llu.%06llu", (unsigned long long)(us / 1000000), (unsigned long long)(us % 1000000));
+    return buf;
+}
+
+/**
+ * @brief Sums up the per-core copies of a histogram.
+ *
+ * @param series Histogram to merge.
+ * @param counts Receives the merged bucket counts.
+ * @param sum_us Receives the sum of all recorded durations.
+ *
+ * @return Number of recorded samples.
+ */
+static uint32_t metrics_merge(int series, uint32_t counts[METRICS_BUCKETS], uint64_t *sum_us) {
+    uint32_t total = 0;
+    *sum_us = 0;
+    memset(counts, 0, METRICS_BUCKETS * sizeof(counts[0]));
+    for (int c = 0; c < METRICS_CORES; c++) {
+        const metrics_hist_t *h = &hists[c][series];
+        uint32_t hi, lo;
+        // Re-read if a carry into the high word raced with us
+        do {
+            hi = __atomic_load_n(&h->sum_hi, __ATOMIC_RELAXED);
+            lo = __atomic_load_n(&h->sum_lo, __ATOMIC_RELAXED);
+        } while (hi != __atomic_load_n(&h->sum_hi, __ATOMIC_RELAXED));
+        *sum_us += ((uint64_t)hi << 32) | lo;
+        for (int b = 0; b < METRICS_BUCKETS; b++) {
+            uint32_t n = __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+            counts[b] += n;
+            total += n;
+        }
+    }
+    return total;
+}
+
+esp_err_t metrics_export(metrics_write_fn_t write, void *ctx) {
+    static metrics_out_t out; // too large for the httpd task stack
+    uint32_t *counts = out.counts;
+    uint64_t sum;
+    char secs[24];
+
+    out.write = write;
+    out.ctx = ctx;
+    out.err = ESP_OK;
+    out.len = 0;
+
+    metrics_printf(&out, "# HELP lock_request_stage_seconds Time spent in each request handling stage.\n"
+                         "# TYPE lock_request_stage_seconds histogram\n");
+    for (int s = 0; s < METRICS_SERIES_COUNT && out.err == ESP_OK; s++) {
+        uint32_t total = metrics_merge(s, counts, &sum);
+        if (total == 0) {
+            continue;
+        }
+        const char *ep = series_labels[s].endpoint;
+        const char *stage = series_labels[s].stage;
+
+        // Cumulative buckets at every power of two, where bucket edges line up exactly
+        uint32_t cumulative = 0;
+        int b = 0;
+        for (int log2 = 0; log2 <= METRICS_MAX_LOG2; log2++) {
+            for (int end = metrics_bucket((1u << log2) + 1); b < end; b++) {
+                cumulative += counts[b];
+            }
+            metrics_printf(&out, "lock_request_stage_seconds_bucket{endpoint=\"%s\",stage=\"%s\",le=\"%s\"} %lu\n",
+                           ep, stage, metrics_seconds(secs, 1ull << log2), (unsigned long)cumulative);
+        }
+        metrics_printf(&out, "lock_request_stage_seconds_bucket{endpoint=\"%s\",stage=\"%s\",le=\"+Inf\"} %lu\n",
+                       ep, stage, (unsigned long)total);
+        metrics_printf(&out, "lock_request_stage_seconds_sum{endpoint=\"%s\",stage=\"%s\"} %s\n",
+                       ep, stage, metrics_seconds(secs, sum));
+        metrics_printf(&out, "lock_request_stage_seconds_count{endpoint=\"%s\",stage=\"%s\"} %lu\n",
+                       ep, stage, (unsigned long)total);
+    }
+
+    // Quantiles from the fine buckets, reported as the upper edge of their bucket
+    metrics_printf(&out, "# HELP lock_request_stage_quantile_seconds Stage duration quantiles since boot.\n"
+                         "# TYPE lock_request_stage_quantile_seconds gauge\n");
+    for (int s = 0; s < METRICS_SERIES_COUNT && out.err == ESP_OK; s++) {
+        uint32_t total = metrics_merge(s, counts, &sum);
+        if (total == 0) {
+            continue;
+        }
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+            uint64_t rank = ((uint64_t)total * quantiles[q].permille + 999) / 1000;
+            uint32_t seen = 0;
+            int b;
+            for (b = 0; b < METRICS_BUCKETS - 1; b++) {
+                seen += counts[b];
+                if (seen >= rank) {
+                    break;
+                }
+            }
+            uint32_t edge = metrics_bucket_edge(b < METRICS_BUCKETS - 1 ? b + 1 : b);
+            metrics_printf(&out, "lock_request_stage_quantile_seconds{endpoint=\"%s\",stage=\"%s\",quantile=\"%s\"} %s\n",
+                           series_labels[s].endpoint, series_labels[s].stage, quantiles[q].label,
+                           metrics_seconds(secs, edge));
+        }
+    }
+    metrics_flush(&out);
+    return out.err;
+}
+
+void metrics_benchmark(void) {
+    // Time the laps against the LED series and clear it afterwards
+    int64_t start = lock_hal_time_us();
+    int64_t t = start;
+    for (int i = 0; i < METRICS_BENCH_ITERATIONS; i++) {
+        t = metrics_lap(METRICS_LED_REFRESH, t);
+    }
+    int64_t elapsed = lock_hal_time_us() - start;
+    for (int c = 0; c < METRICS_CORES; c++) {
+        memset(&hists[c][METRICS_LED_REFRESH], 0, sizeof(metrics_hist_t));
+    }
+
+    // A fully instrumented request records four laps
+    ESP_LOGI(TAG, "⏱️ %lld ns per lap, %lld ns per instrumented request",
+             (long long)elapsed * 1000 / METRICS_BENCH_ITERATIONS,
+             (long long)elapsed * 4000 / METRICS_BENCH_ITERATIONS);
+}
+
+#endif /* CONFIG_LOCK_METRICS */
@@ -0,0 +1,112 @@
+/*
+ * 📊 Metrics - per-stage request latency histograms 📈
+ *
+ * Every instrumented stage (receive, verification, response send, ...) owns a
+ * log-linear histogram of its duration in microseconds, kept in fixed memory
+ * with one copy per CPU core. Recording is a clock read plus two relaxed
+ * atomic adds on the caller's core, with no locks and no allocation, so it
+ * can stay enabled in production. The histograms are exported in the
+ * Prometheus text format by metrics_export().
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "lock_hal.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Instrumented stages, one histogram each.
+ */
+typedef enum {
+    METRICS_CHALLENGE_ISSUE,   /*!< GET /challenge: random nonce drawn and stored */
+    METRICS_CHALLENGE_SEND,    /*!< GET /challenge: response sent */
+    METRICS_CHALLENGE_TOTAL,   /*!< GET /challenge: whole handler */
+    METRICS_RESPONSE_RECV,     /*!< POST /response: query and body received */
+    METRICS_RESPONSE_VERIFY,   /*!< POST /response: challenge consumed and HMAC verified */
+    METRICS_RESPONSE_SEND,     /*!< POST /response: response sent */
+    METRICS_RESPONSE_TOTAL,    /*!< POST /response: whole handler */
+    METRICS_UNLOCK_RECV,       /*!< POST /unlock: body received and parsed */
+    METRICS_UNLOCK_VERIFY,     /*!< POST /unlock: HMAC and replay window checked */
+    METRICS_UNLOCK_SEND,       /*!< POST /unlock: response sent */
+    METRICS_UNLOCK_TOTAL,      /*!< POST /unlock: whole handler */
+    METRICS_WS_RECV,           /*!< WebSocket: frame received */
+    METRICS_WS_VERIFY,         /*!< WebSocket: command executed */
+    METRICS_WS_SEND,           /*!< WebSocket: reply sent */
+    METRICS_WS_TOTAL,          /*!< WebSocket: whole frame */
+    METRICS_ASSET_LOOKUP,      /*!< GET asset: path resolved in the asset bundle */
+    METRICS_ASSET_SEND,        /*!< GET asset: headers and payload sent */
+    METRICS_ASSET_TOTAL,       /*!< GET asset: whole handler */
+    METRICS_LED_REFRESH,       /*!< Lock controller: LED color written */
+    METRICS_SERIES_COUNT
+} metrics_series_t;
+
+/**
+ * @brief Sink for exported text, e.g. a wrapper around httpd_resp_send_chunk().
+ *
+ * @return ESP_OK to continue, anything else aborts the export.
+ */
+typedef esp_err_t (*metrics_write_fn_t)(void *ctx, const char *data, size_t len);
+
+#if CONFIG_LOCK_METRICS
+/**
+ * @brief Returns the timestamp stages are measured against.
+ */
+static inline int64_t metrics_now(void) {
+    return lock_hal_time_us();
+}
+
+/**
+ * @brief Records the time elapsed since a timestamp and returns the current time.
+ *
+ * Consecutive stages chain naturally:
+ *
+ *     int64_t t0 = metrics_now();
+ *     int64_t t = metrics_lap(METRICS_RESPONSE_RECV, t0);
+ *     ...
+ *     t = metrics_lap(METRICS_RESPONSE_VERIFY, t);
+ *
+ * Safe to call from any task on any core.
+ *
+ * @param series Histogram to record into.
+ * @param since_us Start of the stage, from metrics_now() or a previous lap.
+ *
+ * @return The current time, i.e. the start of the next stage.
+ */
+int64_t metrics_lap(metrics_series_t series, int64_t since_us);
+
+/**
+ * @brief Writes all non-empty histograms in the Prometheus text exposition format.
+ *
+ * Output is produced in pieces of a few hundred bytes. Uses a static buffer,
+ * so it must only be called from one task (the HTTP server task).
+ *
+ * @param write Sink receiving the text.
+ * @param ctx User argument passed to the sink.
+ *
+ * @return ESP_OK, or the first error returned by the sink.
+ */
+esp_err_t metrics_export(metrics_write_fn_t write, void *ctx);
+
+/**
+ * @brief Measures and logs the cost of metrics_lap() on this target.
+ */
+void metrics_benchmark(void);
+#else
+static inline int64_t metrics_now(void) {
+    return 0;
+}
+
+static inline int64_t metrics_lap(metrics_series_t series, int64_t since_us) {
+    return 0;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,211 @@
+/*
+ * 🎟️ Nonce Pool - pre-generated challenge nonces 🎲
+ *
+ * The ring is the mirror image of the log offload ring (see log_offload.c):
+ * a bounded queue in the style of Dmitry Vyukov's, here with a single
+ * producer, the refill task, and any number of consumers. Consumers claim a
+ * position with one compare-and-swap, copy the nonce out and hand the slot
+ * back through its sequence number. The refill task sleeps while the ring is
+ * full and is woken when it drops to half full, with a periodic wake-up as a
+ * backstop.
+ */
+
+#include "nonce_pool.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "lock_hal.h"
+#include "task_topology.h"
+
+/* 🏷️ Log tag for the nonce pool */
+static const char *TAG = "nonce_pool";
+
+/* Ring geometry: slot count must be a power of two */
+#define NONCE_POOL_SLOTS      CONFIG_LOCK_NONCE_POOL_SLOTS
+#define NONCE_POOL_RAW_LEN    16
+
+/* Longest the refill task sleeps without being woken */
+#define NONCE_POOL_IDLE_MS    100
+
+/* Refill task stack */
+#define NONCE_POOL_TASK_STACK 2048
+
+_Static_assert((NONCE_POOL_SLOTS & (NONCE_POOL_SLOTS - 1)) == 0, "nonce ring slot count must be a power of two");
+_Static_assert(NONCE_POOL_NONCE_LEN == (NONCE_POOL_RAW_LEN * 8 + 5) / 6,
+               "nonce length is unpadded base64 of the raw bits");
+
+/**
+ * @brief One ring slot.
+ *
+ * seq == position: free for the refill task to fill at that position.
+ * seq == position + 1: holds the nonce of that position.
+ */
+typedef struct {
+    uint32_t seq;
+    char nonce[NONCE_POOL_NONCE_LEN + 2];   /*!< NUL-terminated, padded to a word */
+} nonce_slot_t;
+
+static nonce_slot_t slots[NONCE_POOL_SLOTS];
+static uint32_t head;                   /*!< Next position to fill, written by the refill task only */
+static uint32_t tail;                   /*!< Next position to take, shared by consumers */
+static uint32_t exhausted;              /*!< Nonces generated synchronously */
+static TaskHandle_t refill_task;
+TASK_TOPOLOGY_MEM_DEFINE(refill_mem, NONCE_POOL_TASK_STACK);
+
+static const char base64url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+/**
+ * @brief Draws 128 random bits and encodes them as unpadded base64url.
+ */
+static void nonce_generate(char nonce[NONCE_POOL_NONCE_LEN + 1]) {
+    uint8_t raw[NONCE_POOL_RAW_LEN + 2] = { 0 };
+    char *out = nonce;
+
+    lock_hal_fill_random(raw, NONCE_POOL_RAW_LEN);
+    // Whole 3-byte groups, then the last byte (zero-extended) as two characters
+    for (int i = 0; i < NONCE_POOL_RAW_LEN; i += 3) {
+        uint32_t v = (uint32_t)raw[i] << 16 | (uint32_t)raw[i + 1] << 8 | raw[i + 2];
+        *out++ = base64url[(v >> 18) & 0x3f];
+        *out++ = base64url[(v >> 12) & 0x3f];
+        if (i + 1 < NONCE_POOL_RAW_LEN) {
+            *out++ = base64url[(v >> 6) & 0x3f];
+        }
+        if (i + 2 < NONCE_POOL_RAW_LEN) {
+            *out++ = base64url[v & 0x3f];
+        }
+    }
+    *out = '\0';
+}
+
+/**
+ * @brief Takes the nonce at the oldest filled position.
+ *
+ * @return false if the ring is empty.
+ */
+static bool nonce_pool_pop(char nonce[NONCE_POOL_NONCE_LEN + 1]) {
+    uint32_t pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+    for (;;) {
+        nonce_slot_t *slot = &slots[pos & (NONCE_POOL_SLOTS - 1)];
+        int32_t diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+        if (diff == 0) {
+            // Filled for this position: try to take it (pos is refreshed on failure)
+            if (__atomic_compare_exchange_n(&tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                memcpy(nonce, slot->nonce, NONCE_POOL_NONCE_LEN + 1);
+                __atomic_store_n(&slot->seq, pos + NONCE_POOL_SLOTS, __ATOMIC_RELEASE);
+                // Wake the refill task when this take leaves the ring half full
+                if (__atomic_load_n(&head, __ATOMIC_RELAXED) - (pos + 1) == NONCE_POOL_SLOTS / 2) {
+                    xTaskNotifyGive(refill_task);
+                }
+                return true;
+            }
+        } else if (diff < 0) {
+            // Not filled yet: the ring is empty
+            return false;
+        } else {
+            // Another consumer took this position first
+            pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void nonce_pool_take(char nonce[NONCE_POOL_NONCE_LEN + 1]) {
+    if (refill_task && nonce_pool_pop(nonce)) {
+        return;
+    }
+    __atomic_fetch_add(&exhausted, 1, __ATOMIC_RELAXED);
+    if (refill_task) {
+        xTaskNotifyGive(refill_task);
+    }
+    nonce_generate(nonce);
+}
+
+uint32_t nonce_pool_exhausted(void) {
+    return __atomic_load_n(&exhausted, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Refill task body: keeps every free slot filled, in ring order.
+ *
+ * @param arg Unused.
+ */
+static void nonce_pool_task(void *arg) {
+    uint32_t reported = 0;
+
+    for (;;) {
+        nonce_slot_t *slot = &slots[head & (NONCE_POOL_SLOTS - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != head) {
+            // Full, or a consumer is still copying out of this slot
+            uint32_t lost = nonce_pool_exhausted();
+            if (lost != reported) {
+                ESP_LOGW(TAG, "⚠️ Pool ran dry, %lu nonces generated synchronously", (unsigned long)(lost - reported));
+                reported = lost;
+            }
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NONCE_POOL_IDLE_MS));
+            continue;
+        }
+
+        nonce_generate(slot->nonce);
+        __atomic_store_n(&slot->seq, head + 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&head, head + 1, __ATOMIC_RELAXED);
+    }
+}
+
+esp_err_t nonce_pool_start(void) {
+    if (refill_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Start full, so the first burst after boot is served from the ring
+    for (uint32_t i = 0; i < NONCE_POOL_SLOTS; i++) {
+        nonce_generate(slots[i].nonce);
+        slots[i].seq = i + 1;
+    }
+    head = NONCE_POOL_SLOTS;
+    tail = 0;
+
+    if (task_topology_create(TASK_ROLE_NONCE_POOL, nonce_pool_task, "nonce_pool", NONCE_POOL_TASK_STACK,
+                             NULL, TASK_TOPOLOGY_MEM(refill_mem), &refill_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "🎟️ Nonce pool ready (%d x %d-bit nonces)", NONCE_POOL_SLOTS, NONCE_POOL_RAW_LEN * 8);
+    return ESP_OK;
+}
+
+#if CONFIG_LOCK_NONCE_POOL_BENCHMARK
+
+void nonce_pool_benchmark(void) {
+    char nonce[NONCE_POOL_NONCE_LEN + 1];
+
+    // Let the refill task top the ring up after whatever was taken before
+    vTaskDelay(pdMS_TO_TICKS(NONCE_POOL_IDLE_MS));
+
+    // A burst twice the ring size: the first half is served from the ring
+    uint32_t fallbacks = nonce_pool_exhausted();
+    int64_t start = lock_hal_time_us();
+    for (int i = 0; i < NONCE_POOL_SLOTS; i++) {
+        nonce_pool_take(nonce);
+    }
+    int64_t pooled_us = lock_hal_time_us() - start;
+    start = lock_hal_time_us();
+    for (int i = 0; i < NONCE_POOL_SLOTS; i++) {
+        nonce_pool_take(nonce);
+    }
+    int64_t drained_us = lock_hal_time_us() - start;
+    fallbacks = nonce_pool_exhausted() - fallbacks;
+
+    start = lock_hal_time_us();
+    for (int i = 0; i < NONCE_POOL_SLOTS; i++) {
+        nonce_generate(nonce);
+    }
+    int64_t sync_us = lock_hal_time_us() - start;
+
+    ESP_LOGI(TAG, "⏱️ Burst of %d: %lld ns per take from the full ring, %lld ns past it (%lu synchronous), "
+             "%lld ns to generate", 2 * NONCE_POOL_SLOTS, (long long)pooled_us * 1000 / NONCE_POOL_SLOTS,
+             (long long)drained_us * 1000 / NONCE_POOL_SLOTS, (unsigned long)fallbacks,
+             (long long)sync_us * 1000 / NONCE_POOL_SLOTS);
+}
+
+#endif /* CONFIG_LOCK_NONCE_POOL_BENCHMARK */
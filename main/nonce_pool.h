@@ -0,0 +1,63 @@
+/*
+ * 🎟️ Nonce Pool - pre-generated challenge nonces 🎲
+ *
+ * Challenges are 128 random bits, encoded as 22 characters of unpadded
+ * base64url so they can go into URLs and WebSocket frames as they are. A
+ * low-priority task draws them ahead of time from the hardware RNG into a
+ * lock-free ring, so issuing a challenge is one pop and one copy. If a burst
+ * empties the ring, the nonce is generated on the spot instead and the event
+ * is counted.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Length of a nonce in characters, without the terminator */
+#define NONCE_POOL_NONCE_LEN 22
+
+/**
+ * @brief Fills the ring and starts the refill task.
+ *
+ * The ring is filled on the calling task, so call it between
+ * lock_hal_entropy_enable() and lock_hal_entropy_disable() when the network
+ * is not up yet; refills happen once clients are served, with the radio on.
+ *
+ * @return
+ *      - ESP_OK: pool running
+ *      - ESP_ERR_INVALID_STATE: already started
+ *      - ESP_ERR_NO_MEM: the refill task could not be created
+ */
+esp_err_t nonce_pool_start(void);
+
+/**
+ * @brief Takes a fresh nonce.
+ *
+ * Safe to call from any task. Never blocks: when the ring is empty (or the
+ * pool has not been started) the nonce is generated synchronously.
+ *
+ * @param nonce Receives the NUL-terminated nonce.
+ */
+void nonce_pool_take(char nonce[NONCE_POOL_NONCE_LEN + 1]);
+
+/**
+ * @brief Returns how many nonces had to be generated synchronously because the ring was empty.
+ */
+uint32_t nonce_pool_exhausted(void);
+
+#if CONFIG_LOCK_NONCE_POOL_BENCHMARK
+/**
+ * @brief Logs the cost of taking nonces in a burst from the full ring and
+ * past its end, against generating every nonce synchronously.
+ */
+void nonce_pool_benchmark(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
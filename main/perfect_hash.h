@@ -0,0 +1,58 @@
+/*
+ * #️⃣ Perfect Hash - lookup side of the generated hash-and-displace tables 🧮
+ *
+ * Asset images (gen_assets.py) and credential tables (tools/gen_creds.py) are
+ * laid out on the host by the same minimal perfect hash, build_perfect_hash()
+ * in gen_assets.py: every key's FNV-1a hash picks a displacement bucket, and
+ * one mix of the hash with that bucket's displacement gives the entry slot.
+ * A lookup therefore reads exactly one bucket and one entry, whatever the
+ * table size. The functions here must stay in sync with fnv1a() and
+ * perfect_slot() there.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Hashes a key with FNV-1a, starting from the table's seed.
+ */
+static inline uint32_t perfect_hash_key(const char *key, size_t len, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Returns the entry slot of a key hash.
+ *
+ * Every hash maps to some slot; the caller confirms the entry there is really
+ * its key.
+ *
+ * @param h Hash from perfect_hash_key()
+ * @param buckets Displacement table
+ * @param bucket_mask Number of buckets minus one (the count is a power of two)
+ * @param count Number of entries, at least one
+ */
+static inline uint32_t perfect_hash_slot(uint32_t h, const uint16_t *buckets, uint32_t bucket_mask,
+                                         uint32_t count) {
+    // Murmur3 finalizer of the hash displaced by the bucket's value
+    uint32_t x = h ^ (buckets[h & bucket_mask] * 0x9e3779b1u);
+    x ^= x >> 16;
+    x *= 0x85ebca6bu;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35u;
+    x ^= x >> 16;
+    return x % count;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,102 @@
+/*
+ * 🚦 Rate Limiter - per-client token buckets for authentication endpoints 🪣
+ *
+ * Buckets are kept in their "virtual scheduling" form (GCRA): instead of a
+ * token count and a refill timestamp, every client stores the time at which
+ * its bucket would be full again. This is exactly a token bucket, but needs
+ * a single comparison and no division per request.
+ */
+
+#include "rate_limit.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "lock_hal.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+/* 🏷️ Log tag for the rate limiter */
+static const char *TAG = "rate_limit";
+
+/* Number of clients tracked at the same time */
+#define RATE_LIMIT_SLOTS       16
+
+/* Minimum time between two log lines about the same client */
+#define RATE_LIMIT_LOG_INTERVAL_US (10 * 1000 * 1000)
+
+/* Time for one token to refill, and how far ahead of it a client may run */
+#define RATE_LIMIT_INTERVAL_US (1000000LL / CONFIG_LOCK_AUTH_RATE_LIMIT_PER_SEC)
+#define RATE_LIMIT_BURST_US    ((CONFIG_LOCK_AUTH_RATE_LIMIT_BURST - 1) * RATE_LIMIT_INTERVAL_US)
+
+/**
+ * @brief One client's bucket.
+ */
+typedef struct {
+    uint8_t addr[RATE_LIMIT_ADDR_LEN];  /*!< Client address */
+    int64_t full_at_us;                 /*!< When the bucket is full again (theoretical arrival time) */
+    int64_t last_seen_us;               /*!< Last attempt, 0 if the slot is unused */
+    int64_t logged_us;                  /*!< Last time rejections of this client were logged */
+    uint32_t dropped;                   /*!< Attempts rejected and not logged yet */
+} rate_limit_entry_t;
+
+static rate_limit_entry_t entries[RATE_LIMIT_SLOTS];
+
+/* Guards the table: attempts are checked on the server task and the HTTP workers */
+static portMUX_TYPE table_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Finds a client's bucket, recycling the least recently used one if needed.
+ */
+static rate_limit_entry_t *rate_limit_lookup(const uint8_t addr[RATE_LIMIT_ADDR_LEN]) {
+    rate_limit_entry_t *lru = &entries[0];
+    for (int i = 0; i < RATE_LIMIT_SLOTS; i++) {
+        rate_limit_entry_t *e = &entries[i];
+        if (e->last_seen_us && memcmp(e->addr, addr, RATE_LIMIT_ADDR_LEN) == 0) {
+            return e;
+        }
+        if (e->last_seen_us < lru->last_seen_us) {
+            lru = e;
+        }
+    }
+
+    // A new client starts with a full bucket
+    memcpy(lru->addr, addr, RATE_LIMIT_ADDR_LEN);
+    lru->full_at_us = 0;
+    lru->logged_us = INT64_MIN / 2;
+    lru->dropped = 0;
+    return lru;
+}
+
+bool rate_limit_allow(const uint8_t addr[RATE_LIMIT_ADDR_LEN], uint32_t *retry_after_s) {
+    int64_t now = lock_hal_time_us();
+    uint32_t report = 0;
+    bool allowed = true;
+
+    portENTER_CRITICAL(&table_lock);
+    rate_limit_entry_t *e = rate_limit_lookup(addr);
+    e->last_seen_us = now;
+
+    int64_t earliest = e->full_at_us - RATE_LIMIT_BURST_US;
+    if (now < earliest) {
+        // Summarize floods instead of logging every rejected attempt
+        e->dropped++;
+        if (now - e->logged_us >= RATE_LIMIT_LOG_INTERVAL_US) {
+            report = e->dropped;
+            e->logged_us = now;
+            e->dropped = 0;
+        }
+        if (retry_after_s) {
+            *retry_after_s = (uint32_t)((earliest - now + 999999) / 1000000);
+        }
+        allowed = false;
+    } else {
+        e->full_at_us = (e->full_at_us > now ? e->full_at_us : now) + RATE_LIMIT_INTERVAL_US;
+    }
+    portEXIT_CRITICAL(&table_lock);
+
+    // Log outside the critical section
+    if (report) {
+        ESP_LOGW(TAG, "🚫 Client over its limit, %u attempts rejected", (unsigned)report);
+    }
+    return allowed;
+}
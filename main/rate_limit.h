@@ -0,0 +1,38 @@
+/*
+ * 🚦 Rate Limiter - per-client token buckets for authentication endpoints 🪣
+ *
+ * A fixed-size table of token buckets keyed by the client's IP address. Each
+ * authentication attempt takes one token; tokens refill at a steady rate up
+ * to a burst size. When the table is full the least recently used client is
+ * evicted, so a flood from many addresses cannot grow memory use. Lookups are
+ * a short linear scan and never allocate, so rejecting a client costs far
+ * less than verifying its token.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size of the client addresses used as keys (IPv6, or IPv4-mapped IPv6) */
+#define RATE_LIMIT_ADDR_LEN 16
+
+/**
+ * @brief Takes one token from a client's bucket.
+ *
+ * Safe to call from the HTTP server task and the HTTP workers.
+ *
+ * @param addr Client address.
+ * @param retry_after_s Receives the number of seconds until the next token is
+ *                      available when the attempt is rejected. May be NULL.
+ *
+ * @return true if the attempt may proceed, false if the client is over its limit.
+ */
+bool rate_limit_allow(const uint8_t addr[RATE_LIMIT_ADDR_LEN], uint32_t *retry_after_s);
+
+#ifdef __cplusplus
+}
+#endif
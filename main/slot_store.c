@@ -0,0 +1,262 @@
+/*
+ * 🔁 Slot Store - A/B flash partitions holding one committed image each 🗃️
+ *
+ * Slot header layout, all integers little endian; gen_assets.py --slot-output
+ * writes the same header for the asset image flashed with the app:
+ *
+ *   magic       u32        the store's magic once committed, erased before
+ *   version     u32        SLOT_VERSION
+ *   generation  u32        increases with every committed upload
+ *   image_size  u32        size of the image following the header
+ *   sha256      32 bytes   SHA-256 of the image
+ *   reserved    16 bytes   left erased
+ */
+
+#include "slot_store.h"
+
+#include <string.h>
+#include "esp_log.h"
+
+#define SLOT_VERSION     1
+#define SLOT_SECTOR_SIZE 4096
+
+/**
+ * @brief Slot header at the start of each partition.
+ */
+typedef struct {
+    uint32_t magic;          /*!< The store's magic once committed, erased (0xFFFFFFFF) before */
+    uint32_t version;        /*!< SLOT_VERSION */
+    uint32_t generation;     /*!< Increases with every committed upload */
+    uint32_t image_size;     /*!< Size of the image following the header */
+    uint8_t sha256[32];      /*!< SHA-256 of the image */
+    uint8_t reserved[16];    /*!< Left erased */
+} slot_header_t;
+
+_Static_assert(sizeof(slot_header_t) == SLOT_STORE_HEADER_SIZE, "slot header layout");
+
+/**
+ * @brief Checks a slot's header and hash, and has the owner open its image.
+ */
+static void slot_load(slot_store_t *store, int index) {
+    slot_store_slot_t *slot = &store->slots[index];
+    slot_header_t hdr;
+    uint8_t digest[32];
+
+    slot->generation = 0;
+    memcpy(&hdr, slot->map, sizeof(hdr));
+    if (hdr.magic != store->magic || hdr.version != SLOT_VERSION || hdr.generation == 0 ||
+        hdr.image_size > slot->part->size - SLOT_STORE_HEADER_SIZE) {
+        return;
+    }
+
+    const uint8_t *image = slot->map + SLOT_STORE_HEADER_SIZE;
+    if (mbedtls_sha256(image, hdr.image_size, digest, 0) != 0 ||
+        memcmp(digest, hdr.sha256, sizeof(digest)) != 0) {
+        ESP_LOGW(store->tag, "⚠️ Slot %s: %s hash mismatch, ignoring", slot->label, store->what);
+        return;
+    }
+    if (store->open(index, image, hdr.image_size) != ESP_OK) {
+        ESP_LOGW(store->tag, "⚠️ Slot %s: malformed %s, ignoring", slot->label, store->what);
+        return;
+    }
+    slot->generation = hdr.generation;
+}
+
+/**
+ * @brief Makes the valid slot with the highest generation the active one.
+ */
+static void slot_select(slot_store_t *store) {
+    int best = -1;
+    for (int i = 0; i < 2; i++) {
+        if (store->slots[i].generation && (best < 0 || store->slots[i].generation > store->slots[best].generation)) {
+            best = i;
+        }
+    }
+    __atomic_store_n(&store->active, best, __ATOMIC_SEQ_CST);
+}
+
+esp_err_t slot_store_init(slot_store_t *store) {
+    bool found = false;
+
+    for (int i = 0; i < 2; i++) {
+        slot_store_slot_t *slot = &store->slots[i];
+        slot->generation = 0;
+        slot->part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, store->subtype, slot->label);
+        if (!slot->part) {
+            ESP_LOGW(store->tag, "⚠️ Partition %s not found", slot->label);
+            continue;
+        }
+        if (!slot->map) {
+            const void *map = NULL;
+            esp_err_t err = esp_partition_mmap(slot->part, 0, slot->part->size, ESP_PARTITION_MMAP_DATA,
+                                               &map, &slot->map_handle);
+            if (err != ESP_OK) {
+                ESP_LOGW(store->tag, "⚠️ Cannot map %s: %s", slot->label, esp_err_to_name(err));
+                slot->part = NULL;
+                continue;
+            }
+            slot->map = map;
+        }
+        slot_load(store, i);
+        found = true;
+    }
+
+    slot_select(store);
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+int slot_store_active(const slot_store_t *store) {
+    return __atomic_load_n(&store->active, __ATOMIC_SEQ_CST);
+}
+
+int slot_store_pin(slot_store_t *store) {
+    // Pin the active slot; retry if a commit made the other one active meanwhile
+    for (;;) {
+        int slot = __atomic_load_n(&store->active, __ATOMIC_SEQ_CST);
+        if (slot < 0) {
+            return -1;
+        }
+        __atomic_fetch_add(&store->readers[slot], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&store->active, __ATOMIC_SEQ_CST) == slot) {
+            return slot;
+        }
+        __atomic_fetch_sub(&store->readers[slot], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void slot_store_unpin(slot_store_t *store, int slot) {
+    if (slot >= 0) {
+        __atomic_fetch_sub(&store->readers[slot], 1, __ATOMIC_RELEASE);
+    }
+}
+
+esp_err_t slot_store_upload_begin(slot_store_t *store, size_t image_size, const uint8_t sha256[32]) {
+    if (store->upload.in_progress) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Write into the slot that is not active
+    slot_store_slot_t *target = NULL;
+    uint32_t newest = 0;
+    for (int i = 0; i < 2; i++) {
+        slot_store_slot_t *slot = &store->slots[i];
+        if (slot->generation > newest) {
+            newest = slot->generation;
+        }
+        if (slot->part && i != store->active && (!target || slot->generation < target->generation)) {
+            target = slot;
+        }
+    }
+    if (!target) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    // A send that started before the last commit may still stream from this slot
+    if (__atomic_load_n(&store->readers[target - store->slots], __ATOMIC_SEQ_CST) != 0) {
+        ESP_LOGW(store->tag, "⚠️ Slot %s is still being read, refusing the upload", target->label);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (image_size == 0 || image_size > target->part->size - SLOT_STORE_HEADER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(&store->upload, 0, sizeof(store->upload));
+    store->upload.in_progress = true;
+    store->upload.slot = target;
+    store->upload.image_size = image_size;
+    store->upload.generation = newest + 1;
+    memcpy(store->upload.expected, sha256, sizeof(store->upload.expected));
+    mbedtls_sha256_init(&store->upload.sha);
+    mbedtls_sha256_starts(&store->upload.sha, 0);
+
+    // The first erase wipes the old header, so the slot is invalid from here on
+    target->generation = 0;
+    ESP_LOGI(store->tag, "⬆️ Receiving %u-byte %s into %s", (unsigned)image_size, store->what, target->label);
+    return ESP_OK;
+}
+
+esp_err_t slot_store_upload_write(slot_store_t *store, const void *data, size_t len) {
+    if (!store->upload.in_progress) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > store->upload.image_size - store->upload.written) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const esp_partition_t *part = store->upload.slot->part;
+    size_t offset = SLOT_STORE_HEADER_SIZE + store->upload.written;
+
+    // Erase only the sectors this write reaches
+    size_t needed = (offset + len + SLOT_SECTOR_SIZE - 1) & ~(size_t)(SLOT_SECTOR_SIZE - 1);
+    if (needed > store->upload.erased) {
+        esp_err_t err = esp_partition_erase_range(part, store->upload.erased, needed - store->upload.erased);
+        if (err != ESP_OK) {
+            return err;
+        }
+        store->upload.erased = needed;
+    }
+
+    esp_err_t err = esp_partition_write(part, offset, data, len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    mbedtls_sha256_update(&store->upload.sha, data, len);
+    store->upload.written += len;
+    return ESP_OK;
+}
+
+esp_err_t slot_store_upload_finish(slot_store_t *store) {
+    if (!store->upload.in_progress) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = ESP_OK;
+    slot_store_slot_t *slot = store->upload.slot;
+    uint8_t digest[32];
+
+    if (store->upload.written != store->upload.image_size) {
+        err = ESP_ERR_INVALID_SIZE;
+        goto out;
+    }
+    mbedtls_sha256_finish(&store->upload.sha, digest);
+    if (memcmp(digest, store->upload.expected, sizeof(digest)) != 0) {
+        ESP_LOGW(store->tag, "⚠️ Uploaded %s hash mismatch", store->what);
+        err = ESP_ERR_INVALID_CRC;
+        goto out;
+    }
+    err = store->open(slot - store->slots, slot->map + SLOT_STORE_HEADER_SIZE, store->upload.image_size);
+    if (err != ESP_OK) {
+        ESP_LOGW(store->tag, "⚠️ Uploaded %s is malformed: %s", store->what, esp_err_to_name(err));
+        goto out;
+    }
+
+    // Header first with the magic left erased, then the magic word as the commit point
+    slot_header_t hdr;
+    memset(&hdr, 0xff, sizeof(hdr));
+    hdr.version = SLOT_VERSION;
+    hdr.generation = store->upload.generation;
+    hdr.image_size = store->upload.image_size;
+    memcpy(hdr.sha256, digest, sizeof(digest));
+    err = esp_partition_write(slot->part, 0, &hdr, sizeof(hdr));
+    if (err == ESP_OK) {
+        err = esp_partition_write(slot->part, offsetof(slot_header_t, magic), &store->magic, sizeof(store->magic));
+    }
+    if (err != ESP_OK) {
+        goto out;
+    }
+
+    slot->generation = store->upload.generation;
+    slot_select(store);
+
+out:
+    mbedtls_sha256_free(&store->upload.sha);
+    store->upload.in_progress = false;
+    return err;
+}
+
+void slot_store_upload_abort(slot_store_t *store) {
+    if (store->upload.in_progress) {
+        mbedtls_sha256_free(&store->upload.sha);
+        store->upload.in_progress = false;
+        ESP_LOGW(store->tag, "⚠️ Upload of %s into %s aborted", store->what, store->upload.slot->label);
+    }
+}
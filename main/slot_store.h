@@ -0,0 +1,160 @@
+/*
+ * 🔁 Slot Store - A/B flash partitions holding one committed image each 🗃️
+ *
+ * The asset store (web UI images) and the credential store (credential tables)
+ * both keep their data in a pair of data partitions, memory-mapped through the
+ * flash cache and used in place. Each partition starts with a 64-byte slot
+ * header: a generation counter, the image size and its SHA-256, and a magic
+ * word that is programmed last, so a slot only becomes valid once everything
+ * else is on flash. The valid slot with the highest generation is the active
+ * one.
+ *
+ * A new image is streamed into the other slot, erasing flash sectors just
+ * ahead of the write position and hashing as it goes, and committed by
+ * writing its header. Power loss at any point leaves the previous image
+ * active. What an image contains is up to the owning store, which opens and
+ * validates it through a callback.
+ *
+ * Readers pin the active slot for as long as they read from its mapping, for
+ * example while a large asset is sent in chunks. An upload is refused while
+ * the slot it would overwrite, the one that was active before the last
+ * commit, is still pinned.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "mbedtls/sha256.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size of the header in front of every slot's image */
+#define SLOT_STORE_HEADER_SIZE 64
+
+/**
+ * @brief Opens and validates the image in a slot.
+ *
+ * @param slot Index of the slot, 0 or 1
+ * @param image Image in the slot's mapping
+ * @param size Image size
+ * @return ESP_OK if the image can be served from this slot
+ */
+typedef esp_err_t (*slot_store_open_t)(int slot, const uint8_t *image, size_t size);
+
+/**
+ * @brief One slot and its permanent flash mapping. Read-only for the owner.
+ */
+typedef struct {
+    const char *label;                   /*!< Partition label */
+    const esp_partition_t *part;         /*!< Partition, NULL if missing */
+    const uint8_t *map;                  /*!< Mapping of the whole partition */
+    esp_partition_mmap_handle_t map_handle;
+    uint32_t generation;                 /*!< Generation of the valid image, 0 if none */
+} slot_store_slot_t;
+
+/**
+ * @brief A pair of slots. The owner fills in the first block statically.
+ */
+typedef struct {
+    const char *tag;                     /*!< Log tag of the owning store */
+    const char *what;                    /*!< What the images are, for log messages, e.g. "asset image" */
+    uint8_t subtype;                     /*!< Data partition subtype of both slots */
+    uint32_t magic;                      /*!< Slot header magic of this store */
+    slot_store_open_t open;              /*!< Opens an image after its hash was checked */
+    slot_store_slot_t slots[2];          /*!< Only the labels are set by the owner */
+
+    int active;                          /*!< Index of the active slot, -1 if none */
+    uint32_t readers[2];                 /*!< Pins per slot, see slot_store_pin() */
+    struct {
+        bool in_progress;
+        slot_store_slot_t *slot;
+        size_t image_size;
+        size_t written;
+        size_t erased;                   /*!< Bytes from the start of the partition already erased */
+        uint32_t generation;
+        uint8_t expected[32];
+        mbedtls_sha256_context sha;
+    } upload;                            /*!< Upload in progress */
+} slot_store_t;
+
+/**
+ * @brief Maps both slots, checks their images and selects the active one.
+ *
+ * @return
+ *      - ESP_OK: at least one slot is usable, possibly without a valid image
+ *      - ESP_ERR_NOT_FOUND: neither partition could be mapped
+ */
+esp_err_t slot_store_init(slot_store_t *store);
+
+/**
+ * @brief Returns the index of the active slot, or -1 if neither holds a valid image.
+ */
+int slot_store_active(const slot_store_t *store);
+
+/**
+ * @brief Pins the active slot so that no upload overwrites it while it is read.
+ *
+ * Safe to call from any task. Every pin of a slot must be released with
+ * slot_store_unpin().
+ *
+ * @return Index of the pinned slot, or -1 if no slot is active (nothing pinned).
+ */
+int slot_store_pin(slot_store_t *store);
+
+/**
+ * @brief Releases a pin taken with slot_store_pin(); -1 is ignored.
+ */
+void slot_store_unpin(slot_store_t *store, int slot);
+
+/**
+ * @brief Starts writing a new image into the slot that is not active.
+ *
+ * Only one upload per store can be in progress at a time, and none while the
+ * slot it would write is still pinned by a reader.
+ *
+ * @param image_size Exact size of the image that will be written
+ * @param sha256 Expected SHA-256 of the image
+ * @return
+ *      - ESP_OK: upload started
+ *      - ESP_ERR_INVALID_STATE: another upload is in progress, or the slot is still being read
+ *      - ESP_ERR_INVALID_SIZE: the image is empty or does not fit into a slot
+ *      - ESP_ERR_NOT_FOUND: no slot to write into
+ */
+esp_err_t slot_store_upload_begin(slot_store_t *store, size_t image_size, const uint8_t sha256[32]);
+
+/**
+ * @brief Appends image data, erasing flash sectors just ahead of the write position.
+ *
+ * @return
+ *      - ESP_OK: data written
+ *      - ESP_ERR_INVALID_STATE: no upload in progress
+ *      - ESP_ERR_INVALID_SIZE: more data than announced in slot_store_upload_begin()
+ *      - Other: flash error
+ */
+esp_err_t slot_store_upload_write(slot_store_t *store, const void *data, size_t len);
+
+/**
+ * @brief Verifies the written image, opens it and commits the slot as the active one.
+ *
+ * @return
+ *      - ESP_OK: the new image is active
+ *      - ESP_ERR_INVALID_STATE: no upload in progress
+ *      - ESP_ERR_INVALID_SIZE: fewer bytes written than announced
+ *      - ESP_ERR_INVALID_CRC: SHA-256 mismatch
+ *      - Other: the open callback rejected the image, or a flash error occurred
+ */
+esp_err_t slot_store_upload_finish(slot_store_t *store);
+
+/**
+ * @brief Abandons an upload in progress; the active image is unaffected.
+ */
+void slot_store_upload_abort(slot_store_t *store);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,330 @@
+/*
+ * 💾 State Store - lock state and counters that survive a reset 🔁
+ *
+ * The record carries a magic, a version, its own size and a CRC-32, so a
+ * copy from an older firmware, RTC memory that lost power, or a torn NVS
+ * blob is recognized and skipped rather than restored. A sequence number
+ * that grows with every change tells which of two valid copies is newer.
+ *
+ * The RTC copy is written under the same spinlock as the RAM one, so it is
+ * always a whole record; NVS gets a snapshot taken under the lock and
+ * written outside it.
+ */
+
+#include "state_store.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "lock_hal.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_attr.h"
+#endif
+
+/* 🏷️ Log tag for the state store */
+static const char *TAG = "state_store";
+
+#define STATE_NVS_NAMESPACE    "lock"
+#define STATE_NVS_KEY          "state"
+#define STATE_NVS_BENCH_KEY    "state_bench"
+
+#define STATE_MAGIC            0x3154534c // 'LST1'
+#define STATE_VERSION          1
+
+#define STATE_WRITEBACK_US     ((int64_t)CONFIG_LOCK_STATE_WRITEBACK_MS * 1000)
+
+/* Rounds timed by state_store_benchmark() */
+#define STATE_BENCH_READS      100
+#define STATE_BENCH_WRITES     10
+
+#if CONFIG_IDF_TARGET_LINUX
+/* A restarted process keeps nothing in memory; the state comes from NVS */
+#define STATE_RETAINED_ATTR
+#else
+/* RTC slow memory, left alone by the startup code on every reset but a power-on */
+#define STATE_RETAINED_ATTR    RTC_NOINIT_ATTR
+#endif
+
+/**
+ * @brief The stored form of the state, the same in RTC memory and in NVS.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;              /*!< sizeof(state_record_t) */
+    uint32_t seq;               /*!< Increases with every change */
+    state_store_data_t data;
+    uint32_t crc;               /*!< CRC-32 of everything before it */
+} state_record_t;
+
+/* Current state, and its copy that survives warm resets; both under store_lock */
+static state_record_t current;
+static STATE_RETAINED_ATTR state_record_t retained;
+static int64_t writeback_due_us = STATE_STORE_CLEAN;
+static portMUX_TYPE store_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Sequence number of the record in NVS, only used by the flushing task */
+static uint32_t stored_seq;
+
+/* NVS handle for write-backs, opened by the first one and kept: opening allocates */
+static nvs_handle_t write_nvs;
+static bool write_nvs_open;
+
+/* Counters since boot, for flash writes per state change */
+static uint32_t changes;
+static uint32_t nvs_writes;
+
+static state_store_source_t source;
+
+static const char *const source_names[] = {
+    [STATE_STORE_SOURCE_NONE] = "none",
+    [STATE_STORE_SOURCE_RTC] = "rtc",
+    [STATE_STORE_SOURCE_NVS] = "nvs",
+};
+
+static uint32_t record_crc(const state_record_t *rec) {
+    return esp_rom_crc32_le(0, (const uint8_t *)rec, offsetof(state_record_t, crc));
+}
+
+static bool record_valid(const state_record_t *rec) {
+    return rec->magic == STATE_MAGIC && rec->version == STATE_VERSION && rec->size == sizeof(*rec) &&
+           rec->crc == record_crc(rec);
+}
+
+/**
+ * @brief Seals `current` after a change and copies it to RTC memory; store_lock must be held.
+ */
+static void record_commit_locked(int64_t now_us) {
+    current.seq++;
+    current.crc = record_crc(&current);
+    retained = current;
+    changes++;
+    if (writeback_due_us == STATE_STORE_CLEAN) {
+        writeback_due_us = now_us + STATE_WRITEBACK_US;
+    }
+}
+
+/**
+ * @brief Reads a record from NVS.
+ *
+ * @return true if a valid record was read.
+ */
+static bool state_store_read_nvs(const char *key, state_record_t *rec) {
+    nvs_handle_t nvs;
+    size_t len = sizeof(*rec);
+    esp_err_t err = nvs_open(STATE_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_get_blob(nvs, key, rec, &len);
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        // ESP_ERR_NVS_INVALID_LENGTH: a larger record from another firmware version
+        ESP_LOGW(TAG, "⚠️ Cannot read the stored lock state: %s", esp_err_to_name(err));
+    }
+    return err == ESP_OK && len == sizeof(*rec) && record_valid(rec);
+}
+
+/**
+ * @brief Writes a record to NVS and commits it.
+ */
+static esp_err_t state_store_write_nvs(const char *key, const state_record_t *rec) {
+    if (!write_nvs_open) {
+        esp_err_t err = nvs_open(STATE_NVS_NAMESPACE, NVS_READWRITE, &write_nvs);
+        if (err != ESP_OK) {
+            return err;
+        }
+        write_nvs_open = true;
+    }
+    esp_err_t err = nvs_set_blob(write_nvs, key, rec, sizeof(*rec));
+    if (err == ESP_OK) {
+        err = nvs_commit(write_nvs);
+    }
+    return err;
+}
+
+esp_err_t state_store_init(void) {
+    esp_err_t err = lock_hal_storage_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ NVS initialization failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    state_record_t stored;
+    bool have_stored = state_store_read_nvs(STATE_NVS_KEY, &stored);
+    portENTER_CRITICAL(&store_lock);
+    if (record_valid(&retained) && (!have_stored || (int32_t)(retained.seq - stored.seq) >= 0)) {
+        current = retained;
+        source = STATE_STORE_SOURCE_RTC;
+    } else if (have_stored) {
+        current = stored;
+        source = STATE_STORE_SOURCE_NVS;
+    } else {
+        memset(&current, 0, sizeof(current));
+        current.magic = STATE_MAGIC;
+        current.version = STATE_VERSION;
+        current.size = sizeof(current);
+        current.data.last_fail_s = -1;
+        source = STATE_STORE_SOURCE_NONE;
+    }
+    stored_seq = have_stored ? stored.seq : 0;
+    current.data.boots++;
+    record_commit_locked(lock_hal_time_us());
+    state_store_data_t data = current.data;
+    portEXIT_CRITICAL(&store_lock);
+
+    ESP_LOGI(TAG, "💾 Lock state from %s: %s, %lu unlocks, %lu failures (%lu in a row), boot %lu",
+             source_names[source], data.open ? "open" : "locked", (unsigned long)data.unlocks,
+             (unsigned long)data.auth_failures, (unsigned long)data.fail_streak, (unsigned long)data.boots);
+    return ESP_OK;
+}
+
+void state_store_get(state_store_data_t *data) {
+    portENTER_CRITICAL(&store_lock);
+    *data = current.data;
+    portEXIT_CRITICAL(&store_lock);
+}
+
+void state_store_set(const state_store_data_t *data) {
+    int64_t now = lock_hal_time_us();
+    portENTER_CRITICAL(&store_lock);
+    bool relocked = current.data.open && !data->open;
+    current.data = *data;
+    record_commit_locked(now);
+    if (relocked) {
+        // Not coalesced: a power loss must not bring back an open lock that was locked since
+        writeback_due_us = now;
+    }
+    portEXIT_CRITICAL(&store_lock);
+}
+
+int64_t state_store_writeback_due_us(void) {
+    portENTER_CRITICAL(&store_lock);
+    int64_t due = writeback_due_us;
+    portEXIT_CRITICAL(&store_lock);
+    return due;
+}
+
+esp_err_t state_store_flush(void) {
+    portENTER_CRITICAL(&store_lock);
+    state_record_t snapshot = current;
+    writeback_due_us = STATE_STORE_CLEAN;
+    portEXIT_CRITICAL(&store_lock);
+    if (snapshot.seq == stored_seq) {
+        return ESP_OK;
+    }
+
+    esp_err_t err = state_store_write_nvs(STATE_NVS_KEY, &snapshot);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Lock state not written back, retrying later: %s", esp_err_to_name(err));
+        int64_t now = lock_hal_time_us();
+        portENTER_CRITICAL(&store_lock);
+        if (writeback_due_us == STATE_STORE_CLEAN) {
+            writeback_due_us = now + STATE_WRITEBACK_US;
+        }
+        portEXIT_CRITICAL(&store_lock);
+        return err;
+    }
+    stored_seq = snapshot.seq;
+    nvs_writes++;
+    return ESP_OK;
+}
+
+state_store_source_t state_store_source(void) {
+    return source;
+}
+
+esp_err_t state_store_export(state_store_write_fn_t write, void *ctx) {
+    state_store_data_t data;
+    char line[192];
+
+    portENTER_CRITICAL(&store_lock);
+    data = current.data;
+    uint32_t changes_now = changes;
+    portEXIT_CRITICAL(&store_lock);
+
+    const struct {
+        const char *name;
+        const char *type;
+        const char *help;
+        uint32_t value;
+    } values[] = {
+        { "lock_unlocks_total", "counter", "Unlocks over the life of the device.", data.unlocks },
+        { "lock_auth_failures_total", "counter", "Rejected responses over the life of the device.",
+          data.auth_failures },
+        { "lock_auth_fail_streak", "gauge", "Rejected responses since the last unlock.", data.fail_streak },
+        { "lock_boots_total", "counter", "Startups over the life of the device.", data.boots },
+        { "lock_state_changes_total", "counter", "Changes to the persisted lock state since boot.", changes_now },
+        { "lock_state_nvs_writes_total", "counter", "Write-backs of the lock state to NVS since boot.",
+          nvs_writes },
+    };
+    esp_err_t err = ESP_OK;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]) && err == ESP_OK; i++) {
+        int len = snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %lu\n", values[i].name,
+                           values[i].help, values[i].name, values[i].type, values[i].name,
+                           (unsigned long)values[i].value);
+        err = write(ctx, line, len);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    int len = snprintf(line, sizeof(line),
+                       "# HELP lock_state_restored_info Where the lock state was restored from at boot.\n"
+                       "# TYPE lock_state_restored_info gauge\n"
+                       "lock_state_restored_info{source=\"%s\"} 1\n", source_names[source]);
+    return write(ctx, line, len);
+}
+
+#if CONFIG_LOCK_STATE_BENCHMARK
+
+void state_store_benchmark(void) {
+    state_record_t rec;
+
+    portENTER_CRITICAL(&store_lock);
+    rec = retained;
+    portEXIT_CRITICAL(&store_lock);
+    int64_t start = lock_hal_time_us();
+    int valid = 0;
+    for (int i = 0; i < STATE_BENCH_READS; i++) {
+        valid += record_valid(&rec);
+    }
+    int64_t rtc_ns = (lock_hal_time_us() - start) * 1000 / STATE_BENCH_READS;
+
+    // Distinct records under a scratch key: NVS skips writing a blob that did not change
+    int64_t write_us = 0;
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < STATE_BENCH_WRITES && err == ESP_OK; i++) {
+        rec.seq++;
+        rec.crc = record_crc(&rec);
+        start = lock_hal_time_us();
+        err = state_store_write_nvs(STATE_NVS_BENCH_KEY, &rec);
+        write_us += lock_hal_time_us() - start;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ State store benchmark needs NVS: %s", esp_err_to_name(err));
+        return;
+    }
+
+    start = lock_hal_time_us();
+    for (int i = 0; i < STATE_BENCH_READS; i++) {
+        valid += state_store_read_nvs(STATE_NVS_BENCH_KEY, &rec);
+    }
+    int64_t nvs_us = lock_hal_time_us() - start;
+
+    nvs_handle_t nvs;
+    if (nvs_open(STATE_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_erase_key(nvs, STATE_NVS_BENCH_KEY);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+
+    // `valid` keeps the checks from being optimized away; all of them should pass
+    ESP_LOGI(TAG, "⏱️ Restore: %lld ns from RTC memory, %lld µs from NVS; write-back %lld µs (%d/%d valid)",
+             (long long)rtc_ns, (long long)nvs_us / STATE_BENCH_READS, (long long)write_us / STATE_BENCH_WRITES,
+             valid, 2 * STATE_BENCH_READS);
+}
+
+#endif /* CONFIG_LOCK_STATE_BENCHMARK */
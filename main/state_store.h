@@ -0,0 +1,128 @@
+/*
+ * 💾 State Store - lock state and counters that survive a reset 🔁
+ *
+ * Whether the lock is open, the lifetime unlock and failure counters and the
+ * current run of failed attempts are kept in one small record. Every change
+ * is copied at once to RTC memory, which survives software, panic and
+ * watchdog resets, and written back to NVS at most once per
+ * CONFIG_LOCK_STATE_WRITEBACK_MS, so a burst of unlocks and bad tokens costs
+ * one flash write instead of one per event. Relocking is the exception: it
+ * is due for write-back at once, so a power loss can lose counter changes
+ * but never turn a locked door back into an open one. At startup the newer
+ * of the two copies that pass their CRC is restored: the RTC copy after a
+ * warm reset, NVS after a power loss, which loses at most the last
+ * write-back period.
+ *
+ * Only the lock controller task changes and flushes the record; the getters
+ * and the export may be called from any task.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* state_store_writeback_due_us() while NVS is up to date */
+#define STATE_STORE_CLEAN INT64_MAX
+
+/**
+ * @brief The persisted state.
+ */
+typedef struct {
+    int64_t last_fail_s;       /*!< Wall-clock time of the last rejected response, -1 if unknown */
+    uint32_t unlocks;          /*!< Unlocks over the life of the device */
+    uint32_t auth_failures;    /*!< Rejected responses over the life of the device */
+    uint32_t fail_streak;      /*!< Rejected responses since the last unlock */
+    uint32_t boots;            /*!< Startups, counted by state_store_init() */
+    bool open;                 /*!< The lock was unlocked */
+} state_store_data_t;
+
+/**
+ * @brief Where state_store_init() found the state.
+ */
+typedef enum {
+    STATE_STORE_SOURCE_NONE,   /*!< Nothing valid stored, started from defaults */
+    STATE_STORE_SOURCE_RTC,    /*!< RTC memory, after a warm reset */
+    STATE_STORE_SOURCE_NVS,    /*!< NVS, after a power loss or an update */
+} state_store_source_t;
+
+/**
+ * @brief Initializes NVS and restores the state persisted before the reset.
+ *
+ * Must be called before the lock controller starts. Counts the boot, which
+ * schedules a write-back.
+ *
+ * @return
+ *      - ESP_OK: state restored, or defaults if nothing valid was stored
+ *      - Error from lock_hal_storage_init(): NVS unusable
+ */
+esp_err_t state_store_init(void);
+
+/**
+ * @brief Copies the current state.
+ */
+void state_store_get(state_store_data_t *data);
+
+/**
+ * @brief Replaces the state.
+ *
+ * Updates the RTC copy right away and arms the write-back deadline unless it
+ * is armed already; the deadline is not pushed back by later changes, so NVS
+ * is never more than one write-back period behind. A change from open to
+ * locked makes the write-back due immediately.
+ */
+void state_store_set(const state_store_data_t *data);
+
+/**
+ * @brief Returns when state_store_flush() should run, on the lock_hal_time_us() clock.
+ *
+ * @return The deadline, or STATE_STORE_CLEAN if NVS is up to date.
+ */
+int64_t state_store_writeback_due_us(void);
+
+/**
+ * @brief Writes the state to NVS if it changed since the last write.
+ *
+ * A failed write is retried after another write-back period.
+ *
+ * @return ESP_OK, or the NVS error.
+ */
+esp_err_t state_store_flush(void);
+
+/**
+ * @brief Returns where state_store_init() found the state.
+ */
+state_store_source_t state_store_source(void);
+
+/**
+ * @brief Callback receiving the export of state_store_export() piece by piece.
+ */
+typedef esp_err_t (*state_store_write_fn_t)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Exports the counters, the changes and NVS writes since boot, and
+ *        the restore source in the Prometheus text format.
+ *
+ * @param write Sink for the text
+ * @param ctx Passed to write
+ * @return ESP_OK, or the first error returned by write
+ */
+esp_err_t state_store_export(state_store_write_fn_t write, void *ctx);
+
+#if CONFIG_LOCK_STATE_BENCHMARK
+/**
+ * @brief Logs the cost of restoring the state from RTC memory and from NVS,
+ *        and of one write-back.
+ */
+void state_store_benchmark(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,155 @@
+/*
+ * 🧭 Task Topology - which core and priority every task runs at 🗺️
+ *
+ * The table is constant and built from Kconfig, so a layout is tried by
+ * changing sdkconfig and reflashing. The report reads the kernel's task list
+ * with uxTaskGetSystemState(), which with run-time statistics enabled also
+ * carries the time each task has spent running, counted in µs by esp_timer.
+ */
+
+#include "task_topology.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "heap_watch.h"
+#include "mem_placement.h"
+
+/* 🏷️ Log tag for the task topology */
+static const char *TAG = "task_topology";
+
+/* Kconfig core of a role, where -1 stands for no affinity; single-core builds ignore it */
+#if portNUM_PROCESSORS > 1
+#define TOPO_CORE(core) ((core) < 0 ? tskNO_AFFINITY : (BaseType_t)(core))
+#else
+#define TOPO_CORE(core) tskNO_AFFINITY
+#endif
+
+/* Background tasks keep their relative priorities on the shared core */
+#define TOPO_AUDIT_PRIO       (tskIDLE_PRIORITY + 2)
+#define TOPO_LOG_OFFLOAD_PRIO (tskIDLE_PRIORITY + 1)
+#define TOPO_NONCE_POOL_PRIO  (tskIDLE_PRIORITY + 1)
+
+static const task_placement_t placements[TASK_ROLE_COUNT] = {
+    [TASK_ROLE_HTTPD] = { "httpd", TOPO_CORE(CONFIG_LOCK_TOPO_HTTPD_CORE), CONFIG_LOCK_TOPO_HTTPD_PRIO },
+    [TASK_ROLE_HTTP_WORKER] = { "http_worker", TOPO_CORE(CONFIG_LOCK_TOPO_HTTP_WORKERS_CORE),
+                                CONFIG_LOCK_TOPO_HTTP_WORKERS_PRIO },
+    [TASK_ROLE_LOCK_CTRL] = { "lock_ctrl", TOPO_CORE(CONFIG_LOCK_TOPO_LOCK_CTRL_CORE),
+                              CONFIG_LOCK_TOPO_LOCK_CTRL_PRIO },
+    [TASK_ROLE_AUDIT] = { "audit", TOPO_CORE(CONFIG_LOCK_TOPO_BACKGROUND_CORE), TOPO_AUDIT_PRIO },
+    [TASK_ROLE_LOG_OFFLOAD] = { "log_offload", TOPO_CORE(CONFIG_LOCK_TOPO_BACKGROUND_CORE), TOPO_LOG_OFFLOAD_PRIO },
+    [TASK_ROLE_NONCE_POOL] = { "nonce_pool", TOPO_CORE(CONFIG_LOCK_TOPO_BACKGROUND_CORE), TOPO_NONCE_POOL_PRIO },
+};
+
+const task_placement_t *task_topology_get(task_role_t role) {
+    return &placements[role];
+}
+
+BaseType_t task_topology_create(task_role_t role, TaskFunction_t fn, const char *name, uint32_t stack,
+                                void *arg, const task_topology_mem_t *mem, TaskHandle_t *handle) {
+    const task_placement_t *p = &placements[role];
+    TaskHandle_t task = NULL;
+    if (!mem) {
+        xTaskCreatePinnedToCore(fn, name, stack, arg, p->priority, &task, p->core);
+    } else {
+        task = xTaskCreateStaticPinnedToCore(fn, name, stack, arg, p->priority, mem->stack, mem->tcb, p->core);
+    }
+    if (handle) {
+        *handle = task;
+    }
+    if (!task) {
+        return pdFAIL;
+    }
+    heap_watch_add_task(task, HEAP_WATCH_FIRMWARE);
+    return pdPASS;
+}
+
+/**
+ * @brief Formats a core for the log and the report: "0", "1" or "any".
+ */
+static const char *core_name(BaseType_t core) {
+    static const char *const names[] = { "0", "1" };
+    return core >= 0 && core < 2 ? names[core] : "any";
+}
+
+void task_topology_log(void) {
+    for (int i = 0; i < TASK_ROLE_COUNT; i++) {
+        ESP_LOGI(TAG, "🧭 %-12s core %-3s priority %u", placements[i].role, core_name(placements[i].core),
+                 (unsigned)placements[i].priority);
+    }
+#if CONFIG_LWIP_TCPIP_TASK_PRIO
+    ESP_LOGI(TAG, "🧭 %-12s core %-3s priority %u", "tcpip",
+             CONFIG_LWIP_TCPIP_TASK_AFFINITY == tskNO_AFFINITY ? "any" :
+             core_name(CONFIG_LWIP_TCPIP_TASK_AFFINITY), (unsigned)CONFIG_LWIP_TCPIP_TASK_PRIO);
+#endif
+#if CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_1
+    ESP_LOGI(TAG, "🧭 %-12s core 1", "wifi");
+#elif CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_0
+    ESP_LOGI(TAG, "🧭 %-12s core 0", "wifi");
+#endif
+}
+
+#if CONFIG_LOCK_TASK_STATS
+
+/* Tasks that may be created while the list is being read */
+#define TOPO_REPORT_SLACK 4
+
+#if CONFIG_LOCK_STATIC_ALLOC
+/* Most tasks listed; only the HTTP server task writes reports, so one buffer does */
+#define TOPO_REPORT_MAX_TASKS 32
+static LOCK_COLD_BSS TaskStatus_t report_tasks[TOPO_REPORT_MAX_TASKS];
+#endif
+
+/**
+ * @brief qsort() comparator putting the busiest task first.
+ */
+static int by_run_time(const void *a, const void *b) {
+    const TaskStatus_t *x = a, *y = b;
+    return x->ulRunTimeCounter < y->ulRunTimeCounter ? 1 : x->ulRunTimeCounter > y->ulRunTimeCounter ? -1 : 0;
+}
+
+esp_err_t task_topology_report(task_topology_write_fn_t write, void *ctx) {
+    static const char states[] = { [eRunning] = 'X', [eReady] = 'R', [eBlocked] = 'B',
+                                   [eSuspended] = 'S', [eDeleted] = 'D' };
+    static const char header[] = "task             core prio state stack_free     cpu_us   cpu%\n";
+    configRUN_TIME_COUNTER_TYPE total;
+    char line[96];
+
+#if CONFIG_LOCK_STATIC_ALLOC
+    // uxTaskGetSystemState() lists nothing if the buffer is too small, so the report then says so
+    UBaseType_t capacity = TOPO_REPORT_MAX_TASKS;
+    TaskStatus_t *tasks = report_tasks;
+#else
+    UBaseType_t capacity = uxTaskGetNumberOfTasks() + TOPO_REPORT_SLACK;
+    TaskStatus_t *tasks = heap_caps_malloc(capacity * sizeof(*tasks), LOCK_COLD_CAPS);
+    if (!tasks) {
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+    UBaseType_t count = uxTaskGetSystemState(tasks, capacity, &total);
+    qsort(tasks, count, sizeof(*tasks), by_run_time);
+
+    esp_err_t err = write(ctx, header, sizeof(header) - 1);
+    for (UBaseType_t i = 0; i < count && err == ESP_OK; i++) {
+        const TaskStatus_t *t = &tasks[i];
+        // Share of one core since boot, in tenths of a percent
+        unsigned permille = total ? (unsigned)((uint64_t)t->ulRunTimeCounter * 1000 / total) : 0;
+        int len = snprintf(line, sizeof(line), "%-16s %4s %4u %5c %10lu %10llu %4u.%u\n", t->pcTaskName,
+                           core_name(xTaskGetCoreID(t->xHandle)), (unsigned)t->uxCurrentPriority,
+                           t->eCurrentState < sizeof(states) ? states[t->eCurrentState] : '?',
+                           (unsigned long)t->usStackHighWaterMark, (unsigned long long)t->ulRunTimeCounter,
+                           permille / 10, permille % 10);
+        err = write(ctx, line, len);
+    }
+#if CONFIG_LOCK_STATIC_ALLOC
+    if (count == 0 && err == ESP_OK) {
+        static const char overflow[] = "more tasks than TOPO_REPORT_MAX_TASKS\n";
+        err = write(ctx, overflow, sizeof(overflow) - 1);
+    }
+#else
+    free(tasks);
+#endif
+    return err;
+}
+
+#endif /* CONFIG_LOCK_TASK_STATS */
@@ -0,0 +1,125 @@
+/*
+ * 🧭 Task Topology - which core and priority every task runs at 🗺️
+ *
+ * The firmware's tasks are placed from one table, filled from the "Lock Task
+ * Topology" Kconfig menu, instead of each module picking its own affinity:
+ *
+ *     role          default core  default priority
+ *     httpd         1             5
+ *     http_worker   any           5
+ *     lock_ctrl     1             5
+ *     audit         0             2
+ *     log_offload   0             1
+ *     nonce_pool    0             1
+ *
+ * The Wi-Fi and lwIP tasks belong to ESP-IDF and are placed by its own
+ * options (ESP_WIFI_TASK_PINNED_TO_CORE_x, LWIP_TCPIP_TASK_AFFINITY_CPUx);
+ * sdkconfig.defaults.esp32s3 puts both on core 0, and the boot log lists
+ * them next to the table. GET /tasks reports where every task actually ran
+ * and how much CPU time it used, to compare layouts against the unlock
+ * latency at /metrics.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Tasks placed by the topology table.
+ */
+typedef enum {
+    TASK_ROLE_HTTPD,        /*!< HTTP server task (esp_http_server) */
+    TASK_ROLE_HTTP_WORKER,  /*!< HTTP workers (http_workers.h), all alike */
+    TASK_ROLE_LOCK_CTRL,    /*!< Lock controller and LED (lock_ctrl.h) */
+    TASK_ROLE_AUDIT,        /*!< Audit log writer (audit_log.h) */
+    TASK_ROLE_LOG_OFFLOAD,  /*!< Console drain (log_offload.h) */
+    TASK_ROLE_NONCE_POOL,   /*!< Nonce refill (nonce_pool.h) */
+    TASK_ROLE_COUNT
+} task_role_t;
+
+/**
+ * @brief Where a task runs.
+ */
+typedef struct {
+    const char *role;       /*!< Role name, as in the boot log */
+    BaseType_t core;        /*!< Core the task is pinned to, or tskNO_AFFINITY */
+    UBaseType_t priority;   /*!< FreeRTOS priority */
+} task_placement_t;
+
+/**
+ * @brief Stack and control block of a task that does not take them from the heap.
+ */
+typedef struct {
+    StackType_t *stack;     /*!< Stack, as many bytes as the task's stack size */
+    StaticTask_t *tcb;      /*!< Task control block */
+} task_topology_mem_t;
+
+#if CONFIG_LOCK_STATIC_ALLOC
+/* Reserves the stack and control block of a task in .bss, for TASK_TOPOLOGY_MEM(name) */
+#define TASK_TOPOLOGY_MEM_DEFINE(name, stack_size) \
+    static StackType_t name##_stack[stack_size]; \
+    static StaticTask_t name##_tcb
+#define TASK_TOPOLOGY_MEM(name) (&(const task_topology_mem_t){ name##_stack, &name##_tcb })
+#else
+#define TASK_TOPOLOGY_MEM_DEFINE(name, stack_size) _Static_assert((stack_size) > 0, "task stack size")
+#define TASK_TOPOLOGY_MEM(name) NULL
+#endif
+
+/**
+ * @brief Returns the placement of a role.
+ */
+const task_placement_t *task_topology_get(task_role_t role);
+
+/**
+ * @brief Creates a task at the core and priority of its role.
+ *
+ * The task's heap allocations are counted as the firmware's (see heap_watch.h).
+ *
+ * @param role Role of the task
+ * @param fn Task body
+ * @param name Task name
+ * @param stack Stack size in bytes
+ * @param arg Argument passed to fn
+ * @param mem Stack and control block, or NULL to take them from the heap
+ * @param handle Receives the task handle, may be NULL
+ * @return pdPASS if the task was created
+ */
+BaseType_t task_topology_create(task_role_t role, TaskFunction_t fn, const char *name, uint32_t stack,
+                                void *arg, const task_topology_mem_t *mem, TaskHandle_t *handle);
+
+/**
+ * @brief Logs the topology table and the placement of the ESP-IDF network tasks.
+ */
+void task_topology_log(void);
+
+#if CONFIG_LOCK_TASK_STATS
+/**
+ * @brief Callback receiving the report of task_topology_report() piece by piece.
+ */
+typedef esp_err_t (*task_topology_write_fn_t)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Writes one line per task: name, core, priority, state, stack
+ * headroom and CPU time since boot, busiest task first.
+ *
+ * @param write Sink for the text
+ * @param ctx Passed to write
+ * @return
+ *      - ESP_OK: report written
+ *      - ESP_ERR_NO_MEM: no memory for the task list
+ *      - Other: error returned by write
+ */
+esp_err_t task_topology_report(task_topology_write_fn_t write, void *ctx);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,166 @@
+/*
+ * 🔓 Unlock Flow - what the unlock endpoints decide, without the transport 🧭
+ *
+ * Clients are identified by the address the handlers take from the socket;
+ * the same address keys the rate limiter and goes into the audit log.
+ */
+
+#include "unlock_flow.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "access_policy.h"
+#include "auth_hmac.h"
+#include "config_store.h"
+#include "cred_store.h"
+#include "lock_ctrl.h"
+#include "lock_hal.h"
+#include "nonce_pool.h"
+
+/* 🏷️ Log tag for the unlock flow */
+static const char *TAG = "unlock_flow";
+
+_Static_assert(NONCE_POOL_NONCE_LEN <= CHALLENGE_NONCE_MAX_LEN, "challenge store holds pool nonces");
+_Static_assert(AUDIT_ADDR_LEN == RATE_LIMIT_ADDR_LEN, "one client address for the limiter and the audit log");
+
+#if CONFIG_LOCK_AUTH_COUNTER_UNLOCK
+/* Number of counters below the highest one that are still accepted once */
+#define REPLAY_WINDOW_SIZE 64
+
+/* Sliding replay window for one-round-trip unlocks (see unlock_flow_counter()).
+ * A fresh epoch is drawn at every boot, which invalidates all counters used
+ * before the restart without having to persist them. */
+static struct {
+    uint32_t epoch;     /*!< Random value clients must quote with their counter */
+    uint32_t highest;   /*!< Highest counter accepted so far in this epoch */
+    uint64_t seen;      /*!< Bit n set: counter (highest - n) has been used */
+} replay;
+
+/* Guards replay.highest and replay.seen against concurrent /unlock requests */
+static portMUX_TYPE replay_lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+void unlock_flow_init(void) {
+#if CONFIG_LOCK_AUTH_COUNTER_UNLOCK
+    portENTER_CRITICAL(&replay_lock);
+    replay.epoch = lock_hal_random();
+    replay.highest = 0;
+    replay.seen = 0;
+    portEXIT_CRITICAL(&replay_lock);
+#endif
+}
+
+bool unlock_flow_admit(const uint8_t client[RATE_LIMIT_ADDR_LEN], uint32_t *retry_after_s) {
+    return rate_limit_allow(client, retry_after_s);
+}
+
+esp_err_t unlock_flow_issue(char challenge[CHALLENGE_NONCE_MAX_LEN + 1]) {
+    esp_err_t err;
+
+    // Retry on the (practically impossible) event that the nonce is already outstanding
+    int attempts = 0;
+    do {
+        nonce_pool_take(challenge);
+        err = challenge_store_put(challenge);
+    } while (err == ESP_ERR_INVALID_STATE && ++attempts < 3);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Cannot issue challenge: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "🎲 New challenge generated: %s", challenge);
+    return ESP_OK;
+}
+
+const char *unlock_flow_verify(const uint8_t client[RATE_LIMIT_ADDR_LEN], audit_channel_t channel,
+                               const char *id, const char *nonce, const char *token) {
+    auth_hmac_key_t cred_key;
+    const auth_hmac_key_t *key = &config_store_get()->psk_key;
+    uint8_t schedule = 0;
+    bool challenge_ok = challenge_store_consume(nonce);
+
+    if (challenge_ok && id) {
+        if (cred_store_lookup(id, &cred_key, &schedule) != ESP_OK) {
+            lock_ctrl_post(LOCK_EVT_AUTH_FAIL);
+            audit_log_record(AUDIT_EVT_UNKNOWN_CREDENTIAL, channel, client);
+            return "Unknown credential";
+        }
+        key = &cred_key;
+    }
+    if (challenge_ok && auth_hmac_verify_hex(key, nonce, strlen(nonce), token)) {
+        if (id && !access_policy_allows(schedule)) {
+            lock_ctrl_post(LOCK_EVT_AUTH_FAIL);
+            audit_log_record(AUDIT_EVT_OUTSIDE_SCHEDULE, channel, client);
+            return "Outside access schedule";
+        }
+        lock_ctrl_post(LOCK_EVT_AUTH_OK);
+        audit_log_record(AUDIT_EVT_UNLOCK, channel, client);
+        return NULL;
+    }
+    lock_ctrl_post(LOCK_EVT_AUTH_FAIL);
+    audit_log_record(challenge_ok ? AUDIT_EVT_BAD_TOKEN : AUDIT_EVT_UNKNOWN_CHALLENGE, channel, client);
+    return challenge_ok ? "Invalid token" : "Unknown or expired challenge";
+}
+
+#if CONFIG_LOCK_AUTH_COUNTER_UNLOCK
+/**
+ * @brief Accepts a counter at most once, tolerating reordering within the window.
+ *
+ * Counters above the highest one slide the window forward; counters inside
+ * the window are accepted if they have not been used yet; older counters are
+ * rejected. This is the anti-replay scheme of IPsec (RFC 4303, 3.4.3).
+ *
+ * @param counter Counter to check, already authenticated.
+ *
+ * @return true if the counter had not been used and is now marked as used.
+ */
+static bool replay_window_accept(uint32_t counter) {
+    bool fresh = false;
+
+    portENTER_CRITICAL(&replay_lock);
+    if (counter > replay.highest) {
+        uint32_t shift = counter - replay.highest;
+        replay.seen = shift >= REPLAY_WINDOW_SIZE ? 1 : (replay.seen << shift) | 1;
+        replay.highest = counter;
+        fresh = true;
+    } else {
+        uint32_t age = replay.highest - counter;
+        if (counter != 0 && age < REPLAY_WINDOW_SIZE && !(replay.seen & (1ULL << age))) {
+            replay.seen |= 1ULL << age;
+            fresh = true;
+        }
+    }
+    portEXIT_CRITICAL(&replay_lock);
+    return fresh;
+}
+
+unlock_counter_result_t unlock_flow_counter(const uint8_t client[RATE_LIMIT_ADDR_LEN], uint32_t epoch,
+                                            uint32_t counter, const char *token) {
+    char message[24];
+
+    // A stale epoch skips verification and leads straight to the resync answer
+    if (epoch != replay.epoch) {
+        return UNLOCK_COUNTER_STALE;
+    }
+    int len = snprintf(message, sizeof(message), "%lu:%lu", (unsigned long)epoch, (unsigned long)counter);
+    if (!auth_hmac_verify_hex(&config_store_get()->psk_key, message, len, token)) {
+        lock_ctrl_post(LOCK_EVT_AUTH_FAIL);
+        audit_log_record(AUDIT_EVT_BAD_TOKEN, AUDIT_CH_COUNTER, client);
+        return UNLOCK_COUNTER_FORGED;
+    }
+    if (!replay_window_accept(counter)) {
+        audit_log_record(AUDIT_EVT_REPLAY, AUDIT_CH_COUNTER, client);
+        return UNLOCK_COUNTER_STALE;
+    }
+    lock_ctrl_post(LOCK_EVT_AUTH_OK);
+    audit_log_record(AUDIT_EVT_UNLOCK, AUDIT_CH_COUNTER, client);
+    return UNLOCK_COUNTER_OK;
+}
+
+void unlock_flow_counter_resync(uint32_t *epoch, uint32_t *next) {
+    *epoch = replay.epoch;
+    *next = __atomic_load_n(&replay.highest, __ATOMIC_RELAXED) + 1;
+}
+#endif
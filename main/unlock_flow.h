@@ -0,0 +1,110 @@
+/*
+ * 🔓 Unlock Flow - what the unlock endpoints decide, without the transport 🧭
+ *
+ * GET /challenge, POST /response, POST /unlock and the WebSocket commands
+ * only parse their requests and send the answers; the decisions are made
+ * here: issuing challenges, charging attempts to the client's rate limit,
+ * checking a response with the pre-shared key or a credential's key and the
+ * credential's access schedule, the counter replay window, and posting the
+ * outcome to the lock controller and the audit log. Nothing here depends on
+ * the HTTP server, so the host tests run the same code as the handlers.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "audit_log.h"
+#include "challenge_store.h"
+#include "rate_limit.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Draws the epoch of the counter replay window.
+ *
+ * Called once at startup, after the random number generator has entropy.
+ * Invalidates every counter used before.
+ */
+void unlock_flow_init(void);
+
+/**
+ * @brief Charges an authentication attempt to a client's rate limit.
+ *
+ * @param client Client address, see rate_limit.h.
+ * @param retry_after_s Receives the seconds until the next attempt is allowed. May be NULL.
+ *
+ * @return true if the attempt may proceed.
+ */
+bool unlock_flow_admit(const uint8_t client[RATE_LIMIT_ADDR_LEN], uint32_t *retry_after_s);
+
+/**
+ * @brief Takes a random challenge from the nonce pool and records it in the challenge store.
+ *
+ * @param challenge Receives the NUL-terminated challenge.
+ *
+ * @return ESP_OK on success, or the challenge store error.
+ */
+esp_err_t unlock_flow_issue(char challenge[CHALLENGE_NONCE_MAX_LEN + 1]);
+
+/**
+ * @brief Checks a response token against an outstanding challenge and drives the lock.
+ *
+ * The challenge is consumed first so that it can never be answered twice. The
+ * token is checked with the named credential's key, or with the pre-shared
+ * key if no credential is named; a valid credential must also be inside the
+ * time windows of its access schedule (see access_policy.h). The outcome is
+ * posted to the lock controller and recorded in the audit log.
+ *
+ * @param client Client address, for the audit log.
+ * @param channel How the response arrived, for the audit log.
+ * @param id Credential ID, or NULL for the pre-shared key.
+ * @param nonce Challenge being answered.
+ * @param token Hex encoded HMAC-SHA256 of the challenge.
+ *
+ * @return NULL if the lock was opened, otherwise the reason for the rejection.
+ */
+const char *unlock_flow_verify(const uint8_t client[RATE_LIMIT_ADDR_LEN], audit_channel_t channel,
+                               const char *id, const char *nonce, const char *token);
+
+#if CONFIG_LOCK_AUTH_COUNTER_UNLOCK
+/**
+ * @brief Outcome of a one-round-trip unlock.
+ */
+typedef enum {
+    UNLOCK_COUNTER_OK,       /*!< Token valid and counter unused: the lock was opened */
+    UNLOCK_COUNTER_FORGED,   /*!< Token invalid for the current epoch */
+    UNLOCK_COUNTER_STALE,    /*!< Other epoch, or counter already used or out of the window */
+} unlock_counter_result_t;
+
+/**
+ * @brief Checks a one-round-trip unlock and drives the lock.
+ *
+ * The token is the hex encoded HMAC-SHA256 of `<epoch>:<counter>` keyed with
+ * the pre-shared key. It is verified before the counter is checked against
+ * the replay window, so forged requests cannot move the window. A stale epoch
+ * skips verification.
+ *
+ * @param client Client address, for the audit log.
+ * @param epoch Epoch the client quotes.
+ * @param counter Counter the client chose, not 0.
+ * @param token Hex encoded HMAC-SHA256 of `<epoch>:<counter>`.
+ */
+unlock_counter_result_t unlock_flow_counter(const uint8_t client[RATE_LIMIT_ADDR_LEN], uint32_t epoch,
+                                            uint32_t counter, const char *token);
+
+/**
+ * @brief Returns where a client whose counter was stale resumes.
+ *
+ * @param epoch Receives the current epoch.
+ * @param next Receives the lowest counter that is certainly unused.
+ */
+void unlock_flow_counter_resync(uint32_t *epoch, uint32_t *next);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
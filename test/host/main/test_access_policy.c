@@ -0,0 +1,93 @@
+/*
+ * 🗓️ Access policy tests: windows, midnight wrap, unknown time, persistence 🧪
+ *
+ * Times are given as local times of the week starting Monday 2024-01-01,
+ * converted with the policy's `tz +01:00`, so every check names the
+ * wall-clock time the rule was written for.
+ */
+
+#include <string.h>
+#include "unity.h"
+#include "nvs_flash.h"
+#include "access_policy.h"
+
+/* Monday 2024-01-01 00:00 UTC */
+#define TEST_MONDAY_UTC  1704067200LL
+#define TEST_TZ_S        3600
+
+enum { MON, TUE, WED, THU, FRI, SAT, SUN };
+
+static const char sample_policy[] =
+    "# contractors: weekdays 08:00-17:00, Saturday mornings\n"
+    "tz +01:00\n"
+    "1 mon-fri 08:00-17:00\n"
+    "1 sat 08:00-12:00\n"
+    "2 daily 22:00-06:00\n"
+    "3 never\n";
+
+/**
+ * @brief Returns the Unix time of a local time in the test week.
+ */
+static int64_t local(int day, int hour, int minute) {
+    return TEST_MONDAY_UTC + day * 86400LL + hour * 3600 + minute * 60 - TEST_TZ_S;
+}
+
+static void policy_start(void) {
+    int error_line;
+
+    // Policies persist in NVS, on the emulated flash of the linux target
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_flash_init());
+    TEST_ASSERT_EQUAL(ESP_OK, access_policy_init());
+    TEST_ASSERT_EQUAL(ESP_OK, access_policy_update(sample_policy, strlen(sample_policy), &error_line));
+    TEST_ASSERT_EQUAL(0, error_line);
+}
+
+static void check_sample(void) {
+    TEST_ASSERT_EQUAL_HEX32(0x000e, access_policy_restricted());
+
+    // Window edges are inclusive at the start and exclusive at the end
+    TEST_ASSERT_FALSE(access_policy_allows_at(1, local(MON, 7, 55)));
+    TEST_ASSERT_TRUE(access_policy_allows_at(1, local(MON, 8, 0)));
+    TEST_ASSERT_TRUE(access_policy_allows_at(1, local(FRI, 16, 55)));
+    TEST_ASSERT_FALSE(access_policy_allows_at(1, local(FRI, 17, 0)));
+    TEST_ASSERT_TRUE(access_policy_allows_at(1, local(SAT, 11, 55)));
+    TEST_ASSERT_FALSE(access_policy_allows_at(1, local(SAT, 12, 0)));
+    TEST_ASSERT_FALSE(access_policy_allows_at(1, local(SUN, 10, 0)));
+
+    // Past midnight, and from Sunday night into Monday across the end of the week
+    TEST_ASSERT_TRUE(access_policy_allows_at(2, local(WED, 23, 0)));
+    TEST_ASSERT_TRUE(access_policy_allows_at(2, local(THU, 5, 55)));
+    TEST_ASSERT_FALSE(access_policy_allows_at(2, local(THU, 6, 0)));
+    TEST_ASSERT_TRUE(access_policy_allows_at(2, local(SUN, 23, 30)));
+    TEST_ASSERT_TRUE(access_policy_allows_at(2, local(MON, 0, 30)));
+    TEST_ASSERT_TRUE(access_policy_allows_at(2, local(MON, 0, 30) + 7 * 86400LL));
+    TEST_ASSERT_FALSE(access_policy_allows_at(2, local(TUE, 12, 0)));
+
+    TEST_ASSERT_FALSE(access_policy_allows_at(3, local(TUE, 12, 0)));
+    TEST_ASSERT_TRUE(access_policy_allows_at(4, local(TUE, 12, 0)));
+    TEST_ASSERT_FALSE(access_policy_allows_at(ACCESS_SCHEDULE_COUNT, local(TUE, 12, 0)));
+
+    // Without a wall clock only schedules open around the clock pass
+    TEST_ASSERT_TRUE(access_policy_allows_at(0, -1));
+    TEST_ASSERT_TRUE(access_policy_allows_at(4, -1));
+    TEST_ASSERT_FALSE(access_policy_allows_at(1, -1));
+    TEST_ASSERT_FALSE(access_policy_allows_at(2, -1));
+}
+
+TEST_CASE("a policy opens each schedule exactly in its windows", "[access_policy]") {
+    policy_start();
+    check_sample();
+}
+
+TEST_CASE("a bad policy is rejected and the active one kept, also across a restart", "[access_policy]") {
+    static const char bad[] = "tz +01:00\n1 mon-fri 08:00-17:00\n1 someday 08:00-12:00\n";
+    int error_line;
+
+    policy_start();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, access_policy_update(bad, strlen(bad), &error_line));
+    TEST_ASSERT_EQUAL(3, error_line);
+    check_sample();
+
+    TEST_ASSERT_EQUAL(ESP_OK, access_policy_init());
+    check_sample();
+}
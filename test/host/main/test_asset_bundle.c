@@ -0,0 +1,101 @@
+/*
+ * 📦 Asset bundle tests: perfect-hash lookups in images of 1, 50 and 500 assets 🧪
+ *
+ * The images are made at build time with `gen_assets.py --synthetic N`.
+ * Besides checking that every page is found, the lookup case checks that
+ * the perfect hash gives every path a slot of its own, so a lookup is one
+ * hash, one displacement read and one compare at any size, and prints the
+ * time per lookup in each image.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "asset_bundle.h"
+#include "perfect_hash.h"
+#include "lock_hal.h"
+
+#define BENCH_MAX_ASSETS 500
+#define BENCH_LOOKUPS    1000000
+
+extern const uint8_t test_assets_1[];
+extern const size_t test_assets_1_size;
+extern const uint8_t test_assets_50[];
+extern const size_t test_assets_50_size;
+extern const uint8_t test_assets_500[];
+extern const size_t test_assets_500_size;
+
+static const struct {
+    const uint8_t *image;
+    const size_t *size;
+    int count;
+} bundles[] = {
+    { test_assets_1, &test_assets_1_size, 1 },
+    { test_assets_50, &test_assets_50_size, 50 },
+    { test_assets_500, &test_assets_500_size, BENCH_MAX_ASSETS },
+};
+
+/* Paths of the synthetic pages, as gen_assets.py names them */
+static char paths[BENCH_MAX_ASSETS][20];
+
+static void make_paths(void) {
+    for (int i = 0; i < BENCH_MAX_ASSETS; i++) {
+        snprintf(paths[i], sizeof(paths[i]), "/page-%05d.html", i);
+    }
+}
+
+TEST_CASE("every asset is found and other paths are not", "[asset_bundle]") {
+    asset_bundle_t bundle;
+    asset_t asset;
+
+    make_paths();
+    for (size_t b = 0; b < sizeof(bundles) / sizeof(bundles[0]); b++) {
+        TEST_ASSERT_EQUAL(ESP_OK, asset_bundle_open(&bundle, bundles[b].image, *bundles[b].size));
+        TEST_ASSERT_EQUAL(bundles[b].count, bundle.count);
+        for (int i = 0; i < bundles[b].count; i++) {
+            TEST_ASSERT_TRUE(asset_bundle_find(&bundle, paths[i], strlen(paths[i]), &asset));
+            TEST_ASSERT_EQUAL_STRING(paths[i], asset.path);
+            TEST_ASSERT_EQUAL_STRING("text/html", asset.mime);
+            TEST_ASSERT_GREATER_THAN(0, asset.len);
+        }
+        // A page past the last one, a prefix of a page and a path differing in its last character
+        TEST_ASSERT_FALSE(asset_bundle_find(&bundle, "/page-99999.html", 16, &asset));
+        TEST_ASSERT_FALSE(asset_bundle_find(&bundle, paths[0], strlen(paths[0]) - 1, &asset));
+        TEST_ASSERT_FALSE(asset_bundle_find(&bundle, "/page-00000.htmx", 16, &asset));
+    }
+}
+
+TEST_CASE("every lookup reads one bucket and one entry", "[asset_bundle]") {
+    asset_bundle_t bundle;
+    asset_t asset;
+    static bool taken[BENCH_MAX_ASSETS];
+
+    make_paths();
+    for (size_t b = 0; b < sizeof(bundles) / sizeof(bundles[0]); b++) {
+        TEST_ASSERT_EQUAL(ESP_OK, asset_bundle_open(&bundle, bundles[b].image, *bundles[b].size));
+        int count = bundles[b].count;
+        size_t path_len = strlen(paths[0]);
+
+        // The one probe of every path lands on a slot of its own, so no lookup needs a second one
+        memset(taken, 0, sizeof(taken));
+        for (int i = 0; i < count; i++) {
+            uint32_t h = perfect_hash_key(paths[i], path_len, bundle.seed);
+            uint32_t slot = perfect_hash_slot(h, bundle.buckets, bundle.bucket_mask, bundle.count);
+            TEST_ASSERT_LESS_THAN(count, slot);
+            TEST_ASSERT_FALSE_MESSAGE(taken[slot], paths[i]);
+            taken[slot] = true;
+        }
+
+        // Timing depends on the machine, so it is reported, not checked
+        int found = 0;
+        int next = 0;
+        int64_t start = lock_hal_time_us();
+        for (int i = 0; i < BENCH_LOOKUPS; i++) {
+            found += asset_bundle_find(&bundle, paths[next], path_len, &asset);
+            next = next + 1 < count ? next + 1 : 0;
+        }
+        int64_t ns = (lock_hal_time_us() - start) * 1000 / BENCH_LOOKUPS;
+        TEST_ASSERT_EQUAL(BENCH_LOOKUPS, found);
+        printf("%3d assets: %lld ns per lookup\n", count, (long long)ns);
+    }
+}
@@ -0,0 +1,96 @@
+/*
+ * 🗄️ Asset store tests: uploads into the A/B partitions, pinned images 🧪
+ *
+ * The images are the synthetic ones of test_asset_bundle.c; the one-page
+ * image doubles as the built-in fallback. A bundle is held between
+ * asset_store_acquire() and asset_store_release() the way asset_get_handler()
+ * holds it for a chunked send.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "mbedtls/sha256.h"
+#include "asset_store.h"
+
+/* Upload piece size: like httpd_req_recv() results, not aligned to flash sectors */
+#define TEST_UPLOAD_CHUNK 1000
+
+extern const uint8_t test_assets_1[];
+extern const size_t test_assets_1_size;
+extern const uint8_t test_assets_50[];
+extern const size_t test_assets_50_size;
+extern const uint8_t test_assets_500[];
+extern const size_t test_assets_500_size;
+
+static esp_err_t upload(const uint8_t *image, size_t size) {
+    uint8_t sha[32];
+
+    TEST_ASSERT_EQUAL(0, mbedtls_sha256(image, size, sha, 0));
+    esp_err_t err = asset_store_upload_begin(size, sha);
+    if (err != ESP_OK) {
+        return err;
+    }
+    for (size_t off = 0; off < size; off += TEST_UPLOAD_CHUNK) {
+        size_t n = size - off < TEST_UPLOAD_CHUNK ? size - off : TEST_UPLOAD_CHUNK;
+        TEST_ASSERT_EQUAL(ESP_OK, asset_store_upload_write(image + off, n));
+    }
+    return asset_store_upload_finish();
+}
+
+/**
+ * @brief Returns the number of assets served right now.
+ */
+static unsigned served_count(void) {
+    const asset_bundle_t *bundle = asset_store_acquire();
+    unsigned count = bundle->count;
+    asset_store_release(bundle);
+    return count;
+}
+
+/**
+ * @brief Checks that every page of a synthetic bundle can still be read.
+ */
+static void check_pages(const asset_bundle_t *bundle, int count) {
+    char path[20];
+    asset_t asset;
+
+    for (int i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "/page-%05d.html", i);
+        TEST_ASSERT_TRUE(asset_bundle_find(bundle, path, strlen(path), &asset));
+        TEST_ASSERT_EQUAL_STRING(path, asset.path);
+    }
+}
+
+TEST_CASE("an uploaded image is served from the next request on", "[asset_store]") {
+    TEST_ASSERT_EQUAL(ESP_OK, asset_store_init(test_assets_1, test_assets_1_size));
+
+    TEST_ASSERT_EQUAL(ESP_OK, upload(test_assets_50, test_assets_50_size));
+    TEST_ASSERT_EQUAL(50, served_count());
+    TEST_ASSERT_EQUAL(ESP_OK, upload(test_assets_500, test_assets_500_size));
+    TEST_ASSERT_EQUAL(500, served_count());
+
+    // A restart serves the newest upload, not the older image in the other slot
+    TEST_ASSERT_EQUAL(ESP_OK, asset_store_init(test_assets_1, test_assets_1_size));
+    TEST_ASSERT_EQUAL(500, served_count());
+}
+
+TEST_CASE("an image still being sent is not overwritten by the next upload", "[asset_store]") {
+    TEST_ASSERT_EQUAL(ESP_OK, asset_store_init(test_assets_1, test_assets_1_size));
+    TEST_ASSERT_EQUAL(ESP_OK, upload(test_assets_50, test_assets_50_size));
+
+    // A send from the 50-page image is in flight while a new image replaces it
+    const asset_bundle_t *sending = asset_store_acquire();
+    TEST_ASSERT_EQUAL(50, sending->count);
+    TEST_ASSERT_EQUAL(ESP_OK, upload(test_assets_500, test_assets_500_size));
+    TEST_ASSERT_EQUAL(500, served_count());
+
+    // The next upload would erase the slot the send reads from
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, upload(test_assets_50, test_assets_50_size));
+    check_pages(sending, 50);
+    TEST_ASSERT_EQUAL(500, served_count());
+
+    asset_store_release(sending);
+    TEST_ASSERT_EQUAL(ESP_OK, upload(test_assets_50, test_assets_50_size));
+    TEST_ASSERT_EQUAL(50, served_count());
+}
@@ -0,0 +1,217 @@
+/*
+ * 🧾 Audit log tests: records read back, range queries, ring wrap-around 🧪
+ *
+ * The cases run against the audit partition of partitions.csv. Each record
+ * carries a test tag and its own index in the client address, so the full
+ * log can be matched against what was recorded. Range queries are checked
+ * by brute force: every range must return exactly the records of a full
+ * query whose time falls into it, in the same order.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "audit_log.h"
+#include "lock_hal.h"
+
+/* The writer queue holds 32 records; batches stay below that, so none is dropped */
+#define TEST_AUDIT_BATCH     16
+
+/* More than the 1024 pages of the audit partition hold at about 16 records a page.
+ * At least 12 fit a page, so the ring keeps that many from all but one sector. */
+#define TEST_AUDIT_WRAP      20000
+#define TEST_AUDIT_KEPT_MIN  ((1024 - 16) * 12)
+
+/* Records seen by one poll of the writer: a sector and a batch */
+#define TEST_AUDIT_RECENT    1024
+
+#define TEST_AUDIT_RANGES    200
+
+/* Every code a record can hold: 4 bits of event, 2 of channel, named or not yet */
+#define TEST_AUDIT_EVENT_CODES   16
+#define TEST_AUDIT_CHANNEL_CODES 4
+
+#define TAG_ORDER            0x51
+#define TAG_WRAP             0x52
+
+typedef struct {
+    audit_record_t *recs;
+    size_t cap;
+    size_t count;
+} collect_t;
+
+/* Records of a full query; the ring holds fewer than TEST_AUDIT_WRAP */
+static audit_record_t everything[TEST_AUDIT_WRAP];
+static audit_record_t in_range[TEST_AUDIT_WRAP];
+
+static void audit_start(void) {
+    static bool started;
+    if (!started) {
+        TEST_ASSERT_EQUAL(ESP_OK, audit_log_init());
+        started = true;
+    }
+}
+
+/**
+ * @brief Makes the client address of record `index` of a case: IPv4-mapped or IPv6.
+ */
+static void make_addr(uint8_t addr[AUDIT_ADDR_LEN], uint8_t tag, uint32_t index, bool v4) {
+    memset(addr, 0, AUDIT_ADDR_LEN);
+    if (v4) {
+        addr[10] = addr[11] = 0xff;
+        addr[12] = tag;
+    } else {
+        addr[0] = 0x20;
+        addr[1] = 0x01;
+        addr[2] = 0x0d;
+        addr[3] = 0xb8;
+        addr[4] = tag;
+        addr[12] = (uint8_t)(index >> 24);
+    }
+    addr[13] = (uint8_t)(index >> 16);
+    addr[14] = (uint8_t)(index >> 8);
+    addr[15] = (uint8_t)index;
+}
+
+static uint8_t addr_tag(const uint8_t addr[AUDIT_ADDR_LEN]) {
+    return addr[0] == 0x20 ? addr[4] : addr[12];
+}
+
+static uint32_t addr_index(const uint8_t addr[AUDIT_ADDR_LEN]) {
+    uint32_t index = addr[0] == 0x20 ? addr[12] : 0;
+    return index << 24 | (uint32_t)addr[13] << 16 | (uint32_t)addr[14] << 8 | addr[15];
+}
+
+static esp_err_t collect(void *ctx, const audit_record_t *rec) {
+    collect_t *c = ctx;
+    if (c->count < c->cap) {
+        c->recs[c->count] = *rec;
+    }
+    c->count++;
+    return ESP_OK;
+}
+
+static size_t query(uint64_t from_ms, uint64_t to_ms, audit_record_t *recs, size_t cap) {
+    collect_t c = { recs, cap, 0 };
+    TEST_ASSERT_EQUAL(ESP_OK, audit_log_query(from_ms, to_ms, collect, &c));
+    TEST_ASSERT_TRUE(c.count <= cap);
+    return c.count;
+}
+
+/**
+ * @brief Waits until the writer task has taken the record with the given address.
+ */
+static void wait_written(uint64_t since_ms, const uint8_t addr[AUDIT_ADDR_LEN]) {
+    static audit_record_t recent[TEST_AUDIT_RECENT];
+    int64_t deadline = lock_hal_time_us() + 5 * 1000 * 1000;
+    for (;;) {
+        size_t n = query(since_ms, UINT64_MAX, recent, TEST_AUDIT_RECENT);
+        if (n && memcmp(recent[n - 1].addr, addr, AUDIT_ADDR_LEN) == 0) {
+            return;
+        }
+        TEST_ASSERT_TRUE_MESSAGE(lock_hal_time_us() < deadline, "audit writer did not catch up");
+        taskYIELD();
+    }
+}
+
+/**
+ * @brief Records `count` records of a case, `step_ms` apart on the audit clock.
+ *
+ * A step of 0 leaves records of the same batch with the same time.
+ */
+static void record_batch(uint8_t tag, uint32_t first, uint32_t count, int64_t step_ms) {
+    uint8_t addr[AUDIT_ADDR_LEN];
+    for (uint32_t done = 0; done < count;) {
+        uint64_t since_ms = audit_log_now_ms();
+        uint32_t n = count - done < TEST_AUDIT_BATCH ? count - done : TEST_AUDIT_BATCH;
+        for (uint32_t i = first + done; i < first + done + n; i++) {
+            make_addr(addr, tag, i, i % 3 == 0);
+            audit_log_record((audit_event_t)(i % TEST_AUDIT_EVENT_CODES),
+                             (audit_channel_t)(i % TEST_AUDIT_CHANNEL_CODES), addr);
+            lock_hal_advance_time_us(step_ms * 1000);
+        }
+        wait_written(since_ms, addr);
+        done += n;
+    }
+}
+
+/**
+ * @brief Checks that the records of one case in `recs` are first..last, in order.
+ *
+ * @return Records of the case.
+ */
+static uint32_t check_sequence(const audit_record_t *recs, size_t n, uint8_t tag, uint32_t first, uint32_t last) {
+    uint8_t addr[AUDIT_ADDR_LEN];
+    uint32_t next = first;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0) {
+            TEST_ASSERT_TRUE(recs[i].time_ms >= recs[i - 1].time_ms);
+        }
+        if (addr_tag(recs[i].addr) != tag) {
+            continue;
+        }
+        make_addr(addr, tag, next, next % 3 == 0);
+        TEST_ASSERT_EQUAL_MEMORY(addr, recs[i].addr, AUDIT_ADDR_LEN);
+        TEST_ASSERT_EQUAL(next % TEST_AUDIT_EVENT_CODES, recs[i].event);
+        TEST_ASSERT_EQUAL(next % TEST_AUDIT_CHANNEL_CODES, recs[i].channel);
+        next++;
+    }
+    TEST_ASSERT_EQUAL(last + 1, next);
+    return next - first;
+}
+
+/**
+ * @brief Compares random range queries with the matching slice of a full query.
+ */
+static void check_ranges(const audit_record_t *all, size_t n) {
+    srand(n);
+    for (int r = 0; r < TEST_AUDIT_RANGES; r++) {
+        size_t a = rand() % n;
+        size_t b = a + rand() % (n - a);
+        uint64_t from_ms = all[a].time_ms - (r & 1);
+        uint64_t to_ms = all[b].time_ms + (r & 2 ? 1 : 0);
+        size_t lo = 0;
+        size_t hi = 0;
+        while (lo < n && all[lo].time_ms < from_ms) {
+            lo++;
+        }
+        for (hi = lo; hi < n && all[hi].time_ms <= to_ms; hi++) {
+        }
+
+        size_t got = query(from_ms, to_ms, in_range, TEST_AUDIT_WRAP);
+        TEST_ASSERT_EQUAL(hi - lo, got);
+        TEST_ASSERT_EQUAL_MEMORY(&all[lo], in_range, got * sizeof(audit_record_t));
+    }
+    // Before the oldest record and after the newest
+    TEST_ASSERT_EQUAL(0, query(0, all[0].time_ms - 1, in_range, TEST_AUDIT_WRAP));
+    TEST_ASSERT_EQUAL(0, query(all[n - 1].time_ms + 1, UINT64_MAX, in_range, TEST_AUDIT_WRAP));
+}
+
+TEST_CASE("records read back in order and ranges return exactly their records", "[audit_log]") {
+    audit_start();
+    // Bursts within one millisecond, and steps between them
+    for (uint32_t i = 0; i < 600; i += 40) {
+        record_batch(TAG_ORDER, i, 40, (i / 40) % 3 == 0 ? 0 : 7);
+    }
+
+    size_t n = query(0, UINT64_MAX, everything, TEST_AUDIT_WRAP);
+    TEST_ASSERT_EQUAL(600, check_sequence(everything, n, TAG_ORDER, 0, 599));
+    check_ranges(everything, n);
+}
+
+TEST_CASE("a wrapped ring keeps the newest records", "[audit_log]") {
+    audit_start();
+    record_batch(TAG_WRAP, 0, TEST_AUDIT_WRAP, 100);
+
+    size_t n = query(0, UINT64_MAX, everything, TEST_AUDIT_WRAP);
+    TEST_ASSERT_TRUE(n < TEST_AUDIT_WRAP);
+    TEST_ASSERT_TRUE(n >= TEST_AUDIT_KEPT_MIN);
+    // The oldest records are gone; the rest run without a gap to the newest
+    uint32_t oldest = addr_index(everything[0].addr);
+    TEST_ASSERT_EQUAL(TAG_WRAP, addr_tag(everything[0].addr));
+    TEST_ASSERT_TRUE(oldest > 0);
+    TEST_ASSERT_EQUAL(n, check_sequence(everything, n, TAG_WRAP, oldest, TEST_AUDIT_WRAP - 1));
+    check_ranges(everything, n);
+}
@@ -0,0 +1,135 @@
+/*
+ * 🎲 Challenge store tests: many phones unlocking at once 🧪
+ *
+ * With a single global challenge, a second GET /challenge overwrote the
+ * first and one of two phones always failed. Here 32 clients hold
+ * challenges at the same time, answered in a different order than issued,
+ * and 32 tasks run challenge flows against the store concurrently. A client
+ * asking for challenges in a loop only pushes out the oldest ones.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "challenge_store.h"
+#include "lock_hal.h"
+#include "nonce_pool.h"
+#include "test_fixtures.h"
+
+#define STRESS_CLIENTS          32
+#define STRESS_FLOWS_PER_CLIENT 2000
+
+/* Challenges asked for in a row by one client, more than the store holds */
+#define STRESS_FLOOD            200
+
+/* Longer than the challenge lifetime */
+#define STRESS_EXPIRE_US        (31LL * 1000 * 1000)
+
+/* Outcome of the concurrent case, summed over all client tasks */
+static uint32_t stress_consumed;
+static uint32_t stress_failed;
+static SemaphoreHandle_t stress_done;
+
+TEST_CASE("32 interleaved clients each answer their own challenge", "[challenge_store]") {
+    char nonces[STRESS_CLIENTS][CHALLENGE_NONCE_MAX_LEN + 1];
+
+    test_fixture_challenges();
+    for (int i = 0; i < STRESS_CLIENTS; i++) {
+        nonce_pool_take(nonces[i]);
+        TEST_ASSERT_EQUAL(ESP_OK, challenge_store_put(nonces[i]));
+    }
+    // Every client answers after all others were issued a challenge, in another order
+    for (int i = 0; i < STRESS_CLIENTS; i++) {
+        int client = (i * 7 + 3) % STRESS_CLIENTS;
+        TEST_ASSERT_TRUE(challenge_store_consume(nonces[client]));
+    }
+    for (int i = 0; i < STRESS_CLIENTS; i++) {
+        TEST_ASSERT_FALSE(challenge_store_consume(nonces[i]));
+    }
+}
+
+/**
+ * @brief One client: issue a challenge, give the others a turn, answer it.
+ */
+static void stress_client_task(void *arg) {
+    char nonce[CHALLENGE_NONCE_MAX_LEN + 1];
+    uint32_t consumed = 0;
+    uint32_t failed = 0;
+
+    for (int i = 0; i < STRESS_FLOWS_PER_CLIENT; i++) {
+        nonce_pool_take(nonce);
+        if (challenge_store_put(nonce) != ESP_OK) {
+            failed++;
+            continue;
+        }
+        taskYIELD();
+        if (challenge_store_consume(nonce)) {
+            consumed++;
+        } else {
+            failed++;
+        }
+    }
+    __atomic_fetch_add(&stress_consumed, consumed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stress_failed, failed, __ATOMIC_RELAXED);
+    xSemaphoreGive(stress_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("32 concurrent clients never lose a challenge", "[challenge_store]") {
+    test_fixture_challenges();
+    stress_consumed = 0;
+    stress_failed = 0;
+    stress_done = xSemaphoreCreateCounting(STRESS_CLIENTS, 0);
+    TEST_ASSERT_NOT_NULL(stress_done);
+
+    int64_t start = lock_hal_time_us();
+    for (int i = 0; i < STRESS_CLIENTS; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "client%d", i);
+        TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(stress_client_task, name, 4096, NULL, tskIDLE_PRIORITY + 1, NULL));
+    }
+    for (int i = 0; i < STRESS_CLIENTS; i++) {
+        TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(stress_done, pdMS_TO_TICKS(60000)));
+    }
+    int64_t elapsed_us = lock_hal_time_us() - start;
+    vSemaphoreDelete(stress_done);
+
+    printf("%d clients: %lu challenges answered, %lu lost, in %lld ms\n", STRESS_CLIENTS,
+           (unsigned long)stress_consumed, (unsigned long)stress_failed, (long long)elapsed_us / 1000);
+    TEST_ASSERT_EQUAL(0, stress_failed);
+    TEST_ASSERT_EQUAL(STRESS_CLIENTS * STRESS_FLOWS_PER_CLIENT, stress_consumed);
+}
+
+TEST_CASE("challenges expire, and a full store drops the oldest", "[challenge_store]") {
+    char nonces[STRESS_FLOOD][CHALLENGE_NONCE_MAX_LEN + 1];
+
+    test_fixture_challenges();
+    nonce_pool_take(nonces[0]);
+    TEST_ASSERT_EQUAL(ESP_OK, challenge_store_put(nonces[0]));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, challenge_store_put(nonces[0]));
+
+    // One client asks for far more challenges than the store holds, one millisecond apart
+    uint32_t evicted = challenge_store_evicted();
+    for (int i = 1; i < STRESS_FLOOD; i++) {
+        lock_hal_advance_time_us(1000);
+        nonce_pool_take(nonces[i]);
+        TEST_ASSERT_EQUAL(ESP_OK, challenge_store_put(nonces[i]));
+    }
+    uint32_t dropped = challenge_store_evicted() - evicted;
+    TEST_ASSERT_TRUE(dropped > 0);
+    TEST_ASSERT_TRUE(dropped < STRESS_FLOOD);
+
+    // The oldest made room; the rest are still outstanding
+    for (uint32_t i = 0; i < dropped; i++) {
+        TEST_ASSERT_FALSE(challenge_store_consume(nonces[i]));
+    }
+    TEST_ASSERT_TRUE(challenge_store_consume(nonces[STRESS_FLOOD - 1]));
+    TEST_ASSERT_TRUE(challenge_store_consume(nonces[dropped]));
+
+    lock_hal_advance_time_us(STRESS_EXPIRE_US);
+    TEST_ASSERT_FALSE(challenge_store_consume(nonces[dropped + 1]));
+    TEST_ASSERT_EQUAL(STRESS_FLOOD - dropped - 3, challenge_store_reap());
+}
@@ -0,0 +1,159 @@
+/*
+ * ⚙️ Config store tests: partial updates, rejection, persistence 🧪
+ *
+ * Every case starts from the menuconfig defaults with nothing stored, and
+ * calls config_store_init() again to see what the next boot would load.
+ * Before each update the virtual clock skips one grace period, so updates
+ * never wait for a replaced snapshot to fall out of use.
+ */
+
+#include <string.h>
+#include "unity.h"
+#include "nvs.h"
+#include "config_store.h"
+#include "lock_hal.h"
+
+/* NVS namespace of the config store */
+#define TEST_CONFIG_NAMESPACE "lock_cfg"
+
+#define TEST_GRACE_US         ((int64_t)CONFIG_STORE_GRACE_MS * 1000)
+
+/**
+ * @brief Forgets the stored settings and loads the defaults.
+ */
+static void reset_to_defaults(void) {
+    nvs_handle_t nvs;
+
+    TEST_ASSERT_EQUAL(ESP_OK, lock_hal_storage_init());
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_open(TEST_CONFIG_NAMESPACE, NVS_READWRITE, &nvs));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_erase_all(nvs));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_commit(nvs));
+    nvs_close(nvs);
+    TEST_ASSERT_EQUAL(ESP_OK, config_store_init());
+}
+
+static esp_err_t update(const char *text, int *error_line, uint32_t *changed) {
+    lock_hal_advance_time_us(TEST_GRACE_US);
+    return config_store_update(text, strlen(text), error_line, changed);
+}
+
+TEST_CASE("an update changes only the settings it names", "[config_store]") {
+    int line;
+    uint32_t changed;
+
+    reset_to_defaults();
+    TEST_ASSERT_EQUAL(0, config_store_get()->generation);
+
+    TEST_ASSERT_EQUAL(ESP_OK, update("bad_token_ms=1500\n", &line, &changed));
+    TEST_ASSERT_EQUAL(CONFIG_STORE_CHANGED_LOCK, changed);
+    TEST_ASSERT_EQUAL(1500, config_store_get()->bad_token_ms);
+    TEST_ASSERT_EQUAL_STRING(CONFIG_LOCK_AP_SSID, config_store_get()->ap_ssid);
+    TEST_ASSERT_EQUAL(1, config_store_get()->generation);
+
+    // CRLF line ends, a comment and a blank line
+    TEST_ASSERT_EQUAL(ESP_OK, update("ap_ssid=Front door\r\n# new network\n\nap_password=correct horse\n", &line,
+                                     &changed));
+    TEST_ASSERT_EQUAL(CONFIG_STORE_CHANGED_NET, changed);
+    TEST_ASSERT_EQUAL_STRING("Front door", config_store_get()->ap_ssid);
+    TEST_ASSERT_EQUAL_STRING("correct horse", config_store_get()->ap_password);
+
+    TEST_ASSERT_EQUAL(ESP_OK, update("psk=another key", &line, &changed));
+    TEST_ASSERT_EQUAL(CONFIG_STORE_CHANGED_AUTH, changed);
+    TEST_ASSERT_EQUAL_STRING("another key", config_store_get()->psk);
+    TEST_ASSERT_EQUAL(3, config_store_get()->generation);
+
+    // The same values again: nothing changes, no new generation
+    TEST_ASSERT_EQUAL(ESP_OK, update("bad_token_ms=1500\nap_ssid=Front door\n", &line, &changed));
+    TEST_ASSERT_EQUAL(0, changed);
+    TEST_ASSERT_EQUAL(3, config_store_get()->generation);
+
+    // The next boot starts from the stored values
+    TEST_ASSERT_EQUAL(ESP_OK, config_store_init());
+    TEST_ASSERT_EQUAL(1500, config_store_get()->bad_token_ms);
+    TEST_ASSERT_EQUAL_STRING("Front door", config_store_get()->ap_ssid);
+    TEST_ASSERT_EQUAL_STRING("correct horse", config_store_get()->ap_password);
+    TEST_ASSERT_EQUAL_STRING("another key", config_store_get()->psk);
+}
+
+TEST_CASE("an update with a bad line changes nothing", "[config_store]") {
+    static const struct {
+        const char *text;
+        esp_err_t err;
+        int line;
+    } bad[] = {
+        { "bad_token_ms=2000\nno_such_setting=1\n", ESP_ERR_NOT_FOUND, 2 },
+        { "ap_ssid=Back door\nap_password=short\n", ESP_ERR_INVALID_ARG, 2 },
+        { "bad_token_ms=99\n", ESP_ERR_INVALID_ARG, 1 },
+        { "bad_token_ms=1500ms\n", ESP_ERR_INVALID_ARG, 1 },
+        { "# comment\nbad_token_ms=4294967296\n", ESP_ERR_INVALID_ARG, 2 },
+        { "led_gpio=49\n", ESP_ERR_INVALID_ARG, 1 },
+        { "ap_ssid=\n", ESP_ERR_INVALID_ARG, 1 },
+        { "bad_token_ms=2000\npsk\n", ESP_ERR_INVALID_ARG, 2 },
+    };
+    char big[CONFIG_STORE_TEXT_MAX_LEN + 2];
+    int line;
+    uint32_t changed;
+
+    reset_to_defaults();
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        TEST_ASSERT_EQUAL_MESSAGE(bad[i].err, update(bad[i].text, &line, &changed), bad[i].text);
+        TEST_ASSERT_EQUAL_MESSAGE(bad[i].line, line, bad[i].text);
+        TEST_ASSERT_EQUAL(0, changed);
+    }
+    memset(big, '#', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, update(big, &line, &changed));
+
+    TEST_ASSERT_EQUAL(0, config_store_get()->generation);
+    TEST_ASSERT_EQUAL(CONFIG_LOCK_BAD_TOKEN_MS, config_store_get()->bad_token_ms);
+    TEST_ASSERT_EQUAL_STRING(CONFIG_LOCK_AP_SSID, config_store_get()->ap_ssid);
+    TEST_ASSERT_EQUAL(CONFIG_BLINK_GPIO, config_store_get()->led_gpio);
+}
+
+TEST_CASE("a new led_gpio is stored once the LED confirms it", "[config_store]") {
+    uint32_t gpio = CONFIG_BLINK_GPIO == 5 ? 6 : 5;
+    uint32_t stored;
+    nvs_handle_t nvs;
+    int line;
+    uint32_t changed;
+
+    reset_to_defaults();
+    TEST_ASSERT_EQUAL(ESP_OK, update(gpio == 5 ? "led_gpio=5" : "led_gpio=6", &line, &changed));
+    TEST_ASSERT_EQUAL(CONFIG_STORE_CHANGED_LED, changed);
+    TEST_ASSERT_EQUAL(gpio, config_store_get()->led_gpio);
+
+    // Active, but a reboot before the LED came up goes back to the previous pin
+    TEST_ASSERT_EQUAL(ESP_OK, config_store_init());
+    TEST_ASSERT_EQUAL(CONFIG_BLINK_GPIO, config_store_get()->led_gpio);
+
+    TEST_ASSERT_EQUAL(ESP_OK, config_store_confirm_led_gpio(gpio));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_open(TEST_CONFIG_NAMESPACE, NVS_READONLY, &nvs));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_get_u32(nvs, "led_gpio", &stored));
+    nvs_close(nvs);
+    TEST_ASSERT_EQUAL(gpio, stored);
+    TEST_ASSERT_EQUAL(ESP_OK, config_store_init());
+    TEST_ASSERT_EQUAL(gpio, config_store_get()->led_gpio);
+}
+
+TEST_CASE("the text form leaves out the secrets and reads back unchanged", "[config_store]") {
+    char text[CONFIG_STORE_TEXT_MAX_LEN];
+    int line;
+    uint32_t changed;
+
+    reset_to_defaults();
+    size_t len = config_store_format(text, sizeof(text));
+    TEST_ASSERT_EQUAL(strlen(text), len);
+    TEST_ASSERT_NOT_NULL(strstr(text, "# generation 0\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "ap_ssid=" CONFIG_LOCK_AP_SSID "\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "bad_token_ms="));
+    TEST_ASSERT_NULL(strstr(text, "ap_password"));
+    TEST_ASSERT_NULL(strstr(text, "psk"));
+    TEST_ASSERT_NULL(strstr(text, CONFIG_LOCK_PSK));
+
+    TEST_ASSERT_EQUAL(ESP_OK, config_store_update(text, len, &line, &changed));
+    TEST_ASSERT_EQUAL(0, changed);
+
+    // Truncated like snprintf()
+    TEST_ASSERT_EQUAL(7, config_store_format(text, 8));
+    TEST_ASSERT_EQUAL_STRING("# gener", text);
+}
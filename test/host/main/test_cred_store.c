@@ -0,0 +1,137 @@
+/*
+ * 🪪 Credential store tests: uploads into the A/B partitions, lookups 🧪
+ *
+ * The tables are made at build time with `tools/gen_creds.py --synthetic N`:
+ * credential `phone-<n>` signs with the secret `secret-phone-<n>`, so every
+ * key the store hands out can be checked against one prepared from the
+ * secret directly.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "mbedtls/sha256.h"
+#include "auth_hmac.h"
+#include "cred_store.h"
+
+#define TEST_CREDS       300
+
+/* Upload piece size: like httpd_req_recv() results, not aligned to flash sectors */
+#define TEST_UPLOAD_CHUNK 1000
+
+extern const uint8_t test_creds_0[];
+extern const size_t test_creds_0_size;
+extern const uint8_t test_creds_1[];
+extern const size_t test_creds_1_size;
+extern const uint8_t test_creds_300[];
+extern const size_t test_creds_300_size;
+
+static void creds_start(void) {
+    static bool started;
+    if (!started) {
+        TEST_ASSERT_EQUAL(ESP_OK, cred_store_init());
+        started = true;
+    }
+}
+
+/**
+ * @brief Streams a table image into the store the way PUT /credentials does.
+ *
+ * @param len Bytes written, which may differ from the size announced
+ * @param corrupt Announce a SHA-256 that does not match the image
+ * @return Result of cred_store_upload_finish().
+ */
+static esp_err_t upload(const uint8_t *image, size_t size, size_t len, bool corrupt) {
+    uint8_t sha[32];
+
+    TEST_ASSERT_EQUAL(0, mbedtls_sha256(image, size, sha, 0));
+    sha[0] ^= corrupt;
+    TEST_ASSERT_EQUAL(ESP_OK, cred_store_upload_begin(size, sha));
+    for (size_t off = 0; off < len; off += TEST_UPLOAD_CHUNK) {
+        size_t n = len - off < TEST_UPLOAD_CHUNK ? len - off : TEST_UPLOAD_CHUNK;
+        TEST_ASSERT_EQUAL(ESP_OK, cred_store_upload_write(image + off, n));
+    }
+    return cred_store_upload_finish();
+}
+
+/**
+ * @brief Checks that credential `index` is found and signs like its secret.
+ */
+static void check_credential(int index) {
+    static const char nonce[] = "0123456789abcdef0123456789abcdef";
+    char id[CRED_ID_MAX_LEN + 1];
+    char secret[CRED_ID_MAX_LEN + 8];
+    auth_hmac_key_t key;
+    auth_hmac_key_t expected_key;
+    uint8_t mac[AUTH_HMAC_LEN];
+    uint8_t expected[AUTH_HMAC_LEN];
+    uint8_t schedule = 0xff;
+
+    snprintf(id, sizeof(id), "phone-%05d", index);
+    snprintf(secret, sizeof(secret), "secret-%s", id);
+    TEST_ASSERT_EQUAL_MESSAGE(ESP_OK, cred_store_lookup(id, &key, &schedule), id);
+    TEST_ASSERT_EQUAL(0, schedule);
+    TEST_ASSERT_EQUAL(ESP_OK, auth_hmac_key_init(&expected_key, auth_hmac_backend_sw, (const uint8_t *)secret,
+                                                 strlen(secret)));
+    TEST_ASSERT_EQUAL(ESP_OK, auth_hmac_compute(&key, nonce, strlen(nonce), mac));
+    TEST_ASSERT_EQUAL(ESP_OK, auth_hmac_compute(&expected_key, nonce, strlen(nonce), expected));
+    TEST_ASSERT_EQUAL_MEMORY(expected, mac, AUTH_HMAC_LEN);
+}
+
+TEST_CASE("an uploaded table answers for every credential and only those", "[cred_store]") {
+    static const char *const unknown[] = { "phone-00300", "phone-0000", "phone-000000", "Phone-00000", "" };
+    auth_hmac_key_t key;
+    uint8_t schedule;
+
+    creds_start();
+    TEST_ASSERT_EQUAL(ESP_OK, upload(test_creds_300, test_creds_300_size, test_creds_300_size, false));
+    TEST_ASSERT_EQUAL(TEST_CREDS, cred_store_count());
+    for (int i = 0; i < TEST_CREDS; i++) {
+        check_credential(i);
+    }
+    for (size_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); i++) {
+        TEST_ASSERT_EQUAL_MESSAGE(ESP_ERR_NOT_FOUND, cred_store_lookup(unknown[i], &key, &schedule), unknown[i]);
+    }
+}
+
+TEST_CASE("a failed upload leaves the active table in place", "[cred_store]") {
+    uint8_t sha[32] = { 0 };
+
+    creds_start();
+    TEST_ASSERT_EQUAL(ESP_OK, upload(test_creds_1, test_creds_1_size, test_creds_1_size, false));
+    TEST_ASSERT_EQUAL(1, cred_store_count());
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, upload(test_creds_300, test_creds_300_size, test_creds_300_size, true));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE,
+                      upload(test_creds_300, test_creds_300_size, test_creds_300_size - 1, false));
+    TEST_ASSERT_EQUAL(1, cred_store_count());
+    check_credential(0);
+
+    // One upload at a time, and no more data than announced
+    TEST_ASSERT_EQUAL(ESP_OK, cred_store_upload_begin(4, sha));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, cred_store_upload_begin(4, sha));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, cred_store_upload_write(test_creds_1, 5));
+    cred_store_upload_abort();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, cred_store_upload_finish());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, cred_store_upload_begin(0, sha));
+    TEST_ASSERT_EQUAL(1, cred_store_count());
+    check_credential(0);
+}
+
+TEST_CASE("an empty table revokes every credential", "[cred_store]") {
+    auth_hmac_key_t key;
+    uint8_t schedule;
+
+    creds_start();
+    TEST_ASSERT_EQUAL(ESP_OK, upload(test_creds_1, test_creds_1_size, test_creds_1_size, false));
+    check_credential(0);
+    TEST_ASSERT_EQUAL(ESP_OK, upload(test_creds_0, test_creds_0_size, test_creds_0_size, false));
+    TEST_ASSERT_EQUAL(0, cred_store_count());
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, cred_store_lookup("phone-00000", &key, &schedule));
+
+    // Uploads alternate between the partitions; a restart picks the newest table
+    TEST_ASSERT_EQUAL(ESP_OK, upload(test_creds_300, test_creds_300_size, test_creds_300_size, false));
+    TEST_ASSERT_EQUAL(ESP_OK, cred_store_init());
+    TEST_ASSERT_EQUAL(TEST_CREDS, cred_store_count());
+    check_credential(TEST_CREDS - 1);
+}
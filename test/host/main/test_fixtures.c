@@ -0,0 +1,36 @@
+/*
+ * 🧰 Setup shared by the test cases, done once per run
+ */
+
+#include "test_fixtures.h"
+
+#include "unity.h"
+#include "challenge_store.h"
+#include "config_store.h"
+#include "lock_ctrl.h"
+#include "lock_hal.h"
+#include "nonce_pool.h"
+#include "state_store.h"
+#include "unlock_flow.h"
+
+void test_fixture_challenges(void) {
+    static bool ready;
+    if (!ready) {
+        TEST_ASSERT_EQUAL(ESP_OK, challenge_store_init());
+        TEST_ASSERT_EQUAL(ESP_OK, nonce_pool_start());
+        ready = true;
+    }
+}
+
+void test_fixture_lock(void) {
+    static bool ready;
+    test_fixture_challenges();
+    if (!ready) {
+        TEST_ASSERT_EQUAL(ESP_OK, lock_hal_storage_init());
+        TEST_ASSERT_EQUAL(ESP_OK, config_store_init());
+        TEST_ASSERT_EQUAL(ESP_OK, state_store_init());
+        TEST_ASSERT_EQUAL(ESP_OK, lock_ctrl_start());
+        unlock_flow_init();
+        ready = true;
+    }
+}
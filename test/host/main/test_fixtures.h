@@ -0,0 +1,20 @@
+/*
+ * 🧰 Setup shared by the test cases, done once per run
+ *
+ * The modules under test keep their state in statics and are started once
+ * at boot on the device, so the cases share one instance of each.
+ */
+#pragma once
+
+/**
+ * @brief Starts the challenge store and the nonce pool.
+ */
+void test_fixture_challenges(void);
+
+/**
+ * @brief Starts the challenges, the settings, the persisted state and the lock controller.
+ *
+ * The lock controller runs its task like on the device; its counters in the
+ * state store (see state_store.h) show which events it has handled.
+ */
+void test_fixture_lock(void);
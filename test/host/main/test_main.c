@@ -0,0 +1,22 @@
+/*
+ * 🧪 Unit tests of the lock core on the ESP-IDF linux target 🐧
+ *
+ * Runs every TEST_CASE linked in, or with LOCK_TEST_FILTER set only those
+ * carrying that tag, and exits with the number of failures.
+ */
+
+#include <stdlib.h>
+#include "unity.h"
+#include "unity_test_runner.h"
+
+void app_main(void) {
+    const char *filter = getenv("LOCK_TEST_FILTER");
+
+    UNITY_BEGIN();
+    if (filter) {
+        unity_run_tests_by_tag(filter, false);
+    } else {
+        unity_run_all_tests();
+    }
+    exit(UNITY_END());
+}
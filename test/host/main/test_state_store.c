@@ -0,0 +1,125 @@
+/*
+ * 💾 State store tests: write-back coalescing and restore after a reset 🧪
+ *
+ * The flash writes are counted through lock_state_nvs_writes_total in the
+ * export, the same figure /metrics shows. On the linux target the copy that
+ * survives warm resets is an ordinary static, so calling state_store_init()
+ * a second time in the process restores the state like a warm reset does.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "lock_hal.h"
+#include "state_store.h"
+
+#define STATE_WRITEBACK_US ((int64_t)CONFIG_LOCK_STATE_WRITEBACK_MS * 1000)
+
+typedef struct {
+    char text[1024];
+    size_t len;
+} export_buf_t;
+
+static esp_err_t export_append(void *ctx, const char *data, size_t len) {
+    export_buf_t *buf = ctx;
+    if (buf->len + len >= sizeof(buf->text)) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(buf->text + buf->len, data, len);
+    buf->len += len;
+    buf->text[buf->len] = '\0';
+    return ESP_OK;
+}
+
+/**
+ * @brief Returns the value of one metric from the export.
+ */
+static unsigned long export_value(const char *name) {
+    export_buf_t buf = { 0 };
+    char needle[64];
+    unsigned long value = 0;
+
+    TEST_ASSERT_EQUAL(ESP_OK, state_store_export(export_append, &buf));
+    snprintf(needle, sizeof(needle), "\n%s ", name);
+    const char *line = strstr(buf.text, needle);
+    TEST_ASSERT_NOT_NULL(line);
+    TEST_ASSERT_EQUAL(1, sscanf(line + strlen(needle), "%lu", &value));
+    return value;
+}
+
+TEST_CASE("a burst of changes costs one write-back", "[state_store]") {
+    state_store_data_t data;
+
+    TEST_ASSERT_EQUAL(ESP_OK, state_store_init());
+    TEST_ASSERT_EQUAL(ESP_OK, state_store_flush());
+    TEST_ASSERT_EQUAL(STATE_STORE_CLEAN, state_store_writeback_due_us());
+    unsigned long writes = export_value("lock_state_nvs_writes_total");
+
+    // Ten failures in a row, one second apart: the first arms the deadline, the rest leave it
+    state_store_get(&data);
+    int64_t due = STATE_STORE_CLEAN;
+    for (int i = 0; i < 10; i++) {
+        data.auth_failures++;
+        data.fail_streak++;
+        state_store_set(&data);
+        if (i == 0) {
+            due = state_store_writeback_due_us();
+            TEST_ASSERT_TRUE(due > lock_hal_time_us());
+            TEST_ASSERT_TRUE(due <= lock_hal_time_us() + STATE_WRITEBACK_US);
+        }
+        TEST_ASSERT_EQUAL_INT64(due, state_store_writeback_due_us());
+        lock_hal_advance_time_us(STATE_WRITEBACK_US / 10);
+    }
+    TEST_ASSERT_TRUE(lock_hal_time_us() >= due);
+
+    TEST_ASSERT_EQUAL(ESP_OK, state_store_flush());
+    TEST_ASSERT_EQUAL(STATE_STORE_CLEAN, state_store_writeback_due_us());
+    TEST_ASSERT_EQUAL(writes + 1, export_value("lock_state_nvs_writes_total"));
+
+    // Nothing changed since: no write
+    TEST_ASSERT_EQUAL(ESP_OK, state_store_flush());
+    TEST_ASSERT_EQUAL(writes + 1, export_value("lock_state_nvs_writes_total"));
+}
+
+TEST_CASE("relocking is written back at once", "[state_store]") {
+    state_store_data_t data;
+
+    TEST_ASSERT_EQUAL(ESP_OK, state_store_init());
+    state_store_get(&data);
+    data.open = true;
+    data.unlocks++;
+    data.fail_streak = 0;
+    state_store_set(&data);
+    TEST_ASSERT_TRUE(state_store_writeback_due_us() > lock_hal_time_us());
+
+    data.open = false;
+    state_store_set(&data);
+    TEST_ASSERT_TRUE(state_store_writeback_due_us() <= lock_hal_time_us());
+    TEST_ASSERT_EQUAL(ESP_OK, state_store_flush());
+    TEST_ASSERT_EQUAL(STATE_STORE_CLEAN, state_store_writeback_due_us());
+}
+
+TEST_CASE("a warm reset restores the state and counts the boot", "[state_store]") {
+    state_store_data_t before, after;
+
+    TEST_ASSERT_EQUAL(ESP_OK, state_store_init());
+    state_store_get(&before);
+    before.unlocks += 3;
+    before.open = true;
+    state_store_set(&before);
+    // Not flushed: only the retained copy has the change
+    TEST_ASSERT_TRUE(state_store_writeback_due_us() != STATE_STORE_CLEAN);
+
+    TEST_ASSERT_EQUAL(ESP_OK, state_store_init());
+    TEST_ASSERT_EQUAL(STATE_STORE_SOURCE_RTC, state_store_source());
+    state_store_get(&after);
+    TEST_ASSERT_EQUAL(before.unlocks, after.unlocks);
+    TEST_ASSERT_EQUAL(before.auth_failures, after.auth_failures);
+    TEST_ASSERT_TRUE(after.open);
+    TEST_ASSERT_EQUAL(before.boots + 1, after.boots);
+    TEST_ASSERT_EQUAL(after.boots, export_value("lock_boots_total"));
+
+    after.open = false;
+    state_store_set(&after);
+    TEST_ASSERT_EQUAL(ESP_OK, state_store_flush());
+}
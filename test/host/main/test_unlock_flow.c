@@ -0,0 +1,283 @@
+/*
+ * 🔓 Unlock flow tests: challenges, credentials, schedules, rate limit, lock events 🧪
+ *
+ * Runs the code behind GET /challenge, POST /response and POST /unlock (see
+ * unlock_flow.h) without the HTTP server: the test plays the phone, signing
+ * with the pre-shared key of the settings or a credential's secret, and
+ * checks the answer along with the events the lock controller handled.
+ * tools/e2e_test.sh runs the same flows over HTTP against the linux build of
+ * the firmware.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "mbedtls/sha256.h"
+#include "access_policy.h"
+#include "auth_hmac.h"
+#include "config_store.h"
+#include "cred_store.h"
+#include "lock_ctrl.h"
+#include "lock_hal.h"
+#include "state_store.h"
+#include "unlock_flow.h"
+#include "test_fixtures.h"
+
+/* Flows timed by the throughput case */
+#define UNLOCK_FLOWS           20000
+
+/* How long the lock controller may take to handle the events of a case */
+#define LOCK_EVENTS_WAIT_MS    2000
+
+/* Upload piece size for the credential table */
+#define TEST_UPLOAD_CHUNK      1000
+
+/* One credential, `phone-00000` with the secret `secret-phone-00000`, schedule 0 */
+extern const uint8_t test_creds_1[];
+extern const size_t test_creds_1_size;
+
+/**
+ * @brief Returns the address of test client n (192.0.2.n, IPv4-mapped).
+ */
+static const uint8_t *client(int n) {
+    static uint8_t addr[256][RATE_LIMIT_ADDR_LEN];
+    uint8_t *a = addr[n];
+    memset(a, 0, RATE_LIMIT_ADDR_LEN);
+    a[10] = a[11] = 0xff;
+    a[12] = 192;
+    a[14] = 2;
+    a[15] = n;
+    return a;
+}
+
+/**
+ * @brief Signs a message the way the web UI does: hex HMAC-SHA256.
+ */
+static void sign_with(const auth_hmac_key_t *key, const char *message, char token[AUTH_HMAC_HEX_LEN + 1]) {
+    uint8_t mac[AUTH_HMAC_LEN];
+    TEST_ASSERT_EQUAL(ESP_OK, auth_hmac_compute(key, message, strlen(message), mac));
+    for (size_t i = 0; i < AUTH_HMAC_LEN; i++) {
+        snprintf(token + 2 * i, 3, "%02x", mac[i]);
+    }
+}
+
+static void sign(const char *message, char token[AUTH_HMAC_HEX_LEN + 1]) {
+    sign_with(&config_store_get()->psk_key, message, token);
+}
+
+/**
+ * @brief Waits until the lock controller has handled exactly this many more events.
+ *
+ * @param before Counters taken with state_store_get() before the case posted anything
+ */
+static void expect_events(const state_store_data_t *before, uint32_t unlocks, uint32_t failures) {
+    state_store_data_t now;
+
+    for (int waited = 0; waited < LOCK_EVENTS_WAIT_MS; waited += 10) {
+        state_store_get(&now);
+        if (now.unlocks - before->unlocks >= unlocks && now.auth_failures - before->auth_failures >= failures) {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    TEST_ASSERT_EQUAL(unlocks, now.unlocks - before->unlocks);
+    TEST_ASSERT_EQUAL(failures, now.auth_failures - before->auth_failures);
+}
+
+TEST_CASE("a signed challenge unlocks once", "[unlock_flow]") {
+    char nonce[CHALLENGE_NONCE_MAX_LEN + 1];
+    char token[AUTH_HMAC_HEX_LEN + 1];
+    state_store_data_t before;
+
+    test_fixture_lock();
+    state_store_get(&before);
+    TEST_ASSERT_EQUAL(ESP_OK, unlock_flow_issue(nonce));
+    sign(nonce, token);
+    TEST_ASSERT_NULL(unlock_flow_verify(client(1), AUDIT_CH_HTTP, NULL, nonce, token));
+    expect_events(&before, 1, 0);
+    TEST_ASSERT_EQUAL(LOCK_STATE_UNLOCKED, lock_ctrl_get_state());
+
+    TEST_ASSERT_EQUAL_STRING("Unknown or expired challenge",
+                             unlock_flow_verify(client(1), AUDIT_CH_HTTP, NULL, nonce, token));
+    expect_events(&before, 1, 1);
+    TEST_ASSERT_EQUAL(LOCK_STATE_BAD_TOKEN, lock_ctrl_get_state());
+}
+
+TEST_CASE("a wrong token or an unknown challenge does not unlock", "[unlock_flow]") {
+    char nonce[CHALLENGE_NONCE_MAX_LEN + 1];
+    char token[AUTH_HMAC_HEX_LEN + 1];
+    state_store_data_t before;
+
+    test_fixture_lock();
+    state_store_get(&before);
+    TEST_ASSERT_EQUAL(ESP_OK, unlock_flow_issue(nonce));
+    sign(nonce, token);
+    token[0] = token[0] == '0' ? '1' : '0';
+    TEST_ASSERT_EQUAL_STRING("Invalid token", unlock_flow_verify(client(1), AUDIT_CH_WS, NULL, nonce, token));
+
+    // Signed correctly, but never issued
+    strcpy(nonce, "AAAAAAAAAAAAAAAAAAAAAA");
+    sign(nonce, token);
+    TEST_ASSERT_EQUAL_STRING("Unknown or expired challenge",
+                             unlock_flow_verify(client(1), AUDIT_CH_WS, NULL, nonce, token));
+    expect_events(&before, 0, 2);
+    TEST_ASSERT_EQUAL(LOCK_STATE_BAD_TOKEN, lock_ctrl_get_state());
+}
+
+TEST_CASE("a credential unlocks with its own key and only inside its schedule", "[unlock_flow]") {
+    static const char secret[] = "secret-phone-00000";
+    char nonce[CHALLENGE_NONCE_MAX_LEN + 1];
+    char token[AUTH_HMAC_HEX_LEN + 1];
+    uint8_t sha[32];
+    auth_hmac_key_t phone_key;
+    state_store_data_t before;
+    int error_line;
+
+    test_fixture_lock();
+    TEST_ASSERT_EQUAL(ESP_OK, cred_store_init());
+    TEST_ASSERT_EQUAL(0, mbedtls_sha256(test_creds_1, test_creds_1_size, sha, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, cred_store_upload_begin(test_creds_1_size, sha));
+    for (size_t off = 0; off < test_creds_1_size; off += TEST_UPLOAD_CHUNK) {
+        size_t n = test_creds_1_size - off < TEST_UPLOAD_CHUNK ? test_creds_1_size - off : TEST_UPLOAD_CHUNK;
+        TEST_ASSERT_EQUAL(ESP_OK, cred_store_upload_write(test_creds_1 + off, n));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, cred_store_upload_finish());
+    TEST_ASSERT_EQUAL(ESP_OK, auth_hmac_key_init(&phone_key, auth_hmac_backend_sw, (const uint8_t *)secret,
+                                                 strlen(secret)));
+    TEST_ASSERT_EQUAL(ESP_OK, access_policy_update("", 0, &error_line));
+    state_store_get(&before);
+
+    TEST_ASSERT_EQUAL(ESP_OK, unlock_flow_issue(nonce));
+    sign_with(&phone_key, nonce, token);
+    TEST_ASSERT_NULL(unlock_flow_verify(client(2), AUDIT_CH_HTTP, "phone-00000", nonce, token));
+
+    // The pre-shared key does not sign for a credential, nor a credential's key without its ID
+    TEST_ASSERT_EQUAL(ESP_OK, unlock_flow_issue(nonce));
+    sign(nonce, token);
+    TEST_ASSERT_EQUAL_STRING("Invalid token",
+                             unlock_flow_verify(client(2), AUDIT_CH_HTTP, "phone-00000", nonce, token));
+    TEST_ASSERT_EQUAL(ESP_OK, unlock_flow_issue(nonce));
+    sign_with(&phone_key, nonce, token);
+    TEST_ASSERT_EQUAL_STRING("Invalid token", unlock_flow_verify(client(2), AUDIT_CH_HTTP, NULL, nonce, token));
+    TEST_ASSERT_EQUAL(ESP_OK, unlock_flow_issue(nonce));
+    TEST_ASSERT_EQUAL_STRING("Unknown credential",
+                             unlock_flow_verify(client(2), AUDIT_CH_HTTP, "phone-00001", nonce, token));
+
+    // Schedule 0 closed: a correct token is still turned away
+    TEST_ASSERT_EQUAL(ESP_OK, access_policy_update("0 never\n", 8, &error_line));
+    TEST_ASSERT_EQUAL(ESP_OK, unlock_flow_issue(nonce));
+    sign_with(&phone_key, nonce, token);
+    TEST_ASSERT_EQUAL_STRING("Outside access schedule",
+                             unlock_flow_verify(client(2), AUDIT_CH_HTTP, "phone-00000", nonce, token));
+    expect_events(&before, 1, 4);
+
+    // The pre-shared key is never restricted
+    TEST_ASSERT_EQUAL(ESP_OK, unlock_flow_issue(nonce));
+    sign(nonce, token);
+    TEST_ASSERT_NULL(unlock_flow_verify(client(2), AUDIT_CH_HTTP, NULL, nonce, token));
+    expect_events(&before, 2, 4);
+    TEST_ASSERT_EQUAL(ESP_OK, access_policy_update("", 0, &error_line));
+}
+
+TEST_CASE("a client over its rate limit is turned away without touching the lock", "[unlock_flow]") {
+    char nonce[CHALLENGE_NONCE_MAX_LEN + 1];
+    char token[AUTH_HMAC_HEX_LEN + 1];
+    state_store_data_t before;
+    uint32_t retry_after_s = 0;
+
+    test_fixture_lock();
+    state_store_get(&before);
+    for (int i = 0; i < CONFIG_LOCK_AUTH_RATE_LIMIT_BURST; i++) {
+        TEST_ASSERT_TRUE(unlock_flow_admit(client(3), NULL));
+    }
+    TEST_ASSERT_FALSE(unlock_flow_admit(client(3), &retry_after_s));
+    TEST_ASSERT_TRUE(retry_after_s >= 1);
+
+    // Another client is not held up, and the first one gets a token back in time
+    TEST_ASSERT_EQUAL(ESP_OK, unlock_flow_issue(nonce));
+    sign(nonce, token);
+    TEST_ASSERT_TRUE(unlock_flow_admit(client(4), NULL));
+    TEST_ASSERT_NULL(unlock_flow_verify(client(4), AUDIT_CH_WS, NULL, nonce, token));
+    lock_hal_advance_time_us(1000000 / CONFIG_LOCK_AUTH_RATE_LIMIT_PER_SEC);
+    TEST_ASSERT_TRUE(unlock_flow_admit(client(3), NULL));
+    TEST_ASSERT_FALSE(unlock_flow_admit(client(3), NULL));
+
+    // Only the one verified response reached the lock controller
+    expect_events(&before, 1, 0);
+}
+
+#if CONFIG_LOCK_AUTH_COUNTER_UNLOCK
+TEST_CASE("a counter unlocks once and a forged one does not move the window", "[unlock_flow]") {
+    char message[24];
+    char token[AUTH_HMAC_HEX_LEN + 1];
+    state_store_data_t before;
+    uint32_t epoch, next, resume_epoch, resume;
+
+    test_fixture_lock();
+    state_store_get(&before);
+    unlock_flow_counter_resync(&epoch, &next);
+    snprintf(message, sizeof(message), "%lu:%lu", (unsigned long)epoch, (unsigned long)next);
+    sign(message, token);
+    TEST_ASSERT_EQUAL(UNLOCK_COUNTER_OK, unlock_flow_counter(client(5), epoch, next, token));
+    TEST_ASSERT_EQUAL(UNLOCK_COUNTER_STALE, unlock_flow_counter(client(5), epoch, next, token));
+    TEST_ASSERT_EQUAL(UNLOCK_COUNTER_STALE, unlock_flow_counter(client(5), epoch + 1, next, token));
+
+    // A forged token far ahead is rejected before it can slide the window
+    snprintf(message, sizeof(message), "%lu:%lu", (unsigned long)epoch, (unsigned long)next + 1000);
+    sign(message, token);
+    token[0] = token[0] == '0' ? '1' : '0';
+    TEST_ASSERT_EQUAL(UNLOCK_COUNTER_FORGED, unlock_flow_counter(client(5), epoch, next + 1000, token));
+    unlock_flow_counter_resync(&resume_epoch, &resume);
+    TEST_ASSERT_EQUAL(epoch, resume_epoch);
+    TEST_ASSERT_EQUAL(next + 1, resume);
+
+    // Counters may arrive out of order within the window
+    snprintf(message, sizeof(message), "%lu:%lu", (unsigned long)epoch, (unsigned long)next + 3);
+    sign(message, token);
+    TEST_ASSERT_EQUAL(UNLOCK_COUNTER_OK, unlock_flow_counter(client(5), epoch, next + 3, token));
+    snprintf(message, sizeof(message), "%lu:%lu", (unsigned long)epoch, (unsigned long)next + 2);
+    sign(message, token);
+    TEST_ASSERT_EQUAL(UNLOCK_COUNTER_OK, unlock_flow_counter(client(5), epoch, next + 2, token));
+    expect_events(&before, 3, 1);
+}
+#endif
+
+TEST_CASE("unlock flows run at thousands per second", "[unlock_flow]") {
+    char nonce[CHALLENGE_NONCE_MAX_LEN + 1];
+    char token[AUTH_HMAC_HEX_LEN + 1];
+    state_store_data_t before, after;
+    int unlocked = 0;
+
+    test_fixture_lock();
+    // The lock controller cannot show every flow, so most events are dropped with a warning each
+    esp_log_level_set("lock_ctrl", ESP_LOG_ERROR);
+    esp_log_level_set("unlock_flow", ESP_LOG_WARN);
+
+    int64_t start = lock_hal_time_us();
+    for (int i = 0; i < UNLOCK_FLOWS; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, unlock_flow_issue(nonce));
+        sign(nonce, token);
+        unlocked += unlock_flow_verify(client(6), AUDIT_CH_HTTP, NULL, nonce, token) == NULL;
+    }
+    int64_t elapsed_us = lock_hal_time_us() - start;
+    int64_t per_s = elapsed_us > 0 ? (int64_t)UNLOCK_FLOWS * 1000000 / elapsed_us : INT64_MAX;
+
+    esp_log_level_set("lock_ctrl", ESP_LOG_INFO);
+    esp_log_level_set("unlock_flow", ESP_LOG_INFO);
+
+    // Timing depends on the workstation, so it is reported, not checked
+    printf("%d unlock flows in %lld µs: %lld per second (%s backend)\n", UNLOCK_FLOWS, (long long)elapsed_us,
+           (long long)per_s, auth_hmac_backend_name(config_store_get()->psk_key.backend));
+    TEST_ASSERT_EQUAL(UNLOCK_FLOWS, unlocked);
+
+    // Let the controller drain its queue before the next case counts events
+    state_store_get(&after);
+    do {
+        before = after;
+        vTaskDelay(pdMS_TO_TICKS(50));
+        state_store_get(&after);
+    } while (after.unlocks != before.unlocks);
+}
@@ -0,0 +1,64 @@
+#!/usr/bin/env bash
+#
+# ⏱️ Measures boot time in QEMU, repeatably.
+#
+# Builds the QEMU image once (tools/qemu_run.sh), then boots it RUNS times.
+# Each run times, on the host, how long it takes from starting QEMU until
+# /challenge answers, and scrapes the firmware's own boot profile
+# (lock_boot_* at /metrics: start and duration of every phase on the
+# esp_timer clock). The medians over all runs are printed per phase.
+#
+#     tools/boot_bench.sh                   # RUNS=10
+#     RUNS=20 tools/boot_bench.sh --no-build
+#
+# QEMU runs unthrottled, so absolute times are those of the emulation on this
+# host: compare builds on the same machine, and confirm on the board (the same
+# lines are in its boot log) before trusting a difference in Wi-Fi or flash.
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+RUNS="${RUNS:-10}"
+PORT="${PORT:-8080}"
+WORK="$(mktemp -d)"
+QEMU_PID=""
+trap '[[ -n "$QEMU_PID" ]] && kill "$QEMU_PID" 2>/dev/null; rm -rf "$WORK"' EXIT
+
+if [[ "${1:-}" != "--no-build" ]]; then
+    "$ROOT/tools/qemu_run.sh" --build-only >"$WORK/build.log" 2>&1 || { cat "$WORK/build.log"; exit 1; }
+fi
+
+for run in $(seq "$RUNS"); do
+    start=$(date +%s%N)
+    PORT="$PORT" "$ROOT/tools/qemu_run.sh" --no-build </dev/null >"$WORK/qemu$run.log" 2>&1 &
+    QEMU_PID=$!
+    until curl -sf -m 1 "http://localhost:$PORT/challenge" >/dev/null; do
+        kill -0 "$QEMU_PID" 2>/dev/null || { cat "$WORK/qemu$run.log"; exit 1; }
+        sleep 0.05
+    done
+    echo "host_first_response_seconds $(( ($(date +%s%N) - start) / 1000 ))e-6" >"$WORK/run$run.prom"
+
+    # The ready line comes from the boot log; wait for it before scraping
+    for _ in $(seq 100); do
+        grep -q "Ready" "$WORK/qemu$run.log" && break
+        sleep 0.1
+    done
+    curl -sf "http://localhost:$PORT/metrics" | grep '^lock_boot_' >>"$WORK/run$run.prom" || true
+    kill "$QEMU_PID"
+    wait "$QEMU_PID" 2>/dev/null || true
+    QEMU_PID=""
+    echo "run $run/$RUNS: $(head -1 "$WORK/run$run.prom")"
+done
+
+python3 - "$WORK"/run*.prom <<'EOF'
+import statistics, sys
+samples = {}
+for path in sys.argv[1:]:
+    for line in open(path):
+        name, value = line.rsplit(' ', 1)
+        samples.setdefault(name, []).append(float(value))
+print('{:<60} {:>10} {:>10} {:>10}'.format('metric', 'median_ms', 'min_ms', 'max_ms'))
+for name in sorted(samples):
+    values = samples[name]
+    print('{:<60} {:>10.1f} {:>10.1f} {:>10.1f}'.format(
+        name, statistics.median(values) * 1e3, min(values) * 1e3, max(values) * 1e3))
+EOF
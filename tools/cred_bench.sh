@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+#
+# 🪪 Measures POST /response against credential tables of increasing size.
+#
+# For every size N the script provisions N synthetic credentials
+# (tools/gen_creds.py --synthetic N), drives challenge-response unlocks signed
+# with random ones of them (lock_loadgen --creds N) and reports the firmware's
+# own mean time for the verify stage (credential lookup + HMAC, from the
+# /metrics histogram deltas) next to the client-side latency.
+#
+#     tools/cred_bench.sh http://localhost:8080          # QEMU or linux target
+#     SIZES="10 10000" DURATION=30 tools/cred_bench.sh http://192.168.4.1
+#
+# The firmware needs a raised CONFIG_LOCK_AUTH_RATE_LIMIT_PER_SEC (as in
+# sdkconfig.defaults.linux), since all virtual users share one address.
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+URL="${1:?usage: $0 http://host[:port]}"
+SIZES="${SIZES:-10 100 1000 10000}"
+DURATION="${DURATION:-10}"
+CONCURRENCY="${CONCURRENCY:-4}"
+PSK="${PSK:-DEFAULT_KEY}"
+LOADGEN="${LOADGEN:-$ROOT/build-loadgen/lock_loadgen}"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+# Prints "<sum> <count>" of the response/verify stage histogram
+verify_totals() {
+    curl -sf "$URL/metrics" | awk '
+        /^lock_request_stage_seconds_sum\{endpoint="response",stage="verify"\}/ { sum = $2 }
+        /^lock_request_stage_seconds_count\{endpoint="response",stage="verify"\}/ { count = $2 }
+        END { print (sum ? sum : 0), (count ? count : 0) }'
+}
+
+printf '%8s %12s %12s %12s %12s\n' credentials verify_us response_p50_ms response_p99_ms unlocked
+for n in $SIZES; do
+    python3 "$ROOT/tools/gen_creds.py" --synthetic "$n" --upload "$URL" --psk "$PSK" >/dev/null
+    read -r sum0 count0 < <(verify_totals)
+    "$LOADGEN" -c "$CONCURRENCY" -d "$DURATION" --creds "$n" -o "$WORK/report.json" "$URL"
+    read -r sum1 count1 < <(verify_totals)
+    python3 - "$WORK/report.json" "$n" "$sum0" "$count0" "$sum1" "$count1" <<'EOF'
+import json, sys
+report = json.load(open(sys.argv[1]))
+n, s0, c0, s1, c1 = sys.argv[2], *map(float, sys.argv[3:])
+resp = report['endpoints'].get('POST /response', {'latency_ms': {'p50': 0, 'p99': 0}})
+flows = report['endpoints'].get('flow', {'outcomes': {}})
+verify_us = (s1 - s0) / (c1 - c0) * 1e6 if c1 > c0 else 0
+print('{:>8} {:>12.1f} {:>12.2f} {:>12.2f} {:>12}'.format(
+    n, verify_us, resp['latency_ms']['p50'], resp['latency_ms']['p99'], flows['outcomes'].get('unlocked', 0)))
+EOF
+done
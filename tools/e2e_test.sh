@@ -0,0 +1,173 @@
+#!/usr/bin/env bash
+#
+# 🧪 End-to-end checks of the firmware over HTTP, on the ESP-IDF linux target.
+#
+# Builds the firmware for the linux target (in build-e2e/), then for every
+# scenario starts it afresh on localhost, drives it and checks the outcome.
+# The script stops at the first scenario that fails and shows the tail of
+# the firmware log.
+#
+#   throughput   lock_loadgen unlock flows for DURATION s: none may fail, and
+#                at least MIN_FLOWS_PER_S must unlock per second
+#   bad_token    one client sends a wrong token; while its blue indication
+#                lasts, a second client's challenge and response must both
+#                answer within MAX_FLOW_MS, and so must the rejection
+#   flood        lock_loadgen floods wrong tokens from FLOOD_SOURCE with
+#                FLOOD_CONCURRENCY connections for FLOOD_S s; meanwhile
+#                FLOOD_FLOWS unlock flows of a second client on 127.0.0.1
+#                must each succeed within MAX_FLOW_MS, and every flooded
+#                flow must have been rejected
+#
+#     tools/e2e_test.sh                     # every scenario
+#     tools/e2e_test.sh throughput
+#     NO_BUILD=1 tools/e2e_test.sh          # reuse the last build
+#
+# Local clients other than the flood are 127.0.0.1 and share one bucket of
+# the rate limiter, 1000 attempts per second in sdkconfig.defaults.linux, so
+# flows held back with 429 do not count as failures and MIN_FLOWS_PER_S
+# stays below that limit. The flood connects from another loopback address
+# and so has a bucket of its own. test/host runs the same flow without HTTP
+# at its full rate.
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD="${BUILD:-$ROOT/build-e2e}"
+PORT="${PORT:-8080}"
+URL="http://localhost:$PORT"
+DURATION="${DURATION:-10}"
+CONCURRENCY="${CONCURRENCY:-4}"
+MIN_FLOWS_PER_S="${MIN_FLOWS_PER_S:-900}"
+MAX_FLOW_MS="${MAX_FLOW_MS:-100}"
+FLOOD_SOURCE="${FLOOD_SOURCE:-127.0.0.2}"
+FLOOD_CONCURRENCY="${FLOOD_CONCURRENCY:-8}"
+FLOOD_FLOWS="${FLOOD_FLOWS:-20}"
+FLOOD_S="${FLOOD_S:-10}"
+PSK="${PSK:-DEFAULT_KEY}"
+LOADGEN="${LOADGEN:-$ROOT/build-loadgen/lock_loadgen}"
+WORK="$(mktemp -d)"
+FIRMWARE_PID=""
+FLOOD_PID=""
+trap '[[ -n "$FLOOD_PID" ]] && kill "$FLOOD_PID" 2>/dev/null; [[ -n "$FIRMWARE_PID" ]] && kill "$FIRMWARE_PID" 2>/dev/null
+      rm -rf "$WORK"' EXIT
+
+start_firmware() {
+    # Line-buffered, so the log can be watched while the firmware runs
+    stdbuf -oL "$BUILD/my_lock_project.elf" >"$WORK/firmware.log" 2>&1 &
+    FIRMWARE_PID=$!
+    for _ in $(seq 50); do
+        curl -sf "$URL/challenge" >/dev/null && return 0
+        sleep 0.1
+    done
+    echo "firmware did not answer on $URL" >&2
+    return 1
+}
+
+stop_firmware() {
+    kill "$FIRMWARE_PID" 2>/dev/null || true
+    wait "$FIRMWARE_PID" 2>/dev/null || true
+    FIRMWARE_PID=""
+}
+
+# Checks a lock_loadgen report: prints the flow summary, fails if any flow
+# ended other than unlocked or rate_limited, or if fewer than $2 unlocked per second
+check_flows() {
+    python3 - "$1" "$2" <<'EOF'
+import json, sys
+report = json.load(open(sys.argv[1]))
+flows = report["endpoints"].get("flow", {"outcomes": {}, "latency_ms": {}})
+outcomes = flows["outcomes"]
+per_s = outcomes.get("unlocked", 0) / report["duration_s"]
+print("  {:.0f} unlocks/s, flow p99 {} ms, outcomes {}".format(per_s, flows["latency_ms"].get("p99"), outcomes))
+failed = {k: v for k, v in outcomes.items() if k not in ("unlocked", "rate_limited")}
+sys.exit(1 if failed or per_s < float(sys.argv[2]) else 0)
+EOF
+}
+
+# Runs GET /challenge and POST /response signed with key $1; prints
+# "<status of the response> <ms spent in both requests>", leaving out the signing
+timed_flow() {
+    local challenge_s response_s code
+    challenge_s="$(curl -sf -o "$WORK/nonce" -w '%{time_total}' "$URL/challenge")"
+    python3 -c 'import hashlib, hmac, sys
+print(hmac.new(sys.argv[1].encode(), open(sys.argv[2]).read().encode(), hashlib.sha256).hexdigest(), end="")' \
+        "$1" "$WORK/nonce" >"$WORK/token"
+    read -r code response_s < <(curl -s -o /dev/null -w '%{http_code} %{time_total}\n' \
+        --data-binary "@$WORK/token" "$URL/response?nonce=$(cat "$WORK/nonce")")
+    awk -v code="$code" -v a="$challenge_s" -v b="$response_s" 'BEGIN { printf "%s %.1f\n", code, (a + b) * 1000 }'
+}
+
+scenario_throughput() {
+    "$LOADGEN" -c "$CONCURRENCY" -d "$DURATION" -o "$WORK/report.json" "$URL" >/dev/null
+    check_flows "$WORK/report.json" "$MIN_FLOWS_PER_S"
+}
+
+scenario_bad_token() {
+    local code ms
+    read -r code ms < <(timed_flow "not-$PSK")
+    echo "  wrong token: HTTP $code in $ms ms"
+    [[ "$code" == 401 ]] && awk -v ms="$ms" -v max="$MAX_FLOW_MS" 'BEGIN { exit !(ms <= max) }' || return 1
+    for _ in $(seq 20); do
+        grep -q "LED flashing blue" "$WORK/firmware.log" && break
+        sleep 0.05
+    done
+    grep -q "LED flashing blue" "$WORK/firmware.log" || { echo "  no blue indication in the log"; return 1; }
+
+    read -r code ms < <(timed_flow "$PSK")
+    echo "  second client during the blue indication: HTTP $code in $ms ms"
+    [[ "$code" == 200 ]] && awk -v ms="$ms" -v max="$MAX_FLOW_MS" 'BEGIN { exit !(ms <= max) }'
+}
+
+scenario_flood() {
+    local code ms failed=0
+    "$LOADGEN" -c "$FLOOD_CONCURRENCY" -d "$FLOOD_S" -b 1 --source "$FLOOD_SOURCE" -o "$WORK/flood.json" \
+        "http://127.0.0.1:$PORT" >/dev/null &
+    FLOOD_PID=$!
+    sleep 1
+
+    for i in $(seq "$FLOOD_FLOWS"); do
+        read -r code ms < <(timed_flow "$PSK")
+        echo "  flow $i during the flood: HTTP $code in $ms ms"
+        [[ "$code" == 200 ]] && awk -v ms="$ms" -v max="$MAX_FLOW_MS" 'BEGIN { exit !(ms <= max) }' || failed=1
+    done
+    kill -0 "$FLOOD_PID" 2>/dev/null || { echo "  the flood ended before the timed flows; raise FLOOD_S"; failed=1; }
+    wait "$FLOOD_PID" || failed=1
+    FLOOD_PID=""
+
+    # Every flooded flow must have been turned away; challenge_failed means FLOOD_SOURCE could not connect
+    python3 - "$WORK/flood.json" <<'EOF' || failed=1
+import json, sys
+report = json.load(open(sys.argv[1]))
+flows = report["endpoints"].get("flow (bad token)", {"count": 0, "outcomes": {}})
+outcomes = flows["outcomes"]
+print("  flood: {:.0f} flows/s, outcomes {}".format(flows["count"] / report["duration_s"], outcomes))
+sys.exit(0 if flows["count"] > 0 and set(outcomes) <= {"rejected", "rate_limited"} else 1)
+EOF
+    [[ "$failed" == 0 ]]
+}
+
+if [[ $# -eq 0 ]]; then
+    set -- throughput bad_token flood
+fi
+
+if [[ -z "${NO_BUILD:-}" ]]; then
+    mkdir -p "$BUILD"
+    idf.py -C "$ROOT" -B "$BUILD" \
+        -D SDKCONFIG="$BUILD/sdkconfig" \
+        -D SDKCONFIG_DEFAULTS="sdkconfig.defaults.linux" \
+        --preview set-target linux build >"$WORK/build.log" 2>&1 || { cat "$WORK/build.log"; exit 1; }
+fi
+if [[ ! -x "$LOADGEN" ]]; then
+    cmake -S "$ROOT/tools/loadgen" -B "$(dirname "$LOADGEN")" >/dev/null
+    cmake --build "$(dirname "$LOADGEN")" >/dev/null
+fi
+
+for scenario in "$@"; do
+    echo "▶️ $scenario"
+    if ! start_firmware || ! "scenario_$scenario"; then
+        tail -n 20 "$WORK/firmware.log" >&2
+        echo "❌ $scenario" >&2
+        exit 1
+    fi
+    stop_firmware
+    echo "✅ $scenario"
+done
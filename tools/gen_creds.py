@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""
+Credential table builder for the lock firmware.
+
+Reads per-phone credentials and packs them into the read-only table the
+firmware looks credentials up in (see main/cred_store.h). The input is a text
+file with one credential per line, `<id> <secret as hex> [schedule]`; blank
+lines and lines starting with '#' are ignored. The schedule (0 to 15, default
+0) is the access schedule whose time windows apply to the credential, as set
+with PUT /policy (see main/access_policy.h). With --synthetic N the tool
+instead makes N test credentials `phone-00000`, `phone-00001`, ... in
+schedule 0 whose secret is the ASCII text `secret-<id>` (this is what
+`lock_loadgen --creds N` signs with).
+
+Table layout, all integers little endian:
+
+  header      32 bytes   magic 'CRD1', version, credential count, hash seed,
+                         bucket count, offsets of the tables below, image size
+  buckets     u16[nb]    displacement per bucket of the minimal perfect hash
+  entries     100 B each one per credential, stored at its perfect-hash slot:
+                         FNV-1a hash of the ID, NUL-padded ID (27 characters
+                         at most), access schedule (u8, 3 bytes padding),
+                         SHA-256 states after the HMAC inner and outer pad
+                         blocks (8 + 8 u32)
+
+The perfect hash is the one gen_assets.py builds over web asset paths. Only
+the pad midstates are stored, so the device never hashes a secret; note that
+they are as sensitive as the secrets themselves.
+
+With --upload the table is sent to a running lock with PUT /credentials,
+authenticated with the pre-shared key, and replaces all credentials at once.
+Uploading an empty input file revokes every credential. With --c-source the
+table is also written as a C array; the host unit tests (test/host) build
+their synthetic tables that way.
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import struct
+import sys
+import urllib.request
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'main'))
+from gen_assets import build_perfect_hash, fnv1a, write_c_source  # noqa: E402
+
+
+TABLE_MAGIC = 0x31445243  # 'CRD1'
+TABLE_VERSION = 2
+HEADER_FMT = '<IHHIIIIII'
+ENTRY_FMT = '<I28sB3x16I'
+ID_MAX_LEN = 27
+SECRET_MAX_LEN = 64
+SCHEDULE_COUNT = 16
+
+SHA256_IV = [
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+]
+
+SHA256_K = [
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+]
+
+
+def rotr(x: int, n: int) -> int:
+    return ((x >> n) | (x << (32 - n))) & 0xFFFFFFFF
+
+
+def sha256_compress(state, block: bytes):
+    """One SHA-256 compression; hashlib does not expose intermediate states."""
+    w = list(struct.unpack('>16I', block))
+    for i in range(16, 64):
+        s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3)
+        s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10)
+        w.append((w[i - 16] + s0 + w[i - 7] + s1) & 0xFFFFFFFF)
+    a, b, c, d, e, f, g, h = state
+    for i in range(64):
+        t1 = (h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i]) & 0xFFFFFFFF
+        t2 = ((rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c))) & 0xFFFFFFFF
+        h, g, f, e, d, c, b, a = g, f, e, (d + t1) & 0xFFFFFFFF, c, b, a, (t1 + t2) & 0xFFFFFFFF
+    return [(x + y) & 0xFFFFFFFF for x, y in zip(state, (a, b, c, d, e, f, g, h))]
+
+
+def pad_midstates(secret: bytes):
+    """HMAC-SHA256 inner and outer pad midstates, as cached by the firmware's software backend."""
+    k0 = secret.ljust(64, b'\0')
+    inner = sha256_compress(SHA256_IV, bytes(b ^ 0x36 for b in k0))
+    outer = sha256_compress(SHA256_IV, bytes(b ^ 0x5C for b in k0))
+    return inner + outer
+
+
+def read_credentials(path: str):
+    creds = []
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            fields = line.split()
+            if len(fields) not in (2, 3):
+                raise ValueError('{}:{}: expected "<id> <secret as hex> [schedule]"'.format(path, lineno))
+            schedule = int(fields[2]) if len(fields) == 3 else 0
+            creds.append((fields[0], bytes.fromhex(fields[1]), schedule))
+    return creds
+
+
+def synthetic_credentials(n: int):
+    return [('phone-{:05d}'.format(i), 'secret-phone-{:05d}'.format(i).encode(), 0) for i in range(n)]
+
+
+def pack(creds, quiet=False) -> bytes:
+    seen = set()
+    for cred_id, secret, schedule in creds:
+        if not 0 < len(cred_id) <= ID_MAX_LEN or not cred_id.isascii() or not cred_id.isprintable():
+            raise ValueError('invalid credential ID {!r}'.format(cred_id))
+        if not 0 < len(secret) <= SECRET_MAX_LEN:
+            raise ValueError('secret of {} must be 1 to {} bytes'.format(cred_id, SECRET_MAX_LEN))
+        if not 0 <= schedule < SCHEDULE_COUNT:
+            raise ValueError('schedule of {} must be 0 to {}'.format(cred_id, SCHEDULE_COUNT - 1))
+        if cred_id in seen:
+            raise ValueError('duplicate credential ID {}'.format(cred_id))
+        seen.add(cred_id)
+
+    keys = [c[0].encode() for c in creds]
+    n = len(creds)
+    seed, disp, slot_of = build_perfect_hash(keys) if n else (0, [0], [])
+    nbuckets = len(disp)
+
+    header_size = struct.calcsize(HEADER_FMT)
+    buckets_off = header_size
+    entries_off = (buckets_off + 2 * nbuckets + 3) & ~3
+    image_size = entries_off + struct.calcsize(ENTRY_FMT) * n
+
+    entries = [None] * n
+    for i, (cred_id, secret, schedule) in enumerate(creds):
+        entries[slot_of[i]] = struct.pack(ENTRY_FMT, fnv1a(keys[i], seed), keys[i], schedule,
+                                          *pad_midstates(secret))
+
+    image = bytearray(struct.pack(HEADER_FMT, TABLE_MAGIC, TABLE_VERSION, 0, n, seed, nbuckets,
+                                  buckets_off, entries_off, image_size))
+    image += struct.pack('<{}H'.format(nbuckets), *disp)
+    image += bytes(entries_off - len(image))
+    image += b''.join(entries)
+    if not quiet:
+        print('gen_creds: {} credentials, {} buckets, seed {}, {} bytes'.format(n, nbuckets, seed, len(image)))
+    return bytes(image)
+
+
+def upload(url: str, psk: str, image: bytes) -> str:
+    """Authenticates with a fresh challenge and PUTs the table to /credentials."""
+    url = url.rstrip('/')
+    with urllib.request.urlopen(url + '/challenge') as r:
+        nonce = r.read().decode()
+    token = hmac.new(psk.encode(), nonce.encode(), hashlib.sha256).hexdigest()
+    req = urllib.request.Request(url + '/credentials', data=image, method='PUT', headers={
+        'X-Nonce': nonce,
+        'X-Auth': token,
+        'X-Image-SHA256': hashlib.sha256(image).hexdigest(),
+        'Content-Type': 'application/octet-stream',
+    })
+    with urllib.request.urlopen(req) as r:
+        return r.read().decode()
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--input', help='credential file, one "<id> <secret as hex> [schedule]" per line')
+    source.add_argument('--synthetic', type=int, metavar='N', help='make N test credentials instead')
+    parser.add_argument('--output', help='path of the table image to write')
+    parser.add_argument('--c-source', help='also write the table as a C array to this file')
+    parser.add_argument('--symbol', default='cred_table_image', help='C symbol name used with --c-source')
+    parser.add_argument('--upload', metavar='URL', help='send the table to the lock at URL, e.g. http://192.168.4.1')
+    parser.add_argument('--psk', default='DEFAULT_KEY', help='pre-shared key authenticating --upload')
+    args = parser.parse_args()
+
+    creds = read_credentials(args.input) if args.input else synthetic_credentials(args.synthetic)
+    image = pack(creds)
+    for out in (args.output, args.c_source):
+        if out:
+            os.makedirs(os.path.dirname(os.path.abspath(out)), exist_ok=True)
+    if args.output:
+        with open(args.output, 'wb') as f:
+            f.write(image)
+    if args.c_source:
+        write_c_source(args.c_source, args.symbol, image, 'gen_creds.py')
+    if args.upload:
+        print('gen_creds: {}'.format(upload(args.upload, args.psk, image)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,118 @@
+#!/usr/bin/env bash
+#
+# 🧪 Checks that the firmware does not allocate while it serves unlocks.
+#
+# Needs a build with CONFIG_LOCK_HEAP_ALLOC_COUNT, whose heap hooks count
+# every allocation by the task that made it (see main/heap_watch.h). One
+# warm-up round of challenge-response unlocks (lock_loadgen) lets every
+# lazily opened handle and buffer settle; after it and after each of ROUNDS
+# further rounds the counters and the internal heap gauges are read from
+# /metrics once the connections have closed. The script fails if
+#
+#  - the firmware's own tasks (lock controller, HTTP workers, audit log,
+#    log output, nonce pool) allocated anything during a round, even if it
+#    was freed again before the reading, or
+#  - free bytes or allocated blocks differ from the warm-up reading.
+#
+# The HTTP server task, lwIP and Wi-Fi allocate per connection and per
+# packet by design (the server also copies each request it hands to an HTTP
+# worker); their allocations are printed per unlock but not limited, and
+# the gauge check makes sure all of them are freed again.
+#
+#     tools/heap_soak.sh http://localhost:8080          # QEMU
+#     ROUNDS=50 DURATION=60 tools/heap_soak.sh http://192.168.4.1
+#
+# The counters and gauges are only exported by ESP32-S3 builds (board or
+# QEMU), not by the linux target. Every reading is taken by the same single
+# /metrics request once the load's sockets are closed, so the per-socket
+# buffers of lwIP and the HTTP server are the same each time. BYTES_TOLERANCE
+# and BLOCKS_TOLERANCE (default 0) only exist to look into a failure.
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+URL="${1:?usage: $0 http://host[:port]}"
+ROUNDS="${ROUNDS:-10}"
+DURATION="${DURATION:-10}"
+CONCURRENCY="${CONCURRENCY:-4}"
+SETTLE="${SETTLE:-2}"
+BYTES_TOLERANCE="${BYTES_TOLERANCE:-0}"
+BLOCKS_TOLERANCE="${BLOCKS_TOLERANCE:-0}"
+LOADGEN="${LOADGEN:-$ROOT/build-loadgen/lock_loadgen}"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+# Prints "<free_bytes> <allocated_blocks> <minimum_free_bytes>" of the internal heap, then the
+# allocations since boot by the firmware's tasks, by the HTTP server task and by the rest of ESP-IDF
+heap_totals() {
+    curl -sf "$URL/metrics" | awk '
+        /^lock_heap_free_bytes\{region="internal"\}/ { free = $2 }
+        /^lock_heap_allocated_blocks\{region="internal"\}/ { blocks = $2 }
+        /^lock_heap_minimum_free_bytes\{region="internal"\}/ { min = $2 }
+        /^lock_heap_allocs_total\{by="firmware"\}/ { fw = $2 }
+        /^lock_heap_allocs_total\{by="httpd"\}/ { httpd = $2 }
+        /^lock_heap_allocs_total\{by="other"\}/ { other = $2 }
+        END { if (free == "" || fw == "") exit 1; print free, blocks, min, fw, httpd, other }'
+}
+
+# Runs one round of unlocks and prints the number that succeeded
+unlock_round() {
+    "$LOADGEN" -c "$CONCURRENCY" -d "$DURATION" -o "$WORK/report.json" "$URL" >/dev/null
+    python3 -c 'import json, sys
+flows = json.load(open(sys.argv[1]))["endpoints"].get("flow", {"outcomes": {}})
+print(flows["outcomes"].get("unlocked", 0))' "$WORK/report.json"
+    sleep "$SETTLE"
+}
+
+if ! heap_totals >/dev/null; then
+    echo "no lock_heap_* counters at $URL/metrics (linux target, or CONFIG_LOCK_METRICS or" \
+         "CONFIG_LOCK_HEAP_ALLOC_COUNT off?)" >&2
+    exit 2
+fi
+
+unlock_round >/dev/null
+read -r free0 blocks0 min0 fw0 httpd0 other0 < <(heap_totals)
+printf '%6s %10s %12s %12s %12s %12s %10s %10s %10s\n' round unlocked free_bytes free_delta blocks \
+    blocks_delta fw_allocs httpd/unl other/unl
+printf '%6s %10s %12s %12s %12s %12s %10s %10s %10s\n' warmup - "$free0" 0 "$blocks0" 0 - - -
+
+# Prints allocations per unlock of the round
+per_unlock() {
+    awk -v n="$1" -v u="$unlocked" 'BEGIN { if (u > 0) printf "%.2f", n / u; else print "-" }'
+}
+
+total=0
+fw_total=0
+httpd_total=0
+other_total=0
+for round in $(seq 1 "$ROUNDS"); do
+    read -r _ _ _ fw_start httpd_start other_start < <(heap_totals)
+    unlocked="$(unlock_round)"
+    total=$((total + unlocked))
+    read -r free blocks min fw httpd other < <(heap_totals)
+    # Both readings are /metrics requests, served by the HTTP server task, so they never count as firmware
+    fw_round=$((fw - fw_start))
+    fw_total=$((fw_total + fw_round))
+    httpd_total=$((httpd_total + httpd - httpd_start))
+    other_total=$((other_total + other - other_start))
+    printf '%6s %10s %12s %12s %12s %12s %10s %10s %10s\n' "$round" "$unlocked" "$free" $((free - free0)) \
+        "$blocks" $((blocks - blocks0)) "$fw_round" "$(per_unlock $((httpd - httpd_start)))" \
+        "$(per_unlock $((other - other_start)))"
+done
+
+echo "$total unlocks, minimum free heap $min bytes;" \
+     "ESP-IDF allocated $httpd_total times on the HTTP server task and $other_total times elsewhere"
+drift=$((free0 - free))
+block_drift=$((blocks - blocks0))
+status=0
+if [ "$fw_total" -ne 0 ]; then
+    echo "❌ the firmware's tasks allocated $fw_total times during the load" >&2
+    status=1
+fi
+if [ "${drift#-}" -gt "$BYTES_TOLERANCE" ] || [ "${block_drift#-}" -gt "$BLOCKS_TOLERANCE" ]; then
+    echo "❌ heap drifted by $drift bytes and $block_drift blocks" >&2
+    status=1
+fi
+if [ "$status" -ne 0 ]; then
+    exit "$status"
+fi
+echo "✅ no firmware allocations, heap steady ($drift bytes, $block_drift blocks from the warm-up reading)"
@@ -0,0 +1,20 @@
+/*
+ * 🔏 HMAC-SHA256 for the load generator, matching the firmware's auth_hmac 🔑
+ *
+ * Self-contained so the tool builds without OpenSSL on any host.
+ */
+#pragma once
+
+#include <string>
+
+namespace loadgen {
+
+/**
+ * @brief Returns the lowercase hex HMAC-SHA256 of a message.
+ *
+ * @param key Pre-shared key.
+ * @param message Message to authenticate (a challenge, or "<epoch>:<counter>").
+ */
+std::string hmac_sha256_hex(const std::string &key, const std::string &message);
+
+} // namespace loadgen
@@ -0,0 +1,200 @@
+/*
+ * 🌐 Minimal blocking HTTP/1.1 client with keep-alive, one per virtual user 📡
+ */
+
+#include "http_client.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace loadgen {
+
+const char *http_error_name(HttpResult::Error error) {
+    switch (error) {
+    case HttpResult::Error::None:
+        return "none";
+    case HttpResult::Error::Connect:
+        return "connect";
+    case HttpResult::Error::Timeout:
+        return "timeout";
+    case HttpResult::Error::Io:
+        return "io";
+    case HttpResult::Error::BadResponse:
+        return "bad_response";
+    }
+    return "unknown";
+}
+
+bool parse_http_url(const std::string &url, std::string &host, int &port) {
+    const std::string scheme = "http://";
+    if (url.compare(0, scheme.size(), scheme) != 0) {
+        return false;
+    }
+    std::string rest = url.substr(scheme.size());
+    rest = rest.substr(0, rest.find('/'));
+    size_t colon = rest.rfind(':');
+    if (colon == std::string::npos) {
+        host = rest;
+        port = 80;
+    } else {
+        host = rest.substr(0, colon);
+        port = std::atoi(rest.c_str() + colon + 1);
+    }
+    return !host.empty() && port > 0 && port < 65536;
+}
+
+HttpClient::HttpClient(std::string host, int port, int timeout_ms, std::string source)
+    : host_(std::move(host)), source_(std::move(source)), port_(port), timeout_ms_(timeout_ms) {}
+
+HttpClient::~HttpClient() {
+    close_();
+}
+
+bool HttpClient::connect_() {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    addrinfo *src = nullptr;
+    if (!source_.empty()) {
+        hints.ai_flags = AI_NUMERICHOST;
+        if (getaddrinfo(source_.c_str(), nullptr, &hints, &src) != 0) {
+            return false;
+        }
+        // Only server addresses of the source's family can be reached from it
+        hints.ai_family = src->ai_family;
+        hints.ai_flags = 0;
+    }
+    if (getaddrinfo(host_.c_str(), std::to_string(port_).c_str(), &hints, &res) != 0) {
+        if (src) {
+            freeaddrinfo(src);
+        }
+        return false;
+    }
+
+    for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (src && ::bind(fd, src->ai_addr, src->ai_addrlen) != 0) {
+            ::close(fd);
+            continue;
+        }
+        timeval tv{timeout_ms_ / 1000, (timeout_ms_ % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            fd_ = fd;
+            connections_++;
+            break;
+        }
+        ::close(fd);
+    }
+    freeaddrinfo(res);
+    if (src) {
+        freeaddrinfo(src);
+    }
+    return fd_ >= 0;
+}
+
+void HttpClient::close_() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+HttpResult HttpClient::request(const std::string &method, const std::string &path, const std::string &body) {
+    HttpResult result;
+
+    std::string req = method + " " + path + " HTTP/1.1\r\nHost: " + host_ + "\r\n";
+    if (!body.empty() || method == "POST") {
+        req += "Content-Type: text/plain\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    req += "\r\n" + body;
+
+    // A kept-alive connection may have been closed by the server meanwhile: retry once on a fresh one
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = fd_ >= 0;
+        if (!reused && !connect_()) {
+            result.error = HttpResult::Error::Connect;
+            return result;
+        }
+        if (send(fd_, req.data(), req.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(req.size())) {
+            close_();
+            result.error = HttpResult::Error::Io;
+            if (reused) {
+                continue;
+            }
+            return result;
+        }
+
+        std::string buf;
+        size_t header_end = std::string::npos;
+        size_t content_length = 0;
+        bool close_after = false;
+        char chunk[2048];
+        for (;;) {
+            if (header_end != std::string::npos && buf.size() >= header_end + 4 + content_length) {
+                break;
+            }
+            ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                bool timeout = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+                close_();
+                if (!timeout && reused && buf.empty()) {
+                    break; // Stale keep-alive connection, retry
+                }
+                result.error = timeout ? HttpResult::Error::Timeout : HttpResult::Error::Io;
+                return result;
+            }
+            buf.append(chunk, static_cast<size_t>(n));
+            if (header_end == std::string::npos && (header_end = buf.find("\r\n\r\n")) != std::string::npos) {
+                if (buf.compare(0, 9, "HTTP/1.1 ") != 0 && buf.compare(0, 9, "HTTP/1.0 ") != 0) {
+                    close_();
+                    result.error = HttpResult::Error::BadResponse;
+                    return result;
+                }
+                result.status = std::atoi(buf.c_str() + 9);
+                // Header names are case-insensitive
+                size_t pos = buf.find("\r\n");
+                while (pos < header_end) {
+                    size_t eol = buf.find("\r\n", pos + 2);
+                    std::string line = buf.substr(pos + 2, eol - pos - 2);
+                    if (strncasecmp(line.c_str(), "content-length:", 15) == 0) {
+                        content_length = std::strtoul(line.c_str() + 15, nullptr, 10);
+                    } else if (strncasecmp(line.c_str(), "connection:", 11) == 0 &&
+                               line.find("close") != std::string::npos) {
+                        close_after = true;
+                    }
+                    pos = eol;
+                }
+            }
+        }
+        if (fd_ < 0) {
+            continue;
+        }
+
+        result.error = HttpResult::Error::None;
+        result.body = buf.substr(header_end + 4, content_length);
+        if (close_after) {
+            close_();
+        }
+        return result;
+    }
+    result.error = HttpResult::Error::Io;
+    return result;
+}
+
+} // namespace loadgen
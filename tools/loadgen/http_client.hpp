@@ -0,0 +1,76 @@
+/*
+ * 🌐 Minimal blocking HTTP/1.1 client with keep-alive, one per virtual user 📡
+ */
+#pragma once
+
+#include <string>
+
+namespace loadgen {
+
+/**
+ * @brief Outcome of one HTTP exchange.
+ */
+struct HttpResult {
+    enum class Error { None, Connect, Timeout, Io, BadResponse };
+
+    Error error = Error::None; /*!< Transport error, None if a response was parsed */
+    int status = 0;            /*!< HTTP status code */
+    std::string body;          /*!< Response body */
+};
+
+/**
+ * @brief Returns a short name for a transport error ("connect", "timeout", ...).
+ */
+const char *http_error_name(HttpResult::Error error);
+
+/**
+ * @brief HTTP client bound to one server, reusing its connection between requests.
+ *
+ * A new connection is opened when the server closed the previous one (the
+ * firmware closes it after rejected requests) or after a transport error.
+ */
+class HttpClient {
+public:
+    /**
+     * @param source Local address to connect from (e.g. "127.0.0.2"), or empty for the default.
+     */
+    HttpClient(std::string host, int port, int timeout_ms, std::string source = "");
+    ~HttpClient();
+
+    HttpClient(const HttpClient &) = delete;
+    HttpClient &operator=(const HttpClient &) = delete;
+
+    /**
+     * @brief Sends one request and waits for the complete response.
+     *
+     * @param method "GET" or "POST".
+     * @param path Request target including the query string.
+     * @param body Request body, sent as text/plain when not empty.
+     */
+    HttpResult request(const std::string &method, const std::string &path, const std::string &body = "");
+
+    /**
+     * @brief Number of TCP connections opened so far.
+     */
+    unsigned connections() const { return connections_; }
+
+private:
+    bool connect_();
+    void close_();
+
+    std::string host_;
+    std::string source_;
+    int port_;
+    int timeout_ms_;
+    int fd_ = -1;
+    unsigned connections_ = 0;
+};
+
+/**
+ * @brief Splits "http://host[:port]" into host and port.
+ *
+ * @return false if the URL is not a plain http URL.
+ */
+bool parse_http_url(const std::string &url, std::string &host, int &port);
+
+} // namespace loadgen
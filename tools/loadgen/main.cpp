@@ -0,0 +1,357 @@
+/*
+ * 🏋️ lock_loadgen - concurrent load generator for the lock HTTP API 📈
+ *
+ * Every virtual user runs unlock flows in a loop on its own keep-alive
+ * connection, like a phone with the web UI open:
+ *
+ *   challenge mode:  GET /challenge, then POST /response?nonce=<challenge>
+ *   counter mode:    POST /unlock with "<epoch> <counter> <token>"
+ *
+ * A configurable fraction of flows sends a wrong token. At the end a JSON
+ * report with throughput, latency percentiles and the outcome breakdown per
+ * endpoint (and for whole flows) is printed.
+ *
+ * The tool talks plain HTTP to any address, so it works the same against the
+ * board, the firmware under QEMU (with user-mode networking port forwarding)
+ * or the ESP-IDF linux target.
+ *
+ * Note that all virtual users share one IP address and therefore one bucket
+ * of the firmware's per-client rate limiter; raise
+ * CONFIG_LOCK_AUTH_RATE_LIMIT_PER_SEC for pure throughput runs. To measure a
+ * legitimate client's latency while flooding, run a flooding instance with
+ * --source set to another local address (any of 127.0.0.0/8 on a Linux host,
+ * or a second address on the network interface) and -b 1.
+ *
+ * Usage: lock_loadgen [options] http://192.168.4.1
+ *   -c, --concurrency N   virtual users (default 4)
+ *   -d, --duration S      run time in seconds (default 10)
+ *   -t, --think-ms MS     mean pause between flows of one user, +-50% jitter (default 0)
+ *   -b, --bad-ratio R     fraction of flows sending a wrong token, 0..1 (default 0)
+ *   -k, --psk KEY         pre-shared key (default DEFAULT_KEY)
+ *   -m, --mode MODE       challenge or counter (default challenge)
+ *       --creds N         challenge mode: sign as a random one of the N synthetic
+ *                         credentials of `tools/gen_creds.py --synthetic N`
+ *                         instead of with the pre-shared key
+ *       --timeout-ms MS   per-request timeout (default 5000)
+ *       --source ADDR     connect from this local address (default: chosen by the OS)
+ *   -o, --output FILE     write the report to FILE instead of stdout
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hmac_sha256.hpp"
+#include "http_client.hpp"
+
+using namespace loadgen;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+/**
+ * @brief Command line options.
+ */
+struct Options {
+    std::string host;
+    int port = 80;
+    int concurrency = 4;
+    double duration_s = 10;
+    double think_ms = 0;
+    double bad_ratio = 0;
+    std::string psk = "DEFAULT_KEY";
+    std::string mode = "challenge";
+    int creds = 0;
+    int timeout_ms = 5000;
+    std::string source;
+    std::string output;
+};
+
+/**
+ * @brief Latencies and outcomes of one endpoint (or of whole flows).
+ */
+struct EndpointStats {
+    std::vector<double> latency_ms;
+    std::map<std::string, uint64_t> outcomes;
+
+    void add(double ms, const std::string &outcome) {
+        latency_ms.push_back(ms);
+        outcomes[outcome]++;
+    }
+
+    void merge(const EndpointStats &other) {
+        latency_ms.insert(latency_ms.end(), other.latency_ms.begin(), other.latency_ms.end());
+        for (const auto &kv : other.outcomes) {
+            outcomes[kv.first] += kv.second;
+        }
+    }
+};
+
+using Stats = std::map<std::string, EndpointStats>;
+
+/* Counter mode state shared by all virtual users, learned from 409 answers */
+std::atomic<uint32_t> shared_epoch{0};
+std::atomic<uint64_t> shared_counter{1};
+
+double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+std::string outcome_of(const HttpResult &r) {
+    return r.error == HttpResult::Error::None ? std::to_string(r.status) : http_error_name(r.error);
+}
+
+std::string corrupt(std::string token) {
+    token[0] = token[0] == '0' ? '1' : '0';
+    return token;
+}
+
+/**
+ * @brief Times one request and records it under its endpoint name.
+ */
+HttpResult timed_request(HttpClient &client, Stats &stats, const std::string &name, const std::string &method,
+                         const std::string &path, const std::string &body = "") {
+    auto start = Clock::now();
+    HttpResult r = client.request(method, path, body);
+    stats[name].add(ms_since(start), outcome_of(r));
+    return r;
+}
+
+/**
+ * @brief GET /challenge + POST /response. Returns the flow outcome.
+ */
+std::string challenge_flow(HttpClient &client, Stats &stats, const Options &opt, bool bad, std::mt19937 &rng) {
+    HttpResult c = timed_request(client, stats, "GET /challenge", "GET", "/challenge");
+    if (c.error != HttpResult::Error::None || c.status != 200) {
+        return "challenge_failed";
+    }
+    std::string key = opt.psk;
+    std::string path = "/response?nonce=" + c.body;
+    if (opt.creds > 0) {
+        // Same naming as gen_creds.py --synthetic
+        char id[24];
+        std::snprintf(id, sizeof(id), "phone-%05u", static_cast<unsigned>(rng() % opt.creds));
+        key = std::string("secret-") + id;
+        path += std::string("&id=") + id;
+    }
+    std::string token = hmac_sha256_hex(key, c.body);
+    HttpResult r = timed_request(client, stats, "POST /response", "POST", path, bad ? corrupt(token) : token);
+    if (r.error != HttpResult::Error::None) {
+        return "error";
+    }
+    return r.status == 200 ? "unlocked" : r.status == 429 ? "rate_limited" : "rejected";
+}
+
+/**
+ * @brief POST /unlock with the next shared counter, resynchronizing once on 409.
+ */
+std::string counter_flow(HttpClient &client, Stats &stats, const Options &opt, bool bad) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        uint32_t epoch = shared_epoch.load();
+        uint64_t counter = shared_counter.fetch_add(1);
+        std::string message = std::to_string(epoch) + ":" + std::to_string(counter);
+        std::string token = hmac_sha256_hex(opt.psk, message);
+        HttpResult r = timed_request(client, stats, "POST /unlock", "POST", "/unlock",
+                                     std::to_string(epoch) + " " + std::to_string(counter) + " " +
+                                         (bad ? corrupt(token) : token));
+        if (r.error != HttpResult::Error::None) {
+            return "error";
+        }
+        if (r.status != 409) {
+            return r.status == 200 ? "unlocked" : r.status == 429 ? "rate_limited" : "rejected";
+        }
+        unsigned long new_epoch = 0, next = 0;
+        if (std::sscanf(r.body.c_str(), "%lu %lu", &new_epoch, &next) == 2) {
+            shared_epoch.store(static_cast<uint32_t>(new_epoch));
+            uint64_t cur = shared_counter.load();
+            while (cur < next && !shared_counter.compare_exchange_weak(cur, next)) {
+            }
+        }
+    }
+    return "resync_failed";
+}
+
+/**
+ * @brief One virtual user: flows in a loop until the deadline.
+ */
+void virtual_user(const Options &opt, Clock::time_point deadline, unsigned seed, Stats &stats,
+                  unsigned &connections) {
+    HttpClient client(opt.host, opt.port, opt.timeout_ms, opt.source);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    while (Clock::now() < deadline) {
+        bool bad = uniform(rng) < opt.bad_ratio;
+        auto start = Clock::now();
+        std::string outcome = opt.mode == "counter" ? counter_flow(client, stats, opt, bad)
+                                                    : challenge_flow(client, stats, opt, bad, rng);
+        stats[bad ? "flow (bad token)" : "flow"].add(ms_since(start), outcome);
+
+        if (opt.think_ms > 0) {
+            double pause = opt.think_ms * (0.5 + uniform(rng));
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(pause));
+        }
+    }
+    connections = client.connections();
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+std::string json_escape(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(c);
+    }
+    return out;
+}
+
+std::string report(const Options &opt, const Stats &stats, double elapsed_s, unsigned connections) {
+    std::ostringstream o;
+    o.setf(std::ios::fixed);
+    o.precision(2);
+    o << "{\n"
+      << "  \"target\": \"http://" << json_escape(opt.host) << ":" << opt.port << "\",\n"
+      << "  \"source\": \"" << json_escape(opt.source) << "\",\n"
+      << "  \"mode\": \"" << json_escape(opt.mode) << "\",\n"
+      << "  \"credentials\": " << opt.creds << ",\n"
+      << "  \"concurrency\": " << opt.concurrency << ",\n"
+      << "  \"think_ms\": " << opt.think_ms << ",\n"
+      << "  \"bad_ratio\": " << opt.bad_ratio << ",\n"
+      << "  \"duration_s\": " << elapsed_s << ",\n"
+      << "  \"tcp_connections\": " << connections << ",\n"
+      << "  \"endpoints\": {";
+    bool first = true;
+    for (const auto &kv : stats) {
+        std::vector<double> lat = kv.second.latency_ms;
+        std::sort(lat.begin(), lat.end());
+        o << (first ? "\n" : ",\n") << "    \"" << json_escape(kv.first) << "\": {\n"
+          << "      \"count\": " << lat.size() << ",\n"
+          << "      \"throughput_per_s\": " << lat.size() / elapsed_s << ",\n"
+          << "      \"latency_ms\": {\"p50\": " << percentile(lat, 0.50) << ", \"p95\": " << percentile(lat, 0.95)
+          << ", \"p99\": " << percentile(lat, 0.99) << ", \"max\": " << (lat.empty() ? 0 : lat.back()) << "},\n"
+          << "      \"outcomes\": {";
+        bool first_outcome = true;
+        for (const auto &oc : kv.second.outcomes) {
+            o << (first_outcome ? "" : ", ") << "\"" << json_escape(oc.first) << "\": " << oc.second;
+            first_outcome = false;
+        }
+        o << "}\n    }";
+        first = false;
+    }
+    o << "\n  }\n}\n";
+    return o.str();
+}
+
+[[noreturn]] void usage(const char *argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [-c concurrency] [-d seconds] [-t think_ms] [-b bad_ratio] [-k psk]\n"
+                 "          [-m challenge|counter] [--creds n] [--timeout-ms ms] [--source addr] [-o report.json]\n"
+                 "          http://host[:port]\n",
+                 argv0);
+    std::exit(2);
+}
+
+Options parse_args(int argc, char **argv) {
+    Options opt;
+    std::string url;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+            }
+            return argv[++i];
+        };
+        if (a == "-c" || a == "--concurrency") {
+            opt.concurrency = std::atoi(value().c_str());
+        } else if (a == "-d" || a == "--duration") {
+            opt.duration_s = std::atof(value().c_str());
+        } else if (a == "-t" || a == "--think-ms") {
+            opt.think_ms = std::atof(value().c_str());
+        } else if (a == "-b" || a == "--bad-ratio") {
+            opt.bad_ratio = std::atof(value().c_str());
+        } else if (a == "-k" || a == "--psk") {
+            opt.psk = value();
+        } else if (a == "-m" || a == "--mode") {
+            opt.mode = value();
+        } else if (a == "--creds") {
+            opt.creds = std::atoi(value().c_str());
+        } else if (a == "--timeout-ms") {
+            opt.timeout_ms = std::atoi(value().c_str());
+        } else if (a == "--source") {
+            opt.source = value();
+        } else if (a == "-o" || a == "--output") {
+            opt.output = value();
+        } else if (a == "-h" || a == "--help" || !url.empty()) {
+            usage(argv[0]);
+        } else {
+            url = a;
+        }
+    }
+    if (url.empty() || !parse_http_url(url, opt.host, opt.port) || opt.concurrency < 1 || opt.duration_s <= 0 ||
+        opt.bad_ratio < 0 || opt.bad_ratio > 1 || opt.timeout_ms < 1 ||
+        (opt.mode != "challenge" && opt.mode != "counter") || opt.creds < 0 || opt.creds > 100000 ||
+        (opt.creds > 0 && opt.mode != "challenge")) {
+        usage(argv[0]);
+    }
+    return opt;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt = parse_args(argc, argv);
+
+    std::vector<Stats> per_user(opt.concurrency);
+    std::vector<unsigned> connections(opt.concurrency);
+    std::vector<std::thread> users;
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.duration_s));
+    std::random_device seed;
+    for (int i = 0; i < opt.concurrency; i++) {
+        users.emplace_back(virtual_user, std::cref(opt), deadline, seed(), std::ref(per_user[i]),
+                           std::ref(connections[i]));
+    }
+    for (auto &t : users) {
+        t.join();
+    }
+    double elapsed_s = ms_since(start) / 1000.0;
+
+    Stats total;
+    unsigned total_connections = 0;
+    for (int i = 0; i < opt.concurrency; i++) {
+        for (const auto &kv : per_user[i]) {
+            total[kv.first].merge(kv.second);
+        }
+        total_connections += connections[i];
+    }
+
+    std::string json = report(opt, total, elapsed_s, total_connections);
+    if (opt.output.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream(opt.output) << json;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""
+Access policy, clock and settings administration for the lock firmware.
+
+Uploads an access policy (see main/access_policy.h for the format) with
+PUT /policy, and/or sets the lock's wall clock to this machine's time with
+PUT /clock. All requests are authenticated with the pre-shared key. The lock
+has no battery-backed clock, so --set-clock is needed after every restart
+before credentials with a time-restricted schedule are accepted.
+
+    tools/lock_policy.py http://192.168.4.1 --policy site.policy --set-clock
+    tools/lock_policy.py http://192.168.4.1 --set-clock
+
+A policy file is checked by the lock itself; a syntax error is reported with
+its line number and leaves the active policy in place.
+
+--config changes settings (see main/config_store.h) with PUT /config; they
+take effect without a reboot and are kept across reboots. --show-config
+prints them, without the secrets. A new SSID or access point password
+disconnects this machine, and a new psk is the one to give with --psk from
+then on.
+
+    tools/lock_policy.py http://192.168.4.1 --config bad_token_ms=2000 --config led_gpio=38
+    tools/lock_policy.py http://192.168.4.1 --config psk=s3cret --show-config
+"""
+
+import argparse
+import hashlib
+import hmac
+import sys
+import time
+import urllib.error
+import urllib.request
+
+
+def request(url: str, psk: str, method: str, path: str, body: bytes = None) -> str:
+    """Authenticates with a fresh challenge and sends the request to path."""
+    url = url.rstrip('/')
+    with urllib.request.urlopen(url + '/challenge') as r:
+        nonce = r.read().decode()
+    token = hmac.new(psk.encode(), nonce.encode(), hashlib.sha256).hexdigest()
+    req = urllib.request.Request(url + path, data=body, method=method, headers={
+        'X-Nonce': nonce,
+        'X-Auth': token,
+        'Content-Type': 'text/plain',
+    })
+    with urllib.request.urlopen(req) as r:
+        return r.read().decode()
+
+
+def put(url: str, psk: str, path: str, body: bytes) -> str:
+    """Authenticates with a fresh challenge and PUTs body to path."""
+    return request(url, psk, 'PUT', path, body)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('url', help='address of the lock, e.g. http://192.168.4.1')
+    parser.add_argument('--policy', help='policy file to upload')
+    parser.add_argument('--set-clock', action='store_true', help="set the lock's clock to this machine's time")
+    parser.add_argument('--config', action='append', default=[], metavar='KEY=VALUE',
+                        help='change a setting, may be repeated')
+    parser.add_argument('--show-config', action='store_true', help='print the settings')
+    parser.add_argument('--psk', default='DEFAULT_KEY', help='pre-shared key authenticating the requests')
+    args = parser.parse_args()
+    if not args.policy and not args.set_clock and not args.config and not args.show_config:
+        parser.error('nothing to do, give --policy, --set-clock, --config and/or --show-config')
+    for setting in args.config:
+        if '=' not in setting or '\n' in setting:
+            parser.error('--config expects KEY=VALUE, got {!r}'.format(setting))
+
+    try:
+        if args.set_clock:
+            print('lock_policy: {}'.format(put(args.url, args.psk, '/clock', str(int(time.time())).encode())))
+        if args.policy:
+            with open(args.policy, 'rb') as f:
+                print('lock_policy: {}'.format(put(args.url, args.psk, '/policy', f.read())))
+        if args.config:
+            body = ''.join(setting + '\n' for setting in args.config).encode()
+            print('lock_policy: {}'.format(put(args.url, args.psk, '/config', body)))
+            # Later requests in this run are checked against the new key
+            for setting in args.config:
+                if setting.startswith('psk='):
+                    args.psk = setting[len('psk='):]
+        if args.show_config:
+            print(request(args.url, args.psk, 'GET', '/config'), end='')
+    except urllib.error.HTTPError as e:
+        print('lock_policy: {} {}'.format(e.code, e.read().decode(errors='replace')), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,73 @@
+#!/usr/bin/env bash
+#
+# 📝 Compares the challenge issue and response verify stages with and without
+#    the background log output (CONFIG_LOCK_LOG_OFFLOAD).
+#
+# For each setting the script builds the board firmware (one build directory
+# each, so reruns are incremental), flashes it to the board on $ESPPORT,
+# waits until the lock answers at URL and drives DURATION seconds of
+# challenge-response unlocks. It then reads the firmware's own timing of the
+# challenge/issue and response/verify stages from /metrics (mean and p99)
+# next to the /response latency seen by lock_loadgen. Both stages log a line
+# per request, so without the offload they include the time spent waiting for
+# the console. The host must be on the lock's access point.
+#
+#     ESPPORT=/dev/ttyUSB0 tools/log_offload_bench.sh http://192.168.4.1
+#     OFFLOAD=y DURATION=60 ESPPORT=/dev/ttyACM0 tools/log_offload_bench.sh http://192.168.4.1
+#
+# Keep a serial monitor closed while it runs: the console is what is being
+# measured, and the UART keeps draining it either way. Both builds lift the
+# per-client rate limit, since all virtual users share one address.
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+URL="${1:?usage: ESPPORT=/dev/ttyX $0 http://host[:port]}"
+ESPPORT="${ESPPORT:?set ESPPORT to the serial port of the board}"
+OFFLOAD="${OFFLOAD:-n y}"
+DURATION="${DURATION:-20}"
+CONCURRENCY="${CONCURRENCY:-4}"
+LOADGEN="${LOADGEN:-$ROOT/build-loadgen/lock_loadgen}"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+# Prints "<mean µs> <p99 µs>" of a stage, as the firmware timed it since boot
+stage_us() {
+    awk -v series="endpoint=\"$1\",stage=\"$2\"" '
+        index($0, "lock_request_stage_seconds_sum{" series "}") == 1 { sum = $2 }
+        index($0, "lock_request_stage_seconds_count{" series "}") == 1 { count = $2 }
+        index($0, "lock_request_stage_quantile_seconds{" series ",quantile=\"0.99\"}") == 1 { p99 = $2 }
+        END { printf "%.1f %.1f\n", count ? sum / count * 1e6 : 0, p99 * 1e6 }' "$WORK/metrics.txt"
+}
+
+printf '%8s %10s %10s %10s %10s %8s %14s %14s\n' offload issue_us issue_p99 verify_us verify_p99 dropped \
+    response_p50 response_p99
+for offload in $OFFLOAD; do
+    build="$ROOT/build-logoffload-$offload"
+    mkdir -p "$build"
+    {
+        [[ "$offload" == y ]] && echo "CONFIG_LOCK_LOG_OFFLOAD=y" || echo "# CONFIG_LOCK_LOG_OFFLOAD is not set"
+        echo "CONFIG_LOCK_AUTH_RATE_LIMIT_PER_SEC=1000"
+        echo "CONFIG_LOCK_AUTH_RATE_LIMIT_BURST=1000"
+    } >"$build/sdkconfig.logoffload"
+    idf.py -C "$ROOT" -B "$build" -p "$ESPPORT" \
+        -D SDKCONFIG="$build/sdkconfig" \
+        -D SDKCONFIG_DEFAULTS="sdkconfig.defaults.esp32s3;$build/sdkconfig.logoffload" \
+        set-target esp32s3 build flash >"$WORK/build.log" 2>&1 || { cat "$WORK/build.log"; exit 1; }
+
+    # The board resets after flashing; give the host time to rejoin the AP
+    for _ in $(seq 300); do
+        curl -sf -m 1 "$URL/challenge" >/dev/null && break
+        sleep 0.2
+    done
+
+    "$LOADGEN" -c "$CONCURRENCY" -d "$DURATION" -o "$WORK/report.json" "$URL" >/dev/null
+    curl -sf "$URL/metrics" >"$WORK/metrics.txt"
+    read -r issue_us issue_p99 < <(stage_us challenge issue)
+    read -r verify_us verify_p99 < <(stage_us response verify)
+    dropped="$(awk '/^lock_log_dropped_total / { print $2 }' "$WORK/metrics.txt")"
+    read -r p50 p99 < <(python3 -c 'import json, sys
+resp = json.load(open(sys.argv[1]))["endpoints"].get("POST /response", {"latency_ms": {"p50": 0, "p99": 0}})
+print(resp["latency_ms"]["p50"], resp["latency_ms"]["p99"])' "$WORK/report.json")
+    printf '%8s %10s %10s %10s %10s %8s %14.2f %14.2f\n' "$offload" "$issue_us" "$issue_p99" "$verify_us" \
+        "$verify_p99" "${dropped:--}" "$p50" "$p99"
+done
@@ -0,0 +1,77 @@
+#!/usr/bin/env bash
+#
+# 🗄️ Compares internal heap headroom and unlock latency with and without the
+#    PSRAM placement of cold buffers (CONFIG_LOCK_PSRAM_PLACEMENT).
+#
+# For each setting the script builds the board firmware (one build directory
+# each, so reruns are incremental), flashes it to the N16R8 board on $ESPPORT,
+# waits until the lock answers at URL and then reads the internal heap
+# gauges (lock_heap_*{region="internal"} at /metrics) right after boot and
+# after DURATION seconds of challenge-response unlocks. The host must be on
+# the lock's access point.
+#
+#     ESPPORT=/dev/ttyUSB0 tools/psram_bench.sh http://192.168.4.1
+#     PLACEMENTS=y DURATION=60 ESPPORT=/dev/ttyACM0 tools/psram_bench.sh http://192.168.4.1
+#
+# Both builds lift the per-client rate limit, since all virtual users share
+# one address.
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+URL="${1:?usage: ESPPORT=/dev/ttyX $0 http://host[:port]}"
+ESPPORT="${ESPPORT:?set ESPPORT to the serial port of the board}"
+PLACEMENTS="${PLACEMENTS:-n y}"
+DURATION="${DURATION:-20}"
+CONCURRENCY="${CONCURRENCY:-4}"
+LOADGEN="${LOADGEN:-$ROOT/build-loadgen/lock_loadgen}"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+# Prints "<free> <minimum_free> <largest_block>" of the internal heap
+internal_heap() {
+    curl -sf "$URL/metrics" | awk '
+        /^lock_heap_free_bytes\{region="internal"\}/ { free = $2 }
+        /^lock_heap_minimum_free_bytes\{region="internal"\}/ { min = $2 }
+        /^lock_heap_largest_free_block_bytes\{region="internal"\}/ { largest = $2 }
+        END { print free + 0, min + 0, largest + 0 }'
+}
+
+# Prints the firmware's mean time of the /response verify stage, in µs
+verify_mean_us() {
+    curl -sf "$URL/metrics" | awk '
+        /^lock_request_stage_seconds_sum\{endpoint="response",stage="verify"\}/ { sum = $2 }
+        /^lock_request_stage_seconds_count\{endpoint="response",stage="verify"\}/ { count = $2 }
+        END { printf "%.1f\n", count ? sum / count * 1e6 : 0 }'
+}
+
+printf '%9s %12s %12s %12s %12s %12s %14s %14s\n' placement boot_free load_free load_min largest \
+    verify_us response_p50 response_p99
+for placement in $PLACEMENTS; do
+    build="$ROOT/build-psram-$placement"
+    mkdir -p "$build"
+    {
+        [[ "$placement" == y ]] && echo "CONFIG_LOCK_PSRAM_PLACEMENT=y" || echo "# CONFIG_LOCK_PSRAM_PLACEMENT is not set"
+        echo "CONFIG_LOCK_AUTH_RATE_LIMIT_PER_SEC=1000"
+        echo "CONFIG_LOCK_AUTH_RATE_LIMIT_BURST=1000"
+    } >"$build/sdkconfig.psram"
+    idf.py -C "$ROOT" -B "$build" -p "$ESPPORT" \
+        -D SDKCONFIG="$build/sdkconfig" \
+        -D SDKCONFIG_DEFAULTS="sdkconfig.defaults.esp32s3;$build/sdkconfig.psram" \
+        set-target esp32s3 build flash >"$WORK/build.log" 2>&1 || { cat "$WORK/build.log"; exit 1; }
+
+    # The board resets after flashing; give the host time to rejoin the AP
+    for _ in $(seq 300); do
+        curl -sf -m 1 "$URL/challenge" >/dev/null && break
+        sleep 0.2
+    done
+    read -r boot_free _ _ < <(internal_heap)
+
+    "$LOADGEN" -c "$CONCURRENCY" -d "$DURATION" -o "$WORK/report.json" "$URL" >/dev/null
+    read -r load_free load_min largest < <(internal_heap)
+    verify_us="$(verify_mean_us)"
+    read -r p50 p99 < <(python3 -c 'import json, sys
+resp = json.load(open(sys.argv[1]))["endpoints"].get("POST /response", {"latency_ms": {"p50": 0, "p99": 0}})
+print(resp["latency_ms"]["p50"], resp["latency_ms"]["p99"])' "$WORK/report.json")
+    printf '%9s %12s %12s %12s %12s %12s %14.2f %14.2f\n' "$placement" "$boot_free" "$load_free" "$load_min" \
+        "$largest" "$verify_us" "$p50" "$p99"
+done
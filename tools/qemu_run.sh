@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+#
+# 🖥️ Builds the ESP32-S3 firmware with the QEMU network configuration and boots
+# it in qemu-system-xtensa (Espressif fork, installed with
+# `python $IDF_PATH/tools/idf_tools.py install qemu-xtensa`).
+#
+# The emulated open-ethernet NIC sits behind QEMU's user-mode network, and
+# host port $PORT (default 8080) is forwarded to the HTTP server on port 80:
+#
+#     tools/qemu_run.sh                 # build + run
+#     PORT=9000 tools/qemu_run.sh       # different host port
+#     tools/qemu_run.sh --no-build      # run the last build
+#     tools/qemu_run.sh --build-only    # build the flash image, do not run
+#
+# Then e.g. loadgen -c 8 -d 30 http://localhost:8080 (see tools/loadgen)
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD_DIR="${BUILD_DIR:-$ROOT/build-qemu}"
+PORT="${PORT:-8080}"
+FLASH_IMAGE="$BUILD_DIR/qemu_flash.bin"
+
+if [[ "${1:-}" != "--no-build" ]]; then
+    # Separate build dir and sdkconfig, so the board build is left alone
+    idf.py -C "$ROOT" -B "$BUILD_DIR" \
+        -D SDKCONFIG="$BUILD_DIR/sdkconfig" \
+        -D SDKCONFIG_DEFAULTS="sdkconfig.defaults.esp32s3;sdkconfig.defaults.qemu" \
+        set-target esp32s3 build
+
+    # QEMU boots from a full-size flash image: bootloader, partition table, app and assets
+    (cd "$BUILD_DIR" && esptool.py --chip esp32s3 merge_bin --fill-flash-size 16MB \
+        -o "$FLASH_IMAGE" @flash_args)
+fi
+[[ "${1:-}" == "--build-only" ]] && exit 0
+
+echo "🌐 Firmware will be reachable at http://localhost:$PORT/ (Ctrl-A X quits QEMU)"
+exec qemu-system-xtensa -nographic -machine esp32s3 \
+    -drive file="$FLASH_IMAGE",if=mtd,format=raw \
+    -nic user,model=open_eth,hostfwd=tcp::"$PORT"-:80
@@ -0,0 +1,73 @@
+#!/usr/bin/env bash
+#
+# 💾 Measures NVS writes per 1000 lock state changes against the write-back delay.
+#
+# For every delay W (ms) the script builds the linux target with
+# CONFIG_LOCK_STATE_WRITEBACK_MS=W (one build directory each), starts it and
+# drives challenge-response flows with a share of bad responses, so the lock
+# keeps going green, blue and red. It waits one more write-back period, then
+# reads lock_state_changes_total and lock_state_nvs_writes_total from
+# /metrics, and the time the state took to restore at startup (boot phase
+# "state"). W=0 is the baseline with one write per change.
+#
+#     tools/state_bench.sh                          # WRITEBACKS="0 1000 5000"
+#     WRITEBACKS="5000" BAD_RATIO=0.5 DURATION=60 tools/state_bench.sh
+#
+# On the board the same counters are at /metrics; the restore from RTC
+# memory only happens there, after a software or watchdog reset.
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+WRITEBACKS="${WRITEBACKS:-0 1000 5000}"
+DURATION="${DURATION:-10}"
+CONCURRENCY="${CONCURRENCY:-4}"
+BAD_RATIO="${BAD_RATIO:-0.3}"
+PORT="${PORT:-8080}"
+LOADGEN="${LOADGEN:-$ROOT/build-loadgen/lock_loadgen}"
+WORK="$(mktemp -d)"
+FIRMWARE_PID=""
+trap '[[ -n "$FIRMWARE_PID" ]] && kill "$FIRMWARE_PID" 2>/dev/null; rm -rf "$WORK"' EXIT
+
+# Prints "<changes> <nvs_writes> <restore_ms> <source>"
+state_totals() {
+    curl -sf "http://localhost:$PORT/metrics" | awk '
+        /^lock_state_changes_total / { changes = $2 }
+        /^lock_state_nvs_writes_total / { writes = $2 }
+        /^lock_boot_phase_duration_seconds\{phase="state"\}/ { restore = $2 * 1000 }
+        /^lock_state_restored_info/ { match($0, /source="[a-z]+"/); source = substr($0, RSTART + 8, RLENGTH - 9) }
+        END { printf "%d %d %.3f %s\n", changes, writes, restore, source }'
+}
+
+printf '%12s %10s %12s %16s %12s %8s\n' writeback_ms changes nvs_writes writes_per_1000 restore_ms source
+for w in $WRITEBACKS; do
+    build="$ROOT/build-state$w"
+    mkdir -p "$build"
+    printf 'CONFIG_LOCK_STATE_WRITEBACK_MS=%d\n' "$w" > "$build/sdkconfig.state"
+    idf.py -C "$ROOT" -B "$build" \
+        -D SDKCONFIG="$build/sdkconfig" \
+        -D SDKCONFIG_DEFAULTS="sdkconfig.defaults.linux;$build/sdkconfig.state" \
+        --preview set-target linux build >"$WORK/build.log" 2>&1 || { cat "$WORK/build.log"; exit 1; }
+
+    "$build/my_lock_project.elf" >"$WORK/firmware.log" 2>&1 &
+    FIRMWARE_PID=$!
+    for _ in $(seq 50); do
+        curl -sf "http://localhost:$PORT/challenge" >/dev/null && break
+        sleep 0.1
+    done
+
+    # The boot itself is one change; let its write-back pass before counting
+    sleep "$(( w / 1000 + 1 ))"
+    read -r changes0 writes0 restore_ms source < <(state_totals)
+    "$LOADGEN" -c "$CONCURRENCY" -d "$DURATION" -b "$BAD_RATIO" -o "$WORK/report.json" \
+        "http://localhost:$PORT" >/dev/null
+    sleep "$(( w / 1000 + 1 ))"
+    read -r changes1 writes1 _ _ < <(state_totals)
+    kill "$FIRMWARE_PID"
+    wait "$FIRMWARE_PID" 2>/dev/null || true
+    FIRMWARE_PID=""
+
+    changes=$((changes1 - changes0))
+    writes=$((writes1 - writes0))
+    printf '%12s %10s %12s %16s %12s %8s\n' "$w" "$changes" "$writes" \
+        "$(( changes ? writes * 1000 / changes : 0 ))" "$restore_ms" "$source"
+done
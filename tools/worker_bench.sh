@@ -0,0 +1,58 @@
+#!/usr/bin/env bash
+#
+# 🧵 Measures unlock throughput against the number of HTTP worker tasks.
+#
+# For every worker count N the script builds the linux target with
+# CONFIG_LOCK_HTTP_WORKERS=N (one build directory each, so reruns are
+# incremental), starts it, drives challenge-response unlocks with
+# tools/loadgen and reports flows per second and the /response latency.
+# N=0 is the baseline with every handler on the HTTP server task.
+#
+#     tools/worker_bench.sh                        # WORKERS="0 1 2 4"
+#     WORKERS="1 4" CONCURRENCY=16 DURATION=30 tools/worker_bench.sh
+#
+# For the board, flash one build per worker count by hand and run
+# lock_loadgen against it; the numbers are comparable.
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+WORKERS="${WORKERS:-0 1 2 4}"
+DURATION="${DURATION:-10}"
+CONCURRENCY="${CONCURRENCY:-8}"
+PORT="${PORT:-8080}"
+LOADGEN="${LOADGEN:-$ROOT/build-loadgen/lock_loadgen}"
+WORK="$(mktemp -d)"
+FIRMWARE_PID=""
+trap '[[ -n "$FIRMWARE_PID" ]] && kill "$FIRMWARE_PID" 2>/dev/null; rm -rf "$WORK"' EXIT
+
+printf '%8s %12s %16s %16s\n' workers flows_per_s response_p50_ms response_p99_ms
+for n in $WORKERS; do
+    build="$ROOT/build-workers$n"
+    mkdir -p "$build"
+    printf 'CONFIG_LOCK_HTTP_WORKERS=%d\n' "$n" > "$build/sdkconfig.workers"
+    idf.py -C "$ROOT" -B "$build" \
+        -D SDKCONFIG="$build/sdkconfig" \
+        -D SDKCONFIG_DEFAULTS="sdkconfig.defaults.linux;$build/sdkconfig.workers" \
+        --preview set-target linux build >"$WORK/build.log" 2>&1 || { cat "$WORK/build.log"; exit 1; }
+
+    "$build/my_lock_project.elf" >"$WORK/firmware.log" 2>&1 &
+    FIRMWARE_PID=$!
+    for _ in $(seq 50); do
+        curl -sf "http://localhost:$PORT/challenge" >/dev/null && break
+        sleep 0.1
+    done
+
+    "$LOADGEN" -c "$CONCURRENCY" -d "$DURATION" -o "$WORK/report.json" "http://localhost:$PORT"
+    kill "$FIRMWARE_PID"
+    wait "$FIRMWARE_PID" 2>/dev/null || true
+    FIRMWARE_PID=""
+
+    python3 - "$WORK/report.json" "$n" <<'EOF'
+import json, sys
+report = json.load(open(sys.argv[1]))
+resp = report['endpoints'].get('POST /response', {'latency_ms': {'p50': 0, 'p99': 0}})
+flow = report['endpoints'].get('flow', {'throughput_per_s': 0})
+print('{:>8} {:>12.0f} {:>16.2f} {:>16.2f}'.format(
+    sys.argv[2], flow.get('throughput_per_s', 0), resp['latency_ms']['p50'], resp['latency_ms']['p99']))
+EOF
+done